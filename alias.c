@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "irtest.h"
+#include "util.h"
+
+//a value stored to or loaded from addr that is still what it holds
+struct aliasAvail {
+    int addr;
+    int value;
+};
+
+struct var* aliasOrigin(struct var* v) {
+    return v && v->origin ? v->origin : v;
+}
+
+//the ir knows no base of an addr, so addrs of the same var are the same memory, as for gvn
+bool aliasSameAddr(struct irFunc* f, int a, int b) {
+    if (a == b) return true;
+    struct irInstr* inA = IrGetInstr(f, a);
+    struct irInstr* inB = IrGetInstr(f, b);
+    return inA->op == IR_ADDR && inB->op == IR_ADDR && aliasOrigin(inA->var) == aliasOrigin(inB->var);
+}
+
+bool aliasIsAggregate(TypeId type) {
+    struct type* t = TypeGet(type);
+    return t->bType == BASETYPE_STRUCT || t->bType == BASETYPE_ARRAY;
+}
+
+//memory of different types only overlaps if a struct contains the other, so int32 arrays never alias float64 arrays
+bool aliasMayAlias(struct irFunc* f, int a, int b) {
+    if (aliasSameAddr(f, a, b)) return true;
+    struct irInstr* inA = IrGetInstr(f, a);
+    struct irInstr* inB = IrGetInstr(f, b);
+    if (inA->op == IR_ALLOCA && inB->op == IR_ALLOCA) return false;
+    bool structs = TypeGet(inA->type)->bType == BASETYPE_STRUCT || TypeGet(inB->type)->bType == BASETYPE_STRUCT;
+    if (inA->type != inB->type && !structs) return false;
+    //slots are only reached through their own loads and stores, but members and elements of an aggregate var are addrs
+    if (inA->op == IR_ALLOCA) return aliasIsAggregate(inA->type);
+    if (inB->op == IR_ALLOCA) return aliasIsAggregate(inB->type);
+    return true;
+}
+
+//a param that is not mut cannot be modified through that name, so a call only modifies a slot passed as a mut arg
+bool aliasCallMayModify(struct irFunc* f, int call, int addr) {
+    struct irInstr* in = IrGetInstr(f, call);
+    if (!in->var || IrGetInstr(f, addr)->op != IR_ALLOCA) return true;
+    for (int i = 0; i < in->args.len; i++) {
+        struct irInstr* arg = IrGetInstr(f, IrGetArg(f, call, i));
+        if (arg->op != IR_LOAD || !aliasMayAlias(f, IrGetArg(f, IrGetArg(f, call, i), 0), addr)) continue;
+        if (i >= in->var->type.vars.len || ((struct var*)ListGetIdx(&in->var->type.vars, i))->mut) return true;
+    }
+    return false;
+}
+
+void aliasKill(struct irFunc* f, struct list* avail, int addr, int call) {
+    int kept = 0;
+    for (int i = 0; i < avail->len; i++) {
+        struct aliasAvail a = *(struct aliasAvail*)ListGetIdx(avail, i);
+        bool killed = call != IR_NONE ? aliasCallMayModify(f, call, a.addr) : aliasMayAlias(f, a.addr, addr);
+        if (!killed) *(struct aliasAvail*)ListGetIdx(avail, kept++) = a;
+    }
+    ListRetract(avail, kept);
+}
+
+//a block with a single pred starts from what was available at the end of it, which is its idom and visited before
+bool aliasForwardBlock(struct irFunc* f, int block, struct list* avail) {
+    bool changed = false;
+    struct list* instrs = &IrGetBlock(f, block)->instrs;
+    for (int i = 0; i < instrs->len; i++) {
+        int instr = *(int*)ListGetIdx(instrs, i);
+        struct irInstr* in = IrGetInstr(f, instr);
+        if (in->op == IR_CALL) aliasKill(f, avail, IR_NONE, instr);
+        if (in->op != IR_LOAD && in->op != IR_STORE) continue;
+        struct aliasAvail a = {IrGetArg(f, instr, 0), in->op == IR_LOAD ? instr : IrGetArg(f, instr, 1)};
+        if (in->op == IR_STORE) aliasKill(f, avail, a.addr, IR_NONE);
+        int found = IR_NONE;
+        for (int j = 0; j < avail->len && in->op == IR_LOAD && found == IR_NONE; j++) {
+            struct aliasAvail* e = ListGetIdx(avail, j);
+            if (aliasSameAddr(f, e->addr, a.addr) && IrGetInstr(f, e->value)->type == in->type) found = e->value;
+        }
+        if (found == IR_NONE) {
+            ListAdd(avail, &a);
+            continue;
+        }
+        IrReplaceUses(f, instr, found);
+        IrRemoveInstr(f, instr);
+        i--;
+        changed = true;
+    }
+    return changed;
+}
+
+bool OptForwardMemory(struct irFunc* f) {
+    struct list idoms = IrDominators(f);
+    struct list order = IrDomTreeOrder(f, &idoms);
+    struct list* availAtEnd = MallocOrCrash(f->blocks.len * sizeof(struct list) +1);
+    for (int b = 0; b < f->blocks.len; b++) availAtEnd[b] = ListInit(sizeof(struct aliasAvail));
+    bool changed = false;
+    for (int i = 0; i < order.len; i++) {
+        int block = *(int*)ListGetIdx(&order, i);
+        struct list* preds = &IrGetBlock(f, block)->preds;
+        if (preds->len == 1) ListAddList(&availAtEnd[block], availAtEnd[*(int*)ListGetIdx(preds, 0)]);
+        changed |= aliasForwardBlock(f, block, &availAtEnd[block]);
+    }
+    for (int b = 0; b < f->blocks.len; b++) ListDestroy(availAtEnd[b]);
+    free(availAtEnd);
+    ListDestroy(order);
+    ListDestroy(idoms);
+    return changed;
+}
+
+//g = 1; h = 2 with h an int64; a = g; call(); b = g; return a + b. a is the stored 1, b is loaded again after the call
+TEST(OptForwardTypes) {
+    TypeId i32 = TypeVanillaId(BASETYPE_INT32);
+    struct var g = (struct var){0};
+    g.type = TypeVanilla(BASETYPE_INT32);
+    struct var h = (struct var){0};
+    h.type = TypeVanilla(BASETYPE_INT64);
+    struct var callee;
+    struct var func;
+    IrTestFunc(&callee, "callee", NULL, NULL, 0);
+    struct irFunc* f = IrTestFunc(&func, "globals", &g.type, NULL, 0);
+    struct var* vars[2] = {&g, &h};
+    int addrs[2];
+    for (int i = 0; i < 2; i++) {
+        addrs[i] = IrAddInstr(f, 0, IR_ADDR, vars[i]->type.id);
+        IrGetInstr(f, addrs[i])->var = vars[i];
+        int val = IrAddInstr(f, 0, IR_CONST, vars[i]->type.id);
+        IrGetInstr(f, val)->val = i + 1;
+        int store = IrAddInstr(f, 0, IR_STORE, TYPE_ID_NONE);
+        IrAddArg(f, store, addrs[i]);
+        IrAddArg(f, store, val);
+    }
+    int loads[2];
+    for (int i = 0; i < 2; i++) {
+        if (i) IrGetInstr(f, IrAddInstr(f, 0, IR_CALL, TYPE_ID_NONE))->var = &callee;
+        loads[i] = IrAddInstr(f, 0, IR_LOAD, i32);
+        IrAddArg(f, loads[i], addrs[0]);
+    }
+    int sum = IrAddInstr(f, 0, IR_OPERATION, i32);
+    IrGetInstr(f, sum)->opType = OPERATION_ADD;
+    IrAddArg(f, sum, loads[0]);
+    IrAddArg(f, sum, loads[1]);
+    IrAddArg(f, IrAddInstr(f, 0, IR_RET, TYPE_ID_NONE), sum);
+
+    bool passed = IrTestPassConverges(f, OptForwardMemory);
+    passed = passed && IrGetInstr(f, loads[0])->block == IR_NONE && IrGetInstr(f, loads[1])->block == 0;
+    passed = passed && IrGetInstr(f, IrGetArg(f, sum, 0))->op == IR_CONST && !aliasMayAlias(f, addrs[0], addrs[1]);
+    IrTestFuncDestroy(&callee);
+    IrTestFuncDestroy(&func);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
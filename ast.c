@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ast.h"
+#include "util.h"
+#include "list.h"
+#include "hashmap.h"
+
+struct astVarIdx {
+    struct var* origin;
+    int idx;
+};
+
+struct astLiteralIdx {
+    long long val;
+    int idx;
+};
+
+//the args of an operand are shared as a whole, so a block is keyed by all of its opnds
+struct astOpndsIdx {
+    int idx;
+    int n;
+};
+
+struct astOpndsKey {
+    struct astFunc* af;
+    struct astOpnd* opnds;
+    int n;
+};
+
+struct astFunc* AstFuncNew() {
+    struct astFunc* af = MallocOrCrash(sizeof(struct astFunc));
+    *af = (struct astFunc){0};
+    af->body = AST_NONE;
+    af->stmts = ListInit(sizeof(struct astStmt));
+    af->opnds = ListInit(sizeof(struct astOpnd));
+    af->vars = ListInit(sizeof(struct var));
+    af->literals = ListInit(sizeof(long long));
+    af->toks = ListInit(sizeof(struct token));
+    af->varIdxs = HashMapInit(sizeof(struct astVarIdx));
+    af->literalIdxs = HashMapInit(sizeof(struct astLiteralIdx));
+    af->opndIdxs = HashMapInit(sizeof(struct astOpndsIdx));
+    return af;
+}
+
+void AstDestroy(struct astFunc* af) {
+    ListDestroy(af->stmts);
+    ListDestroy(af->opnds);
+    ListDestroy(af->vars);
+    ListDestroy(af->literals);
+    ListDestroy(af->toks);
+    HashMapDestroy(af->varIdxs);
+    HashMapDestroy(af->literalIdxs);
+    HashMapDestroy(af->opndIdxs);
+    free(af);
+}
+
+struct astStmt* AstGetStmt(struct astFunc* af, int idx) {
+    return ListGetIdx(&af->stmts, idx);
+}
+
+struct astOpnd* AstGetOpnd(struct astFunc* af, int idx) {
+    return ListGetIdx(&af->opnds, idx);
+}
+
+struct var* AstGetVar(struct astFunc* af, int idx) {
+    return ListGetIdx(&af->vars, idx);
+}
+
+long long AstGetLiteral(struct astFunc* af, int idx) {
+    return *(long long*)ListGetIdx(&af->literals, idx);
+}
+
+double AstGetFloatLiteral(struct astFunc* af, int idx) {
+    double f;
+    memcpy(&f, ListGetIdx(&af->literals, idx), sizeof(f));
+    return f;
+}
+
+struct token AstGetTok(struct astFunc* af, int idx) {
+    return *(struct token*)ListGetIdx(&af->toks, idx);
+}
+
+bool astVarIdxCmp(void* origin, void* elem) {
+    return ((struct astVarIdx*)elem)->origin == origin;
+}
+
+int AstAddVar(struct astFunc* af, struct var v) {
+    if (!v.origin) ErrorBugFound();
+    unsigned long long hash = HashBytes(HASH_SEED, &v.origin, sizeof(v.origin));
+    struct astVarIdx* found = HashMapGet(&af->varIdxs, hash, v.origin, astVarIdxCmp);
+    if (found) return found->idx;
+    ListAdd(&af->vars, &v);
+    struct astVarIdx entry = {v.origin, af->vars.len -1};
+    HashMapAdd(&af->varIdxs, hash, &entry);
+    return entry.idx;
+}
+
+bool astLiteralIdxCmp(void* val, void* elem) {
+    return ((struct astLiteralIdx*)elem)->val == *(long long*)val;
+}
+
+int AstAddLiteral(struct astFunc* af, long long val) {
+    unsigned long long hash = HashBytes(HASH_SEED, &val, sizeof(val));
+    struct astLiteralIdx* found = HashMapGet(&af->literalIdxs, hash, &val, astLiteralIdxCmp);
+    if (found) return found->idx;
+    ListAdd(&af->literals, &val);
+    struct astLiteralIdx entry = {val, af->literals.len -1};
+    HashMapAdd(&af->literalIdxs, hash, &entry);
+    return entry.idx;
+}
+
+int AstAddTok(struct astFunc* af, struct token tok) {
+    ListAdd(&af->toks, &tok);
+    return af->toks.len -1;
+}
+
+int astAddAll(struct list* l, void* elems, int n) {
+    if (n == 0) return AST_NONE;
+    int start = l->len;
+    for (int i = 0; i < n; i++) ListAdd(l, (char*)elems + i * l->elemSize);
+    return start;
+}
+
+int AstAddStmts(struct astFunc* af, struct astStmt* stmts, int n) {
+    return astAddAll(&af->stmts, stmts, n);
+}
+
+//calls may have side effects and string literals are told apart by their token
+bool astIsPure(struct astOpnd* o) {
+    if (o->opType == OPERATION_FUNCCALL) return false;
+    return !o->isLiteral || o->type == TYPE_ID_NONE || TypeGet(o->type)->bType != BASETYPE_ARRAY;
+}
+
+//the token is only kept for diagnostics, so it is left out
+bool astOpndIsSame(struct astOpnd* a, struct astOpnd* b) {
+    return a->opType == b->opType && a->type == b->type && a->args == b->args && a->nArgs == b->nArgs &&
+        a->val == b->val && a->isLiteral == b->isLiteral;
+}
+
+unsigned long long astOpndsHash(struct astOpnd* opnds, int n) {
+    unsigned long long hash = HASH_SEED;
+    for (int i = 0; i < n; i++) {
+        struct astOpnd* o = opnds + i;
+        int fields[] = {o->opType, o->type, o->args, o->nArgs, o->val, o->isLiteral};
+        hash = HashBytes(hash, fields, sizeof(fields));
+    }
+    return hash;
+}
+
+bool astOpndsIdxCmp(void* key, void* elem) {
+    struct astOpndsKey* k = key;
+    struct astOpndsIdx* e = elem;
+    if (k->n != e->n) return false;
+    for (int i = 0; i < k->n; i++) {
+        if (!astOpndIsSame(k->opnds + i, AstGetOpnd(k->af, e->idx + i))) return false;
+    }
+    return true;
+}
+
+//children are shared before their parents, so equal subexpressions end up with equal args indices all the way up
+int AstAddOpnds(struct astFunc* af, struct astOpnd* opnds, int n) {
+    if (n == 0) return AST_NONE;
+    for (int i = 0; i < n; i++) {
+        if (!astIsPure(opnds + i)) return astAddAll(&af->opnds, opnds, n);
+    }
+    unsigned long long hash = astOpndsHash(opnds, n);
+    struct astOpndsKey key = {af, opnds, n};
+    struct astOpndsIdx* found = HashMapGet(&af->opndIdxs, hash, &key, astOpndsIdxCmp);
+    if (found) return found->idx;
+    struct astOpndsIdx entry = {astAddAll(&af->opnds, opnds, n), n};
+    HashMapAdd(&af->opndIdxs, hash, &entry);
+    return entry.idx;
+}
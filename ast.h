@@ -0,0 +1,66 @@
+#ifndef AST_H
+#define AST_H
+
+#include "statement.h"
+#include "operation.h"
+#include "token.h"
+#include "type.h"
+#include "list.h"
+#include "var.h"
+#include "hashmap.h"
+
+#define AST_NONE -1 //for absent children, variables and literals
+
+//the statements of a code block and the args of an operand are contiguous,
+//so children are a start index and a count into the same array as the parent
+struct astStmt {
+    enum statementType sType;
+    int var; //index into vars
+    int op; //index into opnds
+    int block; //index into stmts of the first statement of the code block
+    int blockLen;
+};
+
+struct astOpnd {
+    enum operation opType;
+    TypeId type;
+    int args; //index into opnds of the first arg
+    int nArgs;
+    int val; //index into vars for OPERATION_READ_VAR and OPERATION_FUNCCALL, else into literals if isLiteral
+    int tok; //index into toks
+    bool isLiteral;
+};
+
+//one per function body, nodes are added bottom up and pure subexpressions that are built again are shared
+struct astFunc {
+    int body; //index into stmts of the first statement of the function body
+    int bodyLen;
+    struct list stmts; //struct astStmt
+    struct list opnds; //struct astOpnd
+    struct list vars; //struct var; each declaration is stored once
+    struct list literals; //long long; the bits of the double for float types
+    struct list toks; //struct token; only kept for diagnostics
+    struct hashMap varIdxs; //the index into vars of each origin
+    struct hashMap literalIdxs; //the index into literals of each value
+    struct hashMap opndIdxs; //the first index into opnds of each block of pure operands
+};
+
+struct astFunc* AstFuncNew();
+void AstDestroy(struct astFunc* af);
+
+//children are added before their parent, so the parent knows where they start
+int AstAddVar(struct astFunc* af, struct var v); //v must have an origin, returns the index of the copy already stored for it if there is one
+int AstAddLiteral(struct astFunc* af, long long val); //returns the index of the same value if it was added before
+int AstAddTok(struct astFunc* af, struct token tok);
+int AstAddStmts(struct astFunc* af, struct astStmt* stmts, int n); //adjacent, returns the index of the first or AST_NONE if n is 0
+//a block equal to one added before, but for its tokens, is shared if no opnd in it is a call or a string literal
+int AstAddOpnds(struct astFunc* af, struct astOpnd* opnds, int n);
+
+struct astStmt* AstGetStmt(struct astFunc* af, int idx);
+struct astOpnd* AstGetOpnd(struct astFunc* af, int idx);
+struct var* AstGetVar(struct astFunc* af, int idx);
+long long AstGetLiteral(struct astFunc* af, int idx);
+double AstGetFloatLiteral(struct astFunc* af, int idx);
+struct token AstGetTok(struct astFunc* af, int idx);
+
+#endif //AST_H
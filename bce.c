@@ -0,0 +1,434 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <limits.h>
+#include "opt.h"
+#include "irtest.h"
+#include "loop.h"
+#include "util.h"
+
+//a comparison known to hold on an edge, as lhs < rhs or lhs <= rhs
+struct bceCmp {
+    int lhs;
+    int rhs;
+    bool orEqual;
+};
+
+//a loop that runs while its induction variable phi, counting up, stays below bound
+struct bceLoopTest {
+    int phi;
+    int init;
+    long long step;
+    int bound;
+    bool orEqual;
+    int cond;
+    bool inLoopIfTrue;
+};
+
+char* bceKeptReasons[] = {
+    [OPT_CHECK_UNANALYZED] = "not analyzed",
+    [OPT_CHECK_NO_UPPER_BOUND] = "no test of the index against the length dominates it",
+    [OPT_CHECK_NO_LOWER_BOUND] = "the index may be negative",
+    [OPT_CHECK_LOOP_NOT_COUNTED] = "the index is not the counter of a loop exiting only through its test",
+    [OPT_CHECK_LOOP_CALLS] = "the loop calls functions, so failing before it would be visible",
+    [OPT_CHECK_LENGTH_VARIES] = "the length changes within the loop",
+    [OPT_CHECK_LOOP_STEP] = "the counter steps over indexes, so the last one it checks is not known",
+    [OPT_CHECK_LOOP_MAY_WRAP] = "the counter may wrap around before it reaches the bound",
+    [OPT_CHECK_HOISTED] = "hoisted, checks the whole range of a loop before it runs"
+};
+
+bool bceIsInt(TypeId type) {
+    if (type == TYPE_ID_NONE) return false;
+    enum baseType bType = TypeGet(type)->bType;
+    return bType == BASETYPE_BYTE || bType == BASETYPE_INT32 || bType == BASETYPE_INT64;
+}
+
+//casts to a wider integer keep the value, bytes being unsigned
+int bceStrip(struct irFunc* f, int value) {
+    struct irInstr* in = IrGetInstr(f, value);
+    while (in->op == IR_CAST) {
+        TypeId from = IrGetInstr(f, IrGetArg(f, value, 0))->type;
+        if (!bceIsInt(in->type) || !bceIsInt(from) || TypeGetSize(*TypeGet(in->type)) < TypeGetSize(*TypeGet(from))) break;
+        value = IrGetArg(f, value, 0);
+        in = IrGetInstr(f, value);
+    }
+    return value;
+}
+
+bool bceSame(struct irFunc* f, int a, int b) {
+    a = bceStrip(f, a);
+    b = bceStrip(f, b);
+    if (a == b) return true;
+    struct irInstr* inA = IrGetInstr(f, a);
+    struct irInstr* inB = IrGetInstr(f, b);
+    return inA->op == IR_LEN && inB->op == IR_LEN && bceSame(f, IrGetArg(f, a, 0), IrGetArg(f, b, 0));
+}
+
+bool bceConst(struct irFunc* f, int value, long long* c) {
+    struct irInstr* in = IrGetInstr(f, bceStrip(f, value));
+    if (in->op != IR_CONST || !bceIsInt(in->type)) return false;
+    *c = in->val;
+    return true;
+}
+
+//the false edge negates the comparison, greater than swaps the sides
+bool bceNormalize(struct irFunc* f, int cond, bool taken, struct bceCmp* cmp) {
+    struct irInstr* in = IrGetInstr(f, cond);
+    if (in->op != IR_OPERATION || in->args.len != 2) return false;
+    enum operation opType = in->opType;
+    if (!taken) {
+        switch (opType) {
+            case OPERATION_LESS_THAN: opType = OPERATION_GREATER_THAN_OR_EQUAL; break;
+            case OPERATION_LESS_THAN_OR_EQUAL: opType = OPERATION_GREATER_THAN; break;
+            case OPERATION_GREATER_THAN: opType = OPERATION_LESS_THAN_OR_EQUAL; break;
+            case OPERATION_GREATER_THAN_OR_EQUAL: opType = OPERATION_LESS_THAN; break;
+            default: return false;
+        }
+    }
+    int a = IrGetArg(f, cond, 0);
+    int b = IrGetArg(f, cond, 1);
+    switch (opType) {
+        case OPERATION_LESS_THAN: *cmp = (struct bceCmp){a, b, false}; return true;
+        case OPERATION_LESS_THAN_OR_EQUAL: *cmp = (struct bceCmp){a, b, true}; return true;
+        case OPERATION_GREATER_THAN: *cmp = (struct bceCmp){b, a, false}; return true;
+        case OPERATION_GREATER_THAN_OR_EQUAL: *cmp = (struct bceCmp){b, a, true}; return true;
+        default: return false;
+    }
+}
+
+//the comparison holds in block if its only pred branches there on it
+bool bceEdgeFact(struct irFunc* f, int block, struct bceCmp* cmp) {
+    struct irBlock* b = IrGetBlock(f, block);
+    if (b->preds.len != 1) return false;
+    struct irInstr* term = IrGetInstr(f, IrGetTerminator(f, *(int*)ListGetIdx(&b->preds, 0)));
+    if (term->op != IR_CONDBR || term->targets[0] == term->targets[1]) return false;
+    return bceNormalize(f, *(int*)ListGetIdx(&term->args, 0), term->targets[0] == block, cmp);
+}
+
+struct loop* bceHeaderLoop(struct list* loops, int block) {
+    for (int i = 0; i < loops->len; i++) {
+        struct loop* l = ListGetIdx(loops, i);
+        if (l->header == block) return l;
+    }
+    return NULL;
+}
+
+bool bceExitsOnlyAtHeader(struct irFunc* f, struct loop* l) {
+    for (int i = 0; i < l->blocks.len; i++) {
+        int b = *(int*)ListGetIdx(&l->blocks, i);
+        struct irInstr* term = IrGetInstr(f, IrGetTerminator(f, b));
+        for (int t = 0; t < 2 && b != l->header; t++) {
+            if (term->targets[t] != IR_NONE && !LoopContains(l, term->targets[t])) return false;
+        }
+        if (term->op == IR_RET || term->op == IR_EXIT || term->op == IR_UNREACHABLE) return false;
+    }
+    return true;
+}
+
+bool bceHasCalls(struct irFunc* f, struct loop* l) {
+    for (int i = 0; i < l->blocks.len; i++) {
+        struct list* instrs = &IrGetBlock(f, *(int*)ListGetIdx(&l->blocks, i))->instrs;
+        for (int j = 0; j < instrs->len; j++) {
+            if (IrGetInstr(f, *(int*)ListGetIdx(instrs, j))->op == IR_CALL) return true;
+        }
+    }
+    return false;
+}
+
+//the header test has to bound an induction variable counting up by an invariant from above
+enum optCheckKept bceFindLoopTest(struct irFunc* f, struct loop* l, struct bceLoopTest* test) {
+    struct irInstr* term = IrGetInstr(f, IrGetTerminator(f, l->header));
+    if (l->latch == IR_NONE || term->op != IR_CONDBR || !bceExitsOnlyAtHeader(f, l)) return OPT_CHECK_LOOP_NOT_COUNTED;
+    test->inLoopIfTrue = LoopContains(l, term->targets[0]);
+    if (test->inLoopIfTrue == LoopContains(l, term->targets[1])) return OPT_CHECK_LOOP_NOT_COUNTED;
+    test->cond = *(int*)ListGetIdx(&term->args, 0);
+    struct bceCmp cmp;
+    if (!bceNormalize(f, test->cond, test->inLoopIfTrue, &cmp) || !LoopIsInvariant(f, l, cmp.rhs)) return OPT_CHECK_LOOP_NOT_COUNTED;
+    struct loopIndVar iv;
+    test->phi = bceStrip(f, cmp.lhs);
+    if (!LoopFindIndVar(f, l, test->phi, &iv) || iv.opType != OPERATION_ADD || !bceConst(f, iv.step, &test->step) || test->step <= 0 ||
+            !bceIsInt(IrGetInstr(f, cmp.rhs)->type)) {
+        return OPT_CHECK_LOOP_NOT_COUNTED;
+    }
+    test->init = iv.init;
+    test->bound = cmp.rhs;
+    test->orEqual = cmp.orEqual;
+    return OPT_CHECK_HOISTED;
+}
+
+long long bceMax(TypeId type) {
+    switch (TypeGet(type)->bType) {
+        case BASETYPE_BYTE: return UCHAR_MAX;
+        case BASETYPE_INT32: return INT_MAX;
+        default: return LLONG_MAX;
+    }
+}
+
+//the counter gets at most to the bound plus the step, minus 1 for less than, which has to fit its type
+//the comparison may be done in a wider type, so a bound that is not constant must fit the type of the counter
+bool bceCannotWrap(struct irFunc* f, struct bceLoopTest* test) {
+    TypeId type = IrGetInstr(f, test->phi)->type;
+    TypeId boundType = IrGetInstr(f, bceStrip(f, test->bound))->type;
+    long long max = bceMax(type);
+    long long bound;
+    if (bceConst(f, test->bound, &bound)) return test->step <= max && bound <= max - test->step + !test->orEqual;
+    return test->step == 1 && !test->orEqual && TypeGetSize(*TypeGet(boundType)) <= TypeGetSize(*TypeGet(type));
+}
+
+//the hoisted checks cover the first and the last index, so the counter has to go through every index in between
+enum optCheckKept bceLoopReason(struct irFunc* f, struct loop* l, struct bceLoopTest* test) {
+    if (bceHasCalls(f, l)) return OPT_CHECK_LOOP_CALLS;
+    enum optCheckKept reason = bceFindLoopTest(f, l, test);
+    if (reason != OPT_CHECK_HOISTED) return reason;
+    if (test->step != 1) return OPT_CHECK_LOOP_STEP;
+    if (!bceCannotWrap(f, test)) return OPT_CHECK_LOOP_MAY_WRAP;
+    return OPT_CHECK_HOISTED;
+}
+
+//a counter starting at a constant of at least 0 and going up stays at least 0 if the loop test stops it before it wraps around
+bool bceIsNonNegative(struct irFunc* f, struct list* loops, int value) {
+    long long c;
+    if (bceConst(f, value, &c)) return c >= 0;
+    value = bceStrip(f, value);
+    struct irInstr* in = IrGetInstr(f, value);
+    struct loop* l = in->op == IR_PHI ? bceHeaderLoop(loops, in->block) : NULL;
+    struct bceLoopTest test;
+    if (!l || bceFindLoopTest(f, l, &test) != OPT_CHECK_HOISTED || test.phi != value || !bceCannotWrap(f, &test)) return false;
+    long long init;
+    return bceConst(f, test.init, &init) && init >= 0;
+}
+
+//checks that run in every iteration on the counter itself
+enum optCheckKept bceIsHoistable(struct irFunc* f, struct list* idoms, struct loop* l, struct bceLoopTest* test, int check) {
+    if (!LoopIsInvariant(f, l, IrGetArg(f, check, 1))) return OPT_CHECK_LENGTH_VARIES;
+    if (bceStrip(f, IrGetArg(f, check, 0)) != test->phi || !IrDominates(idoms, IrGetInstr(f, check)->block, l->latch)) {
+        return OPT_CHECK_LOOP_NOT_COUNTED;
+    }
+    return OPT_CHECK_HOISTED;
+}
+
+bool bceIsRedundant(struct irFunc* f, struct list* idoms, struct list* loops, int check, enum optCheckKept* reason) {
+    int idx = IrGetArg(f, check, 0);
+    int len = IrGetArg(f, check, 1);
+    bool upper = false;
+    bool lower = bceIsNonNegative(f, loops, idx);
+    for (int b = IrGetInstr(f, check)->block; b != IR_NONE; b = *(int*)ListGetIdx(idoms, b)) {
+        struct bceCmp cmp;
+        if (!bceEdgeFact(f, b, &cmp)) continue;
+        long long c;
+        upper |= !cmp.orEqual && bceSame(f, cmp.lhs, idx) && bceSame(f, cmp.rhs, len);
+        lower |= bceSame(f, cmp.rhs, idx) && bceConst(f, cmp.lhs, &c) && c >= (cmp.orEqual ? 0 : -1);
+    }
+    *reason = !upper ? OPT_CHECK_NO_UPPER_BOUND : OPT_CHECK_NO_LOWER_BOUND;
+    return upper && lower;
+}
+
+//the value of an expression over the counter in its first iteration, computed at the end of block
+int bceAtInit(struct irFunc* f, struct loop* l, int block, int value, struct bceLoopTest* test) {
+    if (value == test->phi) return test->init;
+    if (LoopIsInvariant(f, l, value)) return value;
+    struct irInstr in = *IrGetInstr(f, value);
+    int clone = IrAddInstr(f, block, in.op, in.type);
+    IrGetInstr(f, clone)->opType = in.opType;
+    for (int i = 0; i < in.args.len; i++) IrAddArg(f, clone, bceAtInit(f, l, block, *(int*)ListGetIdx(&in.args, i), test));
+    return clone;
+}
+
+//the preheader branches to a new block checking the highest and, unless it is a constant of at least 0, the first index
+//if the loop runs at all, and both go on to a new preheader; a failing check then fails before the loop instead of in it
+void bceHoist(struct irFunc* f, struct list* loops, struct loop* l, struct bceLoopTest* test, struct list* checks) {
+    int pre = l->preheader;
+    int newPre = IrSplitBlock(f, pre, IrGetBlock(f, pre)->instrs.len -1);
+    int guard = IrAddBlock(f);
+    int runs = bceAtInit(f, l, pre, test->cond, test);
+    int condBr = IrAddInstr(f, pre, IR_CONDBR, TYPE_ID_NONE);
+    IrAddArg(f, condBr, runs);
+    if (test->inLoopIfTrue) IrSetTargets(f, condBr, guard, newPre);
+    else IrSetTargets(f, condBr, newPre, guard);
+
+    int highest = test->bound;
+    if (!test->orEqual) {
+        TypeId type = IrGetInstr(f, test->bound)->type;
+        int one = IrAddInstr(f, guard, IR_CONST, type);
+        IrGetInstr(f, one)->val = 1;
+        highest = IrAddInstr(f, guard, IR_OPERATION, type);
+        IrGetInstr(f, highest)->opType = OPERATION_SUB;
+        IrAddArg(f, highest, test->bound);
+        IrAddArg(f, highest, one);
+    }
+    struct list lens = ListInit(sizeof(int));
+    for (int i = 0; i < checks->len; i++) {
+        int check = *(int*)ListGetIdx(checks, i);
+        int idx = IrGetArg(f, check, 0);
+        int len = IrGetArg(f, check, 1);
+        bool done = false;
+        for (int j = 0; j < lens.len && !done; j++) done = bceSame(f, *(int*)ListGetIdx(&lens, j), len);
+        IrRemoveInstr(f, check);
+        if (done) continue;
+        ListAdd(&lens, &len);
+        int first = bceIsNonNegative(f, loops, test->init) ? IR_NONE : bceAtInit(f, l, guard, idx, test);
+        int args[2][2] = {{highest, len}, {first, len}};
+        for (int j = 0; j < 2 && args[j][0] != IR_NONE; j++) {
+            int hoisted = IrAddInstr(f, guard, IR_BOUNDSCHECK, TYPE_ID_NONE);
+            IrGetInstr(f, hoisted)->val = OPT_CHECK_HOISTED;
+            IrAddArg(f, hoisted, args[j][0]);
+            IrAddArg(f, hoisted, args[j][1]);
+        }
+    }
+    IrSetTargets(f, IrAddInstr(f, guard, IR_BR, TYPE_ID_NONE), newPre, IR_NONE);
+    ListDestroy(lens);
+}
+
+//a loop around a changed one contains blocks added after the loops were found, it is left for the next run
+bool bceContainsChanged(struct loop* l, struct list* changedHeaders) {
+    for (int i = 0; i < changedHeaders->len; i++) {
+        if (LoopContains(l, *(int*)ListGetIdx(changedHeaders, i))) return true;
+    }
+    return false;
+}
+
+struct loop* bceInnermost(struct list* loops, int block) {
+    for (int i = 0; i < loops->len; i++) {
+        struct loop* l = ListGetIdx(loops, i);
+        if (LoopContains(l, block)) return l;
+    }
+    return NULL;
+}
+
+//the reason of a check kept in a loop is why it could not be hoisted, hoisted checks keep saying so
+bool OptBoundsChecks(struct irFunc* f) {
+    bool changed = false;
+    struct list loops = LoopFind(f, &changed);
+    struct list idoms = IrDominators(f);
+    struct list checks = ListInit(sizeof(int));
+    for (int i = 0; i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->op != IR_BOUNDSCHECK || in->block == IR_NONE) continue;
+        enum optCheckKept reason;
+        if (bceIsRedundant(f, &idoms, &loops, i, &reason)) {
+            IrRemoveInstr(f, i);
+            changed = true;
+        }
+        else {
+            if (in->val != OPT_CHECK_HOISTED) in->val = reason;
+            ListAdd(&checks, &i);
+        }
+    }
+
+    struct list changedHeaders = ListInit(sizeof(int));
+    struct list hoisted = ListInit(sizeof(int));
+    for (int i = 0; i < loops.len; i++) {
+        struct loop* l = ListGetIdx(&loops, i);
+        if (bceContainsChanged(l, &changedHeaders)) continue;
+        struct bceLoopTest test;
+        enum optCheckKept loopReason = bceLoopReason(f, l, &test);
+        ListRetract(&hoisted, 0);
+        for (int j = 0; j < checks.len; j++) {
+            int check = *(int*)ListGetIdx(&checks, j);
+            struct irInstr* in = IrGetInstr(f, check);
+            if (in->block == IR_NONE || bceInnermost(&loops, in->block) != l) continue;
+            enum optCheckKept reason = loopReason == OPT_CHECK_HOISTED ? bceIsHoistable(f, &idoms, l, &test, check) : loopReason;
+            if (reason == OPT_CHECK_HOISTED) ListAdd(&hoisted, &check);
+            else if (in->val != OPT_CHECK_HOISTED) in->val = reason;
+        }
+        if (hoisted.len == 0) continue;
+        bceHoist(f, &loops, l, &test, &hoisted);
+        ListAdd(&changedHeaders, &l->header);
+        changed = true;
+    }
+
+    ListDestroy(changedHeaders);
+    ListDestroy(hoisted);
+    ListDestroy(checks);
+    ListDestroy(idoms);
+    LoopDestroyAll(loops);
+    return changed;
+}
+
+void OptBoundsReport(struct list* funcs, FILE* stream) {
+    int nKept = 0;
+    for (int i = 0; i < funcs->len; i++) {
+        struct irFunc* f = ((struct optFunc*)ListGetIdx(funcs, i))->func->ir;
+        bool first = true;
+        for (int j = 0; f && j < f->instrs.len; j++) {
+            struct irInstr* in = IrGetInstr(f, j);
+            if (in->op != IR_BOUNDSCHECK || in->block == IR_NONE) continue;
+            if (first) {
+                fputs("bounds checks kept in ", stream);
+                StrPrint(f->func->name, stream);
+                fputs(":\n", stream);
+                first = false;
+            }
+            fprintf(stream, "    %%%d in b%d: %s\n", j, in->block, bceKeptReasons[in->val]);
+            nKept++;
+        }
+    }
+    fprintf(stream, "%d bounds checks kept\n", nKept);
+}
+
+//a loop over arr while i < len(arr), checking i against len(arr) and against n
+//counting up by 1 the first check is redundant and the second hoisted, counting up by 2 both are kept,
+//inline like the tests so it is not emitted outside of the test build
+static inline bool bceTestLoop(long long step) {
+    TypeId i64 = TypeVanillaId(BASETYPE_INT64);
+    struct type str = TypeString(NULL);
+    struct type params[2] = {str, TypeVanilla(BASETYPE_INT64)};
+    struct var func;
+    struct irFunc* f = IrTestFunc(&func, "loop", NULL, params, 2);
+    int header = IrAddBlock(f);
+    int body = IrAddBlock(f);
+    int exit = IrAddBlock(f);
+    int arr = IrAddInstr(f, 0, IR_PARAM, str.id);
+    int n = IrAddInstr(f, 0, IR_PARAM, i64);
+    IrGetInstr(f, n)->val = 1;
+    int zero = IrAddInstr(f, 0, IR_CONST, i64);
+    int one = IrAddInstr(f, 0, IR_CONST, i64);
+    IrGetInstr(f, one)->val = step;
+    int len = IrAddInstr(f, 0, IR_LEN, i64);
+    IrAddArg(f, len, arr);
+    IrSetTargets(f, IrAddInstr(f, 0, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+
+    int phi = IrAddInstr(f, header, IR_PHI, i64);
+    int cond = IrAddInstr(f, header, IR_OPERATION, TypeVanillaId(BASETYPE_BOOL));
+    IrGetInstr(f, cond)->opType = OPERATION_LESS_THAN;
+    IrAddArg(f, cond, phi);
+    IrAddArg(f, cond, len);
+    int condBr = IrAddInstr(f, header, IR_CONDBR, TYPE_ID_NONE);
+    IrAddArg(f, condBr, cond);
+    IrSetTargets(f, condBr, body, exit);
+
+    int checks[2];
+    for (int i = 0; i < 2; i++) {
+        checks[i] = IrAddInstr(f, body, IR_BOUNDSCHECK, TYPE_ID_NONE);
+        IrAddArg(f, checks[i], phi);
+        IrAddArg(f, checks[i], i == 0 ? len : n);
+    }
+    int next = IrAddInstr(f, body, IR_OPERATION, i64);
+    IrGetInstr(f, next)->opType = OPERATION_ADD;
+    IrAddArg(f, next, phi);
+    IrAddArg(f, next, one);
+    IrSetTargets(f, IrAddInstr(f, body, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+    IrAddArg(f, phi, zero);
+    IrAddArg(f, phi, next);
+    IrAddInstr(f, exit, IR_RET, TYPE_ID_NONE);
+
+    bool changed = OptBoundsChecks(f);
+    bool passed = IrTestVerify(f) && !OptBoundsChecks(f);
+    if (step == 1) passed = passed && changed && IrGetInstr(f, checks[0])->block == IR_NONE && IrGetInstr(f, checks[1])->block == IR_NONE;
+    int nHoisted = 0;
+    for (int i = 0; i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->op != IR_BOUNDSCHECK || in->block == IR_NONE) continue;
+        if (step == 1) passed = passed && in->val == OPT_CHECK_HOISTED && IrGetArg(f, i, 1) == n;
+        else passed = passed && in->block == body && in->val == OPT_CHECK_LOOP_STEP;
+        nHoisted++;
+    }
+    passed = passed && nHoisted == (step == 1 ? 1 : 2);
+    IrTestFuncDestroy(&func);
+    return passed;
+}
+
+TEST(OptBoundsLoop) {
+    if (bceTestLoop(1) && bceTestLoop(2)) TEST_PASSED;
+    TEST_FAILED;
+}
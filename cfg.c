@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "util.h"
+
+//a condbr on a constant or with the same block twice only has one target
+bool cfgFoldBranch(struct irFunc* f, int term) {
+    struct irInstr* in = IrGetInstr(f, term);
+    if (in->op != IR_CONDBR) return false;
+    if (in->targets[0] == in->targets[1]) {
+        IrDropTarget(f, term, 1);
+        return true;
+    }
+    struct irInstr* cond = IrGetInstr(f, IrGetArg(f, term, 0));
+    if (cond->op != IR_CONST) return false;
+    IrDropTarget(f, term, cond->val ? 1 : 0);
+    return true;
+}
+
+//preds of a block only holding a br go to its successor directly, unless that needs phi args
+//or the block is the preheader of a loop, which the loop passes would only add again
+bool cfgSkipEmpty(struct irFunc* f, int block, bool* isHeader) {
+    struct irBlock* b = IrGetBlock(f, block);
+    if (block == 0 || b->instrs.len != 1 || b->preds.len == 0) return false;
+    struct irInstr* br = IrGetInstr(f, *(int*)ListGetIdx(&b->instrs, 0));
+    int succ = br->targets[0];
+    if (br->op != IR_BR || succ == block || isHeader[succ]) return false;
+    struct irBlock* s = IrGetBlock(f, succ);
+    if (s->instrs.len && IrGetInstr(f, *(int*)ListGetIdx(&s->instrs, 0))->op == IR_PHI) return false;
+    while (b->preds.len) {
+        int pred = *(int*)ListGetIdx(&b->preds, 0);
+        IrRetarget(f, IrGetTerminator(f, pred), block, succ);
+        b = IrGetBlock(f, block);
+    }
+    return true;
+}
+
+//merging and skipping blocks keeps back edges back edges, so this holds for a whole sweep
+bool* cfgFindHeaders(struct irFunc* f) {
+    struct list idoms = IrDominators(f);
+    bool* isHeader = CallocOrCrash(f->blocks.len * sizeof(bool));
+    for (int b = 0; b < f->blocks.len; b++) {
+        struct list* preds = &IrGetBlock(f, b)->preds;
+        for (int i = 0; i < preds->len; i++) isHeader[b] |= IrDominates(&idoms, b, *(int*)ListGetIdx(preds, i));
+    }
+    ListDestroy(idoms);
+    return isHeader;
+}
+
+bool cfgMergeIntoPred(struct irFunc* f, int block) {
+    struct irBlock* b = IrGetBlock(f, block);
+    if (block == 0 || b->preds.len != 1) return false;
+    int pred = *(int*)ListGetIdx(&b->preds, 0);
+    if (pred == block || IrGetInstr(f, IrGetTerminator(f, pred))->op != IR_BR) return false;
+    IrMergeBlocks(f, pred, block);
+    return true;
+}
+
+bool OptSimplifyCfg(struct irFunc* f) {
+    bool changed = false;
+    bool found = true;
+    while (found) {
+        found = false;
+        for (int i = 0; i < f->blocks.len; i++) {
+            if (IrGetBlock(f, i)->removed) continue;
+            found |= cfgFoldBranch(f, IrGetTerminator(f, i));
+        }
+        found |= IrRemoveUnreachable(f);
+        bool* isHeader = cfgFindHeaders(f);
+        for (int i = 0; i < f->blocks.len; i++) {
+            if (IrGetBlock(f, i)->removed) continue;
+            if (cfgMergeIntoPred(f, i)) found = true;
+            else found |= cfgSkipEmpty(f, i, isHeader);
+        }
+        free(isHeader);
+        changed |= found;
+    }
+    return changed;
+}
@@ -0,0 +1,1217 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include "check.h"
+#include "syntaxrules.h"
+#include "ast.h"
+#include "compat.h"
+#include "fold.h"
+#include "irbuild.h"
+#include "opt.h"
+#include "errmsg.h"
+#include "hashmap.h"
+#include "timer.h"
+#include "pool.h"
+#include "module.h"
+#include "iface.h"
+#include "irtest.h"
+#include "util.h"
+
+//a function or global and the tree defining it
+struct checkDecl {
+    struct var* v;
+    struct syntax* def; //SNTX_FUNC or SNTX_STMNT_GLOB_DECL
+    struct checkModule* m; //defining it
+    struct errMsgBuffer errs; //of checking the body or initializer
+    bool queued; //to be checked, with lazily parsed bodies only once reached from main or an initializer
+};
+
+struct checkGlobal {
+    struct var* v; //the origin
+    int decl; //index into the decls of the program, -1 for those loaded from an interface
+};
+
+struct checkImport {
+    struct str alias;
+    struct checkModule* m;
+};
+
+//functions and globals share one namespace per module, all of it is visible from every body of the module,
+//the public names, those starting with an uppercase letter, also from the modules importing it
+struct checkModule {
+    int idx; //index into the modules of the program, the main file is 0
+    struct str fileName;
+    unsigned long long srcHash;
+    SyntaxCtx sc; //NULL if loaded from its interface, its globals are then only the public ones without bodies
+    struct iface ifc;
+    struct hashMap globals; //struct checkGlobal; by name
+    struct list imports; //struct checkImport
+};
+
+struct checkProgram {
+    struct list modules; //struct checkModule*; the main file first, then in the order they are first imported
+    struct moduleIds ids;
+    bool lazyBodies; //of the main file, imports are parsed alike
+    bool wholeProgram; //every module is checked from source, so the bodies of imported functions can be inlined
+    struct list decls; //struct checkDecl; by module, then in the order of definition
+    struct hashMap declsByOrigin; //struct checkGlobal; by the address of the origin
+    struct list queue; //int; indices into decls in the order they are checked
+};
+
+struct checkLocal {
+    struct str name;
+    int var; //index into vars of the ast
+};
+
+struct checkBody {
+    struct checkModule* m;
+    struct var* func; //NULL for global initializers
+    struct astFunc* af;
+    struct list locals; //struct checkLocal; those of the innermost scope last
+};
+
+static const enum operation checkBinaryOps[TOK_COUNT] = {
+    [TOK_AND] = OPERATION_AND,
+    [TOK_OR] = OPERATION_OR,
+    [TOK_XOR] = OPERATION_XOR,
+    [TOK_BTWSE_AND] = OPERATION_BITWISE_AND,
+    [TOK_BTWSE_OR] = OPERATION_BITWISE_OR,
+    [TOK_BTWSE_XOR] = OPERATION_BITWISE_XOR,
+    [TOK_LST] = OPERATION_LESS_THAN,
+    [TOK_LSE] = OPERATION_LESS_THAN_OR_EQUAL,
+    [TOK_GRT] = OPERATION_GREATER_THAN,
+    [TOK_GRE] = OPERATION_GREATER_THAN_OR_EQUAL,
+    [TOK_NEQ] = OPERATION_NOT_EQUALS,
+    [TOK_EQ] = OPERATION_EQUALS,
+    [TOK_BTSFT_L] = OPERATION_BITSHIFT_LEFT,
+    [TOK_BTSFT_R] = OPERATION_BITSHIFT_RIGHT,
+    [TOK_ADD] = OPERATION_ADD,
+    [TOK_SUB] = OPERATION_SUB,
+    [TOK_MUL] = OPERATION_MUL,
+    [TOK_DIV] = OPERATION_DIV,
+    [TOK_MOD] = OPERATION_MODULO,
+    //compound assignments apply the operation to the variable and the value
+    [TOK_ASS_ADD] = OPERATION_ADD,
+    [TOK_ASS_SUB] = OPERATION_SUB,
+    [TOK_ASS_MUL] = OPERATION_MUL,
+    [TOK_ASS_DIV] = OPERATION_DIV,
+    [TOK_ASS_MOD] = OPERATION_MODULO,
+    [TOK_ASS_AND] = OPERATION_AND,
+    [TOK_ASS_OR] = OPERATION_OR,
+    [TOK_ASS_XOR] = OPERATION_XOR,
+    [TOK_ASS_BTSFT_L] = OPERATION_BITSHIFT_LEFT,
+    [TOK_ASS_BTSFT_R] = OPERATION_BITSHIFT_RIGHT,
+    [TOK_ASS_BTWSE_AND] = OPERATION_BITWISE_AND,
+    [TOK_ASS_BTWSE_OR] = OPERATION_BITWISE_OR,
+    [TOK_ASS_BTWSE_XOR] = OPERATION_BITWISE_XOR,
+};
+
+static const enum operation checkUnaryOps[TOK_COUNT] = {
+    [TOK_ADD] = OPERATION_PLUS,
+    [TOK_SUB] = OPERATION_MINUS,
+    [TOK_NOT] = OPERATION_NOT,
+    [TOK_BTWSE_INV] = OPERATION_BITWISE_COMPLEMENT,
+};
+
+struct syntaxPart* checkPart(struct syntax* s, int idx) {
+    return ListGetIdx(&s->parts, idx);
+}
+
+struct syntax* checkNested(struct syntax* s, int idx) {
+    return checkPart(s, idx)->nested;
+}
+
+struct token checkTok(struct syntax* s, int idx) {
+    return checkPart(s, idx)->tok;
+}
+
+//trees of files without syntax errors are never empty
+struct token checkFirstTok(struct syntax* s) {
+    struct syntaxPart* p = checkPart(s, 0);
+    return p->nested ? checkFirstTok(p->nested) : p->tok;
+}
+
+struct token checkLastTok(struct syntax* s) {
+    struct syntaxPart* p = checkPart(s, s->parts.len -1);
+    return p->nested ? checkLastTok(p->nested) : p->tok;
+}
+
+struct token checkSpan(struct syntax* s) {
+    return TokenMerge(checkFirstTok(s), checkLastTok(s));
+}
+
+//only vanilla types can be named so far, modules export no types
+bool checkType(struct syntax* iden, TypeId* type) {
+    if (iden->parts.len > 1) {
+        ErrMsgTok(checkSpan(iden), NAMESPACE_NOT_ALLOWED);
+        return false;
+    }
+    struct str name = checkTok(iden, 0).str;
+    for (enum baseType bType = BASETYPE_BOOL; bType <= BASETYPE_FLOAT64; bType++) {
+        if (!StrCmp(TypeVanilla(bType).name, name)) continue;
+        *type = TypeVanillaId(bType);
+        return true;
+    }
+    ErrMsgTok(checkTok(iden, 0), UNKNOWN_TYPE);
+    return false;
+}
+
+//the declaration lives in the origin, asts and parameter lists hold copies of it
+struct var* checkVarNew(struct token nameTok, TypeId type, bool mut) {
+    struct var* v = VarAllocSetOrigin();
+    *v = (struct var){0};
+    v->origin = v;
+    v->name = nameTok.str;
+    v->tok = nameTok;
+    v->mut = mut;
+    if (type != TYPE_ID_NONE) v->type = *TypeGet(type);
+    return v;
+}
+
+bool checkGlobalCmp(void* name, void* elem) {
+    return StrCmp(*(struct str*)name, ((struct checkGlobal*)elem)->v->name);
+}
+
+struct checkGlobal* checkFindGlobalEntry(struct checkModule* m, struct str name) {
+    return HashMapGet(&m->globals, HashBytes(HASH_SEED, name.ptr, name.len), &name, checkGlobalCmp);
+}
+
+struct var* checkFindGlobal(struct checkModule* m, struct str name) {
+    struct checkGlobal* found = checkFindGlobalEntry(m, name);
+    return found ? found->v : NULL;
+}
+
+struct checkBody checkBodyInit(struct checkModule* m, struct var* func) {
+    struct checkBody b = {m, func, AstFuncNew(), ListInit(sizeof(struct checkLocal))};
+    return b;
+}
+
+int checkFindLocal(struct checkBody* b, struct str name) {
+    for (int i = b->locals.len -1; i >= 0; i--) {
+        struct checkLocal* l = ListGetIdx(&b->locals, i);
+        if (StrCmp(l->name, name)) return l->var;
+    }
+    return AST_NONE;
+}
+
+//names are never shadowed, neither those of globals nor those of outer scopes
+void checkDeclareLocal(struct checkBody* b, struct token nameTok, int varIdx) {
+    if (checkFindLocal(b, nameTok.str) != AST_NONE || checkFindGlobal(b->m, nameTok.str)) {
+        ErrMsgTok(nameTok, VAR_NAME_IN_USE);
+        return;
+    }
+    struct checkLocal l = {nameTok.str, varIdx};
+    ListAdd(&b->locals, &l);
+}
+
+bool checkIsPublic(struct str name) {
+    return name.ptr[0] >= 'A' && name.ptr[0] <= 'Z';
+}
+
+struct checkModule* checkFindImport(struct checkModule* m, struct str alias) {
+    for (int i = 0; i < m->imports.len; i++) {
+        struct checkImport* import = ListGetIdx(&m->imports, i);
+        if (StrCmp(import->alias, alias)) return import->m;
+    }
+    return NULL;
+}
+
+//alias.Name, a public global of an imported module
+int checkFindImported(struct checkBody* b, struct syntax* iden) {
+    struct checkModule* m = checkFindImport(b->m, checkTok(iden, 0).str);
+    if (!m) {
+        ErrMsgTok(checkTok(iden, 0), UNKNOWN_FILE_ALIAS);
+        return AST_NONE;
+    }
+    if (iden->parts.len > 3) {
+        ErrMsgTok(TokenMerge(checkTok(iden, 3), checkLastTok(iden)), NAMESPACE_NOT_ALLOWED);
+        return AST_NONE;
+    }
+    struct token nameTok = checkTok(iden, 2);
+    struct var* global = checkFindGlobal(m, nameTok.str);
+    if (!global) ErrMsgTok(nameTok, UNKNOWN_VAR);
+    else if (!checkIsPublic(global->name)) ErrMsgTok(nameTok, VAR_IS_PRIVATE);
+    else return AstAddVar(b->af, *global);
+    return AST_NONE;
+}
+
+//globals and functions are added to the ast once they are used
+int checkFindVar(struct checkBody* b, struct syntax* iden) {
+    if (iden->parts.len > 1) return checkFindImported(b, iden);
+    struct str name = checkTok(iden, 0).str;
+    int local = checkFindLocal(b, name);
+    if (local != AST_NONE) return local;
+    struct var* global = checkFindGlobal(b->m, name);
+    if (global) return AstAddVar(b->af, *global);
+    ErrMsgTok(checkTok(iden, 0), UNKNOWN_VAR);
+    return AST_NONE;
+}
+
+//a type of TYPE_ID_NONE marks an operand whose error was already reported
+struct astOpnd checkOpndNew(struct checkBody* b, enum operation opType, TypeId type, struct token tok) {
+    struct astOpnd o = (struct astOpnd){0};
+    o.opType = opType;
+    o.type = type;
+    o.args = AST_NONE;
+    o.val = AST_NONE;
+    o.tok = AstAddTok(b->af, tok);
+    return o;
+}
+
+struct token checkOpndTok(struct checkBody* b, struct astOpnd o) {
+    return AstGetTok(b->af, o.tok);
+}
+
+enum baseType checkBType(struct astOpnd o) {
+    return TypeGet(o.type)->bType;
+}
+
+enum compatClass checkClass(struct astOpnd o) {
+    return CompatClass(checkBType(o), o.isLiteral);
+}
+
+//the root of an expression is added by its statement, AST_NONE if it has an error
+int checkPlace(struct checkBody* b, struct astOpnd o) {
+    if (o.type == TYPE_ID_NONE) return AST_NONE;
+    return AstAddOpnds(b->af, &o, 1);
+}
+
+//the token still holds the quotes, escapes were validated by the tokenizer
+long long checkCharVal(struct str s) {
+    if (s.ptr[1] != '\\') return (unsigned char)s.ptr[1];
+    switch (s.ptr[2]) {
+        case 'n': return '\n';
+        case 't': return '\t';
+        default: return (unsigned char)s.ptr[2];
+    }
+}
+
+//int literals are int32 if they fit, float literals are float64 and only rounded once converted to a float32
+struct foldVal checkLiteralVal(struct token tok) {
+    char cStr[tok.str.len +1];
+    StrGetAsCStr(tok.str, cStr);
+    switch (tok.type) {
+        case TOK_BOOL_LIT: return FoldInt(BASETYPE_BOOL, StrCmp(tok.str, StrFromCStr("true")));
+        case TOK_CHAR_LIT: return FoldInt(BASETYPE_BYTE, checkCharVal(tok.str));
+        case TOK_INT_LIT: {
+            long long i = strtoll(cStr, NULL, 10);
+            return FoldInt(i >= INT_MIN && i <= INT_MAX ? BASETYPE_INT32 : BASETYPE_INT64, i);
+        }
+        default: {
+            double f = strtod(cStr, NULL);
+            return FoldFloat(BASETYPE_FLOAT64, f);
+        }
+    }
+}
+
+struct astOpnd checkLiteral(struct checkBody* b, struct token tok) {
+    struct foldVal v = checkLiteralVal(tok);
+    struct astOpnd o = checkOpndNew(b, OPERATION_NONE, TypeVanillaId(v.bType), tok);
+    o.val = AstAddLiteral(b->af, FoldToBits(v));
+    o.isLiteral = true;
+    return o;
+}
+
+//literals are converted in place, anything else by a cast
+struct astOpnd checkConvert(struct checkBody* b, struct astOpnd o, enum baseType to) {
+    if (checkBType(o) == to) return o;
+    if (o.isLiteral) {
+        struct foldVal v = FoldCast(FoldFromBits(checkBType(o), AstGetLiteral(b->af, o.val)), to);
+        o.val = AstAddLiteral(b->af, FoldToBits(v));
+        o.type = TypeVanillaId(to);
+        return o;
+    }
+    struct astOpnd cast = checkOpndNew(b, OPERATION_TYPECAST, TypeVanillaId(to), checkOpndTok(b, o));
+    cast.args = AstAddOpnds(b->af, &o, 1);
+    cast.nArgs = 1;
+    return cast;
+}
+
+//the value of an assignment, arg, return or case must have the type of its target,
+//a literal is converted if the tables give the type of the target when adding it to the target
+struct astOpnd checkAssignable(struct checkBody* b, struct astOpnd o, TypeId to, char* errMsg) {
+    if (o.type == TYPE_ID_NONE || to == TYPE_ID_NONE || o.type == to) return o;
+    enum baseType toBType = TypeGet(to)->bType;
+    enum baseType resBType;
+    if (o.isLiteral && CompatBinary(OPERATION_ADD, CompatClass(toBType, false), checkClass(o), &resBType) &&
+            resBType == toBType) {
+        return checkConvert(b, o, toBType);
+    }
+    ErrMsgTok(checkOpndTok(b, o), errMsg);
+    o.type = TYPE_ID_NONE;
+    return o;
+}
+
+struct astOpnd checkExpr(struct checkBody* b, struct syntax* s);
+
+//operations on literals become literals, folded with the semantics of the target
+struct astOpnd checkFold(struct checkBody* b, struct astOpnd o, struct astOpnd* args) {
+    struct foldVal vals[2];
+    for (int i = 0; i < o.nArgs; i++) vals[i] = FoldFromBits(checkBType(args[i]), AstGetLiteral(b->af, args[i].val));
+    struct foldVal res;
+    enum foldStatus status = o.nArgs == 1 ? FoldUnary(o.opType, vals[0], &res) : FoldBinary(o.opType, vals[0], vals[1], &res);
+    o.nArgs = 0;
+    if (status == FOLD_DIV_BY_ZERO) {
+        ErrMsgTok(checkOpndTok(b, args[1]), DIVISION_BY_ZERO);
+        o.type = TYPE_ID_NONE;
+        return o;
+    }
+    o.opType = OPERATION_NONE;
+    o.type = TypeVanillaId(res.bType);
+    o.val = AstAddLiteral(b->af, FoldToBits(res));
+    o.isLiteral = true;
+    return o;
+}
+
+void checkBinaryError(struct checkBody* b, enum operation opType, struct astOpnd* args, struct token tok) {
+    bool argError = false;
+    for (int i = 0; i < 2; i++) {
+        char* errMsg = CompatBinaryArgError(opType, i, checkClass(args[i]));
+        if (!errMsg) continue;
+        ErrMsgTok(checkOpndTok(b, args[i]), errMsg);
+        argError = true;
+    }
+    if (argError) return;
+    bool bitwise = opType == OPERATION_BITWISE_AND || opType == OPERATION_BITWISE_OR || opType == OPERATION_BITWISE_XOR;
+    ErrMsgTok(tok, bitwise ? OPERANDS_NOT_SAME_SIZE : OPERANDS_NOT_SAME_TYPE);
+}
+
+//both args of the ir have the same type except for the count of a shift,
+//comparisons convert to the type the args would be added in
+struct astOpnd checkBinary(struct checkBody* b, enum operation opType, struct astOpnd lhs, struct astOpnd rhs) {
+    struct token tok = TokenMerge(checkOpndTok(b, lhs), checkOpndTok(b, rhs));
+    struct astOpnd o = checkOpndNew(b, opType, TYPE_ID_NONE, tok);
+    if (lhs.type == TYPE_ID_NONE || rhs.type == TYPE_ID_NONE) return o;
+    struct astOpnd args[2] = {lhs, rhs};
+    enum baseType resBType;
+    if (!CompatBinary(opType, checkClass(lhs), checkClass(rhs), &resBType)) {
+        checkBinaryError(b, opType, args, tok);
+        return o;
+    }
+    enum baseType argBType = resBType;
+    if (resBType == BASETYPE_BOOL && opType != OPERATION_AND && opType != OPERATION_OR && opType != OPERATION_XOR) {
+        CompatBinary(OPERATION_ADD, checkClass(lhs), checkClass(rhs), &argBType);
+    }
+    args[0] = checkConvert(b, lhs, argBType);
+    if (opType != OPERATION_BITSHIFT_LEFT && opType != OPERATION_BITSHIFT_RIGHT) args[1] = checkConvert(b, rhs, argBType);
+    o.type = TypeVanillaId(resBType);
+    o.nArgs = 2;
+    if (args[0].isLiteral && args[1].isLiteral) return checkFold(b, o, args);
+    o.args = AstAddOpnds(b->af, args, 2);
+    return o;
+}
+
+//the operators are applied from the innermost
+struct astOpnd checkUnary(struct checkBody* b, struct syntax* s) {
+    struct astOpnd in = checkExpr(b, checkNested(s, s->parts.len -1));
+    for (int i = s->parts.len -2; i >= 0; i--) {
+        struct token opTok = checkTok(checkNested(s, i), 0);
+        enum operation opType = checkUnaryOps[opTok.type];
+        struct astOpnd o = checkOpndNew(b, opType, TYPE_ID_NONE, TokenMerge(opTok, checkOpndTok(b, in)));
+        if (in.type != TYPE_ID_NONE && !CompatUnary(opType, checkClass(in))) {
+            ErrMsgTok(checkOpndTok(b, in), CompatUnaryError(opType));
+        }
+        else if (in.type != TYPE_ID_NONE) {
+            o.type = in.type;
+            o.nArgs = 1;
+            if (in.isLiteral) o = checkFold(b, o, &in);
+            else o.args = AstAddOpnds(b->af, &in, 1);
+        }
+        in = o;
+    }
+    return in;
+}
+
+//every call has a value since a call is no statement of its own
+struct astOpnd checkCall(struct checkBody* b, struct syntax* s) {
+    struct astOpnd o = checkOpndNew(b, OPERATION_FUNCCALL, TYPE_ID_NONE, checkSpan(s));
+    struct syntax* argSyntax = s->parts.len == 4 ? checkNested(s, 2) : NULL;
+    int nArgs = argSyntax ? (argSyntax->parts.len +1) / 2 : 0;
+    struct astOpnd args[nArgs +1];
+    for (int i = 0; i < nArgs; i++) args[i] = checkExpr(b, checkNested(argSyntax, i * 2));
+    struct syntax* iden = checkNested(s, 0);
+    o.val = checkFindVar(b, iden);
+    if (o.val == AST_NONE) return o;
+    struct var* func = AstGetVar(b->af, o.val);
+    if (func->type.bType != BASETYPE_FUNC) {
+        ErrMsgTok(checkSpan(iden), EXPECTED_FUNC_NAME);
+        return o;
+    }
+    if (nArgs != func->type.vars.len) {
+        ErrMsgTok(checkOpndTok(b, o), WRONG_NUMBER_OF_ARGS);
+        return o;
+    }
+    if (func->type.retType.len == 0) {
+        ErrMsgTok(checkOpndTok(b, o), FUNC_RETURNS_NOTHING);
+        return o;
+    }
+    bool valid = true;
+    for (int i = 0; i < nArgs; i++) {
+        struct var* param = ListGetIdx(&func->type.vars, i);
+        args[i] = checkAssignable(b, args[i], param->type.id, OPERANDS_NOT_SAME_TYPE);
+        valid = valid && args[i].type != TYPE_ID_NONE;
+    }
+    if (!valid) return o;
+    o.type = ((struct type*)ListGetIdx(&func->type.retType, 0))->id;
+    o.args = AstAddOpnds(b->af, args, nArgs);
+    o.nArgs = nArgs;
+    return o;
+}
+
+struct astOpnd checkReadVar(struct checkBody* b, struct syntax* iden) {
+    struct astOpnd o = checkOpndNew(b, OPERATION_READ_VAR, TYPE_ID_NONE, checkSpan(iden));
+    o.val = checkFindVar(b, iden);
+    if (o.val == AST_NONE) return o;
+    struct var* v = AstGetVar(b->af, o.val);
+    if (v->type.bType == BASETYPE_FUNC) ErrMsgTok(checkOpndTok(b, o), FUNC_USED_AS_VALUE);
+    else o.type = v->type.id;
+    return o;
+}
+
+struct astOpnd checkPrimary(struct checkBody* b, struct syntax* s) {
+    struct syntaxPart* p = checkPart(s, 0);
+    if (!p->nested) return checkLiteral(b, p->tok);
+    switch (p->nested->type) {
+        case SNTX_CALL: return checkCall(b, p->nested);
+        case SNTX_IDEN_MB_NMESPCE: return checkReadVar(b, p->nested);
+        default: return checkExpr(b, checkNested(p->nested, 1)); //parentheses only group
+    }
+}
+
+//the binary levels alternate operands and operators and are evaluated from the left
+struct astOpnd checkExpr(struct checkBody* b, struct syntax* s) {
+    if (s->type == SNTX_EXPR_PRIMARY) return checkPrimary(b, s);
+    if (s->type == SNTX_EXPR_UNARY) return checkUnary(b, s);
+    struct astOpnd lhs = checkExpr(b, checkNested(s, 0));
+    for (int i = 1; i +1 < s->parts.len; i += 2) {
+        struct astOpnd rhs = checkExpr(b, checkNested(s, i +1));
+        lhs = checkBinary(b, checkBinaryOps[checkTok(checkNested(s, i), 0).type], lhs, rhs);
+    }
+    return lhs;
+}
+
+int checkCondition(struct checkBody* b, struct syntax* s) {
+    struct astOpnd cond = checkExpr(b, s);
+    if (cond.type != TYPE_ID_NONE && checkBType(cond) != BASETYPE_BOOL) {
+        ErrMsgTok(checkOpndTok(b, cond), OPERATION_REQUIRES_BOOL);
+        return AST_NONE;
+    }
+    return checkPlace(b, cond);
+}
+
+struct astStmt checkStmtNew(enum statementType sType) {
+    struct astStmt s = {sType, AST_NONE, AST_NONE, AST_NONE, 0};
+    return s;
+}
+
+void checkSetBlock(struct checkBody* b, struct astStmt* s, struct list* stmts) {
+    s->block = AstAddStmts(b->af, stmts->ptr, stmts->len);
+    s->blockLen = stmts->len;
+}
+
+bool checkIsMutable(struct checkBody* b, int varIdx, struct token tok) {
+    struct var* v = AstGetVar(b->af, varIdx);
+    if (v->mut && v->type.bType != BASETYPE_FUNC) return true;
+    ErrMsgTok(tok, VAR_IMMUTABLE);
+    return false;
+}
+
+void checkStmnt(struct checkBody* b, struct syntax* s, struct list* stmts);
+
+//the statements of nested code blocks are added before those of the code block
+void checkStmnts(struct checkBody* b, struct syntax* cblock, struct list* stmts) {
+    int scope = b->locals.len;
+    for (int i = 1; i +1 < cblock->parts.len; i++) checkStmnt(b, checkNested(checkNested(cblock, i), 0), stmts);
+    ListRetract(&b->locals, scope);
+}
+
+void checkCodeBlock(struct checkBody* b, struct syntax* cblock, struct astStmt* s) {
+    struct list stmts = ListInit(sizeof(struct astStmt));
+    checkStmnts(b, cblock, &stmts);
+    checkSetBlock(b, s, &stmts);
+    ListDestroy(stmts);
+}
+
+//the value is checked before the name is declared
+void checkLocalDecl(struct checkBody* b, struct syntax* s, struct list* stmts) {
+    struct token nameTok = checkTok(s, 0);
+    struct syntax* ass = checkNested(s, 1);
+    struct astOpnd value = checkExpr(b, checkNested(ass, 2));
+    TypeId type;
+    if (!checkType(checkNested(ass, 0), &type)) return;
+    int varIdx = AstAddVar(b->af, *checkVarNew(nameTok, type, true));
+    checkDeclareLocal(b, nameTok, varIdx);
+    struct astStmt alloc = checkStmtNew(STATEMENT_STACK_ALLOCATION);
+    alloc.var = varIdx;
+    ListAdd(stmts, &alloc);
+    if (checkTok(ass, 1).type != TOK_ASS) {
+        ErrMsgTok(checkTok(ass, 1), EXPECTED_ASSIGNMENT);
+        return;
+    }
+    struct astStmt init = checkStmtNew(STATEMENT_ASSIGNMENT);
+    init.var = varIdx;
+    init.op = checkPlace(b, checkAssignable(b, value, type, OPERANDS_NOT_SAME_TYPE));
+    ListAdd(stmts, &init);
+}
+
+//for SNTX_ASS and SNTX_STMNT_ASS
+void checkAssignment(struct checkBody* b, struct syntax* s, struct list* stmts) {
+    struct syntax* iden = checkNested(s, 0);
+    struct token opTok = checkTok(s, 1);
+    struct astOpnd value = checkExpr(b, checkNested(s, 2));
+    int varIdx = checkFindVar(b, iden);
+    if (varIdx == AST_NONE || !checkIsMutable(b, varIdx, checkSpan(iden))) return;
+    TypeId type = AstGetVar(b->af, varIdx)->type.id;
+    if (opTok.type != TOK_ASS) {
+        struct astOpnd read = checkOpndNew(b, OPERATION_READ_VAR, type, checkSpan(iden));
+        read.val = varIdx;
+        value = checkBinary(b, checkBinaryOps[opTok.type], read, value);
+    }
+    struct astStmt ass = checkStmtNew(STATEMENT_ASSIGNMENT);
+    ass.var = varIdx;
+    ass.op = checkPlace(b, checkAssignable(b, value, type, OPERANDS_NOT_SAME_TYPE));
+    ListAdd(stmts, &ass);
+}
+
+//for SNTX_INC and SNTX_STMNT_INC, the variable must be a number that 1 can be added to
+void checkIncrement(struct checkBody* b, struct syntax* s, struct list* stmts) {
+    struct syntax* iden = checkNested(s, 0);
+    int varIdx = checkFindVar(b, iden);
+    if (varIdx == AST_NONE || !checkIsMutable(b, varIdx, checkSpan(iden))) return;
+    enum baseType bType = AstGetVar(b->af, varIdx)->type.bType;
+    enum baseType resBType;
+    if (!CompatBinary(OPERATION_ADD, CompatClass(bType, false), COMPAT_INT32_LIT, &resBType) || resBType != bType) {
+        ErrMsgTok(checkSpan(iden), OPERATION_REQUIRES_NUMBER);
+        return;
+    }
+    struct astStmt inc = checkStmtNew(checkTok(s, 1).type == TOK_INC ?
+        STATEMENT_ASSIGNMENT_INCREMENT : STATEMENT_ASSIGNMENT_DECREMENT);
+    inc.var = varIdx;
+    ListAdd(stmts, &inc);
+}
+
+//an else directly follows its if, an else if is the only statement of the else
+void checkIf(struct checkBody* b, struct syntax* s, struct list* stmts) {
+    struct astStmt ifStmt = checkStmtNew(STATEMENT_IF);
+    ifStmt.op = checkCondition(b, checkNested(s, 1));
+    checkCodeBlock(b, checkNested(s, 2), &ifStmt);
+    ListAdd(stmts, &ifStmt);
+    if (s->parts.len < 4) return;
+    struct syntax* branch = checkNested(checkNested(s, 3), 1);
+    struct astStmt elseStmt = checkStmtNew(STATEMENT_ELSE);
+    if (branch->type == SNTX_CBLOCK) checkCodeBlock(b, branch, &elseStmt);
+    else {
+        struct list elseStmts = ListInit(sizeof(struct astStmt));
+        checkIf(b, branch, &elseStmts);
+        checkSetBlock(b, &elseStmt, &elseStmts);
+        ListDestroy(elseStmts);
+    }
+    ListAdd(stmts, &elseStmt);
+}
+
+//the init runs before the loop and the step at the end of the body, both in the scope of the loop
+void checkFor(struct checkBody* b, struct syntax* s, struct list* stmts) {
+    int scope = b->locals.len;
+    struct syntax* init = NULL;
+    struct syntax* cond = NULL;
+    struct syntax* step = NULL;
+    struct syntax* body = NULL;
+    for (int i = 1; i < s->parts.len; i++) {
+        struct syntax* part = checkNested(s, i);
+        if (!part) continue;
+        if (part->type == SNTX_FOR_INIT) init = part;
+        else if (part->type == SNTX_FOR_STEP) step = part;
+        else if (part->type == SNTX_CBLOCK) body = part;
+        else cond = part;
+    }
+    if (init) checkStmnt(b, checkNested(init, 0), stmts);
+    struct astStmt forStmt = checkStmtNew(STATEMENT_FOR);
+    forStmt.op = checkCondition(b, cond);
+    struct list bodyStmts = ListInit(sizeof(struct astStmt));
+    checkStmnts(b, body, &bodyStmts);
+    if (step) checkStmnt(b, checkNested(step, 0), &bodyStmts);
+    ListRetract(&b->locals, scope);
+    checkSetBlock(b, &forStmt, &bodyStmts);
+    ListDestroy(bodyStmts);
+    ListAdd(stmts, &forStmt);
+}
+
+//the cases and the nomatch are the code block of the match
+void checkMatch(struct checkBody* b, struct syntax* s, struct list* stmts) {
+    struct astOpnd value = checkExpr(b, checkNested(s, 1));
+    if (value.type != TYPE_ID_NONE && (checkBType(value) < BASETYPE_BYTE || checkBType(value) > BASETYPE_INT64)) {
+        ErrMsgTok(checkOpndTok(b, value), OPERATION_REQUIRES_BYTE_OR_INT);
+        value.type = TYPE_ID_NONE;
+    }
+    struct list cases = ListInit(sizeof(struct astStmt));
+    for (int i = 3; i +1 < s->parts.len; i++) {
+        struct syntax* c = checkNested(s, i);
+        struct astStmt caseStmt = checkStmtNew(c->type == SNTX_CASE ? STATEMENT_CASE : STATEMENT_NOMATCH);
+        if (c->type == SNTX_CASE) {
+            struct astOpnd caseValue = checkExpr(b, checkNested(c, 1));
+            caseStmt.op = checkPlace(b, checkAssignable(b, caseValue, value.type, OPERANDS_NOT_SAME_TYPE));
+        }
+        checkCodeBlock(b, checkNested(c, c->parts.len -1), &caseStmt);
+        ListAdd(&cases, &caseStmt);
+    }
+    struct astStmt match = checkStmtNew(STATEMENT_MATCH);
+    match.op = checkPlace(b, value);
+    checkSetBlock(b, &match, &cases);
+    ListDestroy(cases);
+    ListAdd(stmts, &match);
+}
+
+void checkReturn(struct checkBody* b, struct syntax* s, struct list* stmts) {
+    struct list* retType = &b->func->type.retType;
+    struct astStmt ret = checkStmtNew(STATEMENT_RETURN);
+    if (s->parts.len == 3) {
+        struct astOpnd value = checkExpr(b, checkNested(s, 1));
+        if (retType->len == 0) ErrMsgTok(checkOpndTok(b, value), INVALID_RETURN_TYPE);
+        else ret.op = checkPlace(b, checkAssignable(b, value, ((struct type*)ListGetIdx(retType, 0))->id, INVALID_RETURN_TYPE));
+    }
+    else if (retType->len != 0) ErrMsgTok(checkTok(s, 0), INVALID_RETURN_TYPE);
+    ListAdd(stmts, &ret);
+}
+
+void checkExit(struct checkBody* b, struct syntax* s, struct list* stmts) {
+    struct astStmt exitStmt = checkStmtNew(STATEMENT_EXIT);
+    if (s->parts.len == 3) {
+        struct astOpnd code = checkExpr(b, checkNested(s, 1));
+        if (code.type != TYPE_ID_NONE && checkBType(code) != BASETYPE_INT32 && checkBType(code) != BASETYPE_INT64) {
+            ErrMsgTok(checkOpndTok(b, code), OPERATION_REQUIRES_INT);
+        }
+        else exitStmt.op = checkPlace(b, code);
+    }
+    ListAdd(stmts, &exitStmt);
+}
+
+void checkStmnt(struct checkBody* b, struct syntax* s, struct list* stmts) {
+    switch (s->type) {
+        case SNTX_STMNT_LOC_DECL: checkLocalDecl(b, s, stmts); break;
+        case SNTX_ASS:
+        case SNTX_STMNT_ASS: checkAssignment(b, s, stmts); break;
+        case SNTX_INC:
+        case SNTX_STMNT_INC: checkIncrement(b, s, stmts); break;
+        case SNTX_STMNT_IF: checkIf(b, s, stmts); break;
+        case SNTX_STMNT_FOR: checkFor(b, s, stmts); break;
+        case SNTX_STMNT_MATCH: checkMatch(b, s, stmts); break;
+        case SNTX_STMNT_RET: checkReturn(b, s, stmts); break;
+        case SNTX_STMNT_EXIT: checkExit(b, s, stmts); break;
+        default: ErrorBugFound();
+    }
+}
+
+//every param is its own origin, the copies in the type of the function point to it
+struct var* checkFuncDecl(struct syntax* s) {
+    struct var* func = checkVarNew(checkTok(s, 1), TYPE_ID_NONE, false);
+    func->type.bType = BASETYPE_FUNC;
+    func->type.vars = ListInit(sizeof(struct var));
+    func->type.retType = ListInit(sizeof(struct type));
+    int i = 3;
+    struct syntax* params = checkNested(s, i);
+    if (params) {
+        for (int j = 0; j < params->parts.len; j += 2) {
+            struct syntax* p = checkNested(params, j);
+            TypeId type = TYPE_ID_NONE;
+            checkType(checkNested(p, p->parts.len -1), &type);
+            ListAdd(&func->type.vars, checkVarNew(checkTok(p, 0), type, p->parts.len == 3));
+        }
+        i++;
+    }
+    struct syntax* ret = checkNested(s, ++i);
+    TypeId retType;
+    if (ret->type == SNTX_IDEN_MB_NMESPCE && checkType(ret, &retType)) ListAdd(&func->type.retType, TypeGet(retType));
+    return func;
+}
+
+struct var* checkGlobalDecl(struct syntax* s) {
+    struct syntax* ass = checkNested(s, s->parts.len -1);
+    TypeId type;
+    if (!checkType(checkNested(ass, 0), &type)) return NULL;
+    return checkVarNew(checkTok(s, 0), type, s->parts.len == 3);
+}
+
+//imports were loaded before, they only bring in names prefixed with their alias
+void checkDeclare(struct checkProgram* p, struct checkModule* m, struct syntax* s) {
+    if (s->type != SNTX_STMNT_GLOB) return;
+    struct syntax* def = checkNested(s, 0);
+    struct var* v = def->type == SNTX_FUNC ? checkFuncDecl(def) : checkGlobalDecl(def);
+    if (!v) return;
+    if (checkFindGlobal(m, v->name)) {
+        ErrMsgTok(v->tok, VAR_NAME_IN_USE);
+        return;
+    }
+    struct checkGlobal g = {v, p->decls.len};
+    HashMapAdd(&m->globals, HashBytes(HASH_SEED, v->name.ptr, v->name.len), &g);
+    HashMapAdd(&p->declsByOrigin, HashBytes(HASH_SEED, &v, sizeof(v)), &g);
+    struct checkDecl d = (struct checkDecl){0};
+    d.v = v;
+    d.def = def;
+    d.m = m;
+    ListAdd(&p->decls, &d);
+}
+
+//global initializers must be literals so no code runs before main
+void checkGlobalInit(struct checkDecl* d) {
+    struct syntax* ass = checkNested(d->def, d->def->parts.len -1);
+    struct checkBody b = checkBodyInit(d->m, NULL);
+    struct astOpnd value = checkExpr(&b, checkNested(ass, 2));
+    if (checkTok(ass, 1).type != TOK_ASS) ErrMsgTok(checkTok(ass, 1), EXPECTED_ASSIGNMENT);
+    else if (value.type != TYPE_ID_NONE && !value.isLiteral) ErrMsgTok(checkOpndTok(&b, value), EXPECTED_LITERAL_EXPR);
+    else checkAssignable(&b, value, d->v->type.id, OPERANDS_NOT_SAME_TYPE);
+    AstDestroy(b.af);
+    ListDestroy(b.locals);
+}
+
+//a body skipped by lazy parsing is parsed first, a body with syntax errors is not checked
+void checkFuncBody(struct checkDecl* d) {
+    struct syntax* block = checkNested(d->def, d->def->parts.len -1);
+    if (block->skippedAt != -1) {
+        TimerStart("parse body", d->v->name);
+        bool parsed = SyntaxParseSkipped(d->m->sc, block);
+        TimerStop();
+        if (!parsed) return;
+    }
+    struct checkBody b = checkBodyInit(d->m, d->v);
+    struct list* params = &d->v->type.vars;
+    for (int i = 0; i < params->len; i++) {
+        struct var* param = ListGetIdx(params, i);
+        checkDeclareLocal(&b, param->tok, AstAddVar(b.af, *param));
+    }
+    struct list stmts = ListInit(sizeof(struct astStmt));
+    checkStmnts(&b, checkNested(d->def, d->def->parts.len -1), &stmts);
+    b.af->body = AstAddStmts(b.af, stmts.ptr, stmts.len);
+    b.af->bodyLen = stmts.len;
+    d->v->body = b.af;
+    ListDestroy(stmts);
+    ListDestroy(b.locals);
+}
+
+struct checkWave {
+    struct checkProgram* p;
+    int first; //index into the queue of the first task
+};
+
+//the modules are only read by the tasks, each writes the body of its own function
+void checkDeclTask(void* wave, int taskIdx) {
+    struct checkWave* w = wave;
+    struct checkDecl* d = ListGetIdx(&w->p->decls, *(int*)ListGetIdx(&w->p->queue, w->first + taskIdx));
+    TimerStart("check body", d->v->name);
+    ErrMsgBufferStart(&d->errs);
+    if (d->def->type == SNTX_FUNC) checkFuncBody(d);
+    else checkGlobalInit(d);
+    ErrMsgBufferStop(&d->errs);
+    TimerStop();
+}
+
+struct checkLowering {
+    struct list* program; //struct optFunc
+    struct optConfig* config;
+};
+
+void checkQueue(struct checkProgram* p, int declIdx) {
+    struct checkDecl* d = ListGetIdx(&p->decls, declIdx);
+    if (d->queued) return;
+    d->queued = true;
+    ListAdd(&p->queue, &declIdx);
+}
+
+bool checkOriginCmp(void* origin, void* elem) {
+    return ((struct checkGlobal*)elem)->v == origin;
+}
+
+//the functions a checked body uses, its ast holds a copy of each
+void checkQueueCallees(struct checkProgram* p, struct checkDecl* d) {
+    if (!d->v->body) return;
+    for (int i = 0; i < d->v->body->vars.len; i++) {
+        struct var* origin = AstGetVar(d->v->body, i)->origin;
+        if (origin->type.bType != BASETYPE_FUNC) continue;
+        struct checkGlobal* g = HashMapGet(&p->declsByOrigin, HashBytes(HASH_SEED, &origin, sizeof(origin)), origin, checkOriginCmp);
+        if (g) checkQueue(p, g->decl);
+    }
+}
+
+//all bodies are checked at once, with lazily parsed bodies main and the initializers are checked first
+//and then, wave after wave, the functions the previous wave calls, so unreachable bodies are never parsed
+void checkReachable(struct checkProgram* p, int nThreads) {
+    for (int i = 0; i < p->decls.len; i++) {
+        struct checkDecl* d = ListGetIdx(&p->decls, i);
+        bool isMain = d->m->idx == 0 && StrCmp(d->v->name, StrFromCStr("main"));
+        if (!p->lazyBodies || d->def->type != SNTX_FUNC || isMain) checkQueue(p, i);
+    }
+    int first = 0;
+    while (first < p->queue.len) {
+        struct checkWave w = {p, first};
+        int end = p->queue.len;
+        PoolRun(nThreads, end - first, checkDeclTask, &w);
+        for (int i = first; i < end; i++) checkQueueCallees(p, ListGetIdx(&p->decls, *(int*)ListGetIdx(&p->queue, i)));
+        first = end;
+    }
+}
+
+struct checkModule* checkModuleNew(struct checkProgram* p, struct str fileName, unsigned long long srcHash) {
+    struct checkModule* m = MallocOrCrash(sizeof(struct checkModule));
+    *m = (struct checkModule){0};
+    m->idx = p->modules.len;
+    m->fileName = fileName;
+    m->srcHash = srcHash;
+    m->globals = HashMapInit(sizeof(struct checkGlobal));
+    m->imports = ListInit(sizeof(struct checkImport));
+    ListAdd(&p->modules, &m);
+    return m;
+}
+
+void checkLoadImports(struct checkProgram* p, struct checkModule* m);
+
+//a module with a fresh interface is neither tokenized nor parsed, nor are the modules it imports
+bool checkLoadIface(struct checkModule* m) {
+    TimerStart("load interface", m->fileName);
+    bool loaded = IfaceLoad(m->fileName, m->srcHash, &m->ifc);
+    TimerStop();
+    if (!loaded) return false;
+    for (int i = 0; i < m->ifc.vars.len; i++) {
+        struct var* v = VarAllocSetOrigin();
+        *v = *(struct var*)ListGetIdx(&m->ifc.vars, i);
+        v->origin = v;
+        struct checkGlobal g = {v, -1};
+        HashMapAdd(&m->globals, HashBytes(HASH_SEED, v->name.ptr, v->name.len), &g);
+    }
+    return true;
+}
+
+//paths are relative to the working directory, a file imported through another path or as a byte identical copy
+//is loaded once, a new module is added before its own imports are loaded so imports may be cyclic
+struct checkModule* checkLoadModule(struct checkProgram* p, struct token fileTok) {
+    char* fileName = MallocOrCrash(fileTok.str.len -1); //the tokens of the module point into it from now on
+    StrGetAsCStr(Str(fileTok.str.ptr +1, fileTok.str.len -2), fileName);
+    struct moduleId id;
+    if (!ModuleIdsFind(&p->ids, fileName, &id)) {
+        ErrMsgTok(fileTok, UNABLE_TO_OPEN_FILE);
+        free(fileName);
+        return NULL;
+    }
+    if (id.module != -1) {
+        ModuleIdsAdd(&p->ids, id, id.module);
+        free(fileName);
+        return *(struct checkModule**)ListGetIdx(&p->modules, id.module);
+    }
+    struct checkModule* m = checkModuleNew(p, StrFromCStr(fileName), id.srcHash);
+    ModuleIdsAdd(&p->ids, id, m->idx);
+    if (!p->wholeProgram && checkLoadIface(m)) return m;
+    m->sc = ParseSyntax(fileName, false, p->lazyBodies);
+    checkLoadImports(p, m);
+    return m;
+}
+
+void checkLoadImports(struct checkProgram* p, struct checkModule* m) {
+    for (int i = 0; i < m->sc->syntax.len; i++) {
+        struct syntax* s = ListGetIdx(&m->sc->syntax, i);
+        if (s->type != SNTX_IMPORT) continue;
+        struct checkImport import = {checkTok(s, 1).str, NULL};
+        if (checkFindImport(m, import.alias)) {
+            ErrMsgTok(checkTok(s, 1), FILE_ALIAS_IN_USE);
+            continue;
+        }
+        import.m = checkLoadModule(p, checkTok(s, 2));
+        if (import.m) ListAdd(&m->imports, &import);
+    }
+}
+
+//the main file is known by its identity too, so importing it loads no copy
+struct checkProgram checkProgramInit(SyntaxCtx sc, bool wholeProgram) {
+    struct checkProgram p;
+    p.modules = ListInit(sizeof(struct checkModule*));
+    p.ids = ModuleIdsInit();
+    p.lazyBodies = sc->lazyBodies;
+    p.wholeProgram = wholeProgram;
+    p.decls = ListInit(sizeof(struct checkDecl));
+    p.declsByOrigin = HashMapInit(sizeof(struct checkGlobal));
+    p.queue = ListInit(sizeof(int));
+    struct str fileName = TokenGetFileName(sc->tc);
+    char cFileName[fileName.len +1];
+    StrGetAsCStr(fileName, cFileName);
+    struct moduleId id = (struct moduleId){0};
+    bool found = ModuleIdsFind(&p.ids, cFileName, &id);
+    struct checkModule* m = checkModuleNew(&p, fileName, id.srcHash);
+    m->sc = sc;
+    if (found) ModuleIdsAdd(&p.ids, id, m->idx);
+    checkLoadImports(&p, m);
+    return p;
+}
+
+//the interface of a module is stale once any module it reaches through imports changes
+void checkAddDeps(struct checkProgram* p, struct checkModule* m, bool* reached, struct iface* ifc) {
+    for (int i = 0; i < m->imports.len; i++) {
+        struct checkModule* dep = ((struct checkImport*)ListGetIdx(&m->imports, i))->m;
+        if (reached[dep->idx]) continue;
+        reached[dep->idx] = true;
+        struct ifaceDep d = {dep->fileName, dep->srcHash};
+        ListAdd(&ifc->deps, &d);
+        if (dep->sc) checkAddDeps(p, dep, reached, ifc);
+        else for (int j = 0; j < dep->ifc.deps.len; j++) ListAdd(&ifc->deps, ListGetIdx(&dep->ifc.deps, j));
+    }
+}
+
+void checkWriteIface(struct checkProgram* p, struct checkModule* m) {
+    struct iface ifc = IfaceInit();
+    ifc.srcHash = m->srcHash;
+    bool* reached = CallocOrCrash(p->modules.len * sizeof(bool));
+    reached[m->idx] = true;
+    checkAddDeps(p, m, reached, &ifc);
+    free(reached);
+    for (int i = 0; i < p->decls.len; i++) {
+        struct checkDecl* d = ListGetIdx(&p->decls, i);
+        if (d->m == m && checkIsPublic(d->v->name)) ListAdd(&ifc.vars, d->v);
+    }
+    IfaceWrite(m->fileName, &ifc);
+    IfaceDestroy(ifc);
+}
+
+void checkProgramDestroy(struct checkProgram p) {
+    for (int i = 0; i < p.modules.len; i++) {
+        struct checkModule* m = *(struct checkModule**)ListGetIdx(&p.modules, i);
+        HashMapDestroy(m->globals);
+        ListDestroy(m->imports);
+        if (!m->sc) IfaceDestroy(m->ifc);
+        free(m);
+    }
+    ListDestroy(p.modules);
+    ModuleIdsDestroy(p.ids);
+    ListDestroy(p.decls);
+    HashMapDestroy(p.declsByOrigin);
+    ListDestroy(p.queue);
+}
+
+void checkLowerTask(void* lowering, int funcIdx) {
+    struct checkLowering* l = lowering;
+    struct var* func = ((struct optFunc*)ListGetIdx(l->program, funcIdx))->func;
+    TimerStart("lower to ir", func->name);
+    func->ir = IrBuild(func);
+    TimerStop();
+    OptRun(func->ir, l->config);
+}
+
+//the imported modules are loaded first, from their interface if it is fresh, then every signature is declared
+//and the bodies and initializers are checked and lowered in parallel,
+//the passes across functions run once every function is optimized on its own
+struct list CheckSyntax(SyntaxCtx sc, int nThreads, struct optConfig* config) {
+    int nErrors = ErrMsgGetNErrors();
+    TimerStart("check", TokenGetFileName(sc->tc));
+    struct checkProgram p = checkProgramInit(sc, config->wholeProgram);
+    struct list program = ListInit(sizeof(struct optFunc));
+    if (ErrMsgGetNErrors() != nErrors) { //the trees of files with syntax errors may be incomplete
+        TimerStop();
+        checkProgramDestroy(p);
+        return program;
+    }
+    for (int i = 0; i < p.modules.len; i++) {
+        struct checkModule* m = *(struct checkModule**)ListGetIdx(&p.modules, i);
+        for (int j = 0; m->sc && j < m->sc->syntax.len; j++) checkDeclare(&p, m, ListGetIdx(&m->sc->syntax, j));
+    }
+    checkReachable(&p, nThreads);
+    for (int i = 0; i < p.decls.len; i++) {
+        struct checkDecl* d = ListGetIdx(&p.decls, i);
+        ErrMsgBufferFlush(&d->errs);
+        if (d->def->type != SNTX_FUNC || !d->queued) continue;
+        struct optFunc of = {d->v, d->m->idx};
+        ListAdd(&program, &of);
+    }
+    //with lazily parsed bodies unreachable ones were never checked, so their module may still have errors
+    for (int i = 0; i < p.modules.len && ErrMsgGetNErrors() == nErrors && !p.lazyBodies; i++) {
+        struct checkModule* m = *(struct checkModule**)ListGetIdx(&p.modules, i);
+        if (m->sc) checkWriteIface(&p, m);
+    }
+    TimerStop();
+    checkProgramDestroy(p);
+    if (ErrMsgGetNErrors() != nErrors) return program;
+
+    struct checkLowering lowering = {&program, config};
+    PoolRun(nThreads, program.len, checkLowerTask, &lowering);
+    OptEvalProgram(&program, config);
+    OptInlineProgram(&program, config);
+    if (config->boundsReport) OptBoundsReport(&program, stdout);
+    if (config->tailReport) OptTailReport(&program, stdout);
+    return program;
+}
+
+//every function of the file is checked and lowered, answer calls square with a literal and folded returns a literal,
+//a float literal is exact as a float64 and rounded once as a float32
+TEST(CheckLowersSource) {
+    bool passed;
+    struct list program = IrTestCheckFile("test3.olang", OPT_LEVEL_0, false, &passed);
+    passed = passed && program.len == 12;
+    struct optFunc* answer = IrTestFind(&program, "answer");
+    struct optFunc* square = IrTestFind(&program, "square");
+    int nCalls = 0;
+    for (int i = 0; passed && answer && square && i < answer->func->ir->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(answer->func->ir, i);
+        if (in->op == IR_CALL && in->var->origin == square->func) nCalls++;
+    }
+    passed = passed && nCalls == 1 && IrTestRetConst(&program, "folded") == 25;
+    passed = passed && IrTestRetConst(&program, "tenth") == FoldToBits(FoldFloat(BASETYPE_FLOAT64, 0.1));
+    passed = passed && IrTestRetConst(&program, "tenthSingle") == FoldToBits(FoldFloat(BASETYPE_FLOAT64, 0.1f));
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//whether the statements of the block and of the blocks nested in it were added before the statement holding them,
+//nStmts counts them all
+bool testCheckAstBlock(struct astFunc* af, int block, int len, int* nStmts) {
+    for (int i = block; i < block + len; i++) {
+        struct astStmt* s = AstGetStmt(af, i);
+        (*nStmts)++;
+        if (s->blockLen == 0) continue;
+        if (s->block + s->blockLen > i || !testCheckAstBlock(af, s->block, s->blockLen, nStmts)) return false;
+    }
+    return true;
+}
+
+//the nodes of sumTo are small, its body is added last, every child before its parent and no statement twice,
+//and total is stored once however often it is used
+TEST(CheckBuildsFlatAst) {
+    bool passed;
+    struct list program = IrTestCheckFile("test3.olang", OPT_LEVEL_0, false, &passed);
+    struct optFunc* sumTo = passed ? IrTestFind(&program, "sumTo") : NULL;
+    struct astFunc* af = sumTo ? sumTo->func->body : NULL;
+    int nStmts = 0;
+    passed = af && sizeof(struct astStmt) <= 32 && sizeof(struct astOpnd) <= 32;
+    passed = passed && af->body + af->bodyLen == af->stmts.len && testCheckAstBlock(af, af->body, af->bodyLen, &nStmts);
+    passed = passed && nStmts == af->stmts.len;
+    for (int i = 0; passed && i < af->opnds.len; i++) {
+        struct astOpnd* o = AstGetOpnd(af, i);
+        passed = o->nArgs == 0 || o->args + o->nArgs <= i;
+    }
+    int nTotals = 0;
+    for (int i = 0; passed && i < af->vars.len; i++) nTotals += StrCmp(AstGetVar(af, i)->name, StrFromCStr("total"));
+    passed = passed && nTotals == 1;
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//both factors of poly are the same x * 3 + 1, built once and shared by the product
+TEST(CheckSharesSubexpressions) {
+    bool passed;
+    struct list program = IrTestCheckFile("test3.olang", OPT_LEVEL_0, false, &passed);
+    struct optFunc* poly = passed ? IrTestFind(&program, "poly") : NULL;
+    struct astFunc* af = poly ? poly->func->body : NULL;
+    struct astOpnd* product = NULL;
+    for (int i = 0; af && i < af->opnds.len; i++) {
+        struct astOpnd* o = AstGetOpnd(af, i);
+        if (o->opType == OPERATION_MUL && o->nArgs == 2 && AstGetOpnd(af, o->args)->opType == OPERATION_ADD) product = o;
+    }
+    passed = product && AstGetOpnd(af, product->args)->args == AstGetOpnd(af, product->args +1)->args;
+    passed = passed && AstGetOpnd(af, product->args +1)->opType == OPERATION_ADD;
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//square(6) + 6 is evaluated at compile time once the whole program is optimized
+TEST(CheckOptimizesSource) {
+    bool passed;
+    struct list program = IrTestCheckFile("test3.olang", OPT_LEVEL_2, false, &passed);
+    passed = passed && IrTestRetConst(&program, "answer") == 42;
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//whether the body of the function is still skipped by lazy parsing
+bool testCheckBodySkipped(SyntaxCtx sc, char* name) {
+    for (int i = 0; i < sc->syntax.len; i++) {
+        struct syntax* def = checkNested(ListGetIdx(&sc->syntax, i), 0);
+        if (def->type == SNTX_FUNC && StrCmp(checkTok(def, 1).str, StrFromCStr(name))) {
+            return checkNested(def, def->parts.len -1)->skippedAt != -1;
+        }
+    }
+    return false;
+}
+
+//only main, what it calls and what those call are parsed and lowered, the other bodies stay skipped
+TEST(CheckLazyBodies) {
+    int nErrors = ErrMsgGetNErrors();
+    struct optConfig config = OptConfigForLevel(OPT_LEVEL_0);
+    SyntaxCtx sc = ParseSyntax("test3.olang", false, true);
+    struct list program = CheckSyntax(sc, PoolDefaultThreads(), &config);
+    char* reached[] = {"square", "answer", "sumTo", "classify", "drain", "half", "main"};
+    bool passed = ErrMsgGetNErrors() == nErrors && program.len == 7;
+    for (int i = 0; passed && i < 7; i++) {
+        struct optFunc* of = IrTestFind(&program, reached[i]);
+        passed = of && of->func->ir && !testCheckBodySkipped(sc, reached[i]);
+    }
+    passed = passed && testCheckBodySkipped(sc, "widen") && testCheckBodySkipped(sc, "folded") && testCheckBodySkipped(sc, "tenth");
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//testlib.olang is imported through two paths, it is loaded once and both aliases call the same Twice
+TEST(CheckImportsOnce) {
+    remove("testlib.olang" IFACE_FILE_EXT);
+    bool passed;
+    struct list program = IrTestCheckFile("testimport.olang", OPT_LEVEL_0, false, &passed);
+    int maxModule = 0;
+    for (int i = 0; i < program.len; i++) {
+        struct optFunc* of = ListGetIdx(&program, i);
+        if (of->module > maxModule) maxModule = of->module;
+    }
+    passed = passed && program.len == 3 && maxModule == 1;
+    struct optFunc* main = passed ? IrTestFind(&program, "main") : NULL;
+    int nFuncs = 0;
+    for (int i = 0; main && i < main->func->body->vars.len; i++) {
+        struct var* v = AstGetVar(main->func->body, i);
+        if (v->type.bType == BASETYPE_FUNC) nFuncs++;
+    }
+    passed = passed && nFuncs == 1 && IrTestFind(&program, "Twice")->module == 1;
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//the first check writes the interface of testlib.olang, the second loads Twice from it without parsing the file
+TEST(CheckLoadsInterface) {
+    remove("testlib.olang" IFACE_FILE_EXT);
+    bool passed;
+    IrTestProgramDestroy(IrTestCheckFile("testimport.olang", OPT_LEVEL_0, false, &passed));
+    FILE* fp = fopen("testlib.olang" IFACE_FILE_EXT, "rb");
+    passed = passed && fp;
+    if (fp) fclose(fp);
+    bool loaded;
+    struct list program = IrTestCheckFile("testimport.olang", OPT_LEVEL_0, false, &loaded);
+    passed = passed && loaded && program.len == 1;
+    struct optFunc* main = passed ? IrTestFind(&program, "main") : NULL;
+    struct var* twice = NULL;
+    for (int i = 0; main && i < main->func->body->vars.len; i++) {
+        struct var* v = AstGetVar(main->func->body, i);
+        if (v->type.bType == BASETYPE_FUNC) twice = v->origin;
+    }
+    passed = passed && twice && StrCmp(twice->name, StrFromCStr("Twice")) && !twice->body;
+    passed = passed && twice->type.vars.len == 1 && twice->type.retType.len == 1;
+    passed = passed && ((struct var*)ListGetIdx(&twice->type.vars, 0))->type.id == TypeVanillaId(BASETYPE_INT32);
+    passed = passed && ((struct type*)ListGetIdx(&twice->type.retType, 0))->id == TypeVanillaId(BASETYPE_INT32);
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//the bodies are checked and lowered in whatever order the threads take them, what is printed and built must not depend on it
+TEST(CheckSameWithThreads) {
+    char* fileNames[] = {"testerrors.olang", "test3.olang"};
+    int expectedErrors[] = {4, 0};
+    bool passed = true;
+    for (int i = 0; i < 2 && passed; i++) {
+        int nErrors[2];
+        char* single = IrTestCheckDump(fileNames[i], OPT_LEVEL_2, 1, &nErrors[0]);
+        char* parallel = IrTestCheckDump(fileNames[i], OPT_LEVEL_2, 4, &nErrors[1]);
+        passed = single && parallel && strcmp(single, parallel) == 0 && strlen(single) > 0;
+        passed = passed && nErrors[0] == expectedErrors[i] && nErrors[1] == expectedErrors[i];
+        free(single);
+        free(parallel);
+    }
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
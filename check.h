@@ -0,0 +1,14 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include "syntax.h"
+#include "list.h"
+#include "opt.h"
+
+//loads the modules the file imports, from their interface file if it is fresh and the config is not whole program, resolves the names and checks the types of the trees ParseSyntax built,
+//every function body gets its ast and, if the program has no errors, its ir optimized as configured
+//bodies are checked on up to nThreads threads, their diagnostics are printed by module in the order of definition
+//every module checked from source gets an interface file once all bodies of the program are checked without errors
+struct list CheckSyntax(SyntaxCtx sc, int nThreads, struct optConfig* config); //struct optFunc; by module in the order of definition
+
+#endif //CHECK_H
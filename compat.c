@@ -0,0 +1,310 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "compat.h"
+#include "errmsg.h"
+#include "util.h"
+
+//the literal column is the class of literals, which may be used as a wider type than their own
+static const unsigned char compatClasses[BASETYPE_COUNT][2] = {
+    [BASETYPE_BOOL] = {COMPAT_BOOL, COMPAT_BOOL},
+    [BASETYPE_BYTE] = {COMPAT_BYTE, COMPAT_BYTE},
+    [BASETYPE_INT32] = {COMPAT_INT32, COMPAT_INT32_LIT},
+    [BASETYPE_INT64] = {COMPAT_INT64, COMPAT_INT64_LIT},
+    [BASETYPE_FLOAT32] = {COMPAT_FLOAT32, COMPAT_FLOAT32_LIT},
+    [BASETYPE_FLOAT64] = {COMPAT_FLOAT64, COMPAT_FLOAT64_LIT},
+    [BASETYPE_ARRAY] = {COMPAT_OTHER, COMPAT_OTHER},
+    [BASETYPE_STRUCT] = {COMPAT_OTHER, COMPAT_OTHER},
+    [BASETYPE_VOCAB] = {COMPAT_OTHER, COMPAT_OTHER},
+    [BASETYPE_FUNC] = {COMPAT_OTHER, COMPAT_OTHER},
+    [BASETYPE_ERROR] = {COMPAT_OTHER, COMPAT_OTHER},
+};
+
+//entries are the base type of the result +1 so operations without a rule are incompatible
+#define xx 0
+#define BO (BASETYPE_BOOL +1)
+#define BY (BASETYPE_BYTE +1)
+#define I4 (BASETYPE_INT32 +1)
+#define I8 (BASETYPE_INT64 +1)
+#define F4 (BASETYPE_FLOAT32 +1)
+#define F8 (BASETYPE_FLOAT64 +1)
+
+//rows are the lhs and columns the rhs
+//both numbers of the same type, a literal converts to the type of the other operand
+#define RULE_ARITH { \
+    /*       BO  BY  I4  I4L I8  I8L F4  F4L F8  F8L OT */ \
+    /*BO */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*BY */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I4 */ {xx, xx, I4, I4, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I4L*/ {xx, xx, I4, I4, I8, I8, F4, F4, F8, F8, xx}, \
+    /*I8 */ {xx, xx, xx, I8, I8, I8, xx, xx, xx, xx, xx}, \
+    /*I8L*/ {xx, xx, xx, I8, I8, I8, F4, F4, F8, F8, xx}, \
+    /*F4 */ {xx, xx, xx, F4, xx, F4, F4, F4, xx, F4, xx}, \
+    /*F4L*/ {xx, xx, xx, F4, xx, F4, F4, F4, F8, F8, xx}, \
+    /*F8 */ {xx, xx, xx, F8, xx, F8, xx, F8, F8, F8, xx}, \
+    /*F8L*/ {xx, xx, xx, F8, xx, F8, F4, F8, F8, F8, xx}, \
+    /*OT */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+}
+
+//like arithmetic but the result is a boolean
+#define RULE_COMPARE { \
+    /*       BO  BY  I4  I4L I8  I8L F4  F4L F8  F8L OT */ \
+    /*BO */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*BY */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I4 */ {xx, xx, BO, BO, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I4L*/ {xx, xx, BO, BO, BO, BO, BO, BO, BO, BO, xx}, \
+    /*I8 */ {xx, xx, xx, BO, BO, BO, xx, xx, xx, xx, xx}, \
+    /*I8L*/ {xx, xx, xx, BO, BO, BO, BO, BO, BO, BO, xx}, \
+    /*F4 */ {xx, xx, xx, BO, xx, BO, BO, BO, xx, BO, xx}, \
+    /*F4L*/ {xx, xx, xx, BO, xx, BO, BO, BO, BO, BO, xx}, \
+    /*F8 */ {xx, xx, xx, BO, xx, BO, xx, BO, BO, BO, xx}, \
+    /*F8L*/ {xx, xx, xx, BO, xx, BO, BO, BO, BO, BO, xx}, \
+    /*OT */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+}
+
+//both booleans
+#define RULE_LOGIC { \
+    /*       BO  BY  I4  I4L I8  I8L F4  F4L F8  F8L OT */ \
+    /*BO */ {BO, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*BY */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I4 */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I4L*/ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I8 */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I8L*/ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F4 */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F4L*/ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F8 */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F8L*/ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*OT */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+}
+
+//both integers, the result has the type of the lhs
+#define RULE_MODULO { \
+    /*       BO  BY  I4  I4L I8  I8L F4  F4L F8  F8L OT */ \
+    /*BO */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*BY */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I4 */ {xx, xx, I4, I4, I4, I4, xx, xx, xx, xx, xx}, \
+    /*I4L*/ {xx, xx, I4, I4, I4, I4, xx, xx, xx, xx, xx}, \
+    /*I8 */ {xx, xx, I8, I8, I8, I8, xx, xx, xx, xx, xx}, \
+    /*I8L*/ {xx, xx, I8, I8, I8, I8, xx, xx, xx, xx, xx}, \
+    /*F4 */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F4L*/ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F8 */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F8L*/ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*OT */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+}
+
+//a byte or integer shifted by an integer, the result has the type of the lhs
+#define RULE_SHIFT { \
+    /*       BO  BY  I4  I4L I8  I8L F4  F4L F8  F8L OT */ \
+    /*BO */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*BY */ {xx, xx, BY, BY, BY, BY, xx, xx, xx, xx, xx}, \
+    /*I4 */ {xx, xx, I4, I4, I4, I4, xx, xx, xx, xx, xx}, \
+    /*I4L*/ {xx, xx, I4, I4, I4, I4, xx, xx, xx, xx, xx}, \
+    /*I8 */ {xx, xx, I8, I8, I8, I8, xx, xx, xx, xx, xx}, \
+    /*I8L*/ {xx, xx, I8, I8, I8, I8, xx, xx, xx, xx, xx}, \
+    /*F4 */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F4L*/ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F8 */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F8L*/ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*OT */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+}
+
+//bytes or integers of the same size
+#define RULE_BITWISE { \
+    /*       BO  BY  I4  I4L I8  I8L F4  F4L F8  F8L OT */ \
+    /*BO */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*BY */ {xx, BY, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I4 */ {xx, xx, I4, I4, xx, xx, xx, xx, xx, xx, xx}, \
+    /*I4L*/ {xx, xx, I4, I4, I8, I8, xx, xx, xx, xx, xx}, \
+    /*I8 */ {xx, xx, xx, I8, I8, I8, xx, xx, xx, xx, xx}, \
+    /*I8L*/ {xx, xx, xx, I8, I8, I8, xx, xx, xx, xx, xx}, \
+    /*F4 */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F4L*/ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F8 */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*F8L*/ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+    /*OT */ {xx, xx, xx, xx, xx, xx, xx, xx, xx, xx, xx}, \
+}
+
+static const unsigned char compatBinary[OPERATION_COUNT][COMPAT_CLASS_COUNT][COMPAT_CLASS_COUNT] = {
+    [OPERATION_MODULO] = RULE_MODULO,
+    [OPERATION_ADD] = RULE_ARITH,
+    [OPERATION_SUB] = RULE_ARITH,
+    [OPERATION_MUL] = RULE_ARITH,
+    [OPERATION_DIV] = RULE_ARITH,
+    [OPERATION_LESS_THAN] = RULE_COMPARE,
+    [OPERATION_LESS_THAN_OR_EQUAL] = RULE_COMPARE,
+    [OPERATION_GREATER_THAN] = RULE_COMPARE,
+    [OPERATION_GREATER_THAN_OR_EQUAL] = RULE_COMPARE,
+    [OPERATION_EQUALS] = RULE_COMPARE,
+    [OPERATION_NOT_EQUALS] = RULE_COMPARE,
+    [OPERATION_AND] = RULE_LOGIC,
+    [OPERATION_OR] = RULE_LOGIC,
+    [OPERATION_XOR] = RULE_LOGIC,
+    [OPERATION_BITSHIFT_LEFT] = RULE_SHIFT,
+    [OPERATION_BITSHIFT_RIGHT] = RULE_SHIFT,
+    [OPERATION_BITWISE_AND] = RULE_BITWISE,
+    [OPERATION_BITWISE_OR] = RULE_BITWISE,
+    [OPERATION_BITWISE_XOR] = RULE_BITWISE,
+};
+
+#undef xx
+#undef BO
+#undef BY
+#undef I4
+#undef I8
+#undef F4
+#undef F8
+
+//reported for an operand that can not be used as that arg no matter the other one
+static char* const compatBinaryArgErrors[OPERATION_COUNT][2] = {
+    [OPERATION_MODULO] = {OPERATION_REQUIRES_INT, OPERATION_REQUIRES_INT},
+    [OPERATION_ADD] = {OPERATION_REQUIRES_NUMBER, OPERATION_REQUIRES_NUMBER},
+    [OPERATION_SUB] = {OPERATION_REQUIRES_NUMBER, OPERATION_REQUIRES_NUMBER},
+    [OPERATION_MUL] = {OPERATION_REQUIRES_NUMBER, OPERATION_REQUIRES_NUMBER},
+    [OPERATION_DIV] = {OPERATION_REQUIRES_NUMBER, OPERATION_REQUIRES_NUMBER},
+    [OPERATION_LESS_THAN] = {OPERATION_REQUIRES_NUMBER, OPERATION_REQUIRES_NUMBER},
+    [OPERATION_LESS_THAN_OR_EQUAL] = {OPERATION_REQUIRES_NUMBER, OPERATION_REQUIRES_NUMBER},
+    [OPERATION_GREATER_THAN] = {OPERATION_REQUIRES_NUMBER, OPERATION_REQUIRES_NUMBER},
+    [OPERATION_GREATER_THAN_OR_EQUAL] = {OPERATION_REQUIRES_NUMBER, OPERATION_REQUIRES_NUMBER},
+    [OPERATION_EQUALS] = {OPERATION_REQUIRES_NUMBER, OPERATION_REQUIRES_NUMBER},
+    [OPERATION_NOT_EQUALS] = {OPERATION_REQUIRES_NUMBER, OPERATION_REQUIRES_NUMBER},
+    [OPERATION_AND] = {OPERATION_REQUIRES_BOOL, OPERATION_REQUIRES_BOOL},
+    [OPERATION_OR] = {OPERATION_REQUIRES_BOOL, OPERATION_REQUIRES_BOOL},
+    [OPERATION_XOR] = {OPERATION_REQUIRES_BOOL, OPERATION_REQUIRES_BOOL},
+    [OPERATION_BITSHIFT_LEFT] = {OPERATION_REQUIRES_BYTE_OR_INT, OPERATION_REQUIRES_INT},
+    [OPERATION_BITSHIFT_RIGHT] = {OPERATION_REQUIRES_BYTE_OR_INT, OPERATION_REQUIRES_INT},
+    [OPERATION_BITWISE_AND] = {OPERATION_REQUIRES_BYTE_OR_INT, OPERATION_REQUIRES_BYTE_OR_INT},
+    [OPERATION_BITWISE_OR] = {OPERATION_REQUIRES_BYTE_OR_INT, OPERATION_REQUIRES_BYTE_OR_INT},
+    [OPERATION_BITWISE_XOR] = {OPERATION_REQUIRES_BYTE_OR_INT, OPERATION_REQUIRES_BYTE_OR_INT},
+};
+
+#define RULE_BOOL {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+#define RULE_BYTE_OR_INT {0, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0}
+#define RULE_INT {0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0}
+#define RULE_NUMBER {0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0}
+#define RULE_NUMBER_OR_BYTE {0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0}
+
+static const bool compatUnary[OPERATION_COUNT][COMPAT_CLASS_COUNT] = {
+    [OPERATION_NOT] = RULE_BOOL,
+    [OPERATION_BITWISE_COMPLEMENT] = RULE_BYTE_OR_INT,
+    [OPERATION_PLUS] = RULE_NUMBER,
+    [OPERATION_MINUS] = RULE_NUMBER,
+};
+
+static char* const compatUnaryErrors[OPERATION_COUNT] = {
+    [OPERATION_NOT] = OPERATION_REQUIRES_BOOL,
+    [OPERATION_BITWISE_COMPLEMENT] = OPERATION_REQUIRES_BYTE_OR_INT,
+    [OPERATION_PLUS] = OPERATION_REQUIRES_NUMBER,
+    [OPERATION_MINUS] = OPERATION_REQUIRES_NUMBER,
+};
+
+//indexed by the target type, casts between byte arrays are checked by the caller
+static const bool compatTypeCast[BASETYPE_COUNT][COMPAT_CLASS_COUNT] = {
+    [BASETYPE_BYTE] = RULE_INT,
+    [BASETYPE_INT32] = RULE_NUMBER_OR_BYTE,
+    [BASETYPE_INT64] = RULE_NUMBER_OR_BYTE,
+    [BASETYPE_FLOAT32] = RULE_NUMBER_OR_BYTE,
+    [BASETYPE_FLOAT64] = RULE_NUMBER_OR_BYTE,
+};
+
+#undef RULE_ARITH
+#undef RULE_COMPARE
+#undef RULE_LOGIC
+#undef RULE_MODULO
+#undef RULE_SHIFT
+#undef RULE_BITWISE
+#undef RULE_BOOL
+#undef RULE_BYTE_OR_INT
+#undef RULE_INT
+#undef RULE_NUMBER
+#undef RULE_NUMBER_OR_BYTE
+
+enum compatClass CompatClass(enum baseType bType, bool isLiteral) {
+    if ((unsigned)bType >= BASETYPE_COUNT) ErrorBugFound();
+    return compatClasses[bType][isLiteral];
+}
+
+bool CompatBinary(enum operation opType, enum compatClass a, enum compatClass b, enum baseType* resBType) {
+    if (!compatBinary[opType][a][b]) return false;
+    *resBType = compatBinary[opType][a][b] -1;
+    return true;
+}
+
+//an arg is usable if there is any other arg it is compatible with
+char* CompatBinaryArgError(enum operation opType, int argIdx, enum compatClass c) {
+    for (int other = 0; other < COMPAT_CLASS_COUNT; other++) {
+        if (argIdx == 0 ? compatBinary[opType][c][other] : compatBinary[opType][other][c]) return NULL;
+    }
+    return compatBinaryArgErrors[opType][argIdx];
+}
+
+bool CompatUnary(enum operation opType, enum compatClass in) {
+    return compatUnary[opType][in];
+}
+
+char* CompatUnaryError(enum operation opType) {
+    return compatUnaryErrors[opType];
+}
+
+bool CompatTypeCast(enum baseType to, enum compatClass from) {
+    return compatTypeCast[to][from];
+}
+
+bool compatIsCommutative(enum operation opType) {
+    switch (opType) {
+        case OPERATION_ADD: return true;
+        case OPERATION_MUL: return true;
+        case OPERATION_EQUALS: return true;
+        case OPERATION_NOT_EQUALS: return true;
+        case OPERATION_AND: return true;
+        case OPERATION_OR: return true;
+        case OPERATION_XOR: return true;
+        case OPERATION_BITWISE_AND: return true;
+        case OPERATION_BITWISE_OR: return true;
+        case OPERATION_BITWISE_XOR: return true;
+        default: return false;
+    }
+}
+
+enum compatClass compatNonLiteral(enum compatClass c) {
+    switch (c) {
+        case COMPAT_INT32_LIT: return COMPAT_INT32;
+        case COMPAT_INT64_LIT: return COMPAT_INT64;
+        case COMPAT_FLOAT32_LIT: return COMPAT_FLOAT32;
+        case COMPAT_FLOAT64_LIT: return COMPAT_FLOAT64;
+        default: return c;
+    }
+}
+
+//walks the whole matrix, properties every rule must have
+TEST(CompatMatrix) {
+    for (int op = 0; op < OPERATION_COUNT; op++) {
+        bool any = false;
+        for (int a = 0; a < COMPAT_CLASS_COUNT; a++) {
+            for (int b = 0; b < COMPAT_CLASS_COUNT; b++) {
+                //a literal can be used wherever a variable of its type can
+                if (compatBinary[op][compatNonLiteral(a)][b] && !compatBinary[op][a][b]) TEST_FAILED
+                if (compatBinary[op][a][compatNonLiteral(b)] && !compatBinary[op][a][b]) TEST_FAILED
+                enum baseType res;
+                if (!CompatBinary(op, a, b, &res)) continue;
+                any = true;
+                //results are vanilla
+                if (CompatClass(res, false) == COMPAT_OTHER) TEST_FAILED
+                //operands of commutative operations can be swapped
+                if (compatIsCommutative(op) && compatBinary[op][b][a] != compatBinary[op][a][b]) TEST_FAILED
+                //usable args are never reported
+                if (CompatBinaryArgError(op, 0, a) || CompatBinaryArgError(op, 1, b)) TEST_FAILED
+            }
+        }
+        //every operation reports what it requires
+        if (any && (!compatBinaryArgErrors[op][0] || !compatBinaryArgErrors[op][1])) TEST_FAILED
+        for (int in = 0; in < COMPAT_CLASS_COUNT; in++) {
+            if (compatUnary[op][in] && !compatUnaryErrors[op]) TEST_FAILED
+        }
+    }
+    for (int to = 0; to < BASETYPE_COUNT; to++) {
+        if (CompatTypeCast(to, COMPAT_OTHER)) TEST_FAILED
+    }
+    TEST_PASSED
+}
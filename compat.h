@@ -0,0 +1,32 @@
+#ifndef COMPAT_H
+#define COMPAT_H
+
+#include <stdbool.h>
+#include "type.h"
+#include "operation.h"
+
+//operands are classified by base type and whether they are literals,
+//the rules for operations and type casts are constant tables indexed by these classes
+enum compatClass {
+    COMPAT_BOOL,
+    COMPAT_BYTE,
+    COMPAT_INT32,
+    COMPAT_INT32_LIT,
+    COMPAT_INT64,
+    COMPAT_INT64_LIT,
+    COMPAT_FLOAT32,
+    COMPAT_FLOAT32_LIT,
+    COMPAT_FLOAT64,
+    COMPAT_FLOAT64_LIT, //float literals keep double precision until used with a float32
+    COMPAT_OTHER,
+    COMPAT_CLASS_COUNT
+};
+
+enum compatClass CompatClass(enum baseType bType, bool isLiteral);
+bool CompatBinary(enum operation opType, enum compatClass a, enum compatClass b, enum baseType* resBType);
+char* CompatBinaryArgError(enum operation opType, int argIdx, enum compatClass c); //NULL if c can be used as that arg
+bool CompatUnary(enum operation opType, enum compatClass in); //the result has the type of in
+char* CompatUnaryError(enum operation opType);
+bool CompatTypeCast(enum baseType to, enum compatClass from);
+
+#endif //COMPAT_H
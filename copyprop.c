@@ -0,0 +1,58 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "util.h"
+
+int copyArg(struct irFunc* f, int instr, int argIdx, int* repl) {
+    int arg = IrGetArg(f, instr, argIdx);
+    while (repl[arg] != IR_NONE) arg = repl[arg];
+    return arg;
+}
+
+//the value an instruction merely copies, IR_NONE if it computes something
+//a phi copies if all its args are the same value or the phi itself, as in loops that never change it
+int copySource(struct irFunc* f, int instr, int* repl) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    switch (in->op) {
+        case IR_OPERATION:
+            if (in->opType == OPERATION_PLUS && in->args.len == 1) return copyArg(f, instr, 0, repl);
+            return IR_NONE;
+        case IR_CAST: return IrGetInstr(f, copyArg(f, instr, 0, repl))->type == in->type ? copyArg(f, instr, 0, repl) : IR_NONE;
+        case IR_PHI: {
+            int src = IR_NONE;
+            for (int i = 0; i < in->args.len; i++) {
+                int arg = copyArg(f, instr, i, repl);
+                if (arg == instr || arg == src) continue;
+                if (src != IR_NONE) return IR_NONE;
+                src = arg;
+            }
+            return src;
+        }
+        default: return IR_NONE;
+    }
+}
+
+//removing one copy can turn a phi using it into a copy, so this repeats until nothing is found
+bool OptCopyProp(struct irFunc* f) {
+    int n = f->instrs.len;
+    int* repl = MallocOrCrash(n * sizeof(int) +1);
+    for (int i = 0; i < n; i++) repl[i] = IR_NONE;
+    bool changed = false;
+    bool found = true;
+    while (found) {
+        found = false;
+        for (int i = 0; i < n; i++) {
+            if (IrGetInstr(f, i)->block == IR_NONE) continue;
+            int src = copySource(f, i, repl);
+            if (src == IR_NONE) continue;
+            repl[i] = src;
+            IrRemoveInstr(f, i);
+            found = true;
+            changed = true;
+        }
+    }
+    IrReplaceUsesMapped(f, repl, n);
+    free(repl);
+    return changed;
+}
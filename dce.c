@@ -0,0 +1,44 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "util.h"
+
+//stores, calls, bounds checks and terminators are live, and so is everything they use; the rest is removed
+//cycles of phis that only feed each other are removed as well
+bool dceHasEffect(enum irOp op) {
+    return op == IR_STORE || op == IR_CALL || op == IR_BOUNDSCHECK || IrIsTerminator(op);
+}
+
+bool OptDce(struct irFunc* f) {
+    int n = f->instrs.len;
+    bool* live = CallocOrCrash(n * sizeof(bool) +1);
+    struct list work = ListInit(sizeof(int));
+    for (int i = 0; i < n; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->block == IR_NONE || !dceHasEffect(in->op)) continue;
+        live[i] = true;
+        ListAdd(&work, &i);
+    }
+    while (work.len) {
+        int instr = *(int*)ListGetIdx(&work, work.len -1);
+        ListRetract(&work, work.len -1);
+        struct irInstr* in = IrGetInstr(f, instr);
+        for (int i = 0; i < in->args.len; i++) {
+            int arg = IrGetArg(f, instr, i);
+            if (live[arg]) continue;
+            live[arg] = true;
+            ListAdd(&work, &arg);
+        }
+    }
+
+    bool changed = false;
+    for (int i = 0; i < n; i++) {
+        if (live[i] || IrGetInstr(f, i)->block == IR_NONE) continue;
+        IrRemoveInstr(f, i);
+        changed = true;
+    }
+    free(live);
+    ListDestroy(work);
+    return changed;
+}
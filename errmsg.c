@@ -5,8 +5,49 @@
 #include "token.h"
 
 static int nErrors = 0;
+static _Thread_local struct errMsgBuffer* curBuffer = NULL;
+
+//also those of the calling thread that are still buffered
 int ErrMsgGetNErrors() {
-    return nErrors;
+    int n = nErrors;
+    for (struct errMsgBuffer* b = curBuffer; b; b = b->outer) n += b->nErrors;
+    return n;
+}
+
+FILE* errOut() {
+    return curBuffer ? curBuffer->stream : stdout;
+}
+
+void countError() {
+    if (curBuffer) curBuffer->nErrors++;
+    else nErrors++;
+}
+
+void ErrMsgBufferStart(struct errMsgBuffer* b) {
+    *b = (struct errMsgBuffer){0};
+    b->stream = open_memstream(&b->text, &b->len);
+    if (!b->stream) {
+        fputs(COLOR_FG_RED "ERROR: " COLOR_RESET "memory allocation failed\n", stderr);
+        exit(EXIT_FAILURE);
+    }
+    b->outer = curBuffer;
+    curBuffer = b;
+}
+
+void ErrMsgBufferStop(struct errMsgBuffer* b) {
+    if (curBuffer != b) ErrorBugFound();
+    fclose(b->stream);
+    b->stream = NULL;
+    curBuffer = b->outer;
+}
+
+void ErrMsgBufferFlush(struct errMsgBuffer* b) {
+    if (b->stream) ErrorBugFound();
+    if (b->text) fwrite(b->text, 1, b->len, errOut());
+    if (curBuffer) curBuffer->nErrors += b->nErrors;
+    else nErrors += b->nErrors;
+    free(b->text);
+    *b = (struct errMsgBuffer){0};
 }
 
 void ErrMsgFinishCompilation() {
@@ -22,6 +63,7 @@ void ErrMsgFinishCompilation() {
     exit(EXIT_SUCCESS);
 }
 
+//fatal errors end the compilation right away, they are never buffered
 void ErrMsgFatal(char* errMsg) {
     nErrors++;
     fputs(COLOR_FG_RED "fatal error: " COLOR_FG_YELLOW, stdout);
@@ -31,23 +73,22 @@ void ErrMsgFatal(char* errMsg) {
 }
 
 void pErrChar(char c) {
-    if (c == '\t') fputs("\\t", stdout);
-    else if (c == '\n') fputs("\\n", stdout);
-    else putchar(c);
+    if (c == '\t') fputs("\\t", errOut());
+    else if (c == '\n') fputs("\\n", errOut());
+    else fputc(c, errOut());
 }
 
-#define MAX_CHARS_PER_LINE 80
 void printErrorLine(TokenCtx tc, int errStart, int errEnd) {
-    int linesStart = TokenGetLineStart(tc, errStart) +1;
+    int linesStart = TokenGetLineStart(tc, errStart);
     int linesEnd = TokenGetLineEnd(tc, errEnd);
 
-    fputs(COLOR_FG_CYAN, stdout);
-    for (int i = linesStart; i < errStart; i++) putchar(TokenGetChar(tc, i));
-    fputs(COLOR_FG_RED, stdout);
+    fputs(COLOR_FG_CYAN, errOut());
+    for (int i = linesStart; i < errStart; i++) fputc(TokenGetChar(tc, i), errOut());
+    fputs(COLOR_FG_RED, errOut());
     for (int i = errStart; i <= errEnd; i++) pErrChar(TokenGetChar(tc, i));
-    fputs(COLOR_FG_CYAN, stdout);
-    for (int i = errEnd +1; i < linesEnd; i++) putchar(TokenGetChar(tc, i));
-    puts("\n" COLOR_RESET);
+    fputs(COLOR_FG_CYAN, errOut());
+    for (int i = errEnd +1; i < linesEnd; i++) fputc(TokenGetChar(tc, i), errOut());
+    fputs("\n" COLOR_RESET "\n", errOut());
 }
 
 void printTokErrorLineOneTok(struct token tok) {
@@ -56,31 +97,25 @@ void printTokErrorLineOneTok(struct token tok) {
 }
 
 #define NO_LINE_NR -1
-void syntaxErrorHeader(int lineNr, struct str fileName, struct str errMsg) {
-    nErrors++;
-    fputs(COLOR_FG_GREEN, stdout);
-    if (lineNr != NO_LINE_NR) printf("%d ", lineNr);
-    StrPrint(fileName, stdout);
-    fputs(COLOR_FG_RED " error: " COLOR_FG_YELLOW, stdout);
-    StrPrint(errMsg, stdout);
-    puts(COLOR_RESET);
+void syntaxErrorHeader(int lineNr, struct str fileName, char* errMsg) {
+    countError();
+    fputs(COLOR_FG_GREEN, errOut());
+    if (lineNr != NO_LINE_NR) fprintf(errOut(), "%d ", lineNr);
+    StrPrint(fileName, errOut());
+    fputs(COLOR_FG_RED " error: " COLOR_FG_YELLOW, errOut());
+    fputs(errMsg, errOut());
+    fputs(COLOR_RESET "\n", errOut());
 }
 
+//the line of an EOF token is not printed, there is nothing to point at
+void ErrMsgTok(struct token tok, char* errMsg) {
+    syntaxErrorHeader(tok.lineNr, TokenGetFileName(tok.owner), errMsg);
+    if (tok.type != TOK_EOF) printTokErrorLineOneTok(tok);
+}
 
 void ErrMsgUnexpectedToken(struct token found, char* expected) {
-    struct str fileName = TokenGetFileName(found.owner);
-    char buf[100];
-
-    //TODO
-    struct str err = StrFromCStr(errMsg);
-    syntaxErrorHeader(tok.lineNr, fileName, err);
-    StrDestroy(err);
-    if (tok.type == TOK_EOF) {
-        //printLastLineEOFError(tok.owner);
-        return;
-    }
-    printTokErrorLineOneTok(tok);
-    //fputs("expected: " COLOR_FG_RED, stdout);
-    //fputs(expected, stdout);
-    //puts(COLOR_RESET);
+    ErrMsgTok(found, UNEXPECTED_TOKEN);
+    fputs("expected: " COLOR_FG_RED, errOut());
+    fputs(expected, errOut());
+    fputs(COLOR_RESET "\n", errOut());
 }
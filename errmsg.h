@@ -1,5 +1,6 @@
 #ifndef ERRMSG_H
 #define ERRMSG_H
+#include <stdio.h>
 #include "token.h"
 
 #define TRAILING_TOKEN "trailing token"
@@ -8,6 +9,9 @@
 #define NAMESPACE_NOT_ALLOWED "namespace not allowed"
 #define TRAILING_COMP_ARGS "trailing compilation arguments"
 #define NO_FILE_SPECIFIED "no file specified"
+#define TRACE_NOT_WRITABLE "unable to write the trace file"
+#define UNABLE_TO_OPEN_FILE "unable to open file"
+#define UNEXPECTED_TOKEN "unexpected token"
 #define EXPECTED_CASE_OR_NOMATCH "expected case or nomatch"
 #define EXPECTED_SEMICOLON "expected ;"
 #define EXPECTED_LITERAL_EXPR "expected literal expression"
@@ -60,6 +64,7 @@
 #define UNKNOWN_ERROR "unknown error"
 #define UNKNOWN_VAR "unknown variable"
 #define UNKNOWN_FILE_ALIAS "unknown file alias"
+#define FILE_ALIAS_IN_USE "file alias already in use"
 #define VOCAB_WORD_ALREADY_IN_USE "vocab word already in use"
 #define ERROR_WORD_ALREADY_IN_USE "error word already in use"
 #define INVALID_ARRAY_SIZE "invalid array size"
@@ -81,6 +86,7 @@
 #define OPERATION_REQUIRES_BYTE_OR_INT "operand must be byte or integer"
 #define OPERANDS_NOT_SAME_TYPE "operand must be the same type"
 #define OPERANDS_NOT_SAME_SIZE "operand must be the same size"
+#define DIVISION_BY_ZERO "division by zero"
 #define EXPECTED_OPERAND "expected operand"
 #define TRAILING_PAREN "trailing parenthesis"
 #define TRAILING_CURLY "trailing curly bracket"
@@ -90,12 +96,28 @@
 #define EXPECTED_STATEMENT "expected statement"
 #define INVALID_EXPRESSION "invalid expression"
 #define VAR_IMMUTABLE "variable is immutable"
+#define FUNC_USED_AS_VALUE "function used as a value"
+#define FUNC_RETURNS_NOTHING "function does not return a value"
+#define WRONG_NUMBER_OF_ARGS "wrong number of arguments"
 #define INVALID_RETURN_TYPE "return statement is of the wrong type"
 #define MAIN_FUNC_NOT_FOUND "could not find the main function"
 
-int ErrMsgGetNErrors();
+//diagnostics of a thread can be buffered, e.g. to print those of parallel tasks in source order
+struct errMsgBuffer {
+    char* text;
+    size_t len;
+    FILE* stream; //NULL once stopped
+    int nErrors; //counted once flushed
+    struct errMsgBuffer* outer; //the buffer of the thread when started, current again once stopped
+};
+
+int ErrMsgGetNErrors(); //including those buffered by the calling thread
+void ErrMsgBufferStart(struct errMsgBuffer* b); //diagnostics of the calling thread go to b until stopped, buffers nest
+void ErrMsgBufferStop(struct errMsgBuffer* b);
+void ErrMsgBufferFlush(struct errMsgBuffer* b); //prints and counts a stopped buffer, into the current buffer if there is one
 void ErrMsgFinishCompilation();
 void ErrMsgFatal(char* errMsg);
+void ErrMsgTok(struct token tok, char* errMsg);
 void ErrMsgUnexpectedToken(struct token found, char* expected);
 
 #endif //ERRMSG_H
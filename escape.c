@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "irtest.h"
+#include "util.h"
+
+//the values loaded from the slot of an array or struct var refer to the memory it owns,
+//that memory escapes once such a value is returned, stored outside the slots of the function or passed as a mut argument
+struct escCtx {
+    struct irFunc* f;
+    struct list* users; //per instruction, int
+    bool* refers; //slots holding and values being a reference to the memory
+    struct list work; //int
+};
+
+bool escOwnsMemory(struct irInstr* in) {
+    if (in->op != IR_ALLOCA || !in->var) return false;
+    struct type* t = &in->var->type;
+    return (t->bType == BASETYPE_ARRAY && t->arrMalloc) || (t->bType == BASETYPE_STRUCT && t->structMAlloc);
+}
+
+void escRefers(struct escCtx* c, int instr) {
+    if (c->refers[instr]) return;
+    c->refers[instr] = true;
+    ListAdd(&c->work, &instr);
+}
+
+//params that are not mut are only borrowed for the call, but the result may be the arg handed back
+bool escCallUse(struct escCtx* c, int call, int value) {
+    struct irInstr* in = IrGetInstr(c->f, call);
+    for (int i = 0; i < in->args.len; i++) {
+        if (IrGetArg(c->f, call, i) != value) continue;
+        if (!in->var || i >= in->var->type.vars.len || ((struct var*)ListGetIdx(&in->var->type.vars, i))->mut) return true;
+    }
+    if (in->type == IrGetInstr(c->f, value)->type) escRefers(c, call);
+    return false;
+}
+
+bool escSlotUse(struct escCtx* c, int slot, int user) {
+    struct irInstr* in = IrGetInstr(c->f, user);
+    if (in->op == IR_LOAD) escRefers(c, user);
+    else if (in->op != IR_STORE || IrGetArg(c->f, user, 1) == slot) return true;
+    return false;
+}
+
+bool escValueUse(struct escCtx* c, int value, int user) {
+    struct irInstr* in = IrGetInstr(c->f, user);
+    switch (in->op) {
+        case IR_RET: return true;
+        case IR_PHI: escRefers(c, user); return false;
+        case IR_CAST: escRefers(c, user); return false;
+        case IR_CALL: return escCallUse(c, user, value);
+        case IR_STORE: {
+            if (IrGetArg(c->f, user, 1) != value) return false;
+            int addr = IrGetArg(c->f, user, 0);
+            if (IrGetInstr(c->f, addr)->op != IR_ALLOCA) return true;
+            escRefers(c, addr);
+            return false;
+        }
+        default: return false;
+    }
+}
+
+bool escEscapes(struct escCtx* c, int alloca) {
+    for (int i = 0; i < c->f->instrs.len; i++) c->refers[i] = false;
+    ListRetract(&c->work, 0);
+    escRefers(c, alloca);
+    while (c->work.len) {
+        int instr = *(int*)ListGetIdx(&c->work, c->work.len -1);
+        ListRetract(&c->work, c->work.len -1);
+        bool slot = IrGetInstr(c->f, instr)->op == IR_ALLOCA;
+        struct list* users = &c->users[instr];
+        for (int i = 0; i < users->len; i++) {
+            int user = *(int*)ListGetIdx(users, i);
+            if (slot ? escSlotUse(c, instr, user) : escValueUse(c, instr, user)) return true;
+        }
+    }
+    return false;
+}
+
+//nothing is ever read from a slot that is only stored to, so the memory it owns is not needed at all
+bool escRemoveIfUnread(struct escCtx* c, int alloca) {
+    struct list* users = &c->users[alloca];
+    for (int i = 0; i < users->len; i++) {
+        int user = *(int*)ListGetIdx(users, i);
+        if (IrGetInstr(c->f, user)->op != IR_STORE || IrGetArg(c->f, user, 1) == alloca) return false;
+    }
+    for (int i = 0; i < users->len; i++) IrRemoveInstr(c->f, *(int*)ListGetIdx(users, i));
+    IrRemoveInstr(c->f, alloca);
+    return true;
+}
+
+bool OptEscape(struct irFunc* f) {
+    int n = f->instrs.len;
+    struct escCtx c = {f, MallocOrCrash(n * sizeof(struct list) +1), MallocOrCrash(n * sizeof(bool) +1), ListInit(sizeof(int))};
+    for (int i = 0; i < n; i++) c.users[i] = ListInit(sizeof(int));
+    for (int i = 0; i < n; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        for (int j = 0; j < in->args.len && in->block != IR_NONE; j++) {
+            int arg = IrGetArg(f, i, j);
+            struct list* users = &c.users[arg];
+            if (users->len == 0 || *(int*)ListGetIdx(users, users->len -1) != i) ListAdd(users, &i);
+        }
+    }
+
+    bool changed = false;
+    for (int i = 0; i < n; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->block == IR_NONE || !escOwnsMemory(in)) continue;
+        if (escRemoveIfUnread(&c, i)) {
+            changed = true;
+            continue;
+        }
+        long long alloc = escEscapes(&c, i) ? IR_ALLOC_HEAP : IR_ALLOC_STACK;
+        changed |= IrGetInstr(f, i)->val != alloc;
+        IrGetInstr(f, i)->val = alloc;
+    }
+
+    for (int i = 0; i < n; i++) ListDestroy(c.users[i]);
+    free(c.users);
+    free(c.refers);
+    ListDestroy(c.work);
+    return changed;
+}
+
+//a is only passed to a param that is not mut, b is returned and c is never read
+TEST(OptEscapeArrays) {
+    struct type str = TypeString(NULL);
+    struct var make;
+    struct var use;
+    struct var func;
+    IrTestFunc(&make, "make", &str, NULL, 0);
+    IrTestFunc(&use, "use", NULL, &str, 1);
+    struct irFunc* f = IrTestFunc(&func, "arrays", &str, NULL, 0);
+    struct var locals[3] = {{.type = str}, {.type = str}, {.type = str}};
+    int slots[3];
+    int loads[3];
+    for (int i = 0; i < 3; i++) {
+        slots[i] = IrAddInstr(f, 0, IR_ALLOCA, str.id);
+        IrGetInstr(f, slots[i])->var = &locals[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        int made = IrAddInstr(f, 0, IR_CALL, str.id);
+        IrGetInstr(f, made)->var = &make;
+        int store = IrAddInstr(f, 0, IR_STORE, TYPE_ID_NONE);
+        IrAddArg(f, store, slots[i]);
+        IrAddArg(f, store, made);
+        if (i == 2) break;
+        loads[i] = IrAddInstr(f, 0, IR_LOAD, str.id);
+        IrAddArg(f, loads[i], slots[i]);
+    }
+    int useCall = IrAddInstr(f, 0, IR_CALL, TYPE_ID_NONE);
+    IrGetInstr(f, useCall)->var = &use;
+    IrAddArg(f, useCall, loads[0]);
+    IrAddArg(f, IrAddInstr(f, 0, IR_RET, TYPE_ID_NONE), loads[1]);
+
+    bool passed = IrTestPassConverges(f, OptEscape);
+    passed = passed && IrGetInstr(f, slots[0])->val == IR_ALLOC_STACK && IrGetInstr(f, slots[1])->val == IR_ALLOC_HEAP;
+    passed = passed && IrGetInstr(f, slots[2])->block == IR_NONE;
+    IrTestFuncDestroy(&make);
+    IrTestFuncDestroy(&use);
+    IrTestFuncDestroy(&func);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
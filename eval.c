@@ -0,0 +1,274 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "irtest.h"
+#include "fold.h"
+#include "hashmap.h"
+#include "timer.h"
+#include "util.h"
+
+#define EVAL_MAX_MEMORY (1 << 24) //bytes of the frames live at once
+#define EVAL_MAX_DEPTH 1024 //of calls within the evaluated one
+
+//calls with literal args are run by an interpreter over the ir of the callee and replaced by the result
+//purity is found out while running: globals, strings, arrays, functions without a body and traps all give up,
+//so only calls that would compute the same value without effects at run time are folded
+struct evalEntry {
+    struct var* func;
+    struct irFunc* ir;
+};
+
+struct evalCtx {
+    struct hashMap byFunc; //struct evalEntry
+    int fuel; //instructions left to run
+    int memory; //bytes of the frames live
+    int depth;
+};
+
+bool evalEntryCmp(void* func, void* elem) {
+    return *(struct var**)func == ((struct evalEntry*)elem)->func;
+}
+
+struct irFunc* evalFindIr(struct evalCtx* c, struct var* func) {
+    if (!func) return NULL;
+    if (func->origin) func = func->origin;
+    struct evalEntry* e = HashMapGet(&c->byFunc, HashBytes(HASH_SEED, &func, sizeof(func)), &func, evalEntryCmp);
+    return e ? e->ir : NULL;
+}
+
+bool evalIsScalar(TypeId type) {
+    if (type == TYPE_ID_NONE) return false;
+    struct type* t = TypeGet(type);
+    return t->arrLvls == 0 && t->bType <= BASETYPE_FLOAT64;
+}
+
+//a division by zero traps at run time, so it is left to run
+bool evalFold(struct irFunc* f, int instr, long long* vals) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    if (!evalIsScalar(in->type)) return false;
+    struct foldVal args[2] = {0};
+    for (int i = 0; i < in->args.len; i++) {
+        int arg = IrGetArg(f, instr, i);
+        TypeId type = IrGetInstr(f, arg)->type;
+        if (!evalIsScalar(type)) return false;
+        args[i] = FoldFromBits(TypeGet(type)->bType, vals[arg]);
+    }
+    enum baseType bType = TypeGet(in->type)->bType;
+    struct foldVal out;
+    enum foldStatus status = FOLD_OK;
+    if (in->op == IR_CAST) out = FoldCast(args[0], bType);
+    else if (in->args.len == 1) status = FoldUnary(in->opType, args[0], &out);
+    else status = FoldBinary(in->opType, args[0], args[1], &out);
+    if (status != FOLD_OK) return false;
+    if (out.bType != bType) out = FoldCast(out, bType);
+    vals[instr] = FoldToBits(out);
+    return true;
+}
+
+bool evalCall(struct evalCtx* c, struct irFunc* f, long long* args, long long* result);
+
+//only slots of scalar vars hold memory, everything else is given up on
+bool evalInstr(struct evalCtx* c, struct irFunc* f, int instr, long long* args, long long* vals, long long* slots) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    switch (in->op) {
+        case IR_CONST: vals[instr] = in->val; return true;
+        case IR_PARAM: vals[instr] = args[in->val]; return true;
+        case IR_ALLOCA: slots[instr] = 0; return evalIsScalar(in->type);
+        case IR_LOAD: {
+            int slot = IrGetArg(f, instr, 0);
+            if (IrGetInstr(f, slot)->op != IR_ALLOCA) return false;
+            vals[instr] = slots[slot];
+            return true;
+        }
+        case IR_STORE: {
+            int slot = IrGetArg(f, instr, 0);
+            if (IrGetInstr(f, slot)->op != IR_ALLOCA) return false;
+            slots[slot] = vals[IrGetArg(f, instr, 1)];
+            return true;
+        }
+        case IR_OPERATION: return evalFold(f, instr, vals);
+        case IR_CAST: return evalFold(f, instr, vals);
+        case IR_CALL: {
+            struct irFunc* callee = evalFindIr(c, in->var);
+            if (!callee) return false;
+            long long callArgs[in->args.len +1];
+            for (int i = 0; i < in->args.len; i++) callArgs[i] = vals[IrGetArg(f, instr, i)];
+            return evalCall(c, callee, callArgs, &vals[instr]);
+        }
+        default: return false;
+    }
+}
+
+//the phis of a block take the values of the edge from prev all at once
+bool evalRun(struct evalCtx* c, struct irFunc* f, long long* args, long long* vals, long long* slots, long long* phiVals, long long* result) {
+    int block = 0;
+    int prev = IR_NONE;
+    while (true) {
+        struct irBlock* b = IrGetBlock(f, block);
+        int predIdx = 0;
+        while (prev != IR_NONE && *(int*)ListGetIdx(&b->preds, predIdx) != prev) predIdx++;
+        int nPhis = 0;
+        while (nPhis < b->instrs.len && IrGetInstr(f, *(int*)ListGetIdx(&b->instrs, nPhis))->op == IR_PHI) {
+            phiVals[nPhis] = vals[IrGetArg(f, *(int*)ListGetIdx(&b->instrs, nPhis), predIdx)];
+            nPhis++;
+        }
+        for (int i = 0; i < nPhis; i++) vals[*(int*)ListGetIdx(&b->instrs, i)] = phiVals[i];
+
+        for (int i = nPhis; i < b->instrs.len; i++) {
+            int instr = *(int*)ListGetIdx(&b->instrs, i);
+            struct irInstr* in = IrGetInstr(f, instr);
+            if (c->fuel-- <= 0) return false;
+            switch (in->op) {
+                case IR_BR:
+                    prev = block;
+                    block = in->targets[0];
+                    break;
+                case IR_CONDBR:
+                    prev = block;
+                    block = vals[IrGetArg(f, instr, 0)] ? in->targets[0] : in->targets[1];
+                    break;
+                case IR_RET:
+                    *result = in->args.len ? vals[IrGetArg(f, instr, 0)] : 0;
+                    return true;
+                default:
+                    if (IrIsTerminator(in->op) || !evalInstr(c, f, instr, args, vals, slots)) return false;
+            }
+        }
+    }
+}
+
+bool evalCall(struct evalCtx* c, struct irFunc* f, long long* args, long long* result) {
+    int n = f->instrs.len;
+    int size = 3 * n * sizeof(long long);
+    if (c->depth >= EVAL_MAX_DEPTH || c->memory + size > EVAL_MAX_MEMORY) return false;
+    c->memory += size;
+    c->depth++;
+    long long* vals = MallocOrCrash(size +1);
+    bool ok = evalRun(c, f, args, vals, vals + n, vals + 2 * n, result);
+    free(vals);
+    c->depth--;
+    c->memory -= size;
+    return ok;
+}
+
+int evalPos(struct irFunc* f, int instr) {
+    struct list* instrs = &IrGetBlock(f, IrGetInstr(f, instr)->block)->instrs;
+    int pos = 0;
+    while (*(int*)ListGetIdx(instrs, pos) != instr) pos++;
+    return pos;
+}
+
+//every call gets the full fuel, calls added by evaluating are not visited
+bool evalCaller(struct evalCtx* c, struct irFunc* f, int fuel) {
+    bool changed = false;
+    int n = f->instrs.len;
+    for (int i = 0; i < n; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->op != IR_CALL || in->block == IR_NONE || (in->type != TYPE_ID_NONE && !evalIsScalar(in->type))) continue;
+        struct irFunc* callee = evalFindIr(c, in->var);
+        bool literal = callee != NULL;
+        long long args[in->args.len +1];
+        for (int a = 0; a < in->args.len && literal; a++) {
+            struct irInstr* arg = IrGetInstr(f, IrGetArg(f, i, a));
+            literal = arg->op == IR_CONST;
+            args[a] = arg->val;
+        }
+        long long result;
+        c->fuel = fuel;
+        c->memory = 0;
+        c->depth = 0;
+        if (!literal || !evalCall(c, callee, args, &result)) continue;
+        if (in->type != TYPE_ID_NONE) {
+            int folded = IrInsertInstr(f, in->block, evalPos(f, i), IR_CONST, in->type);
+            IrGetInstr(f, folded)->val = result;
+            IrReplaceUses(f, i, folded);
+        }
+        IrRemoveInstr(f, i);
+        changed = true;
+    }
+    return changed;
+}
+
+void OptEvalProgram(struct list* funcs, struct optConfig* config) {
+    if (config->evalFuel <= 0) return;
+    struct evalCtx c = {HashMapInit(sizeof(struct evalEntry)), 0, 0, 0};
+    for (int i = 0; i < funcs->len; i++) {
+        struct var* func = ((struct optFunc*)ListGetIdx(funcs, i))->func;
+        struct evalEntry e = {func->origin ? func->origin : func, func->ir};
+        if (e.ir && !evalFindIr(&c, e.func)) HashMapAdd(&c.byFunc, HashBytes(HASH_SEED, &e.func, sizeof(e.func)), &e);
+    }
+    for (int i = 0; i < funcs->len; i++) {
+        struct irFunc* f = ((struct optFunc*)ListGetIdx(funcs, i))->func->ir;
+        if (!f) continue;
+        TimerStart("compile time evaluation", f->func->name);
+        bool changed = evalCaller(&c, f, config->evalFuel);
+        TimerStop();
+        if (!changed) continue;
+        if (!IrVerify(f, stdout)) {
+            printf("after compile time evaluation\n");
+            ErrorBugFound();
+        }
+        OptRun(f, config);
+    }
+    HashMapDestroy(c.byFunc);
+}
+
+//fact(n) returns 1 for n <= 1, else n * fact(n - 1), and main returns fact(5)
+TEST(OptEvalFact) {
+    TypeId i32 = TypeVanillaId(BASETYPE_INT32);
+    char* names[2] = {"main", "fact"};
+    struct type i32Type = TypeVanilla(BASETYPE_INT32);
+    struct var funcs[2];
+    for (int i = 0; i < 2; i++) IrTestFunc(&funcs[i], names[i], &i32Type, &i32Type, i);
+
+    struct irFunc* fact = funcs[1].ir;
+    int base = IrAddBlock(fact);
+    int recurse = IrAddBlock(fact);
+    int n = IrAddInstr(fact, 0, IR_PARAM, i32);
+    int one = IrAddInstr(fact, 0, IR_CONST, i32);
+    IrGetInstr(fact, one)->val = 1;
+    int cond = IrAddInstr(fact, 0, IR_OPERATION, TypeVanillaId(BASETYPE_BOOL));
+    IrGetInstr(fact, cond)->opType = OPERATION_LESS_THAN_OR_EQUAL;
+    IrAddArg(fact, cond, n);
+    IrAddArg(fact, cond, one);
+    int condBr = IrAddInstr(fact, 0, IR_CONDBR, TYPE_ID_NONE);
+    IrAddArg(fact, condBr, cond);
+    IrSetTargets(fact, condBr, base, recurse);
+    IrAddArg(fact, IrAddInstr(fact, base, IR_RET, TYPE_ID_NONE), one);
+    int less = IrAddInstr(fact, recurse, IR_OPERATION, i32);
+    IrGetInstr(fact, less)->opType = OPERATION_SUB;
+    IrAddArg(fact, less, n);
+    IrAddArg(fact, less, one);
+    int call = IrAddInstr(fact, recurse, IR_CALL, i32);
+    IrGetInstr(fact, call)->var = &funcs[1];
+    IrAddArg(fact, call, less);
+    int product = IrAddInstr(fact, recurse, IR_OPERATION, i32);
+    IrGetInstr(fact, product)->opType = OPERATION_MUL;
+    IrAddArg(fact, product, n);
+    IrAddArg(fact, product, call);
+    IrAddArg(fact, IrAddInstr(fact, recurse, IR_RET, TYPE_ID_NONE), product);
+
+    struct irFunc* main = funcs[0].ir;
+    int five = IrAddInstr(main, 0, IR_CONST, i32);
+    IrGetInstr(main, five)->val = 5;
+    int mainCall = IrAddInstr(main, 0, IR_CALL, i32);
+    IrGetInstr(main, mainCall)->var = &funcs[1];
+    IrAddArg(main, mainCall, five);
+    int ret = IrAddInstr(main, 0, IR_RET, TYPE_ID_NONE);
+    IrAddArg(main, ret, mainCall);
+
+    struct optConfig config = OptConfigForLevel(OPT_LEVEL_2);
+    struct list program = ListInit(sizeof(struct optFunc));
+    for (int i = 0; i < 2; i++) {
+        struct optFunc of = {&funcs[i], 0};
+        ListAdd(&program, &of);
+    }
+    OptEvalProgram(&program, &config);
+    struct irInstr* result = IrGetInstr(main, IrGetArg(main, ret, 0));
+    bool passed = result->op == IR_CONST && result->val == 120 && IrGetInstr(main, mainCall)->block == IR_NONE;
+    for (int i = 0; i < 2; i++) IrTestFuncDestroy(&funcs[i]);
+    ListDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "fold.h"
+#include "util.h"
+
+bool foldIsFloat(enum baseType bType) {
+    return bType == BASETYPE_FLOAT32 || bType == BASETYPE_FLOAT64;
+}
+
+long long foldWrap(enum baseType bType, unsigned long long u) {
+    switch (bType) {
+        case BASETYPE_BOOL: return u != 0;
+        case BASETYPE_BYTE: return (unsigned char)u;
+        case BASETYPE_INT32: return (int)(unsigned int)u;
+        case BASETYPE_INT64: return (long long)u;
+        default: ErrorBugFound(); return 0;
+    }
+}
+
+struct foldVal FoldInt(enum baseType bType, long long i) {
+    if (foldIsFloat(bType)) ErrorBugFound();
+    struct foldVal v = (struct foldVal){0};
+    v.bType = bType;
+    v.i = foldWrap(bType, i);
+    return v;
+}
+
+struct foldVal FoldFloat(enum baseType bType, double f) {
+    if (!foldIsFloat(bType)) ErrorBugFound();
+    struct foldVal v = (struct foldVal){0};
+    v.bType = bType;
+    v.f = bType == BASETYPE_FLOAT32 ? (float)f : f;
+    return v;
+}
+
+//truncates toward zero, NaN and values out of range give the most negative integer like cvttsd2si;
+//bytes are converted through int32
+long long foldFloatToInt(double f, enum baseType to) {
+    if (to == BASETYPE_INT64) {
+        if (!(f >= -9223372036854775808.0 && f < 9223372036854775808.0)) return -9223372036854775807LL -1;
+        return (long long)f;
+    }
+    if (!(f > -2147483649.0 && f < 2147483648.0)) return -2147483647 -1;
+    return (int)f;
+}
+
+struct foldVal FoldCast(struct foldVal v, enum baseType to) {
+    if (foldIsFloat(to) && foldIsFloat(v.bType)) return FoldFloat(to, v.f);
+    if (to == BASETYPE_FLOAT32) return FoldFloat(to, (float)v.i); //rounded once, not through double
+    if (to == BASETYPE_FLOAT64) return FoldFloat(to, v.i);
+    if (foldIsFloat(v.bType)) return FoldInt(to, foldFloatToInt(v.f, to));
+    return FoldInt(to, v.i);
+}
+
+struct foldVal FoldFromBits(enum baseType bType, long long bits) {
+    if (!foldIsFloat(bType)) return FoldInt(bType, bits);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return FoldFloat(bType, d);
+}
+
+long long FoldToBits(struct foldVal v) {
+    if (!foldIsFloat(v.bType)) return v.i;
+    long long bits;
+    memcpy(&bits, &v.f, sizeof(bits));
+    return bits;
+}
+
+//for arithmetic and comparisons literals are converted to the widest of both types
+int foldRank(enum baseType bType) {
+    switch (bType) {
+        case BASETYPE_BOOL: return 0;
+        case BASETYPE_BYTE: return 1;
+        case BASETYPE_INT32: return 2;
+        case BASETYPE_INT64: return 3;
+        case BASETYPE_FLOAT32: return 4;
+        case BASETYPE_FLOAT64: return 5;
+        default: ErrorBugFound(); return 0;
+    }
+}
+
+enum foldStatus FoldUnary(enum operation opType, struct foldVal in, struct foldVal* out) {
+    if (foldIsFloat(in.bType)) {
+        switch (opType) {
+            case OPERATION_PLUS: *out = in; return FOLD_OK;
+            case OPERATION_MINUS: *out = FoldFloat(in.bType, -in.f); return FOLD_OK;
+            default: ErrorBugFound(); return FOLD_OK;
+        }
+    }
+    unsigned long long u = in.i;
+    switch (opType) {
+        case OPERATION_NOT: *out = FoldInt(BASETYPE_BOOL, !in.i); break;
+        case OPERATION_BITWISE_COMPLEMENT: *out = FoldInt(in.bType, ~u); break;
+        case OPERATION_PLUS: *out = in; break;
+        case OPERATION_MINUS: *out = FoldInt(in.bType, 0 - u); break;
+        default: ErrorBugFound();
+    }
+    return FOLD_OK;
+}
+
+enum foldStatus foldFloatBinary(enum operation opType, struct foldVal a, struct foldVal b, struct foldVal* out) {
+    enum baseType t = a.bType;
+    if (t == BASETYPE_FLOAT32) {
+        float x = a.f, y = b.f;
+        switch (opType) {
+            case OPERATION_ADD: *out = FoldFloat(t, x + y); return FOLD_OK;
+            case OPERATION_SUB: *out = FoldFloat(t, x - y); return FOLD_OK;
+            case OPERATION_MUL: *out = FoldFloat(t, x * y); return FOLD_OK;
+            case OPERATION_DIV: *out = FoldFloat(t, x / y); return FOLD_OK;
+            default: break;
+        }
+    }
+    double x = a.f, y = b.f;
+    switch (opType) {
+        case OPERATION_ADD: *out = FoldFloat(t, x + y); break;
+        case OPERATION_SUB: *out = FoldFloat(t, x - y); break;
+        case OPERATION_MUL: *out = FoldFloat(t, x * y); break;
+        case OPERATION_DIV: *out = FoldFloat(t, x / y); break;
+        case OPERATION_LESS_THAN: *out = FoldInt(BASETYPE_BOOL, x < y); break;
+        case OPERATION_LESS_THAN_OR_EQUAL: *out = FoldInt(BASETYPE_BOOL, x <= y); break;
+        case OPERATION_GREATER_THAN: *out = FoldInt(BASETYPE_BOOL, x > y); break;
+        case OPERATION_GREATER_THAN_OR_EQUAL: *out = FoldInt(BASETYPE_BOOL, x >= y); break;
+        case OPERATION_EQUALS: *out = FoldInt(BASETYPE_BOOL, x == y); break;
+        case OPERATION_NOT_EQUALS: *out = FoldInt(BASETYPE_BOOL, x != y); break;
+        default: ErrorBugFound();
+    }
+    return FOLD_OK;
+}
+
+//bytes are shifted in 32 bit registers
+long long foldShift(enum operation opType, struct foldVal a, long long count) {
+    int width = a.bType == BASETYPE_INT64 ? 64 : 32;
+    count &= width -1;
+    if (opType == OPERATION_BITSHIFT_LEFT) return foldWrap(a.bType, (unsigned long long)a.i << count);
+    return foldWrap(a.bType, a.i >> count); //arithmetic for integers, bytes are never negative
+}
+
+//division and modulo of the most negative integer by -1 wrap instead of trapping
+enum foldStatus foldDivMod(enum operation opType, struct foldVal a, struct foldVal b, enum baseType t, struct foldVal* out) {
+    if (b.i == 0) return FOLD_DIV_BY_ZERO;
+    long long x = a.i;
+    long long y = b.i;
+    if (y == -1) {
+        *out = FoldInt(t, opType == OPERATION_DIV ? 0 - (unsigned long long)x : 0);
+        return FOLD_OK;
+    }
+    *out = FoldInt(t, opType == OPERATION_DIV ? x / y : x % y);
+    return FOLD_OK;
+}
+
+enum foldStatus FoldBinary(enum operation opType, struct foldVal a, struct foldVal b, struct foldVal* out) {
+    switch (opType) {
+        case OPERATION_BITSHIFT_LEFT:
+        case OPERATION_BITSHIFT_RIGHT:
+            *out = FoldInt(a.bType, foldShift(opType, a, b.i));
+            return FOLD_OK;
+        case OPERATION_MODULO: return foldDivMod(opType, a, b, a.bType, out);
+        default: break;
+    }
+
+    enum baseType t = foldRank(a.bType) >= foldRank(b.bType) ? a.bType : b.bType;
+    a = FoldCast(a, t);
+    b = FoldCast(b, t);
+    if (foldIsFloat(t)) return foldFloatBinary(opType, a, b, out);
+
+    unsigned long long x = a.i;
+    unsigned long long y = b.i;
+    switch (opType) {
+        case OPERATION_ADD: *out = FoldInt(t, x + y); break;
+        case OPERATION_SUB: *out = FoldInt(t, x - y); break;
+        case OPERATION_MUL: *out = FoldInt(t, x * y); break;
+        case OPERATION_DIV: return foldDivMod(opType, a, b, t, out);
+        case OPERATION_LESS_THAN: *out = FoldInt(BASETYPE_BOOL, a.i < b.i); break;
+        case OPERATION_LESS_THAN_OR_EQUAL: *out = FoldInt(BASETYPE_BOOL, a.i <= b.i); break;
+        case OPERATION_GREATER_THAN: *out = FoldInt(BASETYPE_BOOL, a.i > b.i); break;
+        case OPERATION_GREATER_THAN_OR_EQUAL: *out = FoldInt(BASETYPE_BOOL, a.i >= b.i); break;
+        case OPERATION_EQUALS: *out = FoldInt(BASETYPE_BOOL, a.i == b.i); break;
+        case OPERATION_NOT_EQUALS: *out = FoldInt(BASETYPE_BOOL, a.i != b.i); break;
+        case OPERATION_AND: *out = FoldInt(BASETYPE_BOOL, a.i && b.i); break;
+        case OPERATION_OR: *out = FoldInt(BASETYPE_BOOL, a.i || b.i); break;
+        case OPERATION_XOR: *out = FoldInt(BASETYPE_BOOL, !a.i != !b.i); break;
+        case OPERATION_BITWISE_AND: *out = FoldInt(t, x & y); break;
+        case OPERATION_BITWISE_OR: *out = FoldInt(t, x | y); break;
+        case OPERATION_BITWISE_XOR: *out = FoldInt(t, x ^ y); break;
+        default: ErrorBugFound();
+    }
+    return FOLD_OK;
+}
+
+bool foldIsInt(struct foldVal v, enum baseType bType, long long i) {
+    return v.bType == bType && v.i == i;
+}
+
+TEST(FoldWidths) {
+    struct foldVal res;
+    struct foldVal i32Max = FoldInt(BASETYPE_INT32, 2147483647);
+    struct foldVal i32Min = FoldInt(BASETYPE_INT32, -2147483647 -1);
+    struct foldVal i64Min = FoldInt(BASETYPE_INT64, -9223372036854775807LL -1);
+    struct foldVal one = FoldInt(BASETYPE_INT32, 1);
+    struct foldVal minusOne = FoldInt(BASETYPE_INT32, -1);
+    struct foldVal zero = FoldInt(BASETYPE_INT32, 0);
+
+    FoldBinary(OPERATION_ADD, i32Max, one, &res);
+    if (!foldIsInt(res, BASETYPE_INT32, -2147483647 -1)) TEST_FAILED
+    FoldBinary(OPERATION_ADD, FoldInt(BASETYPE_BYTE, 255), FoldInt(BASETYPE_BYTE, 1), &res);
+    if (!foldIsInt(res, BASETYPE_BYTE, 0)) TEST_FAILED
+    FoldBinary(OPERATION_DIV, i32Min, minusOne, &res);
+    if (!foldIsInt(res, BASETYPE_INT32, -2147483647 -1)) TEST_FAILED
+    FoldBinary(OPERATION_MODULO, i64Min, FoldInt(BASETYPE_INT64, -1), &res);
+    if (!foldIsInt(res, BASETYPE_INT64, 0)) TEST_FAILED
+    if (FoldBinary(OPERATION_DIV, one, zero, &res) != FOLD_DIV_BY_ZERO) TEST_FAILED
+    if (FoldBinary(OPERATION_MODULO, one, zero, &res) != FOLD_DIV_BY_ZERO) TEST_FAILED
+
+    //literals of different widths are folded in the wider one
+    FoldBinary(OPERATION_ADD, i32Max, FoldInt(BASETYPE_INT64, 1), &res);
+    if (!foldIsInt(res, BASETYPE_INT64, 2147483648LL)) TEST_FAILED
+    FoldBinary(OPERATION_MUL, one, FoldFloat(BASETYPE_FLOAT32, 0.5), &res);
+    if (res.bType != BASETYPE_FLOAT32 || res.f != 0.5) TEST_FAILED
+
+    FoldBinary(OPERATION_BITSHIFT_LEFT, one, FoldInt(BASETYPE_INT32, 33), &res);
+    if (!foldIsInt(res, BASETYPE_INT32, 2)) TEST_FAILED
+    FoldBinary(OPERATION_BITSHIFT_RIGHT, minusOne, FoldInt(BASETYPE_INT32, 4), &res);
+    if (!foldIsInt(res, BASETYPE_INT32, -1)) TEST_FAILED
+    FoldBinary(OPERATION_BITSHIFT_LEFT, FoldInt(BASETYPE_BYTE, 1), FoldInt(BASETYPE_INT32, 8), &res);
+    if (!foldIsInt(res, BASETYPE_BYTE, 0)) TEST_FAILED
+
+    FoldUnary(OPERATION_MINUS, i32Min, &res);
+    if (!foldIsInt(res, BASETYPE_INT32, -2147483647 -1)) TEST_FAILED
+    FoldUnary(OPERATION_BITWISE_COMPLEMENT, FoldInt(BASETYPE_BYTE, 0), &res);
+    if (!foldIsInt(res, BASETYPE_BYTE, 255)) TEST_FAILED
+
+    if (FoldFloat(BASETYPE_FLOAT32, 0.1).f == 0.1) TEST_FAILED
+    if (!foldIsInt(FoldCast(FoldFloat(BASETYPE_FLOAT64, -2.9), BASETYPE_INT32), BASETYPE_INT32, -2)) TEST_FAILED
+    if (!foldIsInt(FoldCast(FoldFloat(BASETYPE_FLOAT64, 1e20), BASETYPE_INT32), BASETYPE_INT32, -2147483647 -1)) TEST_FAILED
+    if (!foldIsInt(FoldCast(FoldFloat(BASETYPE_FLOAT64, 300.0), BASETYPE_BYTE), BASETYPE_BYTE, 44)) TEST_FAILED
+    if (!foldIsInt(FoldCast(FoldInt(BASETYPE_INT64, 4294967297LL), BASETYPE_INT32), BASETYPE_INT32, 1)) TEST_FAILED
+    if (FoldCast(FoldInt(BASETYPE_INT64, 16777217), BASETYPE_FLOAT32).f != 16777216.0) TEST_FAILED
+    if (FoldCast(FoldInt(BASETYPE_INT64, 0x20000020000001LL), BASETYPE_FLOAT32).f != 0x20000040000000LL) TEST_FAILED
+    TEST_PASSED
+}
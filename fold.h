@@ -0,0 +1,29 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "type.h"
+#include "operation.h"
+
+//the value of a literal of a vanilla type
+struct foldVal {
+    enum baseType bType;
+    long long i; //bool, byte and integers; wrapped to the width of bType, bytes are unsigned
+    double f; //floats; rounded to float for float32
+};
+
+enum foldStatus {
+    FOLD_OK,
+    FOLD_DIV_BY_ZERO
+};
+
+//literals are folded with the semantics of the target, i.e. two's complement wraparound,
+//shift counts masked to the register width and truncating float to integer conversions
+struct foldVal FoldInt(enum baseType bType, long long i);
+struct foldVal FoldFloat(enum baseType bType, double f);
+struct foldVal FoldCast(struct foldVal v, enum baseType to);
+struct foldVal FoldFromBits(enum baseType bType, long long bits); //as held by constants in the ir, floats as the bits of a double
+long long FoldToBits(struct foldVal v);
+enum foldStatus FoldUnary(enum operation opType, struct foldVal in, struct foldVal* out);
+enum foldStatus FoldBinary(enum operation opType, struct foldVal a, struct foldVal b, struct foldVal* out);
+
+#endif //FOLD_H
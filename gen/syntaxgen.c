@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "syntaxrules.h"
+
+//emits a recursive descent parser for the rules in syntaxrules.c to stdout
+//every function behaves exactly like ParseRule in syntax.c interpreting the same pattern,
+//choices use the lookahead tables computed by the interpreter when the rules are compiled
+
+#define MAX_WORD_LEN 64
+
+char* nextWord(char* pattern, char* word) {
+    while (*pattern == ' ') pattern++;
+    if (*pattern == '\0') return NULL;
+    int len = 0;
+    while (pattern[len] != ' ' && pattern[len] != '\0') len++;
+    if (len >= MAX_WORD_LEN) {
+        fprintf(stderr, "pattern word too long\n");
+        exit(1);
+    }
+    memcpy(word, pattern, len);
+    word[len] = '\0';
+    return pattern + len;
+}
+
+//the token the pattern ends with outside of groups, ! and ~ aside, as syncTok in syntax.c
+char* trailingTokWord(char* pattern, char* word) {
+    char cur[MAX_WORD_LEN];
+    bool found = false;
+    bool inGroup = false;
+    while ((pattern = nextWord(pattern, cur))) {
+        if (cur[0] == '!' || cur[0] == '~') continue;
+        found = cur[0] == 'T' && !inGroup;
+        if (found) strcpy(word, cur);
+        if (cur[0] == '?' || cur[0] == '*' || cur[0] == '&') inGroup = true;
+        if (cur[0] == '$') inGroup = false;
+    }
+    return found ? word : NULL;
+}
+
+//the text between a group opening and its $, used as the expected message of choices
+void groupText(char* pattern, char* buffer, int bufferLen) {
+    char word[MAX_WORD_LEN];
+    buffer[0] = '\0';
+    while ((pattern = nextWord(pattern, word)) && word[0] != '$') {
+        if ((int)(strlen(buffer) + strlen(word) +2) > bufferLen) break;
+        if (buffer[0] != '\0') strcat(buffer, " ");
+        strcat(buffer, word);
+    }
+}
+
+struct groupState {
+    char kind; //'?', '*', '&' or 0 outside of groups
+    int label;
+    int nAlts; //for choices
+};
+
+//fail is the C statement run on a mismatch of the element
+void emitMatch(char* word, char* fail) {
+    if (word[0] == 'T') {
+        printf("    tok = TokenFeed(sc->tc);\n");
+        printf("    if (tok.type != %s) {TokenUnfeed(sc->tc); s.errorTok = tok; %s}\n", word, fail);
+        printf("    else SyntaxAddTok(&s, tok);\n");
+        return;
+    }
+    printf("    nested = syntaxGen_%s(sc);\n", word);
+    printf("    if (nested.type == SNTX_NOT_FOUND) {s.errorTok = nested.errorTok; %s}\n", fail);
+    printf("    else SyntaxAddNested(&s, nested);\n");
+}
+
+void emitRule(struct syntaxRule rule) {
+    char* name = syntaxTypeNames[rule.type];
+    char word[MAX_WORD_LEN];
+    char syncTok[MAX_WORD_LEN];
+    char choiceText[1024];
+    char fail[MAX_WORD_LEN * 2 + 64];
+    struct groupState group = (struct groupState){0};
+    int nLabels = 0;
+    int nChoices = 0; //numbered like the choice tables of the interpreter
+    bool mayMismatch = false;
+    bool lazy = false; //the next word is a block skipped by lazy parsing
+
+    printf("struct syntax syntaxGen_%s(SyntaxCtx sc) {\n", name);
+    printf("    struct syntax s = SyntaxInit(%s);\n", name);
+    printf("    struct syntax nested;\n");
+    printf("    struct token tok;\n");
+    printf("    char* expected = NULL;\n");
+    printf("    bool started = false;\n");
+    printf("    int startCursor = TokenGetCursor(sc->tc);\n");
+    printf("    int groupCursor = 0;\n");
+    printf("    int groupPartsLen = 0;\n");
+    printf("    unsigned int candidates = 0;\n");
+    printf("    struct token lookahead;\n");
+    printf("    (void)nested; (void)tok; (void)expected; (void)started; (void)groupCursor; (void)groupPartsLen;\n");
+    printf("    (void)candidates; (void)lookahead;\n");
+
+    char* pattern = rule.pattern;
+    while ((pattern = nextWord(pattern, word))) {
+        switch (word[0]) {
+            case '!': printf("    started = true;\n"); break;
+            case '~': lazy = true; break;
+            case '?':
+            case '*':
+            case '&':
+                group.kind = word[0];
+                group.label = nLabels++;
+                if (group.kind == '&') groupText(pattern, choiceText, sizeof(choiceText));
+                if (group.kind == '*') printf("group%d:\n", group.label);
+                printf("    groupCursor = TokenGetCursor(sc->tc);\n");
+                printf("    groupPartsLen = s.parts.len;\n");
+                if (group.kind == '&') {
+                    printf("    lookahead = TokenFeed(sc->tc);\n");
+                    printf("    TokenUnfeed(sc->tc);\n");
+                    printf("    candidates = SyntaxChoiceCandidates(%s, %d, lookahead.type);\n", name, nChoices++);
+                    group.nAlts = 0;
+                }
+                break;
+            case '$':
+                if (group.kind == '&') {
+                    printf("    expected = \"%s\";\n", choiceText);
+                    printf("    goto mismatch;\n");
+                    mayMismatch = true;
+                }
+                else if (group.kind == '*') {
+                    printf("    if (TokenGetCursor(sc->tc) != groupCursor) goto group%d;\n", group.label);
+                    printf("    goto group%dEnd;\n", group.label);
+                }
+                else printf("    goto group%dEnd;\n", group.label);
+                if (group.kind != '&') {
+                    printf("group%dFail:\n", group.label);
+                    printf("    SyntaxRewind(sc, %s, groupCursor);\n", name);
+                    printf("    ListRetract(&s.parts, groupPartsLen);\n");
+                }
+                printf("group%dEnd:\n", group.label);
+                group.kind = 0;
+                break;
+            case 'T':
+            case 'S':
+                if (group.kind == '&') {
+                    printf("    //%s\n", word);
+                    printf("    if (!(candidates >> %d & 1)) s.errorTok = lookahead;\n", group.nAlts++);
+                    printf("    else {\n");
+                    sprintf(fail, "SyntaxRewind(sc, %s, groupCursor); ListRetract(&s.parts, groupPartsLen);", name);
+                    emitMatch(word, fail);
+                    printf("    if (s.parts.len > groupPartsLen) goto group%dEnd;\n", group.label);
+                    printf("    }\n");
+                }
+                else if (group.kind) {
+                    sprintf(fail, "goto group%dFail;", group.label);
+                    emitMatch(word, fail);
+                }
+                else {
+                    sprintf(fail, "expected = \"%s\"; goto mismatch;", word);
+                    if (lazy) printf("    if (!SyntaxSkipBlock(sc, %s, &s)) {\n", word);
+                    emitMatch(word, fail);
+                    if (lazy) printf("    }\n");
+                    mayMismatch = true;
+                }
+                lazy = false;
+                break;
+            default:
+                fprintf(stderr, "unknown pattern word %s in %s\n", word, name);
+                exit(1);
+        }
+    }
+    printf("    return s;\n");
+    if (!mayMismatch) {
+        printf("}\n\n");
+        return;
+    }
+    printf("mismatch:\n");
+    printf("    if (started) {\n");
+    printf("        SyntaxUnexpectedToken(sc, s.errorTok, expected);\n");
+    if (trailingTokWord(rule.pattern, syncTok)) printf("        TokenFeedPast(sc->tc, %s);\n", syncTok);
+    printf("        return s;\n");
+    printf("    }\n");
+    printf("    SyntaxRewind(sc, %s, startCursor);\n", name);
+    printf("    s.type = SNTX_NOT_FOUND;\n");
+    printf("    return s;\n");
+    printf("}\n\n");
+}
+
+void emitRuleWithoutPattern(char* name) {
+    printf("struct syntax syntaxGen_%s(SyntaxCtx sc) {\n", name);
+    printf("    struct syntax s = SyntaxInit(SNTX_NOT_FOUND);\n");
+    printf("    s.errorTok = TokenFeed(sc->tc);\n");
+    printf("    TokenUnfeed(sc->tc);\n");
+    printf("    return s;\n");
+    printf("}\n\n");
+}
+
+struct syntaxRule* getRule(enum syntaxType type) {
+    for (int i = 0; i < nRules; i++) {
+        if (rules[i].type == type) return &rules[i];
+    }
+    return NULL;
+}
+
+int main() {
+    printf("//generated by gen/syntaxgen.c from syntaxrules.c, do not edit\n");
+    printf("#include <stdbool.h>\n");
+    printf("#include \"syntaxrules.h\"\n");
+    printf("#include \"token.h\"\n\n");
+
+    for (int type = SNTX_NOT_FOUND +1; type < SNTX_COUNT; type++) {
+        printf("struct syntax syntaxGen_%s(SyntaxCtx sc);\n", syntaxTypeNames[type]);
+    }
+    printf("\n");
+    for (int type = SNTX_NOT_FOUND +1; type < SNTX_COUNT; type++) {
+        struct syntaxRule* rule = getRule(type);
+        if (rule) emitRule(*rule);
+        else emitRuleWithoutPattern(syntaxTypeNames[type]);
+    }
+
+    printf("struct syntax SyntaxParseRuleGenerated(SyntaxCtx sc, enum syntaxType type) {\n");
+    printf("    switch (type) {\n");
+    for (int type = SNTX_NOT_FOUND +1; type < SNTX_COUNT; type++) {
+        printf("        case %s: return syntaxGen_%s(sc);\n", syntaxTypeNames[type], syntaxTypeNames[type]);
+    }
+    printf("        default: return SyntaxInit(SNTX_NOT_FOUND);\n");
+    printf("    }\n");
+    printf("}\n");
+    return 0;
+}
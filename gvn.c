@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "opt.h"
+#include "hashmap.h"
+#include "util.h"
+
+//dominator based value numbering: blocks are visited in a preorder of the dominator tree, so an equal
+//instruction found in the table is reused only if its block dominates the current one, otherwise it takes its place
+struct gvnKey {
+    enum irOp op;
+    enum operation opType;
+    TypeId type;
+    long long val;
+    struct var* var;
+    int nArgs;
+    int args[2];
+};
+
+struct gvnEntry {
+    struct gvnKey key;
+    int leader;
+};
+
+bool gvnIsPure(struct irInstr* in) {
+    switch (in->op) {
+        case IR_CONST: return true;
+        case IR_PARAM: return true;
+        case IR_ADDR: return true;
+        case IR_OPERATION: return true;
+        case IR_CAST: return true;
+        case IR_LEN: return true; //arrays keep their length
+        default: return false;
+    }
+}
+
+bool gvnIsCommutative(enum operation opType) {
+    switch (opType) {
+        case OPERATION_ADD: return true;
+        case OPERATION_MUL: return true;
+        case OPERATION_EQUALS: return true;
+        case OPERATION_NOT_EQUALS: return true;
+        case OPERATION_AND: return true;
+        case OPERATION_OR: return true;
+        case OPERATION_XOR: return true;
+        case OPERATION_BITWISE_AND: return true;
+        case OPERATION_BITWISE_OR: return true;
+        case OPERATION_BITWISE_XOR: return true;
+        default: return false;
+    }
+}
+
+bool gvnKeyCmp(void* key, void* entry) {
+    return memcmp(key, &((struct gvnEntry*)entry)->key, sizeof(struct gvnKey)) == 0;
+}
+
+//args are taken after the replacements so far, the key is zeroed first as its padding is hashed
+void gvnMakeKey(struct irFunc* f, int instr, int* repl, struct gvnKey* key) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    memset(key, 0, sizeof(*key));
+    key->op = in->op;
+    key->opType = in->opType;
+    key->type = in->type;
+    key->val = in->val;
+    key->var = in->var;
+    key->nArgs = in->args.len;
+    for (int i = 0; i < in->args.len; i++) {
+        int arg = IrGetArg(f, instr, i);
+        while (repl[arg] != IR_NONE) arg = repl[arg];
+        key->args[i] = arg;
+    }
+    if (in->op == IR_OPERATION && in->args.len == 2 && gvnIsCommutative(in->opType) && key->args[0] > key->args[1]) {
+        int tmp = key->args[0];
+        key->args[0] = key->args[1];
+        key->args[1] = tmp;
+    }
+}
+
+bool OptGvn(struct irFunc* f) {
+    int n = f->instrs.len;
+    int* repl = MallocOrCrash(n * sizeof(int) +1);
+    for (int i = 0; i < n; i++) repl[i] = IR_NONE;
+    struct hashMap table = HashMapInit(sizeof(struct gvnEntry));
+    struct list idoms = IrDominators(f);
+    struct list order = IrDomTreeOrder(f, &idoms);
+    bool changed = false;
+
+    for (int i = 0; i < order.len; i++) {
+        int b = *(int*)ListGetIdx(&order, i);
+        struct list* instrs = &IrGetBlock(f, b)->instrs;
+        for (int j = 0; j < instrs->len;) {
+            int instr = *(int*)ListGetIdx(instrs, j);
+            j++;
+            if (!gvnIsPure(IrGetInstr(f, instr))) continue;
+            struct gvnEntry entry;
+            gvnMakeKey(f, instr, repl, &entry.key);
+            entry.leader = instr;
+            unsigned long long hash = HashBytes(HASH_SEED, &entry.key, sizeof(entry.key));
+            struct gvnEntry* found = HashMapGet(&table, hash, &entry.key, gvnKeyCmp);
+            if (!found) HashMapAdd(&table, hash, &entry);
+            else if (!IrDominates(&idoms, IrGetInstr(f, found->leader)->block, b)) found->leader = instr;
+            else {
+                repl[instr] = found->leader;
+                IrRemoveInstr(f, instr);
+                j--;
+                changed = true;
+            }
+        }
+    }
+    IrReplaceUsesMapped(f, repl, n);
+
+    free(repl);
+    HashMapDestroy(table);
+    ListDestroy(idoms);
+    ListDestroy(order);
+    return changed;
+}
@@ -0,0 +1,60 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "hashmap.h"
+#include "list.h"
+#include "util.h"
+
+#define HASHMAP_MIN_SLOTS 64
+
+struct hashMap HashMapInit(int elemSize) {
+    struct hashMap m = (struct hashMap){0};
+    m.elems = ListInit(elemSize);
+    m.hashes = ListInit(sizeof(unsigned long long));
+    return m;
+}
+
+void HashMapDestroy(struct hashMap m) {
+    ListDestroy(m.elems);
+    ListDestroy(m.hashes);
+    if (m.slots) free(m.slots);
+}
+
+void hashMapInsertSlot(struct hashMap* m, unsigned long long hash, int elemIdx) {
+    int slot = hash & (m->nSlots -1);
+    while (m->slots[slot]) slot = (slot +1) & (m->nSlots -1);
+    m->slots[slot] = elemIdx +1;
+}
+
+//kept at most half full so probe sequences stay short
+void hashMapGrow(struct hashMap* m) {
+    if (m->slots && m->elems.len * 2 < m->nSlots) return;
+    if (m->slots) free(m->slots);
+    m->nSlots = m->nSlots ? m->nSlots * 2 : HASHMAP_MIN_SLOTS;
+    m->slots = CallocOrCrash(m->nSlots * sizeof(int));
+    for (int i = 0; i < m->hashes.len; i++) {
+        hashMapInsertSlot(m, *(unsigned long long*)ListGetIdx(&m->hashes, i), i);
+    }
+}
+
+void* HashMapAdd(struct hashMap* m, unsigned long long hash, void* elem) {
+    ListAdd(&m->elems, elem);
+    ListAdd(&m->hashes, &hash);
+    hashMapGrow(m);
+    hashMapInsertSlot(m, hash, m->elems.len -1);
+    return ListGetIdx(&m->elems, m->elems.len -1);
+}
+
+void* HashMapGet(struct hashMap* m, unsigned long long hash, void* cmpVal, bool(*cmpFunc)(void* cmpVal, void* mapElem)) {
+    if (!m->slots) return NULL;
+    int slot = hash & (m->nSlots -1);
+    while (m->slots[slot]) {
+        int elemIdx = m->slots[slot] -1;
+        if (*(unsigned long long*)ListGetIdx(&m->hashes, elemIdx) == hash) {
+            void* elem = ListGetIdx(&m->elems, elemIdx);
+            if (cmpFunc(cmpVal, elem)) return elem;
+        }
+        slot = (slot +1) & (m->nSlots -1);
+    }
+    return NULL;
+}
@@ -0,0 +1,20 @@
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <stdbool.h>
+#include "list.h"
+
+//members may be read but not manipulated outside the functions
+struct hashMap {
+    struct list elems; //in insertion order
+    struct list hashes;
+    int* slots; //index into elems +1, 0 for empty slots
+    int nSlots;
+};
+
+struct hashMap HashMapInit(int elemSize);
+void HashMapDestroy(struct hashMap m);
+void* HashMapAdd(struct hashMap* m, unsigned long long hash, void* elem); //returns the stored copy of elem
+void* HashMapGet(struct hashMap* m, unsigned long long hash, void* cmpVal, bool(*cmpFunc)(void* cmpVal, void* mapElem)); //returns NULL if not found
+
+#endif //HASHMAP_H
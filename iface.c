@@ -0,0 +1,304 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "iface.h"
+#include "operation.h"
+#include "util.h"
+#include "list.h"
+
+#define IFACE_MAGIC "OIF"
+#define IFACE_VERSION 3
+#define IFACE_MAX_NESTING 64
+
+#define TYPE_FLAG_PLACEHOLDER 1
+#define TYPE_FLAG_STRUCT_MALLOC 2
+#define TYPE_FLAG_ARR_MALLOC 4
+#define TYPE_FLAG_HAS_ERROR 8
+#define TYPE_FLAG_ARR_LEN 16
+
+#define VAR_FLAG_MUT 1
+#define VAR_FLAG_MAY_BE_INITIALIZED 2
+
+struct iface IfaceInit() {
+    struct iface ifc = (struct iface){0};
+    ifc.deps = ListInit(sizeof(struct ifaceDep));
+    ifc.vars = ListInit(sizeof(struct var));
+    return ifc;
+}
+
+void IfaceDestroy(struct iface ifc) {
+    ListDestroy(ifc.deps);
+    ListDestroy(ifc.vars);
+}
+
+void getIfaceFileName(struct str srcFileName, char* buffer) { //buffer must hold srcFileName.len + sizeof(IFACE_FILE_EXT)
+    StrGetAsCStr(srcFileName, buffer);
+    strcat(buffer, IFACE_FILE_EXT);
+}
+
+bool IfaceHashFile(struct str fileName, unsigned long long* hash) {
+    char cFileName[fileName.len +1];
+    StrGetAsCStr(fileName, cFileName);
+    FILE* fp = fopen(cFileName, "rb");
+    if (!fp) return false;
+    unsigned char buffer[4096];
+    size_t n;
+    *hash = HASH_SEED;
+    while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) *hash = HashBytes(*hash, buffer, n);
+    fclose(fp);
+    return true;
+}
+
+void writeU8(FILE* fp, int val) {
+    fputc(val & 0xff, fp);
+}
+
+void writeU32(FILE* fp, unsigned int val) {
+    for (int i = 0; i < 4; i++) writeU8(fp, val >> (i * 8));
+}
+
+void writeU64(FILE* fp, unsigned long long val) {
+    for (int i = 0; i < 8; i++) writeU8(fp, val >> (i * 8));
+}
+
+void writeStr(FILE* fp, struct str s) {
+    writeU32(fp, s.len);
+    fwrite(s.ptr, 1, s.len, fp);
+}
+
+void writeType(FILE* fp, struct type* t);
+
+void writeVar(FILE* fp, struct var* v) {
+    writeStr(fp, v->name);
+    writeU8(fp, (v->mut ? VAR_FLAG_MUT : 0) | (v->mayBeInitialized ? VAR_FLAG_MAY_BE_INITIALIZED : 0));
+    writeType(fp, &v->type);
+}
+
+void writeType(FILE* fp, struct type* t) {
+    int flags = 0;
+    if (t->placeholder) flags |= TYPE_FLAG_PLACEHOLDER;
+    if (t->structMAlloc) flags |= TYPE_FLAG_STRUCT_MALLOC;
+    if (t->arrMalloc) flags |= TYPE_FLAG_ARR_MALLOC;
+    if (t->hasError) flags |= TYPE_FLAG_HAS_ERROR;
+    if (t->arrLen && t->arrLen->isLiteral) flags |= TYPE_FLAG_ARR_LEN;
+
+    writeU8(fp, t->bType);
+    writeStr(fp, t->name);
+    writeU8(fp, t->arrBase);
+    writeU8(fp, flags);
+    writeU32(fp, t->arrLvls);
+    if (flags & TYPE_FLAG_ARR_LEN) writeU64(fp, t->arrLen->intLiteralVal);
+
+    writeU32(fp, t->vars.len);
+    for (int i = 0; i < t->vars.len; i++) writeVar(fp, ListGetIdx(&t->vars, i));
+    writeU32(fp, t->words.len);
+    for (int i = 0; i < t->words.len; i++) writeStr(fp, *(struct str*)ListGetIdx(&t->words, i));
+    writeU32(fp, t->retType.len);
+    for (int i = 0; i < t->retType.len; i++) writeType(fp, ListGetIdx(&t->retType, i));
+    writeU32(fp, t->errors.len);
+    for (int i = 0; i < t->errors.len; i++) writeType(fp, ListGetIdx(&t->errors, i));
+}
+
+//interface files are only a cache, failing to write one is not an error
+void IfaceWrite(struct str srcFileName, struct iface* ifc) {
+    char fileName[srcFileName.len + sizeof(IFACE_FILE_EXT)];
+    getIfaceFileName(srcFileName, fileName);
+    FILE* fp = fopen(fileName, "wb");
+    if (!fp) return;
+    fputs(IFACE_MAGIC, fp);
+    writeU8(fp, IFACE_VERSION);
+    writeU64(fp, ifc->srcHash);
+    writeU32(fp, ifc->deps.len);
+    for (int i = 0; i < ifc->deps.len; i++) {
+        struct ifaceDep* dep = ListGetIdx(&ifc->deps, i);
+        writeStr(fp, dep->fileName);
+        writeU64(fp, dep->srcHash);
+    }
+    writeU32(fp, ifc->vars.len);
+    for (int i = 0; i < ifc->vars.len; i++) writeVar(fp, ListGetIdx(&ifc->vars, i));
+    fclose(fp);
+}
+
+struct ifaceReader {
+    unsigned char* buf; //kept alive since loaded names point into it
+    long len;
+    long cursor;
+    int nesting;
+    bool failed;
+};
+
+int readU8(struct ifaceReader* r) {
+    if (r->failed || r->cursor >= r->len) {r->failed = true; return 0;}
+    return r->buf[r->cursor++];
+}
+
+unsigned int readU32(struct ifaceReader* r) {
+    unsigned int val = 0;
+    for (int i = 0; i < 4; i++) val |= (unsigned int)readU8(r) << (i * 8);
+    return val;
+}
+
+unsigned long long readU64(struct ifaceReader* r) {
+    unsigned long long val = 0;
+    for (int i = 0; i < 8; i++) val |= (unsigned long long)readU8(r) << (i * 8);
+    return val;
+}
+
+int readCount(struct ifaceReader* r) {
+    unsigned int n = readU32(r);
+    if (n > (unsigned long)(r->len - r->cursor)) {r->failed = true; return 0;} //every element takes at least one byte
+    return n;
+}
+
+struct str readStr(struct ifaceReader* r) {
+    int len = readCount(r);
+    if (r->failed) return (struct str){0};
+    struct str s = Str((char*)r->buf + r->cursor, len);
+    r->cursor += len;
+    return s;
+}
+
+struct token ifaceToken(struct str name) {
+    struct token tok = (struct token){0};
+    tok.type = TOK_IDEN;
+    tok.str = name;
+    return tok;
+}
+
+struct operand* ifaceArrLen(long long len) {
+    struct operand* op = CallocOrCrash(sizeof(struct operand));
+    op->type = TypeVanillaId(BASETYPE_INT64);
+    op->isLiteral = true;
+    op->intLiteralVal = len;
+    return op;
+}
+
+//the same handles the checker gives the types it names, function types are not interned
+void ifaceInternType(struct type* t) {
+    if (t->bType == BASETYPE_ARRAY) {
+        t->arrBaseId = TypeVanillaId(t->arrBase);
+        t->id = TypeInternArray(t->arrBaseId, t->arrLvls);
+    } else if (t->bType != BASETYPE_FUNC) t->id = TypeVanillaId(t->bType);
+}
+
+struct type readType(struct ifaceReader* r);
+
+struct var readVar(struct ifaceReader* r) {
+    struct var v = (struct var){0};
+    v.name = readStr(r);
+    v.tok = ifaceToken(v.name);
+    int flags = readU8(r);
+    v.mut = flags & VAR_FLAG_MUT;
+    v.mayBeInitialized = flags & VAR_FLAG_MAY_BE_INITIALIZED;
+    v.type = readType(r);
+    return v;
+}
+
+struct type readType(struct ifaceReader* r) {
+    struct type t = (struct type){0};
+    if (++r->nesting > IFACE_MAX_NESTING) r->failed = true;
+    if (r->failed) return t;
+
+    t.bType = readU8(r);
+    if (t.bType >= BASETYPE_COUNT || t.bType == BASETYPE_STRUCT || t.bType == BASETYPE_VOCAB || t.bType == BASETYPE_ERROR) r->failed = true;
+    t.name = readStr(r);
+    t.tok = ifaceToken(t.name);
+    t.arrBase = readU8(r);
+    if (t.bType == BASETYPE_ARRAY && t.arrBase > BASETYPE_FLOAT64) r->failed = true;
+    int flags = readU8(r);
+    t.placeholder = flags & TYPE_FLAG_PLACEHOLDER;
+    t.structMAlloc = flags & TYPE_FLAG_STRUCT_MALLOC;
+    t.arrMalloc = flags & TYPE_FLAG_ARR_MALLOC;
+    t.hasError = flags & TYPE_FLAG_HAS_ERROR;
+    t.arrLvls = readU32(r);
+    if (flags & TYPE_FLAG_ARR_LEN) t.arrLen = ifaceArrLen(readU64(r));
+
+    t.vars = ListInit(sizeof(struct var));
+    t.words = ListInit(sizeof(struct str));
+    t.retType = ListInit(sizeof(struct type));
+    t.errors = ListInit(sizeof(struct type));
+    int n = readCount(r);
+    for (int i = 0; i < n && !r->failed; i++) {
+        struct var v = readVar(r);
+        ListAdd(&t.vars, &v);
+    }
+    n = readCount(r);
+    for (int i = 0; i < n && !r->failed; i++) {
+        struct str word = readStr(r);
+        ListAdd(&t.words, &word);
+    }
+    n = readCount(r);
+    for (int i = 0; i < n && !r->failed; i++) {
+        struct type ret = readType(r);
+        ListAdd(&t.retType, &ret);
+    }
+    n = readCount(r);
+    for (int i = 0; i < n && !r->failed; i++) {
+        struct type err = readType(r);
+        ListAdd(&t.errors, &err);
+    }
+    if (!r->failed) ifaceInternType(&t);
+    r->nesting--;
+    return t;
+}
+
+bool readFileToReader(char* fileName, struct ifaceReader* r) {
+    FILE* fp = fopen(fileName, "rb");
+    if (!fp) return false;
+    fseek(fp, 0, SEEK_END);
+    r->len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (r->len <= 0) {fclose(fp); return false;}
+    r->buf = MallocOrCrash(r->len);
+    bool ok = fread(r->buf, 1, r->len, fp) == (size_t)r->len;
+    fclose(fp);
+    if (!ok) free(r->buf);
+    return ok;
+}
+
+bool readHeaderIsFresh(struct ifaceReader* r, unsigned long long srcHash, struct iface* ifc) {
+    for (int i = 0; i < (int)strlen(IFACE_MAGIC); i++) {
+        if (readU8(r) != IFACE_MAGIC[i]) return false;
+    }
+    if (readU8(r) != IFACE_VERSION) return false;
+    ifc->srcHash = readU64(r);
+    if (r->failed || ifc->srcHash != srcHash) return false;
+
+    int nDeps = readCount(r);
+    for (int i = 0; i < nDeps && !r->failed; i++) {
+        struct ifaceDep dep;
+        dep.fileName = readStr(r);
+        dep.srcHash = readU64(r);
+        unsigned long long curHash;
+        if (r->failed) return false;
+        if (!IfaceHashFile(dep.fileName, &curHash) || curHash != dep.srcHash) return false;
+        ListAdd(&ifc->deps, &dep);
+    }
+    return !r->failed;
+}
+
+bool IfaceLoad(struct str srcFileName, unsigned long long srcHash, struct iface* ifc) {
+    char fileName[srcFileName.len + sizeof(IFACE_FILE_EXT)];
+    getIfaceFileName(srcFileName, fileName);
+    struct ifaceReader r = (struct ifaceReader){0};
+    if (!readFileToReader(fileName, &r)) return false;
+
+    *ifc = IfaceInit();
+    if (!readHeaderIsFresh(&r, srcHash, ifc)) {
+        IfaceDestroy(*ifc);
+        free(r.buf);
+        return false;
+    }
+    int n = readCount(&r);
+    for (int i = 0; i < n && !r.failed; i++) {
+        struct var v = readVar(&r);
+        ListAdd(&ifc->vars, &v);
+    }
+    if (r.failed || r.cursor != r.len) {
+        IfaceDestroy(*ifc);
+        free(r.buf);
+        return false;
+    }
+    return true;
+}
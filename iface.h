@@ -0,0 +1,30 @@
+#ifndef IFACE_H
+#define IFACE_H
+
+#include <stdbool.h>
+#include "type.h"
+#include "util.h"
+#include "list.h"
+
+#define IFACE_FILE_EXT ".oif"
+
+//compact binary summary of what a module exports, stored next to its source file
+//the checker only names vanilla types and arrays of them so far, so modules export no types of their own
+struct iface {
+    unsigned long long srcHash;
+    struct list deps; //struct ifaceDep; every module reachable through imports
+    struct list vars; //public functions and global variables, their origin is set by the importer
+};
+
+struct ifaceDep {
+    struct str fileName;
+    unsigned long long srcHash;
+};
+
+struct iface IfaceInit();
+void IfaceDestroy(struct iface ifc); //only the lists, loaded vars and their names stay valid for the importer
+bool IfaceHashFile(struct str fileName, unsigned long long* hash); //returns false if the file can not be read
+void IfaceWrite(struct str srcFileName, struct iface* ifc);
+bool IfaceLoad(struct str srcFileName, unsigned long long srcHash, struct iface* ifc); //returns false if missing or stale
+
+#endif //IFACE_H
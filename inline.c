@@ -0,0 +1,413 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "irtest.h"
+#include "iface.h"
+#include "hashmap.h"
+#include "timer.h"
+#include "util.h"
+
+#define INLINE_CALL_COST 4 //saved by every inlined call besides passing the args
+#define INLINE_LITERAL_ARG_BONUS 2 //per use of a param that is passed a literal, sccp folds it once inlined
+#define INLINE_ERROR_BONUS 4 //for functions declared with errors, the caller checks their result right away
+#define INLINE_SINGLE_CALL_BONUS 40 //the body is copied once at most, whatever its size
+#define INLINE_MAX_INSTRS 4096 //a caller stops growing from inlining beyond this
+
+//functions are nodes of the call graph, calls within a strongly connected component are never inlined
+struct inlineNode {
+    struct optFunc* of;
+    struct list callees; //int; nodes, once per call
+    int nCallSites; //calls from anywhere in the program
+    int scc;
+    int dfsIdx; //-1 until visited
+    int lowLink;
+    bool onStack;
+};
+
+struct inlineGraph {
+    struct list nodes; //struct inlineNode
+    struct hashMap byFunc; //struct inlineEntry
+    struct list order; //int; nodes, callees before their callers
+    struct list stack; //int
+    int nVisited;
+    int nSccs;
+};
+
+struct inlineEntry {
+    struct var* func;
+    int node;
+};
+
+bool inlineEntryCmp(void* func, void* elem) {
+    return *(struct var**)func == ((struct inlineEntry*)elem)->func;
+}
+
+int inlineFindNode(struct inlineGraph* g, struct var* func) {
+    if (!func) return IR_NONE;
+    if (func->origin) func = func->origin;
+    struct inlineEntry* e = HashMapGet(&g->byFunc, HashBytes(HASH_SEED, &func, sizeof(func)), &func, inlineEntryCmp);
+    return e ? e->node : IR_NONE;
+}
+
+struct inlineNode* inlineGetNode(struct inlineGraph* g, int node) {
+    return ListGetIdx(&g->nodes, node);
+}
+
+//tarjan, an scc is complete when its root is done, which is after every scc it calls into
+void inlineVisit(struct inlineGraph* g, int node) {
+    struct inlineNode* n = inlineGetNode(g, node);
+    n->dfsIdx = n->lowLink = g->nVisited++;
+    n->onStack = true;
+    ListAdd(&g->stack, &node);
+    for (int i = 0; i < n->callees.len; i++) {
+        int callee = *(int*)ListGetIdx(&n->callees, i);
+        struct inlineNode* c = inlineGetNode(g, callee);
+        if (c->dfsIdx < 0) {
+            inlineVisit(g, callee);
+            c = inlineGetNode(g, callee);
+            n = inlineGetNode(g, node);
+            if (c->lowLink < n->lowLink) n->lowLink = c->lowLink;
+        }
+        else if (c->onStack && c->dfsIdx < n->lowLink) n->lowLink = c->dfsIdx;
+    }
+    if (n->lowLink != n->dfsIdx) return;
+    int member;
+    do {
+        member = *(int*)ListGetIdx(&g->stack, g->stack.len -1);
+        ListRetract(&g->stack, g->stack.len -1);
+        struct inlineNode* m = inlineGetNode(g, member);
+        m->onStack = false;
+        m->scc = g->nSccs;
+        ListAdd(&g->order, &member);
+    } while (member != node);
+    g->nSccs++;
+}
+
+struct inlineGraph inlineGraphBuild(struct list* funcs) {
+    struct inlineGraph g = {ListInit(sizeof(struct inlineNode)), HashMapInit(sizeof(struct inlineEntry)),
+            ListInit(sizeof(int)), ListInit(sizeof(int)), 0, 0};
+    for (int i = 0; i < funcs->len; i++) {
+        struct optFunc* of = ListGetIdx(funcs, i);
+        if (!of->func->ir || inlineFindNode(&g, of->func) != IR_NONE) continue;
+        struct inlineNode n = {of, ListInit(sizeof(int)), 0, 0, -1, 0, false};
+        struct inlineEntry e = {of->func->origin ? of->func->origin : of->func, g.nodes.len};
+        HashMapAdd(&g.byFunc, HashBytes(HASH_SEED, &e.func, sizeof(e.func)), &e);
+        ListAdd(&g.nodes, &n);
+    }
+    for (int i = 0; i < g.nodes.len; i++) {
+        struct irFunc* f = inlineGetNode(&g, i)->of->func->ir;
+        for (int j = 0; j < f->instrs.len; j++) {
+            struct irInstr* in = IrGetInstr(f, j);
+            int callee = in->op == IR_CALL && in->block != IR_NONE ? inlineFindNode(&g, in->var) : IR_NONE;
+            if (callee == IR_NONE) continue;
+            ListAdd(&inlineGetNode(&g, i)->callees, &callee);
+            inlineGetNode(&g, callee)->nCallSites++;
+        }
+    }
+    for (int i = 0; i < g.nodes.len; i++) {
+        if (inlineGetNode(&g, i)->dfsIdx < 0) inlineVisit(&g, i);
+    }
+    return g;
+}
+
+void inlineGraphDestroy(struct inlineGraph g) {
+    for (int i = 0; i < g.nodes.len; i++) ListDestroy(inlineGetNode(&g, i)->callees);
+    ListDestroy(g.nodes);
+    HashMapDestroy(g.byFunc);
+    ListDestroy(g.order);
+    ListDestroy(g.stack);
+}
+
+int inlineSize(struct irFunc* f) {
+    int size = 0;
+    for (int i = 0; i < f->blocks.len; i++) {
+        if (!IrGetBlock(f, i)->removed) size += IrGetBlock(f, i)->instrs.len;
+    }
+    return size;
+}
+
+//string literals index the tokens of the function they appear in, and the entry of the callee gets the call as its pred
+bool inlineIsPossible(struct irFunc* callee, struct irInstr* call) {
+    if (call->args.len != callee->nParams || IrGetBlock(callee, 0)->preds.len) return false;
+    bool returns = false;
+    for (int i = 0; i < callee->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(callee, i);
+        if (in->block == IR_NONE) continue;
+        if (in->op == IR_STRING) return false;
+        returns |= in->op == IR_RET;
+    }
+    return returns;
+}
+
+//the size of the callee minus what inlining saves: the call itself, the uses of literal args and the error check
+int inlineCost(struct irFunc* caller, struct irFunc* callee, int call) {
+    int cost = inlineSize(callee) - INLINE_CALL_COST - callee->nParams;
+    if (callee->func->type.errors.len) cost -= INLINE_ERROR_BONUS;
+    for (int i = 0; i < callee->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(callee, i);
+        for (int j = 0; j < in->args.len && in->block != IR_NONE; j++) {
+            struct irInstr* arg = IrGetInstr(callee, IrGetArg(callee, i, j));
+            if (arg->op != IR_PARAM) continue;
+            if (IrGetInstr(caller, IrGetArg(caller, call, arg->val))->op == IR_CONST) cost -= INLINE_LITERAL_ARG_BONUS;
+        }
+    }
+    return cost;
+}
+
+int inlineBlockPos(struct irFunc* f, int instr) {
+    struct list* instrs = &IrGetBlock(f, IrGetInstr(f, instr)->block)->instrs;
+    int pos = 0;
+    while (*(int*)ListGetIdx(instrs, pos) != instr) pos++;
+    return pos;
+}
+
+int inlineMap(int* vals, int value) {
+    if (vals[value] == IR_NONE) ErrorBugFound();
+    return vals[value];
+}
+
+//the block of the call is split after it and branches to the copy of the callee instead,
+//every ret becomes a br to the rest of the block, where a phi merges the returned values
+void inlineCall(struct irFunc* f, struct irFunc* callee, int call) {
+    int block = IrGetInstr(f, call)->block;
+    int rest = IrSplitBlock(f, block, inlineBlockPos(f, call) +1);
+    int* vals = MallocOrCrash(callee->instrs.len * sizeof(int));
+    int* blocks = MallocOrCrash(callee->blocks.len * sizeof(int));
+    for (int i = 0; i < callee->instrs.len; i++) vals[i] = IR_NONE;
+    for (int b = 0; b < callee->blocks.len; b++) blocks[b] = IrGetBlock(callee, b)->removed ? IR_NONE : IrAddBlock(f);
+    int* origBlocks = MallocOrCrash(f->blocks.len * sizeof(int));
+    for (int b = 0; b < f->blocks.len; b++) origBlocks[b] = IR_NONE;
+    for (int b = 0; b < callee->blocks.len; b++) {
+        if (blocks[b] != IR_NONE) origBlocks[blocks[b]] = b;
+    }
+
+    //allocas go to the entry of the caller like its own slots
+    for (int b = 0; b < callee->blocks.len; b++) {
+        struct list* instrs = &IrGetBlock(callee, b)->instrs;
+        for (int i = 0; i < instrs->len && blocks[b] != IR_NONE; i++) {
+            int instr = *(int*)ListGetIdx(instrs, i);
+            struct irInstr* in = IrGetInstr(callee, instr);
+            if (IrIsTerminator(in->op)) continue;
+            if (in->op == IR_PARAM) {
+                vals[instr] = IrGetArg(f, call, in->val);
+                continue;
+            }
+            int clone = in->op == IR_ALLOCA ? IrInsertInstr(f, 0, 0, IR_ALLOCA, in->type) : IrAddInstr(f, blocks[b], in->op, in->type);
+            IrGetInstr(f, clone)->opType = in->opType;
+            IrGetInstr(f, clone)->val = in->op == IR_CALL ? IR_CALL_NORMAL : in->val; //the rets of the callee are no rets of f
+            IrGetInstr(f, clone)->var = in->var;
+            vals[instr] = clone;
+        }
+    }
+    for (int i = 0; i < callee->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(callee, i);
+        if (in->block == IR_NONE || in->op == IR_PHI || in->op == IR_PARAM || IrIsTerminator(in->op)) continue;
+        for (int a = 0; a < in->args.len; a++) IrAddArg(f, vals[i], inlineMap(vals, IrGetArg(callee, i, a)));
+    }
+
+    struct list rets = ListInit(sizeof(int)); //the returned values in the order the rets become preds of rest
+    for (int b = 0; b < callee->blocks.len; b++) {
+        if (blocks[b] == IR_NONE) continue;
+        int term = IrGetTerminator(callee, b);
+        struct irInstr* in = IrGetInstr(callee, term);
+        enum irOp op = in->op == IR_RET ? IR_BR : in->op;
+        int clone = IrAddInstr(f, blocks[b], op, TYPE_ID_NONE);
+        if (in->op == IR_RET) {
+            IrSetTargets(f, clone, rest, IR_NONE);
+            int ret = in->args.len ? inlineMap(vals, IrGetArg(callee, term, 0)) : IR_NONE;
+            ListAdd(&rets, &ret);
+            continue;
+        }
+        for (int a = 0; a < in->args.len; a++) IrAddArg(f, clone, inlineMap(vals, IrGetArg(callee, term, a)));
+        if (in->targets[0] != IR_NONE) {
+            IrSetTargets(f, clone, blocks[in->targets[0]], in->targets[1] == IR_NONE ? IR_NONE : blocks[in->targets[1]]);
+        }
+    }
+
+    //the preds of a copied block are the copies of the preds of the original, possibly in another order
+    for (int b = 0; b < callee->blocks.len; b++) {
+        if (blocks[b] == IR_NONE) continue;
+        struct irBlock* orig = IrGetBlock(callee, b);
+        struct list* preds = &IrGetBlock(f, blocks[b])->preds;
+        for (int i = 0; i < orig->instrs.len; i++) {
+            int phi = *(int*)ListGetIdx(&orig->instrs, i);
+            if (IrGetInstr(callee, phi)->op != IR_PHI) break;
+            for (int p = 0; p < preds->len; p++) {
+                int origPred = origBlocks[*(int*)ListGetIdx(preds, p)];
+                int argIdx = 0;
+                while (*(int*)ListGetIdx(&orig->preds, argIdx) != origPred) argIdx++;
+                IrAddArg(f, vals[phi], inlineMap(vals, IrGetArg(callee, phi, argIdx)));
+            }
+        }
+    }
+
+    if (IrGetInstr(f, call)->type != TYPE_ID_NONE) {
+        int result = *(int*)ListGetIdx(&rets, 0);
+        if (rets.len > 1) {
+            result = IrInsertInstr(f, rest, 0, IR_PHI, IrGetInstr(f, call)->type);
+            for (int i = 0; i < rets.len; i++) IrAddArg(f, result, *(int*)ListGetIdx(&rets, i));
+        }
+        IrReplaceUses(f, call, result);
+    }
+    IrRemoveInstr(f, call);
+    IrSetTargets(f, IrAddInstr(f, block, IR_BR, TYPE_ID_NONE), blocks[0], IR_NONE);
+    ListDestroy(rets);
+    free(vals);
+    free(blocks);
+    free(origBlocks);
+}
+
+//calls are collected first as inlining adds the calls of the callee, which were already turned down for it
+bool inlineCaller(struct inlineGraph* g, int node, struct optConfig* config) {
+    struct inlineNode* n = inlineGetNode(g, node);
+    struct irFunc* f = n->of->func->ir;
+    struct list calls = ListInit(sizeof(int));
+    for (int i = 0; i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->op == IR_CALL && in->block != IR_NONE) ListAdd(&calls, &i);
+    }
+    bool changed = false;
+    for (int i = 0; i < calls.len; i++) {
+        int call = *(int*)ListGetIdx(&calls, i);
+        int callee = inlineFindNode(g, IrGetInstr(f, call)->var);
+        if (callee == IR_NONE) continue;
+        struct inlineNode* c = inlineGetNode(g, callee);
+        if (c->scc == n->scc || (c->of->module != n->of->module && !config->wholeProgram)) continue;
+        struct irFunc* calleeIr = c->of->func->ir;
+        int threshold = config->inlineThreshold + (c->nCallSites == 1 ? INLINE_SINGLE_CALL_BONUS : 0);
+        if (!inlineIsPossible(calleeIr, IrGetInstr(f, call)) || inlineCost(f, calleeIr, call) > threshold) continue;
+        if (inlineSize(f) + inlineSize(calleeIr) > INLINE_MAX_INSTRS) continue;
+        inlineCall(f, calleeIr, call);
+        changed = true;
+    }
+    ListDestroy(calls);
+    return changed;
+}
+
+void OptInlineProgram(struct list* funcs, struct optConfig* config) {
+    if (config->level == OPT_LEVEL_0 || config->inlineThreshold <= 0) return;
+    struct inlineGraph g = inlineGraphBuild(funcs);
+    for (int i = 0; i < g.order.len; i++) {
+        int node = *(int*)ListGetIdx(&g.order, i);
+        struct irFunc* f = inlineGetNode(&g, node)->of->func->ir;
+        TimerStart("inline", f->func->name);
+        bool changed = inlineCaller(&g, node, config);
+        TimerStop();
+        if (!changed) continue;
+        if (!IrVerify(f, stdout)) {
+            printf("after inline\n");
+            ErrorBugFound();
+        }
+        OptRun(f, config);
+    }
+    inlineGraphDestroy(g);
+}
+
+//pick(x) returns x +1 for positive x and 0 otherwise, rec(x) returns rec(x) + x and main returns pick(4) + rec(4)
+TEST(OptInlineLiteral) {
+    TypeId i32 = TypeVanillaId(BASETYPE_INT32);
+    TypeId boolType = TypeVanillaId(BASETYPE_BOOL);
+    char* names[3] = {"main", "pick", "rec"};
+    struct type i32Type = TypeVanilla(BASETYPE_INT32);
+    struct var funcs[3];
+    for (int i = 0; i < 3; i++) {
+        IrTestFunc(&funcs[i], names[i], &i32Type, &i32Type, i > 0);
+        funcs[i].origin = &funcs[i];
+    }
+
+    struct irFunc* pick = funcs[1].ir;
+    int positive = IrAddBlock(pick);
+    int otherwise = IrAddBlock(pick);
+    int x = IrAddInstr(pick, 0, IR_PARAM, i32);
+    int zero = IrAddInstr(pick, 0, IR_CONST, i32);
+    int cond = IrAddInstr(pick, 0, IR_OPERATION, boolType);
+    IrGetInstr(pick, cond)->opType = OPERATION_GREATER_THAN;
+    IrAddArg(pick, cond, x);
+    IrAddArg(pick, cond, zero);
+    int condBr = IrAddInstr(pick, 0, IR_CONDBR, TYPE_ID_NONE);
+    IrAddArg(pick, condBr, cond);
+    IrSetTargets(pick, condBr, positive, otherwise);
+    int one = IrAddInstr(pick, positive, IR_CONST, i32);
+    IrGetInstr(pick, one)->val = 1;
+    int add = IrAddInstr(pick, positive, IR_OPERATION, i32);
+    IrGetInstr(pick, add)->opType = OPERATION_ADD;
+    IrAddArg(pick, add, x);
+    IrAddArg(pick, add, one);
+    IrAddArg(pick, IrAddInstr(pick, positive, IR_RET, TYPE_ID_NONE), add);
+    IrAddArg(pick, IrAddInstr(pick, otherwise, IR_RET, TYPE_ID_NONE), zero);
+
+    struct irFunc* rec = funcs[2].ir;
+    int recCall = IrAddInstr(rec, 0, IR_CALL, i32);
+    IrGetInstr(rec, recCall)->var = &funcs[2];
+    int recParam = IrInsertInstr(rec, 0, 0, IR_PARAM, i32);
+    IrAddArg(rec, recCall, recParam);
+    int recSum = IrAddInstr(rec, 0, IR_OPERATION, i32); //so the call is no tail call turning into a loop
+    IrGetInstr(rec, recSum)->opType = OPERATION_ADD;
+    IrAddArg(rec, recSum, recCall);
+    IrAddArg(rec, recSum, recParam);
+    IrAddArg(rec, IrAddInstr(rec, 0, IR_RET, TYPE_ID_NONE), recSum);
+
+    struct irFunc* main = funcs[0].ir;
+    int four = IrAddInstr(main, 0, IR_CONST, i32);
+    IrGetInstr(main, four)->val = 4;
+    int pickCall = IrAddInstr(main, 0, IR_CALL, i32);
+    IrGetInstr(main, pickCall)->var = &funcs[1];
+    IrAddArg(main, pickCall, four);
+    int mainRecCall = IrAddInstr(main, 0, IR_CALL, i32);
+    IrGetInstr(main, mainRecCall)->var = &funcs[2];
+    IrAddArg(main, mainRecCall, four);
+    int sum = IrAddInstr(main, 0, IR_OPERATION, i32);
+    IrGetInstr(main, sum)->opType = OPERATION_ADD;
+    IrAddArg(main, sum, pickCall);
+    IrAddArg(main, sum, mainRecCall);
+    IrAddArg(main, IrAddInstr(main, 0, IR_RET, TYPE_ID_NONE), sum);
+
+    struct optConfig config = OptConfigForLevel(OPT_LEVEL_2);
+    struct list program = ListInit(sizeof(struct optFunc));
+    for (int i = 0; i < 3; i++) {
+        OptRun(funcs[i].ir, &config);
+        struct optFunc of = {&funcs[i], 0};
+        ListAdd(&program, &of);
+    }
+    OptInlineProgram(&program, &config);
+
+    //main keeps a single call, to rec, whose own call is kept too
+    int nCalls = 0;
+    int folded = 0;
+    for (int i = 0; i < main->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(main, i);
+        if (in->block == IR_NONE || in->op != IR_OPERATION || in->opType != OPERATION_ADD) continue;
+        for (int a = 0; a < 2; a++) {
+            struct irInstr* arg = IrGetInstr(main, IrGetArg(main, i, a));
+            folded += arg->op == IR_CONST && arg->val == 5;
+        }
+    }
+    for (int i = 0; i < main->instrs.len; i++) nCalls += IrGetInstr(main, i)->op == IR_CALL && IrGetInstr(main, i)->block != IR_NONE;
+    bool passed = nCalls == 1 && folded == 1 && IrGetInstr(rec, recCall)->block != IR_NONE;
+    for (int i = 0; i < 3; i++) IrTestFuncDestroy(&funcs[i]);
+    ListDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//main calls Twice of an imported module twice, only with the whole program its body is there to be inlined,
+//even once the first check wrote the interface of the module, eval is off so the calls are not folded instead
+TEST(OptInlineWholeProgram) {
+    remove("testlib.olang" IFACE_FILE_EXT);
+    struct optConfig config = OptConfigInit();
+    config.level = OPT_LEVEL_2;
+    config.evalFuel = 0;
+    OptConfigResolve(&config);
+    int nCalls[2] = {-1, -1};
+    bool passed = true;
+    for (int i = 0; i < 2 && passed; i++) {
+        config.wholeProgram = i == 1;
+        struct list program = IrTestCheckConfigured("testimport.olang", &config, false, &passed);
+        if (passed) nCalls[i] = IrTestCount(IrTestFind(&program, "main")->func->ir, IR_CALL);
+        IrTestProgramDestroy(program);
+    }
+    remove("testlib.olang" IFACE_FILE_EXT);
+    if (passed && nCalls[0] == 2 && nCalls[1] == 0) TEST_PASSED;
+    TEST_FAILED;
+}
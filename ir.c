@@ -0,0 +1,781 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ir.h"
+#include "irtest.h"
+#include "util.h"
+#include "list.h"
+
+struct irFunc* IrFuncNew(struct var* func, struct astFunc* src) {
+    struct irFunc* f = MallocOrCrash(sizeof(struct irFunc));
+    *f = (struct irFunc){0};
+    f->func = func;
+    f->src = src;
+    f->retType = TYPE_ID_NONE;
+    if (func->type.retType.len != 0) f->retType = ((struct type*)ListGetIdx(&func->type.retType, 0))->id;
+    f->nParams = func->type.vars.len;
+    f->instrs = ListInit(sizeof(struct irInstr));
+    f->blocks = ListInit(sizeof(struct irBlock));
+    IrAddBlock(f);
+    return f;
+}
+
+void IrDestroy(struct irFunc* f) {
+    for (int i = 0; i < f->instrs.len; i++) ListDestroy(IrGetInstr(f, i)->args);
+    for (int i = 0; i < f->blocks.len; i++) {
+        ListDestroy(IrGetBlock(f, i)->instrs);
+        ListDestroy(IrGetBlock(f, i)->preds);
+    }
+    ListDestroy(f->instrs);
+    ListDestroy(f->blocks);
+    free(f);
+}
+
+struct irInstr* IrGetInstr(struct irFunc* f, int idx) {
+    return ListGetIdx(&f->instrs, idx);
+}
+
+struct irBlock* IrGetBlock(struct irFunc* f, int idx) {
+    return ListGetIdx(&f->blocks, idx);
+}
+
+int IrGetArg(struct irFunc* f, int instr, int argIdx) {
+    return *(int*)ListGetIdx(&IrGetInstr(f, instr)->args, argIdx);
+}
+
+bool IrIsTerminator(enum irOp op) {
+    switch (op) {
+        case IR_BR: return true;
+        case IR_CONDBR: return true;
+        case IR_RET: return true;
+        case IR_EXIT: return true;
+        case IR_UNREACHABLE: return true;
+        default: return false;
+    }
+}
+
+int IrGetTerminator(struct irFunc* f, int block) {
+    struct irBlock* b = IrGetBlock(f, block);
+    if (b->instrs.len == 0) return IR_NONE;
+    int last = *(int*)ListGetIdx(&b->instrs, b->instrs.len -1);
+    return IrIsTerminator(IrGetInstr(f, last)->op) ? last : IR_NONE;
+}
+
+int IrAddBlock(struct irFunc* f) {
+    struct irBlock b = (struct irBlock){0};
+    b.instrs = ListInit(sizeof(int));
+    b.preds = ListInit(sizeof(int));
+    ListAdd(&f->blocks, &b);
+    return f->blocks.len -1;
+}
+
+int IrInsertInstr(struct irFunc* f, int block, int pos, enum irOp op, TypeId type) {
+    struct irInstr instr = (struct irInstr){0};
+    instr.op = op;
+    instr.opType = OPERATION_NONE;
+    instr.type = type;
+    instr.block = block;
+    instr.args = ListInit(sizeof(int));
+    instr.targets[0] = IR_NONE;
+    instr.targets[1] = IR_NONE;
+    ListAdd(&f->instrs, &instr);
+    int idx = f->instrs.len -1;
+
+    struct list* instrs = &IrGetBlock(f, block)->instrs;
+    ListAdd(instrs, &idx);
+    for (int i = instrs->len -1; i > pos; i--) *(int*)ListGetIdx(instrs, i) = *(int*)ListGetIdx(instrs, i -1);
+    *(int*)ListGetIdx(instrs, pos) = idx;
+    return idx;
+}
+
+int IrAddInstr(struct irFunc* f, int block, enum irOp op, TypeId type) {
+    return IrInsertInstr(f, block, IrGetBlock(f, block)->instrs.len, op, type);
+}
+
+void IrAddArg(struct irFunc* f, int instr, int value) {
+    ListAdd(&IrGetInstr(f, instr)->args, &value);
+}
+
+void IrSetTargets(struct irFunc* f, int instr, int target0, int target1) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    in->targets[0] = target0;
+    in->targets[1] = target1;
+    int block = in->block;
+    if (target0 != IR_NONE) ListAdd(&IrGetBlock(f, target0)->preds, &block);
+    if (target1 != IR_NONE) ListAdd(&IrGetBlock(f, target1)->preds, &block);
+}
+
+void irListRemoveIdx(struct list* l, int idx) {
+    for (int i = idx; i < l->len -1; i++) *(int*)ListGetIdx(l, i) = *(int*)ListGetIdx(l, i +1);
+    ListRetract(l, l->len -1);
+}
+
+int irListFind(struct list* l, int val) {
+    for (int i = 0; i < l->len; i++) {
+        if (*(int*)ListGetIdx(l, i) == val) return i;
+    }
+    return IR_NONE;
+}
+
+//the edge is dropped from the preds of target together with the matching phi args
+void irRemoveEdge(struct irFunc* f, int from, int target) {
+    struct irBlock* b = IrGetBlock(f, target);
+    int predIdx = irListFind(&b->preds, from);
+    if (predIdx == IR_NONE) ErrorBugFound();
+    irListRemoveIdx(&b->preds, predIdx);
+    for (int i = 0; i < b->instrs.len; i++) {
+        struct irInstr* phi = IrGetInstr(f, *(int*)ListGetIdx(&b->instrs, i));
+        if (phi->op != IR_PHI) break;
+        irListRemoveIdx(&phi->args, predIdx);
+    }
+}
+
+void IrRemoveInstr(struct irFunc* f, int instr) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    if (in->block == IR_NONE) ErrorBugFound();
+    int block = in->block;
+    if (in->targets[0] != IR_NONE) irRemoveEdge(f, block, in->targets[0]);
+    if (in->targets[1] != IR_NONE) irRemoveEdge(f, block, in->targets[1]);
+    struct list* instrs = &IrGetBlock(f, block)->instrs;
+    irListRemoveIdx(instrs, irListFind(instrs, instr));
+    in = IrGetInstr(f, instr);
+    in->op = IR_NOP;
+    in->block = IR_NONE;
+    in->targets[0] = IR_NONE;
+    in->targets[1] = IR_NONE;
+    ListRetract(&in->args, 0);
+}
+
+void IrMoveInstr(struct irFunc* f, int instr, int block, int pos) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    if (in->block == IR_NONE || IrIsTerminator(in->op)) ErrorBugFound();
+    struct list* from = &IrGetBlock(f, in->block)->instrs;
+    irListRemoveIdx(from, irListFind(from, instr));
+    in->block = block;
+    struct list* to = &IrGetBlock(f, block)->instrs;
+    ListAdd(to, &instr);
+    for (int i = to->len -1; i > pos; i--) *(int*)ListGetIdx(to, i) = *(int*)ListGetIdx(to, i -1);
+    *(int*)ListGetIdx(to, pos) = instr;
+}
+
+void IrReplaceUses(struct irFunc* f, int value, int replacement) {
+    for (int i = 0; i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        for (int j = 0; j < in->args.len; j++) {
+            if (*(int*)ListGetIdx(&in->args, j) == value) *(int*)ListGetIdx(&in->args, j) = replacement;
+        }
+    }
+}
+
+void IrReplaceUsesMapped(struct irFunc* f, int* repl, int nRepl) {
+    for (int i = 0; i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        for (int j = 0; j < in->args.len; j++) {
+            int* arg = ListGetIdx(&in->args, j);
+            while (*arg < nRepl && repl[*arg] != IR_NONE) *arg = repl[*arg];
+        }
+    }
+}
+
+void IrRetarget(struct irFunc* f, int instr, int oldTarget, int newTarget) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    int block = in->block;
+    for (int i = 0; i < 2; i++) {
+        if (in->targets[i] != oldTarget) continue;
+        irRemoveEdge(f, block, oldTarget);
+        in->targets[i] = newTarget;
+        ListAdd(&IrGetBlock(f, newTarget)->preds, &block);
+    }
+}
+
+void IrDropTarget(struct irFunc* f, int instr, int targetIdx) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    if (in->op != IR_CONDBR) ErrorBugFound();
+    irRemoveEdge(f, in->block, in->targets[targetIdx]);
+    in->op = IR_BR;
+    in->targets[0] = in->targets[!targetIdx];
+    in->targets[1] = IR_NONE;
+    ListRetract(&in->args, 0);
+}
+
+//the phis of block have a single arg and are replaced by it, the successors of block get pred instead
+void IrMergeBlocks(struct irFunc* f, int pred, int block) {
+    struct irBlock* b = IrGetBlock(f, block);
+    int br = IrGetTerminator(f, pred);
+    if (block == 0 || block == pred || b->preds.len != 1 || IrGetInstr(f, br)->op != IR_BR) ErrorBugFound();
+    while (b->instrs.len && IrGetInstr(f, *(int*)ListGetIdx(&b->instrs, 0))->op == IR_PHI) {
+        int phi = *(int*)ListGetIdx(&b->instrs, 0);
+        IrReplaceUses(f, phi, IrGetArg(f, phi, 0));
+        IrRemoveInstr(f, phi);
+    }
+    IrRemoveInstr(f, br);
+    for (int i = 0; i < b->instrs.len; i++) {
+        int instr = *(int*)ListGetIdx(&b->instrs, i);
+        IrGetInstr(f, instr)->block = pred;
+        ListAdd(&IrGetBlock(f, pred)->instrs, &instr);
+    }
+    int term = IrGetTerminator(f, pred);
+    for (int i = 0; i < 2 && term != IR_NONE; i++) {
+        int t = IrGetInstr(f, term)->targets[i];
+        if (t == IR_NONE || (i == 1 && t == IrGetInstr(f, term)->targets[0])) continue;
+        struct list* preds = &IrGetBlock(f, t)->preds;
+        for (int j = 0; j < preds->len; j++) {
+            if (*(int*)ListGetIdx(preds, j) == block) *(int*)ListGetIdx(preds, j) = pred;
+        }
+    }
+    b = IrGetBlock(f, block);
+    ListRetract(&b->instrs, 0);
+    b->removed = true;
+}
+
+//the successors get the new block as pred in place of block, so their phi args stay in order
+int IrSplitBlock(struct irFunc* f, int block, int pos) {
+    int split = IrAddBlock(f);
+    struct irBlock* b = IrGetBlock(f, block);
+    struct irBlock* s = IrGetBlock(f, split);
+    if (pos > b->instrs.len || (pos < b->instrs.len && IrGetInstr(f, *(int*)ListGetIdx(&b->instrs, pos))->op == IR_PHI)) ErrorBugFound();
+    for (int i = pos; i < b->instrs.len; i++) {
+        int instr = *(int*)ListGetIdx(&b->instrs, i);
+        IrGetInstr(f, instr)->block = split;
+        ListAdd(&s->instrs, &instr);
+    }
+    ListRetract(&b->instrs, pos);
+    int term = IrGetTerminator(f, split);
+    for (int i = 0; i < 2 && term != IR_NONE; i++) {
+        int t = IrGetInstr(f, term)->targets[i];
+        if (t == IR_NONE || (i == 1 && t == IrGetInstr(f, term)->targets[0])) continue;
+        struct list* preds = &IrGetBlock(f, t)->preds;
+        for (int j = 0; j < preds->len; j++) {
+            if (*(int*)ListGetIdx(preds, j) == block) *(int*)ListGetIdx(preds, j) = split;
+        }
+    }
+    return split;
+}
+
+int irSuccs(struct irFunc* f, int block, int succs[2]) {
+    int term = IrGetTerminator(f, block);
+    if (term == IR_NONE) return 0;
+    int n = 0;
+    for (int i = 0; i < 2; i++) {
+        int t = IrGetInstr(f, term)->targets[i];
+        if (t != IR_NONE) succs[n++] = t;
+    }
+    return n;
+}
+
+struct irDomCtx {
+    int* rpoNum; //-1 for unreachable blocks
+    int* idoms;
+};
+
+int irIntersect(struct irDomCtx* c, int a, int b) {
+    while (a != b) {
+        while (c->rpoNum[a] > c->rpoNum[b]) a = c->idoms[a];
+        while (c->rpoNum[b] > c->rpoNum[a]) b = c->idoms[b];
+    }
+    return a;
+}
+
+//Cooper, Harvey and Kennedy's iterative algorithm over the reverse postorder
+struct list IrDominators(struct irFunc* f) {
+    int n = f->blocks.len;
+    struct irDomCtx c;
+    c.rpoNum = MallocOrCrash(n * sizeof(int));
+    c.idoms = MallocOrCrash(n * sizeof(int));
+    int* postorder = MallocOrCrash(n * sizeof(int));
+    int* stack = MallocOrCrash(n * sizeof(int));
+    int* nextSucc = CallocOrCrash(n * sizeof(int));
+    bool* visited = CallocOrCrash(n * sizeof(bool));
+    for (int i = 0; i < n; i++) {
+        c.rpoNum[i] = -1;
+        c.idoms[i] = IR_NONE;
+    }
+
+    int nPost = 0;
+    int depth = 0;
+    stack[depth++] = 0;
+    visited[0] = true;
+    while (depth > 0) {
+        int b = stack[depth -1];
+        int succs[2];
+        int nSuccs = irSuccs(f, b, succs);
+        if (nextSucc[b] < nSuccs) {
+            int s = succs[nextSucc[b]++];
+            if (!visited[s]) {
+                visited[s] = true;
+                stack[depth++] = s;
+            }
+            continue;
+        }
+        postorder[nPost++] = b;
+        depth--;
+    }
+    for (int i = 0; i < nPost; i++) c.rpoNum[postorder[i]] = nPost -1 - i;
+
+    c.idoms[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = nPost -2; i >= 0; i--) {
+            int b = postorder[i];
+            struct list* preds = &IrGetBlock(f, b)->preds;
+            int newIdom = IR_NONE;
+            for (int j = 0; j < preds->len; j++) {
+                int p = *(int*)ListGetIdx(preds, j);
+                if (c.idoms[p] == IR_NONE) continue;
+                newIdom = newIdom == IR_NONE ? p : irIntersect(&c, p, newIdom);
+            }
+            if (newIdom != c.idoms[b]) {
+                c.idoms[b] = newIdom;
+                changed = true;
+            }
+        }
+    }
+    c.idoms[0] = IR_NONE;
+
+    struct list idoms = ListInit(sizeof(int));
+    for (int i = 0; i < n; i++) ListAdd(&idoms, &c.idoms[i]);
+    free(c.rpoNum);
+    free(c.idoms);
+    free(postorder);
+    free(stack);
+    free(nextSucc);
+    free(visited);
+    return idoms;
+}
+
+bool IrDominates(struct list* idoms, int a, int b) {
+    for (int x = b; x != IR_NONE; x = *(int*)ListGetIdx(idoms, x)) {
+        if (x == a) return true;
+    }
+    return false;
+}
+
+struct list IrDomTreeOrder(struct irFunc* f, struct list* idoms) {
+    int n = f->blocks.len;
+    struct list* children = MallocOrCrash(n * sizeof(struct list));
+    for (int i = 0; i < n; i++) children[i] = ListInit(sizeof(int));
+    for (int i = 1; i < n; i++) {
+        int idom = *(int*)ListGetIdx(idoms, i);
+        if (idom != IR_NONE) ListAdd(&children[idom], &i);
+    }
+    struct list order = ListInit(sizeof(int));
+    struct list stack = ListInit(sizeof(int));
+    int entry = 0;
+    ListAdd(&stack, &entry);
+    while (stack.len) {
+        int b = *(int*)ListGetIdx(&stack, stack.len -1);
+        ListRetract(&stack, stack.len -1);
+        ListAdd(&order, &b);
+        for (int i = children[b].len -1; i >= 0; i--) ListAdd(&stack, ListGetIdx(&children[b], i));
+    }
+    for (int i = 0; i < n; i++) ListDestroy(children[i]);
+    free(children);
+    ListDestroy(stack);
+    return order;
+}
+
+bool irIsReachable(struct list* idoms, int block) {
+    return block == 0 || *(int*)ListGetIdx(idoms, block) != IR_NONE;
+}
+
+//terminators go first so that removing the other instructions never leaves a dangling phi arg
+bool IrRemoveUnreachable(struct irFunc* f) {
+    struct list idoms = IrDominators(f);
+    bool changed = false;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 1; i < f->blocks.len; i++) {
+            struct irBlock* b = IrGetBlock(f, i);
+            if (b->removed || irIsReachable(&idoms, i)) continue;
+            if (pass == 0) {
+                int term = IrGetTerminator(f, i);
+                if (term != IR_NONE) IrRemoveInstr(f, term);
+                continue;
+            }
+            while (b->instrs.len) {
+                IrRemoveInstr(f, *(int*)ListGetIdx(&b->instrs, b->instrs.len -1));
+                b = IrGetBlock(f, i);
+            }
+            b->removed = true;
+            changed = true;
+        }
+    }
+    ListDestroy(idoms);
+    return changed;
+}
+
+int irBlockPos(struct irFunc* f, int instr) {
+    return irListFind(&IrGetBlock(f, IrGetInstr(f, instr)->block)->instrs, instr);
+}
+
+struct irVerifier {
+    struct irFunc* f;
+    FILE* stream;
+    bool valid;
+};
+
+void irVerifyFail(struct irVerifier* v, int block, int instr, char* problem) {
+    if (v->valid) {
+        fputs("invalid ir in function ", v->stream);
+        StrPrint(v->f->func->name, v->stream);
+        fputc('\n', v->stream);
+    }
+    v->valid = false;
+    if (instr != IR_NONE) fprintf(v->stream, "    b%d %%%d: %s\n", block, instr, problem);
+    else fprintf(v->stream, "    b%d: %s\n", block, problem);
+}
+
+bool irArgCountOk(struct irFunc* f, struct irInstr* in) {
+    int n = in->args.len;
+    switch (in->op) {
+        case IR_LOAD: return n == 1;
+        case IR_STORE: return n == 2;
+        case IR_OPERATION: return n == 1 || n == 2;
+        case IR_CAST: return n == 1;
+        case IR_CALL: return true;
+        case IR_LEN: return n == 1;
+        case IR_BOUNDSCHECK: return n == 2;
+        case IR_PHI: return n == IrGetBlock(f, in->block)->preds.len;
+        case IR_CONDBR: return n == 1;
+        case IR_RET: return n == (f->retType != TYPE_ID_NONE);
+        case IR_EXIT: return n <= 1;
+        default: return n == 0;
+    }
+}
+
+bool irDefinesValue(enum irOp op) {
+    switch (op) {
+        case IR_NOP: return false;
+        case IR_STORE: return false;
+        case IR_BOUNDSCHECK: return false;
+        case IR_CALL: return true; //unless the type is none
+        default: return !IrIsTerminator(op);
+    }
+}
+
+bool irIsComparison(enum operation opType) {
+    switch (opType) {
+        case OPERATION_LESS_THAN: return true;
+        case OPERATION_LESS_THAN_OR_EQUAL: return true;
+        case OPERATION_GREATER_THAN: return true;
+        case OPERATION_GREATER_THAN_OR_EQUAL: return true;
+        case OPERATION_EQUALS: return true;
+        case OPERATION_NOT_EQUALS: return true;
+        default: return false;
+    }
+}
+
+void irVerifyTypes(struct irVerifier* v, int idx, struct irInstr* in) {
+    struct irFunc* f = v->f;
+    TypeId args[2] = {TYPE_ID_NONE, TYPE_ID_NONE};
+    for (int i = 0; i < in->args.len && i < 2; i++) args[i] = IrGetInstr(f, IrGetArg(f, idx, i))->type;
+    TypeId boolType = TypeVanillaId(BASETYPE_BOOL);
+    if (irDefinesValue(in->op) && in->op != IR_CALL && in->type == TYPE_ID_NONE) {
+        irVerifyFail(v, in->block, idx, "missing type");
+    }
+    if (!irDefinesValue(in->op) && in->type != TYPE_ID_NONE) irVerifyFail(v, in->block, idx, "defines a value");
+    switch (in->op) {
+        case IR_LOAD:
+        case IR_STORE: {
+            struct irInstr* slot = IrGetInstr(f, IrGetArg(f, idx, 0));
+            if (slot->op != IR_ALLOCA && slot->op != IR_ADDR) irVerifyFail(v, in->block, idx, "not a slot or address");
+            TypeId value = in->op == IR_LOAD ? in->type : args[1];
+            if (slot->op == IR_ALLOCA && slot->type != value) irVerifyFail(v, in->block, idx, "type differs from the slot");
+            break;
+        }
+        case IR_OPERATION:
+            if (in->args.len == 2 && in->opType != OPERATION_BITSHIFT_LEFT && in->opType != OPERATION_BITSHIFT_RIGHT &&
+                    args[0] != args[1]) {
+                irVerifyFail(v, in->block, idx, "operand types differ");
+            }
+            if (irIsComparison(in->opType) && in->type != boolType) irVerifyFail(v, in->block, idx, "comparison is not bool");
+            break;
+        case IR_PHI:
+            for (int i = 0; i < in->args.len; i++) {
+                if (IrGetInstr(f, IrGetArg(f, idx, i))->type != in->type) irVerifyFail(v, in->block, idx, "arg type differs");
+            }
+            break;
+        case IR_LEN:
+            if (TypeGet(args[0])->bType != BASETYPE_ARRAY) irVerifyFail(v, in->block, idx, "not an array");
+            if (in->type != TypeVanillaId(BASETYPE_INT64)) irVerifyFail(v, in->block, idx, "length is not int64");
+            break;
+        case IR_BOUNDSCHECK:
+            if (args[1] != TypeVanillaId(BASETYPE_INT64)) irVerifyFail(v, in->block, idx, "length is not int64");
+            break;
+        case IR_CONDBR: if (args[0] != boolType) irVerifyFail(v, in->block, idx, "condition is not bool"); break;
+        case IR_RET: if (in->args.len && args[0] != f->retType) irVerifyFail(v, in->block, idx, "wrong return type"); break;
+        default: break;
+    }
+}
+
+//a value must be defined before its uses in the same block and in a block dominating the others,
+//for phis the use is at the end of the corresponding predecessor
+void irVerifyDominance(struct irVerifier* v, struct list* idoms, int idx, struct irInstr* in) {
+    struct irFunc* f = v->f;
+    for (int i = 0; i < in->args.len; i++) {
+        int def = IrGetArg(f, idx, i);
+        int defBlock = IrGetInstr(f, def)->block;
+        int useBlock = in->block;
+        if (in->op == IR_PHI) useBlock = *(int*)ListGetIdx(&IrGetBlock(f, in->block)->preds, i);
+        if (!irIsReachable(idoms, useBlock)) continue;
+        bool ok;
+        if (defBlock == useBlock && in->op != IR_PHI) ok = irBlockPos(f, def) < irBlockPos(f, idx);
+        else ok = IrDominates(idoms, defBlock, useBlock);
+        if (!ok) irVerifyFail(v, in->block, idx, "use not dominated by its definition");
+    }
+}
+
+void irVerifyInstr(struct irVerifier* v, struct list* idoms, int block, int pos, int idx) {
+    struct irFunc* f = v->f;
+    struct irBlock* b = IrGetBlock(f, block);
+    struct irInstr* in = IrGetInstr(f, idx);
+    if (in->block != block) {irVerifyFail(v, block, idx, "listed in the wrong block"); return;}
+    if (in->op == IR_NOP) {irVerifyFail(v, block, idx, "removed instruction"); return;}
+    if (IrIsTerminator(in->op) != (pos == b->instrs.len -1)) irVerifyFail(v, block, idx, "terminator not at the end");
+    if (in->op == IR_PHI && pos > 0 && IrGetInstr(f, *(int*)ListGetIdx(&b->instrs, pos -1))->op != IR_PHI) {
+        irVerifyFail(v, block, idx, "phi after a non phi");
+    }
+    if (!irArgCountOk(f, in)) {irVerifyFail(v, block, idx, "wrong number of args"); return;}
+    for (int i = 0; i < in->args.len; i++) {
+        int arg = IrGetArg(f, idx, i);
+        if (arg < 0 || arg >= f->instrs.len || IrGetInstr(f, arg)->block == IR_NONE) {
+            irVerifyFail(v, block, idx, "arg is not an instruction");
+            return;
+        }
+        if (!irDefinesValue(IrGetInstr(f, arg)->op) || IrGetInstr(f, arg)->type == TYPE_ID_NONE) {
+            irVerifyFail(v, block, idx, "arg has no value");
+            return;
+        }
+    }
+    int nTargets = in->op == IR_BR ? 1 : in->op == IR_CONDBR ? 2 : 0;
+    for (int i = 0; i < 2; i++) {
+        int t = in->targets[i];
+        bool valid = t >= 0 && t < f->blocks.len && !IrGetBlock(f, t)->removed;
+        if (i < nTargets && !valid) irVerifyFail(v, block, idx, "invalid branch target");
+        if (i >= nTargets && t != IR_NONE) irVerifyFail(v, block, idx, "unexpected branch target");
+    }
+    irVerifyTypes(v, idx, in);
+    irVerifyDominance(v, idoms, idx, in);
+}
+
+//the preds of every block must be exactly the blocks branching to it, once per branch target
+void irVerifyPreds(struct irVerifier* v, int block) {
+    struct irFunc* f = v->f;
+    struct irBlock* b = IrGetBlock(f, block);
+    int nEdges = 0;
+    for (int i = 0; i < f->blocks.len; i++) {
+        if (IrGetBlock(f, i)->removed) continue;
+        int succs[2];
+        int nSuccs = irSuccs(f, i, succs);
+        for (int j = 0; j < nSuccs; j++) {
+            if (succs[j] != block) continue;
+            nEdges++;
+            int nListed = 0;
+            for (int k = 0; k < b->preds.len; k++) nListed += *(int*)ListGetIdx(&b->preds, k) == i;
+            int nBranches = (succs[0] == block) + (nSuccs > 1 && succs[1] == block);
+            if (nListed != nBranches) irVerifyFail(v, block, IR_NONE, "preds differ from the branches");
+        }
+    }
+    if (nEdges != b->preds.len) irVerifyFail(v, block, IR_NONE, "preds differ from the branches");
+}
+
+bool IrVerify(struct irFunc* f, FILE* stream) {
+    struct irVerifier v = {f, stream, true};
+    if (f->blocks.len == 0 || IrGetBlock(f, 0)->removed) {
+        irVerifyFail(&v, 0, IR_NONE, "no entry block");
+        return false;
+    }
+    if (IrGetBlock(f, 0)->preds.len != 0) irVerifyFail(&v, 0, IR_NONE, "entry block has preds");
+    for (int i = 0; i < f->blocks.len; i++) {
+        struct irBlock* b = IrGetBlock(f, i);
+        if (b->removed) continue;
+        if (IrGetTerminator(f, i) == IR_NONE) irVerifyFail(&v, i, IR_NONE, "no terminator");
+    }
+    if (!v.valid) return false; //dominators need every block to be terminated
+
+    struct list idoms = IrDominators(f);
+    for (int i = 0; i < f->blocks.len; i++) {
+        struct irBlock* b = IrGetBlock(f, i);
+        if (b->removed) continue;
+        irVerifyPreds(&v, i);
+        for (int j = 0; j < b->instrs.len; j++) irVerifyInstr(&v, &idoms, i, j, *(int*)ListGetIdx(&b->instrs, j));
+    }
+    ListDestroy(idoms);
+    return v.valid;
+}
+
+char* irOpNames[] = {
+    [IR_NOP] = "nop",
+    [IR_CONST] = "const",
+    [IR_STRING] = "string",
+    [IR_PARAM] = "param",
+    [IR_ALLOCA] = "alloca",
+    [IR_ADDR] = "addr",
+    [IR_LOAD] = "load",
+    [IR_STORE] = "store",
+    [IR_OPERATION] = "",
+    [IR_CAST] = "cast",
+    [IR_CALL] = "call",
+    [IR_LEN] = "len",
+    [IR_BOUNDSCHECK] = "boundscheck",
+    [IR_PHI] = "phi",
+    [IR_BR] = "br",
+    [IR_CONDBR] = "condbr",
+    [IR_RET] = "ret",
+    [IR_EXIT] = "exit",
+    [IR_UNREACHABLE] = "unreachable"
+};
+
+char* irOperationNames[OPERATION_COUNT] = {
+    [OPERATION_NOT] = "not",
+    [OPERATION_BITWISE_COMPLEMENT] = "compl",
+    [OPERATION_PLUS] = "plus",
+    [OPERATION_MINUS] = "neg",
+    [OPERATION_MODULO] = "mod",
+    [OPERATION_ADD] = "add",
+    [OPERATION_SUB] = "sub",
+    [OPERATION_MUL] = "mul",
+    [OPERATION_DIV] = "div",
+    [OPERATION_LESS_THAN] = "lt",
+    [OPERATION_LESS_THAN_OR_EQUAL] = "le",
+    [OPERATION_GREATER_THAN] = "gt",
+    [OPERATION_GREATER_THAN_OR_EQUAL] = "ge",
+    [OPERATION_EQUALS] = "eq",
+    [OPERATION_NOT_EQUALS] = "ne",
+    [OPERATION_AND] = "and",
+    [OPERATION_OR] = "or",
+    [OPERATION_XOR] = "xor",
+    [OPERATION_BITSHIFT_LEFT] = "shl",
+    [OPERATION_BITSHIFT_RIGHT] = "shr",
+    [OPERATION_BITWISE_AND] = "bitand",
+    [OPERATION_BITWISE_OR] = "bitor",
+    [OPERATION_BITWISE_XOR] = "bitxor"
+};
+
+void irDumpType(TypeId id, FILE* stream) {
+    if (id == TYPE_ID_NONE) {
+        fputs("void", stream);
+        return;
+    }
+    struct type* t = TypeGet(id);
+    StrPrint(t->name, stream);
+    for (int i = 0; i < t->arrLvls; i++) fputs("[]", stream);
+}
+
+bool irIsFloatType(TypeId id) {
+    if (id == TYPE_ID_NONE) return false;
+    enum baseType bType = TypeGet(id)->bType;
+    return bType == BASETYPE_FLOAT32 || bType == BASETYPE_FLOAT64;
+}
+
+void irDumpInstr(struct irFunc* f, int idx, FILE* stream) {
+    struct irInstr* in = IrGetInstr(f, idx);
+    fputs("    ", stream);
+    if (in->type != TYPE_ID_NONE) fprintf(stream, "%%%d = ", idx);
+    fputs(in->op == IR_OPERATION ? irOperationNames[in->opType] : irOpNames[in->op], stream);
+    if (in->type != TYPE_ID_NONE) {
+        fputc(' ', stream);
+        irDumpType(in->type, stream);
+    }
+    switch (in->op) {
+        case IR_CONST:
+            if (irIsFloatType(in->type)) {
+                double d;
+                memcpy(&d, &in->val, sizeof(d));
+                fprintf(stream, " %g", d);
+            }
+            else fprintf(stream, " %lld", in->val);
+            break;
+        case IR_STRING:
+            fputc(' ', stream);
+            StrPrint(AstGetTok(f->src, in->val).str, stream);
+            break;
+        case IR_PARAM: fprintf(stream, " %lld", in->val); break;
+        case IR_ALLOCA: if (in->val == IR_ALLOC_STACK) fputs(" stack", stream); break;
+        case IR_CALL: if (in->val == IR_CALL_TAIL) fputs(" tail", stream); break;
+        default: break;
+    }
+    if (in->var) {
+        fputc(' ', stream);
+        StrPrint(in->var->name, stream);
+    }
+    for (int i = 0; i < in->args.len; i++) {
+        fprintf(stream, i == 0 ? " %%%d" : ", %%%d", IrGetArg(f, idx, i));
+        if (in->op == IR_PHI) fprintf(stream, " b%d", *(int*)ListGetIdx(&IrGetBlock(f, in->block)->preds, i));
+    }
+    for (int i = 0; i < 2; i++) {
+        if (in->targets[i] != IR_NONE) fprintf(stream, "%sb%d", in->args.len || i ? ", " : " ", in->targets[i]);
+    }
+    fputc('\n', stream);
+}
+
+void IrDump(struct irFunc* f, FILE* stream) {
+    fputs("func ", stream);
+    StrPrint(f->func->name, stream);
+    fputc('(', stream);
+    for (int i = 0; i < f->nParams; i++) {
+        if (i) fputs(", ", stream);
+        irDumpType(((struct var*)ListGetIdx(&f->func->type.vars, i))->type.id, stream);
+    }
+    fputs(") ", stream);
+    irDumpType(f->retType, stream);
+    fputs(" {\n", stream);
+    for (int i = 0; i < f->blocks.len; i++) {
+        struct irBlock* b = IrGetBlock(f, i);
+        if (b->removed) continue;
+        fprintf(stream, "b%d:", i);
+        for (int j = 0; j < b->preds.len; j++) fprintf(stream, j == 0 ? " ; preds b%d" : ", b%d", *(int*)ListGetIdx(&b->preds, j));
+        fputc('\n', stream);
+        for (int j = 0; j < b->instrs.len; j++) irDumpInstr(f, *(int*)ListGetIdx(&b->instrs, j), stream);
+    }
+    fputs("}\n", stream);
+}
+
+//a counting loop with a phi, then a use in the exit block that is not dominated by its definition
+TEST(IrVerifyLoop) {
+    TypeId i32 = TypeVanillaId(BASETYPE_INT32);
+    TypeId boolType = TypeVanillaId(BASETYPE_BOOL);
+    struct type ret = TypeVanilla(BASETYPE_INT32);
+    struct var func;
+    struct irFunc* f = IrTestFunc(&func, "count", &ret, &ret, 1);
+    int header = IrAddBlock(f);
+    int body = IrAddBlock(f);
+    int exit = IrAddBlock(f);
+    int p = IrAddInstr(f, 0, IR_PARAM, i32);
+    int zero = IrAddInstr(f, 0, IR_CONST, i32);
+    int one = IrAddInstr(f, 0, IR_CONST, i32);
+    IrGetInstr(f, one)->val = 1;
+    IrSetTargets(f, IrAddInstr(f, 0, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+
+    int phi = IrAddInstr(f, header, IR_PHI, i32);
+    int cond = IrAddInstr(f, header, IR_OPERATION, boolType);
+    IrGetInstr(f, cond)->opType = OPERATION_GREATER_THAN;
+    IrAddArg(f, cond, phi);
+    IrAddArg(f, cond, zero);
+    int condBr = IrAddInstr(f, header, IR_CONDBR, TYPE_ID_NONE);
+    IrAddArg(f, condBr, cond);
+    IrSetTargets(f, condBr, body, exit);
+
+    int next = IrAddInstr(f, body, IR_OPERATION, i32);
+    IrGetInstr(f, next)->opType = OPERATION_SUB;
+    IrAddArg(f, next, phi);
+    IrAddArg(f, next, one);
+    IrSetTargets(f, IrAddInstr(f, body, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+    IrAddArg(f, phi, p);
+    IrAddArg(f, phi, next);
+
+    int retInstr = IrAddInstr(f, exit, IR_RET, TYPE_ID_NONE);
+    IrAddArg(f, retInstr, phi);
+    bool passed = IrTestVerify(f);
+
+    struct list idoms = IrDominators(f);
+    passed = passed && IrDominates(&idoms, header, exit) && !IrDominates(&idoms, body, exit);
+    ListDestroy(idoms);
+
+    *(int*)ListGetIdx(&IrGetInstr(f, retInstr)->args, 0) = next;
+    passed = passed && !IrTestVerify(f);
+    IrTestFuncDestroy(&func);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
@@ -0,0 +1,103 @@
+#ifndef IR_H
+#define IR_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "ast.h"
+#include "operation.h"
+#include "type.h"
+#include "list.h"
+#include "var.h"
+
+#define IR_NONE -1 //for absent values and blocks
+#define IR_ALLOC_HEAP 0 //the memory of an array or struct var may outlive the function
+#define IR_ALLOC_STACK 1
+#define IR_CALL_NORMAL 0
+#define IR_CALL_TAIL 1 //directly returned, the function is jumped to in the frame of the caller
+
+//every instruction defines at most one value, identified by the index of the instruction
+//variables live in stack slots (IR_ALLOCA) and are only accessed with explicit loads and stores
+enum irOp {
+    IR_NOP, //left behind by passes that remove instructions, never in a block
+    IR_CONST, //val holds the literal, the bits of the double for float types
+    IR_STRING, //val is the index into src->toks of the string literal
+    IR_PARAM, //val is the index of the function argument
+    IR_ALLOCA, //the stack slot of var, typed as the variable, val is where the memory an array or struct var owns lives
+    IR_ADDR, //the address of var if it is not a slot of the function, i.e. of a global
+    IR_LOAD, //args: slot or addr
+    IR_STORE, //args: slot or addr, value
+    IR_OPERATION, //opType with one or two args
+    IR_CAST, //args: value, converted to type
+    IR_CALL, //var is the function, args are the function arguments, val is how it is called
+    IR_LEN, //args: an array, its length from the length header as int64
+    IR_BOUNDSCHECK, //args: index, length; traps unless 0 <= index < length, val is why the check is kept
+    IR_PHI, //one arg per predecessor of the block, in the order of preds
+
+    //terminators, the last instruction of every block and only there
+    IR_BR, //targets[0]
+    IR_CONDBR, //args: bool, to targets[0] if true, else targets[1]
+    IR_RET, //args: the return value unless the function returns nothing
+    IR_EXIT, //args: the exit code if there is one
+    IR_UNREACHABLE //the end of a function with a return type
+};
+
+struct irInstr {
+    enum irOp op;
+    enum operation opType;
+    TypeId type; //TYPE_ID_NONE if no value is defined
+    int block; //IR_NONE once removed
+    struct list args; //int; values
+    int targets[2]; //blocks
+    long long val;
+    struct var* var;
+};
+
+struct irBlock {
+    struct list instrs; //int; phis first, terminator last
+    struct list preds; //int; blocks, in the order branches to this block were added
+    bool removed;
+};
+
+struct irFunc {
+    struct var* func;
+    struct astFunc* src; //kept for string literals
+    TypeId retType; //TYPE_ID_NONE if the function returns nothing
+    int nParams;
+    struct list instrs; //struct irInstr
+    struct list blocks; //struct irBlock; the entry block is 0
+};
+
+struct irFunc* IrFuncNew(struct var* func, struct astFunc* src);
+void IrDestroy(struct irFunc* f);
+struct irInstr* IrGetInstr(struct irFunc* f, int idx);
+struct irBlock* IrGetBlock(struct irFunc* f, int idx);
+int IrGetArg(struct irFunc* f, int instr, int argIdx);
+bool IrIsTerminator(enum irOp op);
+int IrGetTerminator(struct irFunc* f, int block); //IR_NONE if the block has no terminator yet
+
+//for building and rewriting
+int IrAddBlock(struct irFunc* f);
+int IrAddInstr(struct irFunc* f, int block, enum irOp op, TypeId type); //appended to the end of block
+int IrInsertInstr(struct irFunc* f, int block, int pos, enum irOp op, TypeId type); //at position pos of block
+void IrAddArg(struct irFunc* f, int instr, int value);
+void IrSetTargets(struct irFunc* f, int instr, int target0, int target1); //also records the preds, target1 may be IR_NONE
+void IrRemoveInstr(struct irFunc* f, int instr);
+void IrMoveInstr(struct irFunc* f, int instr, int block, int pos); //not for terminators, their edges stay
+void IrReplaceUses(struct irFunc* f, int value, int replacement);
+void IrReplaceUsesMapped(struct irFunc* f, int* repl, int nRepl); //every arg a < nRepl becomes repl[a] unless that is IR_NONE, chains are followed
+void IrRetarget(struct irFunc* f, int instr, int oldTarget, int newTarget); //the caller adds the phi args of newTarget for the new pred
+void IrDropTarget(struct irFunc* f, int instr, int targetIdx); //turns a condbr into a br to the other target
+void IrMergeBlocks(struct irFunc* f, int pred, int block); //pred must end in a br to block, which must have no other pred
+int IrSplitBlock(struct irFunc* f, int block, int pos); //the instructions from pos on move to the returned block, block is left unterminated
+bool IrRemoveUnreachable(struct irFunc* f); //returns whether a block was removed
+
+bool IrVerify(struct irFunc* f, FILE* stream); //prints what is wrong, an invalid function is a bug in whatever built it
+void IrDump(struct irFunc* f, FILE* stream);
+
+//idoms[b] is the immediate dominator of block b, IR_NONE for the entry and unreachable blocks
+//the returned list is owned by the caller
+struct list IrDominators(struct irFunc* f);
+bool IrDominates(struct list* idoms, int a, int b);
+struct list IrDomTreeOrder(struct irFunc* f, struct list* idoms); //int; reachable blocks in depth first preorder of the dominator tree
+
+#endif //IR_H
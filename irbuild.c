@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "irbuild.h"
+#include "ast.h"
+#include "statement.h"
+#include "util.h"
+
+struct irBuilder {
+    struct irFunc* f;
+    struct astFunc* af;
+    int block; //where instructions are appended
+    int* slots; //per variable of af, IR_NONE for those that are not locals or arguments
+    int nAllocas; //the allocas are the first instructions of the entry block
+};
+
+int irbAddInstr(struct irBuilder* b, enum irOp op, TypeId type) {
+    return IrAddInstr(b->f, b->block, op, type);
+}
+
+void irbTerminate(struct irBuilder* b, enum irOp op, int target0, int target1, int arg) {
+    int instr = irbAddInstr(b, op, TYPE_ID_NONE);
+    if (arg != IR_NONE) IrAddArg(b->f, instr, arg);
+    IrSetTargets(b->f, instr, target0, target1);
+}
+
+//statements following a return or exit are unreachable and get a block without preds
+void irbEnsureOpen(struct irBuilder* b) {
+    if (IrGetTerminator(b->f, b->block) != IR_NONE) b->block = IrAddBlock(b->f);
+}
+
+int irbAddSlot(struct irBuilder* b, int varIdx) {
+    struct var* v = AstGetVar(b->af, varIdx);
+    int slot = IrInsertInstr(b->f, 0, b->nAllocas++, IR_ALLOCA, v->type.id);
+    IrGetInstr(b->f, slot)->var = v;
+    b->slots[varIdx] = slot;
+    return slot;
+}
+
+int irbFindVar(struct astFunc* af, struct var* origin) {
+    for (int i = 0; i < af->vars.len; i++) {
+        if (AstGetVar(af, i)->origin == origin) return i;
+    }
+    return AST_NONE;
+}
+
+//arguments are stored into their slots on entry, locals only get a slot
+void irbAddSlots(struct irBuilder* b, struct var* func) {
+    for (int i = 0; i < b->af->vars.len; i++) b->slots[i] = IR_NONE;
+    for (int i = 0; i < b->f->nParams; i++) {
+        struct var* paramVar = ListGetIdx(&func->type.vars, i);
+        int param = irbAddInstr(b, IR_PARAM, paramVar->type.id);
+        IrGetInstr(b->f, param)->val = i;
+        int varIdx = irbFindVar(b->af, paramVar->origin);
+        if (varIdx == AST_NONE) continue;
+        int store = irbAddInstr(b, IR_STORE, TYPE_ID_NONE);
+        IrAddArg(b->f, store, irbAddSlot(b, varIdx));
+        IrAddArg(b->f, store, param);
+    }
+    for (int i = 0; i < b->af->stmts.len; i++) {
+        struct astStmt* s = AstGetStmt(b->af, i);
+        if (s->sType == STATEMENT_STACK_ALLOCATION && b->slots[s->var] == IR_NONE) irbAddSlot(b, s->var);
+    }
+}
+
+//an addr has no base or index, so it only stands for a whole var declared outside of the function
+//members and elements have no origin of their own and never reach the ast
+int irbVarAddr(struct irBuilder* b, int varIdx) {
+    if (b->slots[varIdx] != IR_NONE) return b->slots[varIdx];
+    struct var* v = AstGetVar(b->af, varIdx);
+    if (!v->origin) ErrorBugFound();
+    int addr = irbAddInstr(b, IR_ADDR, v->type.id);
+    IrGetInstr(b->f, addr)->var = v;
+    return addr;
+}
+
+int irbConst(struct irBuilder* b, TypeId type, long long val) {
+    int c = irbAddInstr(b, IR_CONST, type);
+    IrGetInstr(b->f, c)->val = val;
+    return c;
+}
+
+int irbOpnd(struct irBuilder* b, int opndIdx);
+
+int irbLiteral(struct irBuilder* b, struct astOpnd* n) {
+    if (TypeGet(n->type)->bType == BASETYPE_ARRAY) {
+        int str = irbAddInstr(b, IR_STRING, n->type);
+        IrGetInstr(b->f, str)->val = n->tok;
+        return str;
+    }
+    return irbConst(b, n->type, AstGetLiteral(b->af, n->val));
+}
+
+int irbOpnd(struct irBuilder* b, int opndIdx) {
+    struct astOpnd n = *AstGetOpnd(b->af, opndIdx);
+    if (n.opType == OPERATION_NONE) {
+        if (!n.isLiteral) ErrorBugFound();
+        return irbLiteral(b, &n);
+    }
+    if (n.opType == OPERATION_READ_VAR) {
+        int addr = irbVarAddr(b, n.val);
+        int load = irbAddInstr(b, IR_LOAD, n.type);
+        IrAddArg(b->f, load, addr);
+        return load;
+    }
+
+    int args[n.nArgs +1];
+    for (int i = 0; i < n.nArgs; i++) args[i] = irbOpnd(b, n.args + i);
+    int instr;
+    switch (n.opType) {
+        case OPERATION_FUNCCALL:
+            instr = irbAddInstr(b, IR_CALL, n.type);
+            IrGetInstr(b->f, instr)->var = AstGetVar(b->af, n.val);
+            break;
+        case OPERATION_TYPECAST: instr = irbAddInstr(b, IR_CAST, n.type); break;
+        default:
+            instr = irbAddInstr(b, IR_OPERATION, n.type);
+            IrGetInstr(b->f, instr)->opType = n.opType;
+    }
+    for (int i = 0; i < n.nArgs; i++) IrAddArg(b->f, instr, args[i]);
+    return instr;
+}
+
+void irbStore(struct irBuilder* b, int addr, int value) {
+    int store = irbAddInstr(b, IR_STORE, TYPE_ID_NONE);
+    IrAddArg(b->f, store, addr);
+    IrAddArg(b->f, store, value);
+}
+
+void irbIncrement(struct irBuilder* b, struct astStmt* s, enum operation opType) {
+    struct var* v = AstGetVar(b->af, s->var);
+    int addr = irbVarAddr(b, s->var);
+    int load = irbAddInstr(b, IR_LOAD, v->type.id);
+    IrAddArg(b->f, load, addr);
+    long long one = 1;
+    if (v->type.bType == BASETYPE_FLOAT32 || v->type.bType == BASETYPE_FLOAT64) {
+        double oneF = 1.0;
+        memcpy(&one, &oneF, sizeof(one));
+    }
+    int c = irbConst(b, v->type.id, one);
+    int op = irbAddInstr(b, IR_OPERATION, v->type.id);
+    IrGetInstr(b->f, op)->opType = opType;
+    IrAddArg(b->f, op, load);
+    IrAddArg(b->f, op, c);
+    irbStore(b, addr, op);
+}
+
+void irbCodeBlock(struct irBuilder* b, int start, int len);
+
+//lowers the code block of s starting in bodyBlock, falling through to continueBlock
+void irbBranchBody(struct irBuilder* b, struct astStmt s, int bodyBlock, int continueBlock) {
+    b->block = bodyBlock;
+    irbCodeBlock(b, s.block, s.blockLen);
+    if (IrGetTerminator(b->f, b->block) == IR_NONE) irbTerminate(b, IR_BR, continueBlock, IR_NONE, IR_NONE);
+}
+
+//an else directly follows its if in the same code block, returns the number of statements used
+int irbIf(struct irBuilder* b, struct astStmt s, struct astStmt* next) {
+    int cond = irbOpnd(b, s.op);
+    int thenBlock = IrAddBlock(b->f);
+    int elseBlock = next && next->sType == STATEMENT_ELSE ? IrAddBlock(b->f) : IR_NONE;
+    int join = IrAddBlock(b->f);
+    irbTerminate(b, IR_CONDBR, thenBlock, elseBlock != IR_NONE ? elseBlock : join, cond);
+    irbBranchBody(b, s, thenBlock, join);
+    if (elseBlock != IR_NONE) irbBranchBody(b, *next, elseBlock, join);
+    b->block = join;
+    return elseBlock != IR_NONE ? 2 : 1;
+}
+
+void irbFor(struct irBuilder* b, struct astStmt s) {
+    int header = IrAddBlock(b->f);
+    irbTerminate(b, IR_BR, header, IR_NONE, IR_NONE);
+    b->block = header;
+    int cond = irbOpnd(b, s.op);
+    int body = IrAddBlock(b->f);
+    int exit = IrAddBlock(b->f);
+    irbTerminate(b, IR_CONDBR, body, exit, cond);
+    irbBranchBody(b, s, body, header);
+    b->block = exit;
+}
+
+//cases are compared in order, nomatch runs if none is equal wherever it is written
+void irbMatch(struct irBuilder* b, struct astStmt s) {
+    int value = irbOpnd(b, s.op);
+    int join = IrAddBlock(b->f);
+    int noMatch = AST_NONE;
+    for (int i = 0; i < s.blockLen; i++) {
+        struct astStmt c = *AstGetStmt(b->af, s.block + i);
+        if (c.sType == STATEMENT_NOMATCH) {
+            noMatch = s.block + i;
+            continue;
+        }
+        if (c.sType != STATEMENT_CASE) ErrorBugFound();
+        int caseValue = irbOpnd(b, c.op);
+        int eq = irbAddInstr(b, IR_OPERATION, TypeVanillaId(BASETYPE_BOOL));
+        IrGetInstr(b->f, eq)->opType = OPERATION_EQUALS;
+        IrAddArg(b->f, eq, value);
+        IrAddArg(b->f, eq, caseValue);
+        int caseBlock = IrAddBlock(b->f);
+        int next = IrAddBlock(b->f);
+        irbTerminate(b, IR_CONDBR, caseBlock, next, eq);
+        irbBranchBody(b, c, caseBlock, join);
+        b->block = next;
+    }
+    if (noMatch != AST_NONE) irbCodeBlock(b, AstGetStmt(b->af, noMatch)->block, AstGetStmt(b->af, noMatch)->blockLen);
+    if (IrGetTerminator(b->f, b->block) == IR_NONE) irbTerminate(b, IR_BR, join, IR_NONE, IR_NONE);
+    b->block = join;
+}
+
+void irbCodeBlock(struct irBuilder* b, int start, int len) {
+    for (int i = 0; i < len;) {
+        irbEnsureOpen(b);
+        struct astStmt s = *AstGetStmt(b->af, start + i);
+        struct astStmt* next = i +1 < len ? AstGetStmt(b->af, start + i +1) : NULL;
+        int n = 1;
+        switch (s.sType) {
+            case STATEMENT_STACK_ALLOCATION: break;
+            case STATEMENT_ASSIGNMENT: {
+                int value = irbOpnd(b, s.op);
+                irbStore(b, irbVarAddr(b, s.var), value);
+                break;
+            }
+            case STATEMENT_ASSIGNMENT_INCREMENT: irbIncrement(b, &s, OPERATION_ADD); break;
+            case STATEMENT_ASSIGNMENT_DECREMENT: irbIncrement(b, &s, OPERATION_SUB); break;
+            case STATEMENT_IF: n = irbIf(b, s, next); break;
+            case STATEMENT_FOR: irbFor(b, s); break;
+            case STATEMENT_MATCH: irbMatch(b, s); break;
+            case STATEMENT_RETURN: irbTerminate(b, IR_RET, IR_NONE, IR_NONE, s.op != AST_NONE ? irbOpnd(b, s.op) : IR_NONE); break;
+            case STATEMENT_EXIT: irbTerminate(b, IR_EXIT, IR_NONE, IR_NONE, s.op != AST_NONE ? irbOpnd(b, s.op) : IR_NONE); break;
+            case STATEMENT_ELSE: ErrorBugFound(); break; //only after an if
+            case STATEMENT_CASE: ErrorBugFound(); break; //only inside a match
+            case STATEMENT_NOMATCH: ErrorBugFound(); break;
+        }
+        i += n;
+    }
+}
+
+struct irFunc* IrBuild(struct var* func) {
+    struct irBuilder b;
+    b.af = func->body;
+    b.f = IrFuncNew(func, b.af);
+    b.block = 0;
+    b.nAllocas = 0;
+    b.slots = MallocOrCrash(b.af->vars.len * sizeof(int) +1);
+    irbAddSlots(&b, func);
+    irbCodeBlock(&b, b.af->body, b.af->bodyLen);
+    if (IrGetTerminator(b.f, b.block) != IR_NONE);
+    else if (b.f->retType == TYPE_ID_NONE) irbTerminate(&b, IR_RET, IR_NONE, IR_NONE, IR_NONE);
+    else irbTerminate(&b, IR_UNREACHABLE, IR_NONE, IR_NONE, IR_NONE);
+    free(b.slots);
+    if (!IrVerify(b.f, stdout)) ErrorBugFound();
+    return b.f;
+}
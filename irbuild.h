@@ -0,0 +1,11 @@
+#ifndef IRBUILD_H
+#define IRBUILD_H
+
+#include "ir.h"
+#include "var.h"
+
+//lowers the flattened body of func, which must have been parsed without errors
+//every variable of the function gets a stack slot in the entry block, so the result has no phis yet
+struct irFunc* IrBuild(struct var* func);
+
+#endif //IRBUILD_H
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+//only set by the flags of the test build, util.h defines TEST in every build
+#ifdef TEST
+#include "irtest.h"
+#include "check.h"
+#include "syntax.h"
+#include "errmsg.h"
+#include "pool.h"
+#include "ast.h"
+#include "util.h"
+#include "list.h"
+
+struct irFunc* IrTestFunc(struct var* func, char* name, struct type* ret, struct type* params, int nParams) {
+    *func = (struct var){0};
+    if (name) func->name = StrFromCStr(name);
+    func->type.vars = ListInit(sizeof(struct var));
+    func->type.retType = ListInit(sizeof(struct type));
+    if (ret) ListAdd(&func->type.retType, ret);
+    for (int i = 0; i < nParams; i++) {
+        struct var param = (struct var){0};
+        param.type = params[i];
+        ListAdd(&func->type.vars, &param);
+    }
+    func->ir = IrFuncNew(func, NULL);
+    return func->ir;
+}
+
+void IrTestFuncDestroy(struct var* func) {
+    IrDestroy(func->ir);
+    func->ir = NULL;
+    ListDestroy(func->type.vars);
+    ListDestroy(func->type.retType);
+}
+
+bool IrTestVerify(struct irFunc* f) {
+    FILE* devNull = tmpfile();
+    if (!devNull) return false;
+    bool valid = IrVerify(f, devNull);
+    fclose(devNull);
+    return valid;
+}
+
+bool IrTestPassConverges(struct irFunc* f, bool (*pass)(struct irFunc* f)) {
+    return pass(f) && IrTestVerify(f) && !pass(f);
+}
+
+struct list IrTestCheckFile(char* fileName, enum optLevel level, bool lazyBodies, bool* passed) {
+    struct optConfig config = OptConfigForLevel(level);
+    return IrTestCheckConfigured(fileName, &config, lazyBodies, passed);
+}
+
+struct list IrTestCheckConfigured(char* fileName, struct optConfig* config, bool lazyBodies, bool* passed) {
+    int nErrors = ErrMsgGetNErrors();
+    struct list program = CheckSyntax(ParseSyntax(fileName, false, lazyBodies), PoolDefaultThreads(), config);
+    *passed = ErrMsgGetNErrors() == nErrors;
+    for (int i = 0; i < program.len && *passed; i++) *passed = ((struct optFunc*)ListGetIdx(&program, i))->func->ir != NULL;
+    return program;
+}
+
+char* IrTestCheckDump(char* fileName, enum optLevel level, int nThreads, int* nErrors) {
+    struct errMsgBuffer errs;
+    ErrMsgBufferStart(&errs);
+    struct optConfig config = OptConfigForLevel(level);
+    struct list program = CheckSyntax(ParseSyntax(fileName, false, false), nThreads, &config);
+    for (int i = 0; i < program.len; i++) {
+        struct irFunc* f = ((struct optFunc*)ListGetIdx(&program, i))->func->ir;
+        if (f) IrDump(f, errs.stream);
+    }
+    IrTestProgramDestroy(program);
+    ErrMsgBufferStop(&errs);
+    *nErrors = errs.nErrors;
+    return errs.text;
+}
+
+struct optFunc* IrTestFind(struct list* program, char* name) {
+    for (int i = 0; i < program->len; i++) {
+        struct optFunc* of = ListGetIdx(program, i);
+        if (StrCmp(of->func->name, StrFromCStr(name))) return of;
+    }
+    return NULL;
+}
+
+long long IrTestRetConst(struct list* program, char* name) {
+    struct irFunc* f = IrTestFind(program, name)->func->ir;
+    long long val = -1;
+    for (int i = 0; i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->op != IR_RET || in->block == IR_NONE) continue;
+        struct irInstr* ret = IrGetInstr(f, IrGetArg(f, i, 0));
+        if (ret->op != IR_CONST || (val != -1 && val != ret->val)) return -1;
+        val = ret->val;
+    }
+    return val;
+}
+
+//OPERATION_COUNT matches any operation
+int irTestCount(struct irFunc* f, enum irOp op, enum operation opType) {
+    int n = 0;
+    for (int i = 0; i < f->blocks.len; i++) {
+        struct irBlock* b = IrGetBlock(f, i);
+        for (int j = 0; j < b->instrs.len && !b->removed; j++) {
+            struct irInstr* in = IrGetInstr(f, *(int*)ListGetIdx(&b->instrs, j));
+            n += in->op == op && (opType == OPERATION_COUNT || in->opType == opType);
+        }
+    }
+    return n;
+}
+
+int IrTestCount(struct irFunc* f, enum irOp op) {
+    return irTestCount(f, op, OPERATION_COUNT);
+}
+
+int IrTestCountOps(struct irFunc* f, enum operation opType) {
+    return irTestCount(f, IR_OPERATION, opType);
+}
+
+void IrTestProgramDestroy(struct list program) {
+    for (int i = 0; i < program.len; i++) {
+        struct var* func = ((struct optFunc*)ListGetIdx(&program, i))->func;
+        if (func->ir) IrDestroy(func->ir);
+        AstDestroy(func->body);
+    }
+    ListDestroy(program);
+}
+#endif //TEST
@@ -0,0 +1,25 @@
+#ifndef IRTEST_H
+#define IRTEST_H
+
+#include <stdbool.h>
+#include "ir.h"
+#include "opt.h"
+#include "list.h"
+
+//fixtures of the tests, only built into the test binary
+struct irFunc* IrTestFunc(struct var* func, char* name, struct type* ret, struct type* params, int nParams); //gives func the signature and an empty ir as func->ir, ret is NULL if it returns nothing
+void IrTestFuncDestroy(struct var* func); //its ir and signature
+bool IrTestVerify(struct irFunc* f); //without printing what is wrong, for tests expecting invalid ir
+bool IrTestPassConverges(struct irFunc* f, bool (*pass)(struct irFunc* f)); //the pass changes f into valid ir and finds nothing left to do on a second run
+
+//the program of a source file checked at the level, passed is false if it has errors or a function has no ir
+struct list IrTestCheckFile(char* fileName, enum optLevel level, bool lazyBodies, bool* passed); //struct optFunc
+struct list IrTestCheckConfigured(char* fileName, struct optConfig* config, bool lazyBodies, bool* passed); //struct optFunc; config is resolved
+char* IrTestCheckDump(char* fileName, enum optLevel level, int nThreads, int* nErrors); //the diagnostics and then the ir of every function as text to be freed, none of its errors are counted
+struct optFunc* IrTestFind(struct list* program, char* name); //NULL if there is no function of that name
+long long IrTestRetConst(struct list* program, char* name); //the literal every return of the function returns, -1 if they return anything else
+int IrTestCount(struct irFunc* f, enum irOp op); //instructions in the blocks not removed
+int IrTestCountOps(struct irFunc* f, enum operation opType); //IR_OPERATION instructions in the blocks not removed
+void IrTestProgramDestroy(struct list program);
+
+#endif //IRTEST_H
@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "irtest.h"
+#include "loop.h"
+#include "util.h"
+
+//hoisted instructions also run when the loop body does not, so they must not trap:
+//divisions only by a nonzero constant, and loads only from loops that store and call nothing
+bool licmIsSafe(struct irFunc* f, int instr, bool loopWritesMemory) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    switch (in->op) {
+        case IR_CONST: return true;
+        case IR_ADDR: return true;
+        case IR_CAST: return true;
+        case IR_LEN: return true;
+        case IR_LOAD: return !loopWritesMemory;
+        case IR_OPERATION: {
+            if (in->opType != OPERATION_DIV && in->opType != OPERATION_MODULO) return true;
+            struct irInstr* divisor = IrGetInstr(f, IrGetArg(f, instr, 1));
+            return divisor->op == IR_CONST && divisor->val != 0;
+        }
+        default: return false;
+    }
+}
+
+bool licmWritesMemory(struct irFunc* f, struct loop* l) {
+    for (int i = 0; i < l->blocks.len; i++) {
+        struct irBlock* b = IrGetBlock(f, *(int*)ListGetIdx(&l->blocks, i));
+        for (int j = 0; j < b->instrs.len; j++) {
+            enum irOp op = IrGetInstr(f, *(int*)ListGetIdx(&b->instrs, j))->op;
+            if (op == IR_STORE || op == IR_CALL) return true;
+        }
+    }
+    return false;
+}
+
+//blocks are visited with dominators first, so the args of an instruction are hoisted before it
+//hoisting into the preheader of an inner loop puts the instruction into the outer loop, which is visited later
+bool licmLoop(struct irFunc* f, struct loop* l, struct list* domOrder) {
+    bool writesMemory = licmWritesMemory(f, l);
+    bool changed = false;
+    for (int i = 0; i < domOrder->len; i++) {
+        int b = *(int*)ListGetIdx(domOrder, i);
+        if (!LoopContains(l, b)) continue;
+        struct list* instrs = &IrGetBlock(f, b)->instrs;
+        for (int j = 0; j < instrs->len;) {
+            int instr = *(int*)ListGetIdx(instrs, j);
+            bool invariant = licmIsSafe(f, instr, writesMemory);
+            for (int k = 0; k < IrGetInstr(f, instr)->args.len && invariant; k++) {
+                invariant = LoopIsInvariant(f, l, IrGetArg(f, instr, k));
+            }
+            if (!invariant) {
+                j++;
+                continue;
+            }
+            IrMoveInstr(f, instr, l->preheader, IrGetBlock(f, l->preheader)->instrs.len -1);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool OptLicm(struct irFunc* f) {
+    bool changed = false;
+    struct list loops = LoopFind(f, &changed);
+    struct list idoms = IrDominators(f);
+    struct list domOrder = IrDomTreeOrder(f, &idoms);
+    for (int i = 0; i < loops.len; i++) changed |= licmLoop(f, ListGetIdx(&loops, i), &domOrder);
+    ListDestroy(domOrder);
+    ListDestroy(idoms);
+    LoopDestroyAll(loops);
+    return changed;
+}
+
+//k * 3 in the loop of hoisted in testopt.olang does not change while the loop runs, so it is computed once before it
+TEST(OptLicmSource) {
+    bool passed;
+    struct list program = IrTestCheckFile("testopt.olang", OPT_LEVEL_2, false, &passed);
+    struct optFunc* hoisted = passed ? IrTestFind(&program, "hoisted") : NULL;
+    struct irFunc* f = hoisted ? hoisted->func->ir : NULL;
+    bool changed;
+    struct list loops = f ? LoopFind(f, &changed) : ListInit(sizeof(struct loop));
+    passed = loops.len == 1 && IrTestCountOps(f, OPERATION_MUL) == 1;
+    for (int i = 0; passed && i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->block == IR_NONE || in->op != IR_OPERATION || in->opType != OPERATION_MUL) continue;
+        passed = in->block == ((struct loop*)ListGetIdx(&loops, 0))->preheader;
+    }
+    LoopDestroyAll(loops);
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
@@ -29,7 +29,7 @@ void ListAdd(struct list* l, void* elem) {
 void ListAddList(struct list* head, struct list tail) {
     if (head->elemSize != tail.elemSize) ErrorBugFound();
     for (int i = 0; i < tail.len; i++) {
-        ListAdd(head, &tail.ptr + i * tail.elemSize);
+        ListAdd(head, (char*)tail.ptr + i * tail.elemSize);
     }
 }
 
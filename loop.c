@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "loop.h"
+#include "util.h"
+
+bool LoopContains(struct loop* l, int block) {
+    return block >= 0 && block < l->nBlocks && l->contains[block];
+}
+
+bool LoopIsInvariant(struct irFunc* f, struct loop* l, int value) {
+    return !LoopContains(l, IrGetInstr(f, value)->block);
+}
+
+int loopPredIdx(struct irFunc* f, int block, int pred) {
+    struct list* preds = &IrGetBlock(f, block)->preds;
+    for (int i = 0; i < preds->len; i++) {
+        if (*(int*)ListGetIdx(preds, i) == pred) return i;
+    }
+    return IR_NONE;
+}
+
+//integer types only, floats do not step exactly
+bool LoopFindIndVar(struct irFunc* f, struct loop* l, int phi, struct loopIndVar* iv) {
+    struct irInstr* in = IrGetInstr(f, phi);
+    if (l->latch == IR_NONE || in->op != IR_PHI || in->block != l->header || in->args.len != 2) return false;
+    struct type* t = TypeGet(in->type);
+    if (t->arrLvls != 0 || (t->bType != BASETYPE_BYTE && t->bType != BASETYPE_INT32 && t->bType != BASETYPE_INT64)) return false;
+    int next = IrGetArg(f, phi, loopPredIdx(f, l->header, l->latch));
+    struct irInstr* nextIn = IrGetInstr(f, next);
+    if (nextIn->op != IR_OPERATION || (nextIn->opType != OPERATION_ADD && nextIn->opType != OPERATION_SUB)) return false;
+    int a = IrGetArg(f, next, 0);
+    int b = IrGetArg(f, next, 1);
+    if (nextIn->opType == OPERATION_ADD && b == phi) {
+        b = a;
+        a = phi;
+    }
+    if (a != phi || !LoopIsInvariant(f, l, b)) return false;
+    iv->phi = phi;
+    iv->init = IrGetArg(f, phi, loopPredIdx(f, l->header, l->preheader));
+    iv->step = b;
+    iv->next = next;
+    iv->opType = nextIn->opType;
+    return true;
+}
+
+//a block of its own between the preds from outside and the header, their phi args move into phis there
+void loopAddPreheader(struct irFunc* f, int header, struct list* outside) {
+    int pre = IrAddBlock(f);
+    struct irBlock* h = IrGetBlock(f, header);
+    struct list phis = ListInit(sizeof(int));
+    struct list outsideArgs = ListInit(sizeof(int)); //per phi, per outside pred
+    for (int i = 0; i < h->instrs.len; i++) {
+        int phi = *(int*)ListGetIdx(&h->instrs, i);
+        if (IrGetInstr(f, phi)->op != IR_PHI) break;
+        ListAdd(&phis, &phi);
+        for (int j = 0; j < outside->len; j++) {
+            int predIdx = -1;
+            for (int k = 0; k < h->preds.len && predIdx == -1; k++) {
+                if (*(int*)ListGetIdx(&h->preds, k) == *(int*)ListGetIdx(outside, j)) predIdx = k;
+            }
+            int arg = IrGetArg(f, phi, predIdx);
+            ListAdd(&outsideArgs, &arg);
+        }
+    }
+    for (int j = 0; j < outside->len; j++) {
+        int pred = *(int*)ListGetIdx(outside, j);
+        IrRetarget(f, IrGetTerminator(f, pred), header, pre);
+    }
+    struct list* preds = &IrGetBlock(f, pre)->preds;
+    for (int i = 0; i < phis.len; i++) {
+        int phi = *(int*)ListGetIdx(&phis, i);
+        int prePhi = IrAddInstr(f, pre, IR_PHI, IrGetInstr(f, phi)->type);
+        for (int k = 0; k < preds->len; k++) {
+            int j = 0;
+            while (*(int*)ListGetIdx(outside, j) != *(int*)ListGetIdx(preds, k)) j++;
+            IrAddArg(f, prePhi, *(int*)ListGetIdx(&outsideArgs, i * outside->len + j));
+        }
+        IrAddArg(f, phi, prePhi);
+    }
+    IrSetTargets(f, IrAddInstr(f, pre, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+    ListDestroy(phis);
+    ListDestroy(outsideArgs);
+}
+
+//a single pred from outside already is the preheader if the header is its only successor
+bool loopEnsurePreheader(struct irFunc* f, struct list* idoms, int header) {
+    struct list* preds = &IrGetBlock(f, header)->preds;
+    struct list outside = ListInit(sizeof(int));
+    for (int i = 0; i < preds->len; i++) {
+        int pred = *(int*)ListGetIdx(preds, i);
+        bool listed = false;
+        for (int j = 0; j < outside.len; j++) listed |= *(int*)ListGetIdx(&outside, j) == pred;
+        if (!listed && !IrDominates(idoms, header, pred)) ListAdd(&outside, &pred);
+    }
+    bool added = false;
+    if (outside.len != 1 || IrGetInstr(f, IrGetTerminator(f, *(int*)ListGetIdx(&outside, 0)))->op != IR_BR) {
+        if (outside.len == 0) ErrorBugFound(); //the entry block has no preds
+        loopAddPreheader(f, header, &outside);
+        added = true;
+    }
+    ListDestroy(outside);
+    return added;
+}
+
+bool loopIsBackEdge(struct list* idoms, int from, int to) {
+    return IrDominates(idoms, to, from);
+}
+
+struct loop loopCollect(struct irFunc* f, struct list* idoms, int header) {
+    struct loop l;
+    l.header = header;
+    l.latch = IR_NONE;
+    l.preheader = IR_NONE;
+    l.nBlocks = f->blocks.len;
+    l.contains = CallocOrCrash(l.nBlocks * sizeof(bool));
+    l.blocks = ListInit(sizeof(int));
+    l.contains[header] = true;
+    ListAdd(&l.blocks, &header);
+    int nBackEdges = 0;
+    struct list* preds = &IrGetBlock(f, header)->preds;
+    for (int i = 0; i < preds->len; i++) {
+        int pred = *(int*)ListGetIdx(preds, i);
+        if (!loopIsBackEdge(idoms, pred, header)) {
+            l.preheader = pred;
+            continue;
+        }
+        nBackEdges++;
+        l.latch = pred;
+        if (l.contains[pred]) continue;
+        l.contains[pred] = true;
+        ListAdd(&l.blocks, &pred);
+    }
+    if (nBackEdges > 1) l.latch = IR_NONE;
+    for (int i = 1; i < l.blocks.len; i++) {
+        struct list* blockPreds = &IrGetBlock(f, *(int*)ListGetIdx(&l.blocks, i))->preds;
+        for (int j = 0; j < blockPreds->len; j++) {
+            int pred = *(int*)ListGetIdx(blockPreds, j);
+            if (l.contains[pred]) continue;
+            l.contains[pred] = true;
+            ListAdd(&l.blocks, &pred);
+        }
+    }
+    return l;
+}
+
+int loopSizeCmp(const void* a, const void* b) {
+    return ((struct loop*)a)->blocks.len - ((struct loop*)b)->blocks.len;
+}
+
+struct list LoopFind(struct irFunc* f, bool* cfgChanged) {
+    *cfgChanged |= IrRemoveUnreachable(f); //their branches would count as entries into a loop
+    struct list idoms = IrDominators(f);
+    struct list headers = ListInit(sizeof(int));
+    for (int b = 0; b < f->blocks.len; b++) {
+        struct irBlock* block = IrGetBlock(f, b);
+        if (block->removed) continue;
+        for (int i = 0; i < block->preds.len; i++) {
+            if (!loopIsBackEdge(&idoms, *(int*)ListGetIdx(&block->preds, i), b)) continue;
+            ListAdd(&headers, &b);
+            break;
+        }
+    }
+    bool added = false;
+    for (int i = 0; i < headers.len; i++) added |= loopEnsurePreheader(f, &idoms, *(int*)ListGetIdx(&headers, i));
+    *cfgChanged |= added;
+    if (added) {
+        ListDestroy(idoms);
+        idoms = IrDominators(f);
+    }
+
+    struct list loops = ListInit(sizeof(struct loop));
+    for (int i = 0; i < headers.len; i++) {
+        struct loop l = loopCollect(f, &idoms, *(int*)ListGetIdx(&headers, i));
+        ListAdd(&loops, &l);
+    }
+    if (loops.len) qsort(loops.ptr, loops.len, sizeof(struct loop), loopSizeCmp);
+    ListDestroy(idoms);
+    ListDestroy(headers);
+    return loops;
+}
+
+void LoopDestroyAll(struct list loops) {
+    for (int i = 0; i < loops.len; i++) {
+        struct loop* l = ListGetIdx(&loops, i);
+        ListDestroy(l->blocks);
+        free(l->contains);
+    }
+    ListDestroy(loops);
+}
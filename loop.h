@@ -0,0 +1,35 @@
+#ifndef LOOP_H
+#define LOOP_H
+
+#include <stdbool.h>
+#include "ir.h"
+#include "list.h"
+
+//a natural loop: the blocks from which a back edge to the header is reached without passing the header
+struct loop {
+    int header;
+    int latch; //the source of the only back edge, IR_NONE if there are several
+    int preheader; //the only pred of the header outside the loop, ending in a br to it
+    struct list blocks; //int; header first
+    bool* contains; //per block of the function when the loop was found
+    int nBlocks; //of the function when the loop was found
+};
+
+//a basic induction variable: a header phi that starts at init and changes by a loop invariant step per iteration
+struct loopIndVar {
+    int phi;
+    int init; //the arg from the preheader
+    int step;
+    int next; //phi plus or minus step, the arg from the latch
+    enum operation opType; //add or sub
+};
+
+//adds the missing preheaders first and sets cfgChanged if it had to
+//inner loops come before the loops containing them
+struct list LoopFind(struct irFunc* f, bool* cfgChanged); //struct loop
+void LoopDestroyAll(struct list loops);
+bool LoopContains(struct loop* l, int block); //false for blocks added after the loop was found
+bool LoopIsInvariant(struct irFunc* f, struct loop* l, int value); //defined outside of the loop
+bool LoopFindIndVar(struct irFunc* f, struct loop* l, int phi, struct loopIndVar* iv); //false unless the loop has a latch
+
+#endif //LOOP_H
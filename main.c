@@ -1,13 +1,39 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "syntax.h"
+#include "check.h"
 #include "util.h"
-#include "error.h"
+#include "errmsg.h"
+#include "timer.h"
+#include "opt.h"
+#include "pool.h"
+
+#define TRACE_ARG "--trace="
 
 int main(int argc, char** argv) {
-    if (argc < 2) ErrorFatal(NO_FILE_SPECIFIED);
-    if (argc > 2) ErrorFatal(TRAILING_COMP_ARGS);
-    ParseSyntax(argv[1]);
-    FinishCompilation();
+    char* fileName = NULL;
+    char* traceFileName = NULL;
+    bool profileBacktracking = false;
+    bool lazyBodies = false;
+    bool timeReport = false;
+    struct optConfig optConfig = OptConfigInit(); //for the function bodies lowered by CheckSyntax
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profile-backtracking") == 0) profileBacktracking = true;
+        else if (strcmp(argv[i], "--time-report") == 0) timeReport = true;
+        else if (strcmp(argv[i], "--lazy-bodies") == 0) lazyBodies = true;
+        else if (OptParseArg(argv[i], &optConfig));
+        else if (strncmp(argv[i], TRACE_ARG, strlen(TRACE_ARG)) == 0) traceFileName = argv[i] + strlen(TRACE_ARG);
+        else if (!fileName) fileName = argv[i];
+        else ErrMsgFatal(TRAILING_COMP_ARGS);
+    }
+    if (!fileName) ErrMsgFatal(NO_FILE_SPECIFIED);
+    OptConfigResolve(&optConfig);
+    if (timeReport || traceFileName) TimerEnable();
+    SyntaxCtx sc = ParseSyntax(fileName, profileBacktracking, lazyBodies);
+    if (ErrMsgGetNErrors() == 0) ListDestroy(CheckSyntax(sc, PoolDefaultThreads(), &optConfig));
+    if (timeReport) TimerReport(stdout);
+    if (traceFileName && !TimerWriteTrace(traceFileName)) ErrMsgFatal(TRACE_NOT_WRITABLE);
+    ErrMsgFinishCompilation();
     return 0;
 }
@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "util.h"
+
+//slots are promoted with minimal ssa: phis at the iterated dominance frontiers of the stores,
+//then loads are renamed to the reaching store in a walk over the dominator tree, dead phis are left to dce
+struct m2rCtx {
+    struct irFunc* f;
+    struct list idoms;
+    int nVars;
+    int* slots; //per var, the promoted alloca
+    int* zeros; //per var, the value read before any store
+    int* varOf; //per instruction, the var of a promoted alloca or of a phi placed here, -1 otherwise
+    struct list* stacks; //per var, int; the reaching values
+    struct list undo; //int; the var of every push, to pop them when leaving a subtree of the dominator tree
+};
+
+struct m2rScope {
+    int block;
+    int undoLen;
+};
+
+bool m2rIsScalar(TypeId type) {
+    struct type* t = TypeGet(type);
+    return t->arrLvls == 0 && t->bType <= BASETYPE_FLOAT64;
+}
+
+//a slot whose address is used by anything but the slot operand of a load or store has to stay in memory
+void m2rFindSlots(struct m2rCtx* c) {
+    struct irFunc* f = c->f;
+    bool* promotable = CallocOrCrash(f->instrs.len * sizeof(bool));
+    for (int i = 0; i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        promotable[i] = in->op == IR_ALLOCA && in->block != IR_NONE && m2rIsScalar(in->type);
+    }
+    for (int i = 0; i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        for (int j = 0; j < in->args.len; j++) {
+            bool slotOperand = j == 0 && (in->op == IR_LOAD || in->op == IR_STORE);
+            if (!slotOperand) promotable[IrGetArg(f, i, j)] = false;
+        }
+    }
+    c->nVars = 0;
+    c->slots = MallocOrCrash(f->instrs.len * sizeof(int) +1);
+    for (int i = 0; i < f->instrs.len; i++) {
+        if (promotable[i]) c->slots[c->nVars++] = i;
+    }
+    free(promotable);
+}
+
+struct list* m2rFrontiers(struct m2rCtx* c) {
+    struct irFunc* f = c->f;
+    struct list* df = MallocOrCrash(f->blocks.len * sizeof(struct list));
+    for (int i = 0; i < f->blocks.len; i++) df[i] = ListInit(sizeof(int));
+    for (int b = 0; b < f->blocks.len; b++) {
+        struct list* preds = &IrGetBlock(f, b)->preds;
+        if (IrGetBlock(f, b)->removed || preds->len < 2) continue;
+        int idom = *(int*)ListGetIdx(&c->idoms, b);
+        for (int i = 0; i < preds->len; i++) {
+            for (int runner = *(int*)ListGetIdx(preds, i); runner != idom && runner != IR_NONE;
+                    runner = *(int*)ListGetIdx(&c->idoms, runner)) {
+                struct list* l = &df[runner];
+                if (l->len == 0 || *(int*)ListGetIdx(l, l->len -1) != b) ListAdd(l, &b);
+            }
+        }
+    }
+    return df;
+}
+
+//phis get placeholder args that are filled in once the value reaching each pred is known
+void m2rPlacePhis(struct m2rCtx* c, struct list* df) {
+    struct irFunc* f = c->f;
+    int nBlocks = f->blocks.len;
+    int* hasPhi = MallocOrCrash(nBlocks * sizeof(int));
+    int* queued = MallocOrCrash(nBlocks * sizeof(int));
+    for (int i = 0; i < nBlocks; i++) hasPhi[i] = queued[i] = -1;
+    struct list work = ListInit(sizeof(int));
+    struct list phis = ListInit(sizeof(int[2])); //instruction and var
+
+    for (int v = 0; v < c->nVars; v++) {
+        ListRetract(&work, 0);
+        for (int i = 0; i < f->instrs.len; i++) {
+            struct irInstr* in = IrGetInstr(f, i);
+            if (in->op != IR_STORE || IrGetArg(f, i, 0) != c->slots[v] || queued[in->block] == v) continue;
+            queued[in->block] = v;
+            ListAdd(&work, &in->block);
+        }
+        while (work.len) {
+            int b = *(int*)ListGetIdx(&work, work.len -1);
+            ListRetract(&work, work.len -1);
+            for (int i = 0; i < df[b].len; i++) {
+                int d = *(int*)ListGetIdx(&df[b], i);
+                if (hasPhi[d] == v) continue;
+                hasPhi[d] = v;
+                int phi[2] = {IrInsertInstr(f, d, 0, IR_PHI, IrGetInstr(f, c->slots[v])->type), v};
+                for (int j = 0; j < IrGetBlock(f, d)->preds.len; j++) IrAddArg(f, phi[0], IR_NONE);
+                ListAdd(&phis, phi);
+                if (queued[d] != v) {
+                    queued[d] = v;
+                    ListAdd(&work, &d);
+                }
+            }
+        }
+    }
+
+    c->zeros = MallocOrCrash(c->nVars * sizeof(int) +1);
+    for (int v = 0; v < c->nVars; v++) c->zeros[v] = IrInsertInstr(f, 0, 0, IR_CONST, IrGetInstr(f, c->slots[v])->type);
+    c->varOf = MallocOrCrash(f->instrs.len * sizeof(int));
+    for (int i = 0; i < f->instrs.len; i++) c->varOf[i] = -1;
+    for (int v = 0; v < c->nVars; v++) c->varOf[c->slots[v]] = v;
+    for (int i = 0; i < phis.len; i++) {
+        int* phi = ListGetIdx(&phis, i);
+        c->varOf[phi[0]] = phi[1];
+    }
+    free(hasPhi);
+    free(queued);
+    ListDestroy(work);
+    ListDestroy(phis);
+}
+
+void m2rPush(struct m2rCtx* c, int v, int value) {
+    ListAdd(&c->stacks[v], &value);
+    ListAdd(&c->undo, &v);
+}
+
+int m2rTop(struct m2rCtx* c, int v) {
+    struct list* s = &c->stacks[v];
+    return s->len ? *(int*)ListGetIdx(s, s->len -1) : c->zeros[v];
+}
+
+int m2rSlotVar(struct m2rCtx* c, int instr) {
+    struct irInstr* in = IrGetInstr(c->f, instr);
+    if (in->op != IR_LOAD && in->op != IR_STORE) return -1;
+    return c->varOf[IrGetArg(c->f, instr, 0)];
+}
+
+void m2rRenameBlock(struct m2rCtx* c, int b, int* repl) {
+    struct irFunc* f = c->f;
+    struct list* instrs = &IrGetBlock(f, b)->instrs;
+    for (int i = 0; i < instrs->len;) {
+        int instr = *(int*)ListGetIdx(instrs, i);
+        struct irInstr* in = IrGetInstr(f, instr);
+        int v = m2rSlotVar(c, instr);
+        if (in->op == IR_PHI && c->varOf[instr] != -1) m2rPush(c, c->varOf[instr], instr);
+        if (v == -1) {
+            i++;
+            continue;
+        }
+        if (in->op == IR_LOAD) repl[instr] = m2rTop(c, v);
+        else m2rPush(c, v, IrGetArg(f, instr, 1));
+        IrRemoveInstr(f, instr);
+    }
+
+    int term = IrGetTerminator(f, b);
+    for (int t = 0; t < 2; t++) {
+        int succ = IrGetInstr(f, term)->targets[t];
+        if (succ == IR_NONE || (t == 1 && succ == IrGetInstr(f, term)->targets[0])) continue;
+        struct irBlock* s = IrGetBlock(f, succ);
+        for (int i = 0; i < s->instrs.len; i++) {
+            int phi = *(int*)ListGetIdx(&s->instrs, i);
+            if (IrGetInstr(f, phi)->op != IR_PHI) break;
+            if (c->varOf[phi] == -1) continue;
+            for (int j = 0; j < s->preds.len; j++) {
+                if (*(int*)ListGetIdx(&s->preds, j) == b) *(int*)ListGetIdx(&IrGetInstr(f, phi)->args, j) = m2rTop(c, c->varOf[phi]);
+            }
+        }
+    }
+}
+
+void m2rRename(struct m2rCtx* c) {
+    struct irFunc* f = c->f;
+    int nRepl = f->instrs.len;
+    int* repl = MallocOrCrash(nRepl * sizeof(int));
+    for (int i = 0; i < nRepl; i++) repl[i] = IR_NONE;
+    c->stacks = MallocOrCrash(c->nVars * sizeof(struct list) +1);
+    for (int v = 0; v < c->nVars; v++) c->stacks[v] = ListInit(sizeof(int));
+    c->undo = ListInit(sizeof(int));
+    struct list scopes = ListInit(sizeof(struct m2rScope));
+
+    struct list order = IrDomTreeOrder(f, &c->idoms);
+    for (int i = 0; i < order.len; i++) {
+        int b = *(int*)ListGetIdx(&order, i);
+        int idom = *(int*)ListGetIdx(&c->idoms, b);
+        while (scopes.len && ((struct m2rScope*)ListGetIdx(&scopes, scopes.len -1))->block != idom) {
+            struct m2rScope* scope = ListGetIdx(&scopes, scopes.len -1);
+            for (int j = c->undo.len -1; j >= scope->undoLen; j--) {
+                struct list* s = &c->stacks[*(int*)ListGetIdx(&c->undo, j)];
+                ListRetract(s, s->len -1);
+            }
+            ListRetract(&c->undo, scope->undoLen);
+            ListRetract(&scopes, scopes.len -1);
+        }
+        struct m2rScope scope = {b, c->undo.len};
+        ListAdd(&scopes, &scope);
+        m2rRenameBlock(c, b, repl);
+    }
+    IrReplaceUsesMapped(f, repl, nRepl);
+
+    for (int v = 0; v < c->nVars; v++) ListDestroy(c->stacks[v]);
+    free(c->stacks);
+    free(repl);
+    ListDestroy(c->undo);
+    ListDestroy(scopes);
+    ListDestroy(order);
+}
+
+bool OptMem2Reg(struct irFunc* f) {
+    bool changed = IrRemoveUnreachable(f); //so every pred of a phi is reached by the renaming
+    struct m2rCtx c;
+    c.f = f;
+    m2rFindSlots(&c);
+    if (c.nVars == 0) {
+        free(c.slots);
+        return changed;
+    }
+    c.idoms = IrDominators(f);
+    struct list* df = m2rFrontiers(&c);
+    m2rPlacePhis(&c, df);
+    m2rRename(&c);
+    for (int v = 0; v < c.nVars; v++) IrRemoveInstr(f, c.slots[v]);
+
+    for (int i = 0; i < f->blocks.len; i++) ListDestroy(df[i]);
+    free(df);
+    free(c.slots);
+    free(c.zeros);
+    free(c.varOf);
+    ListDestroy(c.idoms);
+    return true;
+}
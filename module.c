@@ -0,0 +1,64 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include "module.h"
+#include "iface.h"
+#include "hashmap.h"
+#include "util.h"
+
+struct moduleIds ModuleIdsInit() {
+    struct moduleIds ids;
+    ids.byFile = HashMapInit(sizeof(struct moduleId));
+    ids.byContent = HashMapInit(sizeof(struct moduleId));
+    return ids;
+}
+
+void ModuleIdsDestroy(struct moduleIds ids) {
+    HashMapDestroy(ids.byFile);
+    HashMapDestroy(ids.byContent);
+}
+
+unsigned long long moduleIdFileHash(struct moduleId* id) {
+    unsigned long long hash = HashBytes(HASH_SEED, &id->dev, sizeof(id->dev));
+    return HashBytes(hash, &id->ino, sizeof(id->ino));
+}
+
+bool moduleIdFileCmp(void* id, void* elem) {
+    struct moduleId* a = id;
+    struct moduleId* b = elem;
+    return a->dev == b->dev && a->ino == b->ino;
+}
+
+bool moduleIdContentCmp(void* id, void* elem) {
+    struct moduleId* a = id;
+    struct moduleId* b = elem;
+    return a->srcHash == b->srcHash && a->size == b->size;
+}
+
+bool ModuleIdsFind(struct moduleIds* ids, char* fileName, struct moduleId* id) {
+    struct stat st;
+    if (stat(fileName, &st)) return false;
+    *id = (struct moduleId){0};
+    id->dev = st.st_dev;
+    id->ino = st.st_ino;
+    id->size = st.st_size;
+    id->module = -1;
+    struct moduleId* found = HashMapGet(&ids->byFile, moduleIdFileHash(id), id, moduleIdFileCmp);
+    if (found) {
+        *id = *found;
+        return true;
+    }
+    if (!IfaceHashFile(StrFromCStr(fileName), &id->srcHash)) return false;
+    found = HashMapGet(&ids->byContent, id->srcHash, id, moduleIdContentCmp);
+    if (found) id->module = found->module;
+    return true;
+}
+
+//a copy found by content is also known by its own identity from then on
+void ModuleIdsAdd(struct moduleIds* ids, struct moduleId id, int module) {
+    id.module = module;
+    if (HashMapGet(&ids->byFile, moduleIdFileHash(&id), &id, moduleIdFileCmp)) return;
+    HashMapAdd(&ids->byFile, moduleIdFileHash(&id), &id);
+    if (!HashMapGet(&ids->byContent, id.srcHash, &id, moduleIdContentCmp)) HashMapAdd(&ids->byContent, id.srcHash, &id);
+}
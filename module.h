@@ -0,0 +1,29 @@
+#ifndef MODULE_H
+#define MODULE_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include "hashmap.h"
+
+//identifies a physical module no matter which path was used to import it
+struct moduleId {
+    dev_t dev;
+    ino_t ino;
+    long long size;
+    unsigned long long srcHash; //only known once the file is not found by identity
+    int module; //index of the loaded module
+};
+
+struct moduleIds {
+    struct hashMap byFile; //same device and inode, catches "./a.olang" vs "a.olang" and symlinks
+    struct hashMap byContent; //byte identical copies
+};
+
+struct moduleIds ModuleIdsInit();
+void ModuleIdsDestroy(struct moduleIds ids);
+//sets module to the one already loaded from the file, found by identity or else by content, -1 if there is none
+//the content is only hashed if the identity is not known, returns false if the file can not be read
+bool ModuleIdsFind(struct moduleIds* ids, char* fileName, struct moduleId* id);
+void ModuleIdsAdd(struct moduleIds* ids, struct moduleId id, int module); //id as set by ModuleIdsFind
+
+#endif //MODULE_H
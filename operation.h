@@ -38,15 +38,17 @@ enum operation {
     OPERATION_BITWISE_OR,
     OPERATION_BITWISE_XOR
 };
+#define OPERATION_COUNT (OPERATION_BITWISE_XOR +1)
 
 struct operand {
     struct token tok;
-    struct type type;
+    TypeId type;
     struct list args;
     enum operation opType;
     bool isLiteral;
     struct var* readVar;
-    long long intLiteralVal;
+    long long intLiteralVal; //bool, byte and integer literals, wrapped to the width of their type
+    double floatLiteralVal; //float literals, rounded to float for float32
 };
 
 struct operand* OperandFuncCall(struct var func, struct list args, struct token tok);
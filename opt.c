@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "opt.h"
+#include "irtest.h"
+#include "timer.h"
+#include "util.h"
+
+#define OPT_MAX_ROUNDS 8 //for -O2, in case two passes keep undoing each other
+#define OPT_UNROLL_FACTOR 4 //the default for -O2
+#define OPT_INLINE_THRESHOLD_1 12 //calls to accessor sized functions
+#define OPT_INLINE_THRESHOLD_2 40
+#define OPT_EVAL_FUEL_1 10000
+#define OPT_EVAL_FUEL_2 1000000 //enough for tables of a few thousand entries computed by loops
+#define OPT_UNROLL_ARG "--unroll="
+#define OPT_INLINE_ARG "--inline="
+#define OPT_EVAL_ARG "--eval-fuel="
+
+//passes with options take the config instead
+struct optPass {
+    char* name;
+    bool (*run)(struct irFunc* f);
+    bool (*runConfigured)(struct irFunc* f, struct optConfig* config);
+};
+
+bool optUnroll(struct irFunc* f, struct optConfig* config) {
+    return OptUnroll(f, config->unrollFactor);
+}
+
+struct optPass optMem2Reg = {"mem2reg", OptMem2Reg, NULL};
+struct optPass optSccp = {"sccp", OptSccp, NULL};
+struct optPass optCopyProp = {"copy propagation", OptCopyProp, NULL};
+struct optPass optGvn = {"gvn", OptGvn, NULL};
+struct optPass optForwardMemory = {"load store forwarding", OptForwardMemory, NULL};
+struct optPass optDce = {"dce", OptDce, NULL};
+struct optPass optEscape = {"escape analysis", OptEscape, NULL};
+struct optPass optValueRanges = {"value ranges", OptValueRanges, NULL};
+struct optPass optSimplifyCfg = {"simplify cfg", OptSimplifyCfg, NULL};
+struct optPass optLicm = {"licm", OptLicm, NULL};
+struct optPass optBoundsChecks = {"bounds checks", OptBoundsChecks, NULL};
+struct optPass optStrengthReduce = {"strength reduction", OptStrengthReduce, NULL};
+struct optPass optTailCalls = {"tail calls", OptTailCalls, NULL};
+struct optPass optUnrollPass = {"unroll", NULL, optUnroll};
+
+struct optPass* optPipeline1[] = {&optSccp, &optCopyProp, &optForwardMemory, &optDce, &optEscape, &optValueRanges, &optSimplifyCfg, &optLicm, &optBoundsChecks, &optTailCalls, NULL};
+struct optPass* optPipeline2[] = {&optSccp, &optCopyProp, &optGvn, &optForwardMemory, &optDce, &optEscape, &optValueRanges, &optSimplifyCfg, &optLicm, &optBoundsChecks, &optStrengthReduce, &optTailCalls, NULL};
+
+struct optConfig OptConfigInit() {
+    struct optConfig config;
+    config.level = OPT_LEVEL_0;
+    config.unrollFactor = -1;
+    config.inlineThreshold = -1;
+    config.evalFuel = -1;
+    config.wholeProgram = false;
+    config.boundsReport = false;
+    config.tailReport = false;
+    return config;
+}
+
+bool OptParseArg(char* arg, struct optConfig* config) {
+    if (strcmp(arg, "-O0") == 0) config->level = OPT_LEVEL_0;
+    else if (strcmp(arg, "-O1") == 0) config->level = OPT_LEVEL_1;
+    else if (strcmp(arg, "-O2") == 0) config->level = OPT_LEVEL_2;
+    else if (strcmp(arg, "--whole-program") == 0) config->wholeProgram = true;
+    else if (strcmp(arg, "--bounds-report") == 0) config->boundsReport = true;
+    else if (strcmp(arg, "--tail-report") == 0) config->tailReport = true;
+    else if (strncmp(arg, OPT_UNROLL_ARG, strlen(OPT_UNROLL_ARG)) == 0) config->unrollFactor = atoi(arg + strlen(OPT_UNROLL_ARG));
+    else if (strncmp(arg, OPT_INLINE_ARG, strlen(OPT_INLINE_ARG)) == 0) config->inlineThreshold = atoi(arg + strlen(OPT_INLINE_ARG));
+    else if (strncmp(arg, OPT_EVAL_ARG, strlen(OPT_EVAL_ARG)) == 0) config->evalFuel = atoi(arg + strlen(OPT_EVAL_ARG));
+    else return false;
+    return true;
+}
+
+void OptConfigResolve(struct optConfig* config) {
+    bool o2 = config->level == OPT_LEVEL_2;
+    if (config->unrollFactor < 0) config->unrollFactor = o2 ? OPT_UNROLL_FACTOR : 1;
+    if (config->inlineThreshold < 0) {
+        config->inlineThreshold = o2 ? OPT_INLINE_THRESHOLD_2 : config->level == OPT_LEVEL_1 ? OPT_INLINE_THRESHOLD_1 : 0;
+    }
+    if (config->evalFuel < 0) config->evalFuel = o2 ? OPT_EVAL_FUEL_2 : config->level == OPT_LEVEL_1 ? OPT_EVAL_FUEL_1 : 0;
+}
+
+struct optConfig OptConfigForLevel(enum optLevel level) {
+    struct optConfig config = OptConfigInit();
+    config.level = level;
+    OptConfigResolve(&config);
+    return config;
+}
+
+//a pass leaving invalid ir behind is a bug in the pass
+bool optRunPass(struct irFunc* f, struct optPass* pass, struct optConfig* config) {
+    TimerStart(pass->name, f->func->name);
+    bool changed = pass->run ? pass->run(f) : pass->runConfigured(f, config);
+    TimerStop();
+    if (changed && !IrVerify(f, stdout)) {
+        printf("after %s\n", pass->name);
+        ErrorBugFound();
+    }
+    return changed;
+}
+
+bool optRunPipeline(struct irFunc* f, struct optPass** pipeline, struct optConfig* config) {
+    bool changed = false;
+    for (int i = 0; pipeline[i]; i++) changed |= optRunPass(f, pipeline[i], config);
+    return changed;
+}
+
+void optRunRounds(struct irFunc* f, struct optPass** pipeline, struct optConfig* config) {
+    for (int i = 0; i < OPT_MAX_ROUNDS && optRunPipeline(f, pipeline, config); i++);
+}
+
+//unrolling runs once the loops are as simple as they get, and the copies are simplified in turn
+void OptRun(struct irFunc* f, struct optConfig* config) {
+    if (config->level == OPT_LEVEL_0) {
+        optRunPass(f, &optTailCalls, config);
+        return;
+    }
+    optRunPass(f, &optMem2Reg, config);
+    if (config->level == OPT_LEVEL_1) {
+        optRunPipeline(f, optPipeline1, config);
+        return;
+    }
+    optRunRounds(f, optPipeline2, config);
+    if (optRunPass(f, &optUnrollPass, config)) optRunRounds(f, optPipeline2, config);
+}
+
+//a stored constant, a branch on it and arithmetic on the loaded value fold into returning the result
+TEST(OptFoldBranch) {
+    TypeId i32 = TypeVanillaId(BASETYPE_INT32);
+    TypeId boolType = TypeVanillaId(BASETYPE_BOOL);
+    struct type ret = TypeVanilla(BASETYPE_INT32);
+    struct var func;
+    struct irFunc* f = IrTestFunc(&func, "six", &ret, NULL, 0);
+    int then = IrAddBlock(f);
+    int otherwise = IrAddBlock(f);
+    int slot = IrAddInstr(f, 0, IR_ALLOCA, i32);
+    int two = IrAddInstr(f, 0, IR_CONST, i32);
+    IrGetInstr(f, two)->val = 2;
+    int store = IrAddInstr(f, 0, IR_STORE, TYPE_ID_NONE);
+    IrAddArg(f, store, slot);
+    IrAddArg(f, store, two);
+    int load = IrAddInstr(f, 0, IR_LOAD, i32);
+    IrAddArg(f, load, slot);
+    int one = IrAddInstr(f, 0, IR_CONST, i32);
+    IrGetInstr(f, one)->val = 1;
+    int cond = IrAddInstr(f, 0, IR_OPERATION, boolType);
+    IrGetInstr(f, cond)->opType = OPERATION_GREATER_THAN;
+    IrAddArg(f, cond, load);
+    IrAddArg(f, cond, one);
+    int condBr = IrAddInstr(f, 0, IR_CONDBR, TYPE_ID_NONE);
+    IrAddArg(f, condBr, cond);
+    IrSetTargets(f, condBr, then, otherwise);
+
+    int loadThen = IrAddInstr(f, then, IR_LOAD, i32);
+    IrAddArg(f, loadThen, slot);
+    int three = IrAddInstr(f, then, IR_CONST, i32);
+    IrGetInstr(f, three)->val = 3;
+    int mul = IrAddInstr(f, then, IR_OPERATION, i32);
+    IrGetInstr(f, mul)->opType = OPERATION_MUL;
+    IrAddArg(f, mul, loadThen);
+    IrAddArg(f, mul, three);
+    IrAddArg(f, IrAddInstr(f, then, IR_RET, TYPE_ID_NONE), mul);
+    IrAddArg(f, IrAddInstr(f, otherwise, IR_RET, TYPE_ID_NONE), one);
+
+    struct optConfig config = OptConfigForLevel(OPT_LEVEL_2);
+    OptRun(f, &config);
+    int nBlocks = 0;
+    for (int i = 0; i < f->blocks.len; i++) nBlocks += !IrGetBlock(f, i)->removed;
+    struct irBlock* entry = IrGetBlock(f, 0);
+    int term = IrGetTerminator(f, 0);
+    bool passed = nBlocks == 1 && entry->instrs.len == 2 && IrGetInstr(f, term)->op == IR_RET &&
+            IrGetInstr(f, IrGetArg(f, term, 0))->op == IR_CONST && IrGetInstr(f, IrGetArg(f, term, 0))->val == 6;
+    IrTestFuncDestroy(&func);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
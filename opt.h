@@ -0,0 +1,69 @@
+#ifndef OPT_H
+#define OPT_H
+
+#include <stdbool.h>
+#include "ir.h"
+
+enum optLevel {
+    OPT_LEVEL_0, //the ir as built, tail calls still become jumps so deep recursion works alike at every level
+    OPT_LEVEL_1, //promotion to ssa values and one round of the cheap scalar passes
+    OPT_LEVEL_2 //all scalar passes, repeated until nothing changes
+};
+
+//options left below 0 get the default of the level when resolved
+struct optConfig {
+    enum optLevel level;
+    int unrollFactor; //copies of the body per test of an unrolled loop, below 2 nothing is unrolled
+    int inlineThreshold; //the highest cost of a call that is inlined, 0 disables inlining
+    bool wholeProgram; //imports are checked from source instead of their interface, so calls are also inlined across modules
+    int evalFuel; //instructions run per call evaluated at compile time, 0 disables it
+    bool boundsReport; //the bounds checks left after optimizing are listed with why they are kept
+    bool tailReport; //the calls in tail position left as calls are listed with why
+};
+
+//why a bounds check is kept, in its val
+enum optCheckKept {
+    OPT_CHECK_UNANALYZED,
+    OPT_CHECK_NO_UPPER_BOUND,
+    OPT_CHECK_NO_LOWER_BOUND,
+    OPT_CHECK_LOOP_NOT_COUNTED,
+    OPT_CHECK_LOOP_CALLS,
+    OPT_CHECK_LENGTH_VARIES,
+    OPT_CHECK_LOOP_STEP,
+    OPT_CHECK_LOOP_MAY_WRAP,
+    OPT_CHECK_HOISTED
+};
+
+//a function of the program with its ir, for the passes across functions
+struct optFunc {
+    struct var* func;
+    int module; //index of the module defining func
+};
+
+struct optConfig OptConfigInit(); //-O0, every other option unset
+bool OptParseArg(char* arg, struct optConfig* config); //-O<n>, --unroll=<n>, --inline=<n>, --eval-fuel=<n>, --whole-program, --bounds-report or --tail-report, false for any other argument
+void OptConfigResolve(struct optConfig* config);
+struct optConfig OptConfigForLevel(enum optLevel level); //resolved with every option unset
+void OptRun(struct irFunc* f, struct optConfig* config); //every pass is timed as a phase of its own
+void OptInlineProgram(struct list* funcs, struct optConfig* config); //struct optFunc; callees first, every caller that changed is optimized again
+void OptEvalProgram(struct list* funcs, struct optConfig* config); //struct optFunc; calls of literals are evaluated, every caller that changed is optimized again
+void OptBoundsReport(struct list* funcs, FILE* stream); //struct optFunc
+void OptTailReport(struct list* funcs, FILE* stream); //struct optFunc
+
+//the passes, each returns whether it changed f
+bool OptMem2Reg(struct irFunc* f); //slots only accessed by loads and stores become values and phis
+bool OptSccp(struct irFunc* f); //sparse conditional constant propagation, folding branches on constants
+bool OptCopyProp(struct irFunc* f); //phis of a single value, unary plus and casts to the same type
+bool OptGvn(struct irFunc* f); //pure instructions computing the same value as a dominating one
+bool OptForwardMemory(struct irFunc* f); //loads of what an earlier store or load left, unless an aliasing store or call is in between
+bool OptDce(struct irFunc* f); //instructions whose values are never used by an effect
+bool OptEscape(struct irFunc* f); //arrays and structs whose memory never outlives f are allocated on the stack, unread ones not at all
+bool OptValueRanges(struct irFunc* f); //integer intervals decide comparisons and bounds checks and turn divisions by powers of two into shifts and masks
+bool OptSimplifyCfg(struct irFunc* f); //unreachable, empty and straight line blocks
+bool OptLicm(struct irFunc* f); //loop invariant instructions that cannot trap move to the preheader
+bool OptBoundsChecks(struct irFunc* f); //checks dominated by a test of the index against the length, checks of loop counters move before the loop
+bool OptStrengthReduce(struct irFunc* f); //products of an induction variable and an invariant become induction variables, other integer products by a power of two shifts
+bool OptTailCalls(struct irFunc* f); //self tail calls become a loop, other tail calls to a function of the same signature are marked as jumps
+bool OptUnroll(struct irFunc* f, int factor); //innermost loops whose constant trip count is a multiple of factor
+
+#endif //OPT_H
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <sys/stat.h>
 #include "parser.h"
 #include "statement.h"
 #include "type.h"
@@ -10,6 +11,14 @@
 #include "var.h"
 #include "util.h"
 #include "list.h"
+#include "iface.h"
+#include "hashmap.h"
+#include "ast.h"
+#include "pool.h"
+#include "errmsg.h"
+#include "timer.h"
+#include "irbuild.h"
+#include "opt.h"
 
 enum parsingMode {
     MODE_FORCE,
@@ -32,7 +41,11 @@ struct pcAlias* aliasGetList(struct list* l, struct str name) {
 }
 
 struct parserContext {
-    TokenCtx tc; //contains fileName
+    TokenCtx tc; //NULL when the exports were loaded from an interface file
+    struct str fileName;
+    unsigned long long srcHash;
+    bool fromIface;
+    struct list ifaceDeps; //only for contexts loaded from an interface file
     struct list jumps;
     struct list aliases; //private for each parser context
     struct list hiddenAliases; //hidden until encountered during a parser pass; to prevent access to tools not yet defined
@@ -41,16 +54,110 @@ struct parserContext {
     struct list vars;
     struct list globStmtns;
     struct list* ctxs; //universal across the compilation
+    struct moduleIds* moduleIds; //universal across the compilation
+    struct list funcBodies; //struct funcBody; recorded during the second pass
+    struct list* bodyQueue; //universal across the compilation; NULL unless function bodies are parsed lazily
+    struct list* bodyTasks; //universal across the compilation; NULL if function bodies are parsed lazily
+    struct list globalVars; //function body tasks only: view of the module level vars declared before the body
+    struct list* initializedGlobals; //function body tasks only, NULL otherwise: module level vars assigned by the body
 };
 
-bool pcCmpForList(void* name, void* elem) {
-    struct str cmpName = *(struct str*)name;
-    struct str elemName = TokenGetFileName(((ParserCtx)elem)->tc);
-    return StrCmp(cmpName, elemName);
+//token range of a function body, the body ends at the matching curly close
+struct funcBody {
+    struct str name;
+    int cursor;
+    bool queued;
+};
+
+struct queuedBody {
+    ParserCtx pc;
+    int bodyIdx;
+};
+
+//function bodies only depend on declarations, so once those are parsed each body is checked as an independent task
+//a task has its own scope and token cursor and must not write to anything shared with other tasks
+struct bodyTask {
+    ParserCtx pc;
+    int bodyIdx;
+    int nGlobals; //module level vars declared before the body
+    int nAliases; //imports encountered before the body
+    struct errMsgBuffer before; //diagnostics of the module level statements since the previous body
+    struct errMsgBuffer errs;
+    struct astFunc* body;
+    struct list initializedGlobals; //struct var*; applied to their origin once all tasks are done
+};
+
+//identifies a physical module no matter which path was used to import it
+struct moduleId {
+    dev_t dev;
+    ino_t ino;
+    long long size;
+    unsigned long long srcHash;
+    int ctxIdx;
+};
+
+struct moduleIds {
+    struct hashMap byFile; //same device and inode, catches "./a.olang" vs "a.olang" and symlinks
+    struct hashMap byContent; //byte identical copies
+};
+
+struct moduleIds moduleIdsInit() {
+    struct moduleIds ids;
+    ids.byFile = HashMapInit(sizeof(struct moduleId));
+    ids.byContent = HashMapInit(sizeof(struct moduleId));
+    return ids;
+}
+
+//only stats the file, its content is hashed by moduleIdHashContent once the file is not found by identity
+bool moduleIdFromFile(struct str fileName, struct moduleId* id) {
+    char cFileName[fileName.len +1];
+    StrGetAsCStr(fileName, cFileName);
+    struct stat st;
+    if (stat(cFileName, &st)) return false;
+    *id = (struct moduleId){0};
+    id->dev = st.st_dev;
+    id->ino = st.st_ino;
+    id->size = st.st_size;
+    return true;
+}
+
+bool moduleIdHashContent(struct str fileName, struct moduleId* id) {
+    return IfaceHashFile(fileName, &id->srcHash);
 }
 
-ParserCtx pcGetList(struct list* l, struct str name) {
-    return ListGetCmp(l, &name, pcCmpForList);
+unsigned long long moduleIdFileHash(struct moduleId* id) {
+    unsigned long long hash = HashBytes(HASH_SEED, &id->dev, sizeof(id->dev));
+    return HashBytes(hash, &id->ino, sizeof(id->ino));
+}
+
+bool moduleIdFileCmp(void* id, void* elem) {
+    struct moduleId* a = id;
+    struct moduleId* b = elem;
+    return a->dev == b->dev && a->ino == b->ino;
+}
+
+bool moduleIdContentCmp(void* id, void* elem) {
+    struct moduleId* a = id;
+    struct moduleId* b = elem;
+    return a->srcHash == b->srcHash && a->size == b->size;
+}
+
+ParserCtx pcGetModuleByFile(ParserCtx pc, struct moduleId* id) { //returns NULL if not yet loaded
+    struct moduleId* found = HashMapGet(&pc->moduleIds->byFile, moduleIdFileHash(id), id, moduleIdFileCmp);
+    return found ? ListGetIdx(pc->ctxs, found->ctxIdx) : NULL;
+}
+
+ParserCtx pcGetModuleByContent(ParserCtx pc, struct moduleId* id) { //id must be hashed
+    struct moduleId* found = HashMapGet(&pc->moduleIds->byContent, id->srcHash, id, moduleIdContentCmp);
+    return found ? ListGetIdx(pc->ctxs, found->ctxIdx) : NULL;
+}
+
+void pcAddModule(ParserCtx pc, struct moduleId id) {
+    id.ctxIdx = pc->ctxs->len -1;
+    HashMapAdd(&pc->moduleIds->byFile, moduleIdFileHash(&id), &id);
+    if (!HashMapGet(&pc->moduleIds->byContent, id.srcHash, &id, moduleIdContentCmp)) {
+        HashMapAdd(&pc->moduleIds->byContent, id.srcHash, &id);
+    }
 }
 
 bool isPublic(struct str name) {
@@ -60,8 +167,38 @@ bool isPublic(struct str name) {
     return false;
 }
 
+//inside a function body task pc->vars only holds the locals
+struct var* pcGetVar(ParserCtx pc, struct str name) {
+    struct var* v = VarGetList(&pc->vars, name);
+    if (!v && pc->initializedGlobals) v = VarGetList(&pc->globalVars, name);
+    return v;
+}
+
+bool isModuleVar(ParserCtx pc, struct var* origin) {
+    for (int i = 0; i < pc->ctxs->len; i++) {
+        struct list* vars = &((ParserCtx)ListGetIdx(pc->ctxs, i))->vars;
+        if (origin >= (struct var*)vars->ptr && origin < (struct var*)vars->ptr + vars->len) return true;
+    }
+    return false;
+}
+
+bool originCmpForList(void* origin, void* elem) {
+    return *(struct var**)elem == origin;
+}
+
+bool pcMayBeInitialized(ParserCtx pc, struct var* origin) {
+    if (origin->mayBeInitialized) return true;
+    return pc->initializedGlobals && ListGetCmp(pc->initializedGlobals, origin, originCmpForList);
+}
+
+void pcSetInitialized(ParserCtx pc, struct var* origin) {
+    if (origin->mayBeInitialized) return;
+    if (!pc->initializedGlobals || !isModuleVar(pc, origin)) origin->mayBeInitialized = true;
+    else if (!pcMayBeInitialized(pc, origin)) ListAdd(pc->initializedGlobals, &origin);
+}
+
 void pcAddVar(ParserCtx pc, struct var v) {
-    if (VarGetList(&pc->vars, v.name)) SyntaxErrorInvalidToken(v.tok, VAR_NAME_IN_USE);
+    if (pcGetVar(pc, v.name)) SyntaxErrorInvalidToken(v.tok, VAR_NAME_IN_USE);
     else ListAdd(&pc->vars, &v);
 }
 
@@ -71,7 +208,7 @@ void pcAddError(ParserCtx pc, struct error e) {
 }
 
 void pcAddVarSetOrigin(ParserCtx pc, struct var v) {
-    if (VarGetList(&pc->vars, v.name)) SyntaxErrorInvalidToken(v.tok, VAR_NAME_IN_USE);
+    if (pcGetVar(pc, v.name)) SyntaxErrorInvalidToken(v.tok, VAR_NAME_IN_USE);
     else {
         ListAdd(&pc->vars, &v);
         struct var* vPtr = ListGetIdx(&pc->vars, pc->vars.len - 1);
@@ -81,6 +218,7 @@ void pcAddVarSetOrigin(ParserCtx pc, struct var v) {
 
 void pcAddType(ParserCtx pc, struct type t) {
     t.owner = pc;
+    t.id = TypeIntern(t);
     if (TypeGetList(&pc->types, t.name)) SyntaxErrorInvalidToken(t.tok, TYPE_NAME_IN_USE);
     ListAdd(&pc->types, &t);
 }
@@ -90,6 +228,8 @@ void pcUpdateOrAddType(ParserCtx pc, struct type t) {
     if (!(tmpTypePtr = TypeGetList(&pc->types, t.name))) pcAddType(pc, t);
     else {
         t.owner = pc;
+        t.id = TypeIntern(t);
+        if (tmpTypePtr->placeholder) TypeInternUpdate(t.id, t);
         *tmpTypePtr = t;
     }
 }
@@ -182,15 +322,26 @@ bool tryParseCurlyClose(ParserCtx pc) {
     return parseToken(pc, TOKEN_CURLY_CLOSE, &tok, MODE_TRY, NULL);
 }
 
+//the skip functions jump using the token indexes precomputed by the tokenizer
+void skipUntil(ParserCtx pc, int tokIdx) {
+    TokenSetCursor(pc->tc, tokIdx);
+}
+
+void skipPast(ParserCtx pc, int tokIdx) {
+    if (tokIdx < TokenGetCount(pc->tc)) tokIdx++;
+    TokenSetCursor(pc->tc, tokIdx);
+}
+
 void skipPastSemiColonOrUntilCurlyClose(ParserCtx pc) {
-    struct token tok;
-    do tok = TokenFeed(pc->tc);
-    while (tok.type != TOKEN_SEMICOLON && tok.type != TOKEN_CURLY_CLOSE && tok.type != TOKEN_EOF);
-    if (tok.type == TOKEN_CURLY_CLOSE) TokenUnfeed(pc->tc);
+    int cursor = TokenGetCursor(pc->tc);
+    int sColon = TokenGetNextSColon(pc->tc, cursor);
+    int curlyClose = TokenGetNextCurlyC(pc->tc, cursor);
+    if (sColon < curlyClose) skipPast(pc, sColon);
+    else skipUntil(pc, curlyClose);
 }
 
 void skipPastSemiColon(ParserCtx pc) {
-    TokenFeedUntilAfter(pc->tc, TOKEN_SEMICOLON);
+    skipPast(pc, TokenGetNextSColon(pc->tc, TokenGetCursor(pc->tc)));
 }
 
 bool forceParseSemiColonOrSkipPast(ParserCtx pc) {
@@ -206,7 +357,7 @@ bool forceParseSemiColonOrSkipPastOrUntilCurlyClose(ParserCtx pc) {
 }
 
 void skipUntilSemiColon(ParserCtx pc) {
-    TokenFeedUntilBefore(pc->tc, TOKEN_SEMICOLON);
+    skipUntil(pc, TokenGetNextSColon(pc->tc, TokenGetCursor(pc->tc)));
 }
 
 void skipUntilCommaOrCurlyClose(ParserCtx pc) {
@@ -217,10 +368,10 @@ void skipUntilCommaOrCurlyClose(ParserCtx pc) {
 }
 
 void skipUntilSemiColonOrCurlyOpen(ParserCtx pc) {
-    struct token tok;
-    do tok = TokenFeed(pc->tc);
-    while (tok.type != TOKEN_EOF && tok.type != TOKEN_SEMICOLON && tok.type != TOKEN_CURLY_OPEN);
-    TokenUnfeed(pc->tc);
+    int cursor = TokenGetCursor(pc->tc);
+    int sColon = TokenGetNextSColon(pc->tc, cursor);
+    int curlyOpen = TokenGetNextCurlyO(pc->tc, cursor);
+    skipUntil(pc, sColon < curlyOpen ? sColon : curlyOpen);
 }
 
 void skipUntilCommaOrParenClose(ParserCtx pc) {
@@ -243,23 +394,13 @@ void skipPastCommaOrCurlyClose(ParserCtx pc) {
     while (tok.type != TOKEN_EOF && tok.type != TOKEN_COMMA && tok.type != TOKEN_CURLY_CLOSE);
 }
 
+//assumes the cursor is inside a curly block
 void skipPastCurlyClosesNested(ParserCtx pc) {
-    struct token tok = TokenFeed(pc->tc);
-    int nOpen = 1;
-    while (true) {
-        if (tok.type == TOKEN_EOF) return;
-        if (tok.type == TOKEN_CURLY_OPEN) nOpen++;
-        else if (tok.type == TOKEN_CURLY_CLOSE) {
-            nOpen--;
-            if (nOpen <= 0) break;
-        }
-        tok = TokenFeed(pc->tc);
-    }
+    skipPast(pc, TokenGetCurlyClose(pc->tc, TokenGetCursor(pc->tc)));
 }
 
 void skipUntilCurlyClosesNested(ParserCtx pc) {
-    skipPastCurlyClosesNested(pc);
-    TokenUnfeed(pc->tc);
+    skipUntil(pc, TokenGetCurlyClose(pc->tc, TokenGetCursor(pc->tc)));
 }
 
 int pcGetCursor(ParserCtx pc) {
@@ -308,13 +449,9 @@ bool tryParseArrayDeclaration(ParserCtx pc, struct type* t) {
     t->arrLen = forceParseIntExpr(pc);
     if (!t->arrLen) return pcSetCursorRetFalse(pc, startCursor);
     forceParseToken(pc, TOKEN_SQUARE_CLOSE, &tok, EXPECTED_SQUARE_CLOSE);
-    t->arrLvls++;
     t->arrMalloc = true;
-
     t->tok = TokenMerge(t->tok, tok);
-    if (t->bType == BASETYPE_ARRAY) return true;
-    t->arrBase = t->bType;
-    t->bType = BASETYPE_ARRAY;
+    TypeSetArrLvls(t, t->arrLvls +1);
     return true;
 }
 
@@ -331,23 +468,18 @@ ParserCtx tryParseAlias(ParserCtx pc) { //returns pc if not found
 
 void tryParseTypeArrayRefLevels(ParserCtx pc, struct type* t) {
     struct token tok;
-    if (!tryParseToken(pc, TOKEN_SQUARE_OPEN, &tok)) return;
-    if (!tryParseToken(pc, TOKEN_SQUARE_CLOSE, &tok)) {
-        TokenUnfeed(pc->tc);
-        return;
-    }
-    t->arrLvls++;
+    struct token closeTok;
+    int arrLvls = t->arrLvls;
     while (tryParseToken(pc, TOKEN_SQUARE_OPEN, &tok)) {
-        if (!tryParseToken(pc, TOKEN_SQUARE_CLOSE, &tok)) {
+        if (!tryParseToken(pc, TOKEN_SQUARE_CLOSE, &closeTok)) {
             TokenUnfeed(pc->tc);
             break;
         }
-        t->arrLvls++;
+        arrLvls++;
     }
-    t->tok = TokenMerge(t->tok, tok);
-    if (t->bType == BASETYPE_ARRAY) return;
-    t->arrBase = t->bType;
-    t->bType = BASETYPE_ARRAY;
+    if (arrLvls == t->arrLvls) return;
+    t->tok = TokenMerge(t->tok, closeTok);
+    TypeSetArrLvls(t, arrLvls);
 }
 
 bool parseType(ParserCtx pc, struct type* t, enum parsingMode mode) {
@@ -384,13 +516,28 @@ void tryParseStructDerefAndArrayIndexing(ParserCtx pc, struct var* v) {
             forceParseIntExpr(pc);
             forceParseToken(pc, TOKEN_SQUARE_CLOSE, &tok, EXPECTED_SQUARE_CLOSE);
             v->tok = TokenMerge(v->tok, tok);
-            v->type.arrLvls--;
-            if (v->type.arrLvls == 0) v->type.bType = v->type.arrBase;
+            TypeSetArrLvls(&v->type, v->type.arrLvls -1);
         }
         else break;
     }
 }
 
+bool funcBodyCmpForList(void* name, void* elem) {
+    return StrCmp(*(struct str*)name, ((struct funcBody*)elem)->name);
+}
+
+//in lazy mode a function body is only parsed once the function is referenced
+void pcQueueFuncBody(ParserCtx pc, struct str name) {
+    if (!pc->bodyQueue) return;
+    struct funcBody* body = ListGetCmp(&pc->funcBodies, &name, funcBodyCmpForList);
+    if (!body || body->queued) return;
+    body->queued = true;
+    struct queuedBody q;
+    q.pc = pc;
+    q.bodyIdx = body - (struct funcBody*)pc->funcBodies.ptr;
+    ListAdd(pc->bodyQueue, &q);
+}
+
 bool parseVar(ParserCtx pc, struct var* v, enum parsingMode mode) {
     *v = (struct var){0};
     int startCursor = pcGetCursor(pc);
@@ -398,7 +545,7 @@ bool parseVar(ParserCtx pc, struct var* v, enum parsingMode mode) {
     struct token tok;
     if (!parseToken(pc, TOKEN_IDENTIFIER, &tok, mode, UNKNOWN_VAR)) return false;
     struct var* tmpVarPtr;
-    if (!(tmpVarPtr = VarGetList(&source->vars, tok.str))) {
+    if (!(tmpVarPtr = pcGetVar(source, tok.str))) {
         if (mode == MODE_FORCE) SyntaxErrorInvalidToken(tok, UNKNOWN_VAR);
         return pcSetCursorRetFalse(pc, startCursor);
     }
@@ -408,6 +555,7 @@ bool parseVar(ParserCtx pc, struct var* v, enum parsingMode mode) {
         if (mode == MODE_FORCE) SyntaxErrorInvalidToken(tok, VAR_IS_PRIVATE);
         return pcSetCursorRetFalse(pc, startCursor);
     }
+    if (v->type.bType == BASETYPE_FUNC) pcQueueFuncBody(source, v->name);
     tryParseStructDerefAndArrayIndexing(pc, v);
     return true;
 }
@@ -416,7 +564,7 @@ struct operand* tryParseVarAsOperand(ParserCtx pc) {
     int startCursor = pcGetCursor(pc);
     struct var v;
     if (!parseVar(pc, &v, MODE_TRY)) return NULL;
-    if (v.origin->mayBeInitialized) return OperandReadVar(v);
+    if (pcMayBeInitialized(pc, v.origin)) return OperandReadVar(v);
     SyntaxErrorInvalidToken(v.tok, VAR_NOT_INITIALIZED);
     return pcSetCursorRetNull(pc, startCursor);
 }
@@ -681,7 +829,46 @@ void forceParseErrorDef(ParserCtx pc) {
     pcAddError(pc, e);
 }
 
-ParserCtx parserCtxNew(struct str fileName, struct list* ctxs) {
+void addIfaceError(ParserCtx pc, struct type t) {
+    struct error e = (struct error){0};
+    e.name = t.name;
+    e.tok = t.tok;
+    e.words = t.words;
+    pcAddError(pc, e);
+}
+
+ParserCtx loadModule(ParserCtx parentCtx, struct str fileName);
+
+//the owners of the types in an interface are the modules by that file name, loaded if not imported yet
+//an owner that would have to be parsed from source makes the interface unusable, the importer is parsed instead
+struct parserContext* ifaceGetOwner(struct str fileName, void* ctx) {
+    ParserCtx pc = ctx;
+    for (int i = 0; i < pc->ctxs->len; i++) {
+        ParserCtx other = ListGetIdx(pc->ctxs, i);
+        if (StrCmp(other->fileName, fileName)) return other;
+    }
+    ParserCtx owner = loadModule(pc, fileName);
+    return owner->fromIface ? owner : NULL;
+}
+
+bool tryLoadIface(ParserCtx pc) {
+    struct iface ifc;
+    if (!IfaceLoad(pc->fileName, pc->srcHash, ifaceGetOwner, pc, &ifc)) return false;
+    for (int i = 0; i < ifc.types.len; i++) {
+        struct type* t = ListGetIdx(&ifc.types, i);
+        if (t->bType == BASETYPE_ERROR) addIfaceError(pc, *t);
+        else pcAddType(pc, *t);
+    }
+    for (int i = 0; i < ifc.vars.len; i++) pcAddVarSetOrigin(pc, *(struct var*)ListGetIdx(&ifc.vars, i));
+    pc->ifaceDeps = ifc.deps;
+    pc->fromIface = true;
+    return true;
+}
+
+//the main file is always parsed from source since its function bodies are needed
+//id is NULL when the file could not be read, tokenizing it then reports the error
+ParserCtx parserCtxNew(struct str fileName, struct list* ctxs, struct moduleIds* moduleIds, struct list* bodyQueue,
+        struct list* bodyTasks, struct moduleId* id, bool mayUseIface) {
     struct parserContext pc = (struct parserContext){0};
     pc.jumps = ListInit(sizeof(int));
     pc.aliases = ListInit(sizeof(struct pcAlias));
@@ -690,11 +877,22 @@ ParserCtx parserCtxNew(struct str fileName, struct list* ctxs) {
     pc.errors = ListInit(sizeof(struct error));
     pc.vars = ListInit(sizeof(struct var));
     pc.globStmtns = ListInit(sizeof(struct statement));
-    pc.tc = TokenizeFile(fileName);
+    pc.funcBodies = ListInit(sizeof(struct funcBody));
+    pc.fileName = fileName;
     pc.ctxs = ctxs;
-    addVanillaTypes(&pc);
+    pc.moduleIds = moduleIds;
+    pc.bodyQueue = bodyQueue;
+    pc.bodyTasks = bodyTasks;
     ListAdd(ctxs, &pc);
-    return ListGetIdx(ctxs, ctxs->len -1);
+    ParserCtx pcPtr = ListGetIdx(ctxs, ctxs->len -1);
+    addVanillaTypes(pcPtr);
+    if (id) {
+        pcPtr->srcHash = id->srcHash;
+        pcAddModule(pcPtr, *id);
+        if (mayUseIface && tryLoadIface(pcPtr)) return pcPtr;
+    }
+    pcPtr->tc = TokenizeFile(fileName);
+    return pcPtr;
 }
 
 ParserCtx parseImport(ParserCtx parentCtx) {
@@ -704,10 +902,7 @@ ParserCtx parseImport(ParserCtx parentCtx) {
     forceParseToken(parentCtx, TOKEN_STRING_LITERAL, &fileNameTok, EXPECTED_FILE_NAME);
     forceParseSemiColonOrSkipPast(parentCtx);
     struct str fileName = StrSlice(fileNameTok.str, 1, fileNameTok.str.len -1);
-
-    ParserCtx importCtx;
-    if ((importCtx = pcGetList(parentCtx->ctxs, fileName)));
-    else importCtx = parserCtxNew(fileName, parentCtx->ctxs);
+    ParserCtx importCtx = loadModule(parentCtx, fileName);
     struct pcAlias alias;
     alias.name = aliasTok.str;
     alias.pc = importCtx;
@@ -716,6 +911,20 @@ ParserCtx parseImport(ParserCtx parentCtx) {
     return importCtx;
 }
 
+//a module already imported through another path is found without reading the file again
+ParserCtx loadModule(ParserCtx parentCtx, struct str fileName) {
+    ParserCtx importCtx;
+    struct moduleId id;
+    bool readable = moduleIdFromFile(fileName, &id);
+    if (readable && (importCtx = pcGetModuleByFile(parentCtx, &id)));
+    else if ((readable = readable && moduleIdHashContent(fileName, &id)) && (importCtx = pcGetModuleByContent(parentCtx, &id)));
+    else {
+        importCtx = parserCtxNew(fileName, parentCtx->ctxs, parentCtx->moduleIds, parentCtx->bodyQueue, parentCtx->bodyTasks,
+                readable ? &id : NULL, true);
+    }
+    return importCtx;
+}
+
 ParserCtx retrieveImport(ParserCtx parentCtx) {
     skipUntilSemiColon(parentCtx);
     struct pcAlias* alias = ListFeed(&parentCtx->hiddenAliases);
@@ -758,9 +967,15 @@ struct var forceParseFuncHeader(ParserCtx pc) {
 void forceParseFuncPrototype(ParserCtx pc) {
     struct var v = forceParseFuncHeader(pc);
     pcAddVarSetOrigin(pc, v);
+    struct funcBody body = (struct funcBody){0};
+    body.name = v.name;
+    body.cursor = TokenGetCursor(pc->tc);
+    if (!ListGetCmp(&pc->funcBodies, &body.name, funcBodyCmpForList)) ListAdd(&pc->funcBodies, &body);
 }
 
 void parseFileFirstPass(ParserCtx pc) {
+    if (pc->fromIface) return;
+    TimerStart("first pass", TokenGetFileName(pc->tc));
     while (TokenPeek(pc->tc).type != TOKEN_EOF) {
         struct token tok = TokenFeed(pc->tc);
         switch (tok.type) {
@@ -769,9 +984,12 @@ void parseFileFirstPass(ParserCtx pc) {
             default: break;
         }
     }
+    TimerStop();
 }
 
 void parseFileSecondPass(ParserCtx pc) {
+    if (pc->fromIface) return;
+    TimerStart("second pass", TokenGetFileName(pc->tc));
     while (TokenPeek(pc->tc).type != TOKEN_EOF) {
         struct token tok = TokenFeed(pc->tc);
         int cursor;
@@ -783,6 +1001,7 @@ void parseFileSecondPass(ParserCtx pc) {
             default: break;
         }
     }
+    TimerStop();
 }
 
 bool parseCompCondition(ParserCtx pc) {
@@ -803,8 +1022,8 @@ void parseGlobalStatement(ParserCtx pc) {
     parseVarDeclAndOrAssignmentStatement(pc, &pc->globStmtns, MODE_FORCE);
 }
 
-struct operand* varOpBinary(struct var v, struct operand* op, enum operation opType) {
-    if (!v.mayBeInitialized) SyntaxErrorInvalidToken(v.tok, VAR_NOT_INITIALIZED);
+struct operand* varOpBinary(ParserCtx pc, struct var v, struct operand* op, enum operation opType) {
+    if (!pcMayBeInitialized(pc, v.origin)) SyntaxErrorInvalidToken(v.tok, VAR_NOT_INITIALIZED);
     return OperandBinary(OperandReadVar(v), op, opType);
 }
 
@@ -840,7 +1059,7 @@ bool parseAssignment(ParserCtx pc, struct list* codeBlock, struct var* assignV,
         skipUntilSemiColon(pc);
         return false;
     }
-    assignV->origin->mayBeInitialized = true;
+    pcSetInitialized(pc, assignV->origin);
     struct token tok = TokenFeed(pc->tc);
     if (!isAssignmentOperator(tok.type)) {
         if (mode == MODE_FORCE) SyntaxErrorInvalidToken(tok, EXPECTED_ASSIGNMENT_OPERATOR);
@@ -864,21 +1083,21 @@ bool parseAssignment(ParserCtx pc, struct list* codeBlock, struct var* assignV,
     if (!op) return pcSetCursorRetFalse(pc, startCursor);
     switch(tok.type) {
         case TOKEN_ASSIGNMENT: break;
-        case TOKEN_ASSIGNMENT_ADD: op = varOpBinary(*assignV, op, OPERATION_ADD); break;
-        case TOKEN_ASSIGNMENT_SUB: op = varOpBinary(*assignV, op, OPERATION_SUB); break;
-        case TOKEN_ASSIGNMENT_MUL: op = varOpBinary(*assignV, op, OPERATION_MUL); break;
-        case TOKEN_ASSIGNMENT_DIV: op = varOpBinary(*assignV, op, OPERATION_DIV); break;
-        case TOKEN_ASSIGNMENT_MODULO: op = varOpBinary(*assignV, op, OPERATION_MODULO); break;
-        case TOKEN_ASSIGNMENT_EQUAL: op = varOpBinary(*assignV, op, OPERATION_EQUALS); break;
-        case TOKEN_ASSIGNMENT_NOT_EQUAL: op = varOpBinary(*assignV, op, OPERATION_NOT_EQUALS); break;
-        case TOKEN_ASSIGNMENT_AND: op = varOpBinary(*assignV, op, OPERATION_AND); break;
-        case TOKEN_ASSIGNMENT_OR: op = varOpBinary(*assignV, op, OPERATION_OR); break;
-        case TOKEN_ASSIGNMENT_XOR: op = varOpBinary(*assignV, op, OPERATION_XOR); break;
-        case TOKEN_ASSIGNMENT_BITSHIFT_LEFT: op = varOpBinary(*assignV, op, OPERATION_BITSHIFT_LEFT); break;
-        case TOKEN_ASSIGNMENT_BITSHIFT_RIGHT: op = varOpBinary(*assignV, op, OPERATION_ADD); break;
-        case TOKEN_ASSIGNMENT_BITWISE_AND: op = varOpBinary(*assignV, op, OPERATION_AND); break;
-        case TOKEN_ASSIGNMENT_BITWISE_OR: op = varOpBinary(*assignV, op, OPERATION_OR); break;
-        case TOKEN_ASSIGNMENT_BITWISE_XOR: op = varOpBinary(*assignV, op, OPERATION_XOR); break;
+        case TOKEN_ASSIGNMENT_ADD: op = varOpBinary(pc, *assignV, op, OPERATION_ADD); break;
+        case TOKEN_ASSIGNMENT_SUB: op = varOpBinary(pc, *assignV, op, OPERATION_SUB); break;
+        case TOKEN_ASSIGNMENT_MUL: op = varOpBinary(pc, *assignV, op, OPERATION_MUL); break;
+        case TOKEN_ASSIGNMENT_DIV: op = varOpBinary(pc, *assignV, op, OPERATION_DIV); break;
+        case TOKEN_ASSIGNMENT_MODULO: op = varOpBinary(pc, *assignV, op, OPERATION_MODULO); break;
+        case TOKEN_ASSIGNMENT_EQUAL: op = varOpBinary(pc, *assignV, op, OPERATION_EQUALS); break;
+        case TOKEN_ASSIGNMENT_NOT_EQUAL: op = varOpBinary(pc, *assignV, op, OPERATION_NOT_EQUALS); break;
+        case TOKEN_ASSIGNMENT_AND: op = varOpBinary(pc, *assignV, op, OPERATION_AND); break;
+        case TOKEN_ASSIGNMENT_OR: op = varOpBinary(pc, *assignV, op, OPERATION_OR); break;
+        case TOKEN_ASSIGNMENT_XOR: op = varOpBinary(pc, *assignV, op, OPERATION_XOR); break;
+        case TOKEN_ASSIGNMENT_BITSHIFT_LEFT: op = varOpBinary(pc, *assignV, op, OPERATION_BITSHIFT_LEFT); break;
+        case TOKEN_ASSIGNMENT_BITSHIFT_RIGHT: op = varOpBinary(pc, *assignV, op, OPERATION_ADD); break;
+        case TOKEN_ASSIGNMENT_BITWISE_AND: op = varOpBinary(pc, *assignV, op, OPERATION_AND); break;
+        case TOKEN_ASSIGNMENT_BITWISE_OR: op = varOpBinary(pc, *assignV, op, OPERATION_OR); break;
+        case TOKEN_ASSIGNMENT_BITWISE_XOR: op = varOpBinary(pc, *assignV, op, OPERATION_XOR); break;
         default: SyntaxErrorInvalidToken(tok, EXPECTED_ASSIGNMENT); return pcSetCursorRetFalse(pc, startCursor);
     }
     if (!op) return pcSetCursorRetFalse(pc, startCursor);
@@ -914,20 +1133,32 @@ struct list parseCodeBlock(ParserCtx pc, struct type funcT) {
 }
 
 void parseIfStatement(ParserCtx pc, struct list* codeBlock, struct type funcT) {
-    struct statement s;
+    struct statement s = (struct statement){0};
+    s.sType = STATEMENT_IF;
     s.op = forceParseBoolExpr(pc);
     if (!s.op) TokenFeedUntilBefore(pc->tc, TOKEN_CURLY_OPEN);
     s.codeBlock = parseCodeBlock(pc, funcT);
     ListAdd(codeBlock, &s);
 }
 
+//the only statements starting with the same token are declarations and assignments, both start with an identifier
+//declarations continue with the type name or mut, assignments with an assignment operator, '.' or '['
+bool declarationAhead(ParserCtx pc) {
+    int startCursor = TokenGetCursor(pc->tc);
+    bool decl = false;
+    if (TokenFeed(pc->tc).type == TOKEN_IDENTIFIER) {
+        enum tokenType next = TokenFeed(pc->tc).type;
+        decl = next == TOKEN_IDENTIFIER || next == TOKEN_MUT;
+    }
+    TokenSetCursor(pc->tc, startCursor);
+    return decl;
+}
+
 void parseVarDeclAndOrAssignmentStatementMutByDefault(ParserCtx pc, struct list* codeBlock, enum parsingMode mode) {
     struct var* v = VarAllocSetOrigin();
-    if (parseVarDeclarationMutByDefault(pc, v, MODE_TRY)) {
-        struct statement s;
-        s.sType = STATEMENT_STACK_ALLOCATION;
-        s.var = *v;
-        ListAdd(codeBlock, &s);
+    if (declarationAhead(pc)) {
+        if (!parseVarDeclarationMutByDefault(pc, v, mode)) {skipPastSemiColon(pc); return;}
+        StatementStackAllocAddList(codeBlock, *v);
         parseAssignmentWithSemiColon(pc, codeBlock, v, MODE_TRY);
     }
     else if (parseVar(pc, v, mode)) parseAssignmentWithSemiColon(pc, codeBlock, v, MODE_FORCE);
@@ -936,11 +1167,9 @@ void parseVarDeclAndOrAssignmentStatementMutByDefault(ParserCtx pc, struct list*
 
 void parseVarDeclAndOrAssignmentStatement(ParserCtx pc, struct list* codeBlock, enum parsingMode mode) {
     struct var* v = VarAllocSetOrigin();
-    if (parseVarDecl(pc, v, MODE_TRY)) {
-        struct statement s;
-        s.sType = STATEMENT_STACK_ALLOCATION;
-        s.var = *v;
-        ListAdd(codeBlock, &s);
+    if (declarationAhead(pc)) {
+        if (!parseVarDecl(pc, v, mode)) {skipPastSemiColon(pc); return;}
+        StatementStackAllocAddList(codeBlock, *v);
         parseAssignmentWithSemiColon(pc, codeBlock, v, MODE_TRY);
     }
     else if (parseVar(pc, v, mode)) parseAssignmentWithSemiColon(pc, codeBlock, v, MODE_FORCE);
@@ -954,21 +1183,26 @@ bool parseForEndOfLoopAssignment(ParserCtx pc, struct list* codeBlock, enum pars
     return false;
 }
 
-bool parseForHeader(ParserCtx pc, struct statement* s, struct list* codeBlock) {
+//the declaration runs once before the loop and goes into the enclosing code block,
+//the end of loop assignment runs after every iteration and is appended to the loop body
+bool parseForHeader(ParserCtx pc, struct statement* s, struct list* codeBlock, struct list* endOfLoop) {
     int varLen = pc->vars.len;
     parseVarDeclAndOrAssignmentStatementMutByDefault(pc, codeBlock, MODE_TRY);
     s->op = forceParseBoolExpr(pc);
     if (!s->op) {ListRetract(&pc->vars, varLen); return false;}
     forceParseSemiColonOrSkipPast(pc);
     s->sType = STATEMENT_FOR;
-    parseForEndOfLoopAssignment(pc, codeBlock, MODE_TRY);
+    parseForEndOfLoopAssignment(pc, endOfLoop, MODE_TRY);
     return true;
 }
 
 void parseForStatement(ParserCtx pc, struct list* codeBlock, struct type funcT) {
     struct statement s = (struct statement){0};
-    if (!parseForHeader(pc, &s, codeBlock)) TokenFeedUntilBefore(pc->tc, TOKEN_CURLY_OPEN);
+    struct list endOfLoop = ListInit(sizeof(struct statement));
+    if (!parseForHeader(pc, &s, codeBlock, &endOfLoop)) TokenFeedUntilBefore(pc->tc, TOKEN_CURLY_OPEN);
     s.codeBlock = parseCodeBlock(pc, funcT);
+    ListAddList(&s.codeBlock, endOfLoop);
+    ListDestroy(endOfLoop);
     ListAdd(codeBlock, &s);
 }
 
@@ -1008,7 +1242,7 @@ void parseMatchStatement(ParserCtx pc, struct list* codeBlock, struct type funcT
             SyntaxErrorInvalidToken(TokenPrevious(pc->tc), EXPECTED_CURLY_CLOSE);
             return;
         }
-        forceParseMatchCase(pc, codeBlock, s.op->type, funcT, &vocabWords);
+        forceParseMatchCase(pc, &s.codeBlock, *TypeGet(s.op->type), funcT, &vocabWords);
     }
     ListAdd(codeBlock, &s);
 }
@@ -1028,7 +1262,7 @@ void parseReturnStatement(ParserCtx pc, struct list* codeBlock, struct type func
     if (!s.op) skipPastSemiColonOrUntilCurlyClose(pc);
     else forceParseSemiColonOrSkipPastOrUntilCurlyClose(pc);
     if (!s.op) return;
-    if (!TypeIsSame(s.op->type, *(struct type*)ListGetIdx(&funcT.retType, 0))) {
+    if (s.op->type != ((struct type*)ListGetIdx(&funcT.retType, 0))->id) {
         SyntaxErrorInvalidToken(s.op->tok, INVALID_RETURN_TYPE);
     }
     else ListAdd(codeBlock, &s);
@@ -1214,19 +1448,96 @@ struct operand* parseExpr(ParserCtx pc, enum parsingMode mode) {
     return op;
 }
 
-void parseFuncBody(ParserCtx pc)  {
-    struct var func;
-    if (!parseVar(pc, &func, MODE_FORCE)) ErrorBugFound();
-    TokenSetCursor(pc->tc, *(int*)ListFeed(&pc->jumps));
+struct astFunc* parseFuncBodyAtCursor(ParserCtx pc, struct var func) {
     int i = 0;
     for (; i < func.type.vars.len; i++) {
         pcAddVar(pc, *(struct var*)ListGetIdx(&func.type.vars, i));
     }
-    func.origin->codeBlock = parseCodeBlock(pc, func.type);
+    struct astFunc* body = AstFromCodeBlock(parseCodeBlock(pc, func.type));
     ListRetract(&pc->vars, pc->vars.len - i);
+    return body;
+}
+
+void skipFuncBody(ParserCtx pc) {
+    struct token tok;
+    TokenFeed(pc->tc); //function name
+    TokenSetCursor(pc->tc, *(int*)ListFeed(&pc->jumps));
+    if (tryParseToken(pc, TOKEN_CURLY_OPEN, &tok)) skipPastCurlyClosesNested(pc);
+}
+
+//the diagnostics of the module level statements so far are kept with the task to print everything in source order
+void queueBodyTask(ParserCtx pc) {
+    struct str name = TokenPeek(pc->tc).str;
+    struct funcBody* body = ListGetCmp(&pc->funcBodies, &name, funcBodyCmpForList);
+    if (!body) ErrorBugFound();
+    struct bodyTask task = (struct bodyTask){0};
+    task.pc = pc;
+    task.bodyIdx = body - (struct funcBody*)pc->funcBodies.ptr;
+    task.nGlobals = pc->vars.len;
+    task.nAliases = pc->aliases.len;
+    task.initializedGlobals = ListInit(sizeof(struct var*));
+    ErrMsgBufferCut(&task.before);
+    ListAdd(pc->bodyTasks, &task);
+    skipFuncBody(pc);
+}
+
+void checkBodyTask(void* tasks, int taskIdx) {
+    struct bodyTask* task = ListGetIdx(tasks, taskIdx);
+    struct funcBody body = *(struct funcBody*)ListGetIdx(&task->pc->funcBodies, task->bodyIdx);
+    struct var* func = VarGetList(&task->pc->vars, body.name);
+    if (!func) ErrorBugFound();
+
+    struct parserContext taskPc = *task->pc;
+    taskPc.tc = TokenFork(task->pc->tc);
+    taskPc.vars = ListInit(sizeof(struct var));
+    taskPc.globalVars = task->pc->vars;
+    taskPc.globalVars.len = task->nGlobals;
+    taskPc.aliases.len = task->nAliases; //a view as well, lookups never add
+    taskPc.initializedGlobals = &task->initializedGlobals;
+
+    TimerStart("function body", body.name);
+    ErrMsgBufferStart(&task->errs);
+    TokenSetCursor(taskPc.tc, body.cursor);
+    task->body = parseFuncBodyAtCursor(&taskPc, *func);
+    ErrMsgBufferStop(&task->errs);
+    TimerStop();
+    ListDestroy(taskPc.vars);
+    free(taskPc.tc);
+}
+
+//the shared state is only written here, after all tasks are done and in source order
+void finishBodyTasks(struct list* tasks) {
+    for (int i = 0; i < tasks->len; i++) {
+        struct bodyTask* task = ListGetIdx(tasks, i);
+        struct funcBody body = *(struct funcBody*)ListGetIdx(&task->pc->funcBodies, task->bodyIdx);
+        VarGetList(&task->pc->vars, body.name)->origin->body = task->body;
+        for (int j = 0; j < task->initializedGlobals.len; j++) {
+            (*(struct var**)ListGetIdx(&task->initializedGlobals, j))->mayBeInitialized = true;
+        }
+        ListDestroy(task->initializedGlobals);
+        ErrMsgBufferFlush(&task->before);
+        ErrMsgBufferFlush(&task->errs);
+    }
+}
+
+//starts from main and the global initializers, callees are queued by parseVar as they are referenced
+void parseReachableFuncBodies(ParserCtx mainPc) {
+    pcQueueFuncBody(mainPc, StrFromCStr("main"));
+    for (int i = 0; i < mainPc->bodyQueue->len; i++) {
+        struct queuedBody q = *(struct queuedBody*)ListGetIdx(mainPc->bodyQueue, i);
+        struct funcBody body = *(struct funcBody*)ListGetIdx(&q.pc->funcBodies, q.bodyIdx);
+        struct var* func = VarGetList(&q.pc->vars, body.name);
+        if (!func) ErrorBugFound();
+        TokenSetCursor(q.pc->tc, body.cursor);
+        TimerStart("function body", body.name);
+        func->origin->body = parseFuncBodyAtCursor(q.pc, *func);
+        TimerStop();
+    }
 }
 
 void parseFileThirdPass(ParserCtx pc) {
+    if (pc->fromIface) return;
+    TimerStart("third pass", TokenGetFileName(pc->tc));
     while (TokenPeek(pc->tc).type != TOKEN_EOF) {
         struct token tok = TokenFeed(pc->tc);
         switch (tok.type) {
@@ -1234,15 +1545,20 @@ void parseFileThirdPass(ParserCtx pc) {
             case TOKEN_TYPE: TokenSetCursor(pc->tc, *(int*)ListFeed(&pc->jumps)); break;
             case TOKEN_ERROR: TokenSetCursor(pc->tc, *(int*)ListFeed(&pc->jumps)); break;
             case TOKEN_IDENTIFIER: TokenUnfeed(pc->tc); parseGlobalStatement(pc); break;
-            case TOKEN_FUNC: parseFuncBody(pc); break;
+            case TOKEN_FUNC:
+                if (pc->bodyQueue) skipFuncBody(pc);
+                else queueBodyTask(pc);
+                break;
             case TOKEN_COMPIF: parseCompIf(pc); break;
             default: break;
         }
     }
+    TimerStop();
 }
 
 void resetTokenCtxs(struct list* ctxs) {
     for (int i = 0; i < ctxs->len; i++) {
+        if (((ParserCtx)ListGetIdx(ctxs, i))->fromIface) continue;
         TokenReset(((ParserCtx)ListGetIdx(ctxs, i))->tc);
         ListClear(&((ParserCtx)ListGetIdx(ctxs, i))->aliases);
         ListResetCursor(&((ParserCtx)ListGetIdx(ctxs, i))->hiddenAliases);
@@ -1258,18 +1574,157 @@ bool findMainFunc(ParserCtx pc) {
     return false;
 }
 
-ParserCtx ParseFile(char* fileName) {
+bool ifaceDepCmpForList(void* fileName, void* elem) {
+    return StrCmp(*(struct str*)fileName, ((struct ifaceDep*)elem)->fileName);
+}
+
+void addIfaceDep(struct list* deps, struct str fileName, unsigned long long srcHash) {
+    if (ListGetCmp(deps, &fileName, ifaceDepCmpForList)) return;
+    struct ifaceDep dep;
+    dep.fileName = fileName;
+    dep.srcHash = srcHash;
+    ListAdd(deps, &dep);
+}
+
+//exported types are copied by value, so a change anywhere below an import invalidates the interface
+void collectIfaceDeps(ParserCtx pc, struct list* deps) {
+    if (pc->fromIface) {
+        for (int i = 0; i < pc->ifaceDeps.len; i++) {
+            struct ifaceDep* dep = ListGetIdx(&pc->ifaceDeps, i);
+            addIfaceDep(deps, dep->fileName, dep->srcHash);
+        }
+        return;
+    }
+    for (int i = 0; i < pc->hiddenAliases.len; i++) {
+        ParserCtx importCtx = ((struct pcAlias*)ListGetIdx(&pc->hiddenAliases, i))->pc;
+        if (ListGetCmp(deps, &importCtx->fileName, ifaceDepCmpForList)) continue;
+        addIfaceDep(deps, importCtx->fileName, importCtx->srcHash);
+        collectIfaceDeps(importCtx, deps);
+    }
+}
+
+struct type typeFromError(struct error e) {
+    struct type t = (struct type){0};
+    t.bType = BASETYPE_ERROR;
+    t.name = e.name;
+    t.tok = e.tok;
+    t.words = e.words;
+    return t;
+}
+
+void writeIface(ParserCtx pc) {
+    struct iface ifc = IfaceInit();
+    ifc.srcHash = pc->srcHash;
+    collectIfaceDeps(pc, &ifc.deps);
+    for (int i = 0; i < pc->ctxs->len; i++) {
+        ParserCtx owner = ListGetIdx(pc->ctxs, i);
+        struct ifaceOwner o = {owner, owner->fileName};
+        ListAdd(&ifc.owners, &o);
+    }
+    for (int i = 0; i < pc->types.len; i++) {
+        struct type* t = ListGetIdx(&pc->types, i);
+        if (isPublic(t->name)) ListAdd(&ifc.types, t);
+    }
+    for (int i = 0; i < pc->errors.len; i++) {
+        struct error* e = ListGetIdx(&pc->errors, i);
+        if (!isPublic(e->name)) continue;
+        struct type t = typeFromError(*e);
+        ListAdd(&ifc.types, &t);
+    }
+    for (int i = 0; i < pc->vars.len; i++) {
+        struct var* v = ListGetIdx(&pc->vars, i);
+        if (isPublic(v->name)) ListAdd(&ifc.vars, v);
+    }
+    IfaceWrite(pc->fileName, &ifc);
+    ListDestroy(ifc.deps);
+    ListDestroy(ifc.owners);
+    ListDestroy(ifc.types);
+    ListDestroy(ifc.vars);
+}
+
+void writeIfaces(struct list* ctxs) {
+    for (int i = 0; i < ctxs->len; i++) {
+        ParserCtx pc = ListGetIdx(ctxs, i);
+        if (!pc->fromIface) writeIface(pc);
+    }
+}
+
+struct compileTasks {
+    struct list funcs; //struct var*
+    struct optConfig optConfig;
+};
+
+void compileFuncBody(void* ctx, int taskIdx) {
+    struct compileTasks* tasks = ctx;
+    struct var* func = *(struct var**)ListGetIdx(&tasks->funcs, taskIdx);
+    TimerStart("lower to ir", func->name);
+    func->ir = IrBuild(func);
+    TimerStop();
+    OptRun(func->ir, &tasks->optConfig);
+}
+
+//functions are independent of each other until inlining, so they are lowered and optimized in parallel first
+void compileFuncBodies(struct list* ctxs, struct optConfig optConfig, int nThreads) {
+    struct compileTasks tasks = {ListInit(sizeof(struct var*)), optConfig};
+    struct list program = ListInit(sizeof(struct optFunc));
+    for (int i = 0; i < ctxs->len; i++) {
+        ParserCtx pc = ListGetIdx(ctxs, i);
+        if (pc->fromIface) continue;
+        for (int j = 0; j < pc->vars.len; j++) {
+            struct var* v = ((struct var*)ListGetIdx(&pc->vars, j))->origin;
+            if (v->type.bType != BASETYPE_FUNC || !v->body) continue;
+            struct optFunc of = {v, i};
+            ListAdd(&tasks.funcs, &v);
+            ListAdd(&program, &of);
+        }
+    }
+    PoolRun(nThreads, tasks.funcs.len, compileFuncBody, &tasks);
+    OptEvalProgram(&program, &tasks.optConfig);
+    OptInlineProgram(&program, &tasks.optConfig);
+    if (tasks.optConfig.boundsReport) OptBoundsReport(&program, stdout);
+    if (tasks.optConfig.tailReport) OptTailReport(&program, stdout);
+    ListDestroy(tasks.funcs);
+    ListDestroy(program);
+}
+
+//with lazyFuncBodies only functions reachable from main and the global initializers are parsed and checked,
+//otherwise all function bodies are checked in parallel on nThreads threads once the third pass is done
+ParserCtx ParseFile(char* fileName, bool lazyFuncBodies, int nThreads, struct optConfig optConfig) {
     struct list ctxs = ListInit(sizeof(struct parserContext));
-    ParserCtx pc = parserCtxNew(StrFromCStr(fileName), &ctxs);
+    struct moduleIds moduleIds = moduleIdsInit();
+    struct list bodyQueue = ListInit(sizeof(struct queuedBody));
+    struct list bodyTasks = ListInit(sizeof(struct bodyTask));
+    struct moduleId id;
+    struct str mainFileName = StrFromCStr(fileName);
+    bool readable = moduleIdFromFile(mainFileName, &id) && moduleIdHashContent(mainFileName, &id);
+    ParserCtx pc = parserCtxNew(mainFileName, &ctxs, &moduleIds, lazyFuncBodies ? &bodyQueue : NULL,
+            lazyFuncBodies ? NULL : &bodyTasks, readable ? &id : NULL, false);
     parseFileFirstPass(pc);
 
     resetTokenCtxs(&ctxs);
     parseFileSecondPass(pc);
 
     resetTokenCtxs(&ctxs);
-    parseFileThirdPass(pc);
+    if (lazyFuncBodies) {
+        parseFileThirdPass(pc);
+        parseReachableFuncBodies(pc);
+    }
+    else {
+        struct errMsgBuffer after; //diagnostics following the last function body
+        ErrMsgBufferStart(&after);
+        parseFileThirdPass(pc);
+        ErrMsgBufferStop(&after);
+        PoolRun(nThreads, bodyTasks.len, checkBodyTask, &bodyTasks);
+        TimerStart("diagnostics", (struct str){0});
+        finishBodyTasks(&bodyTasks);
+        ErrMsgBufferFlush(&after);
+        TimerStop();
+    }
+    ListDestroy(bodyTasks);
 
     if (getNSyntaxErrors() == 0 && !findMainFunc(pc)) SyntaxErrorInfo(pc->tc, MAIN_FUNC_NOT_FOUND);
+    if (getNSyntaxErrors() == 0) writeIfaces(&ctxs);
+    if (getNSyntaxErrors() == 0) compileFuncBodies(&ctxs, optConfig, nThreads);
 
     return pc;
 }
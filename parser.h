@@ -2,8 +2,12 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <stdbool.h>
+#include "opt.h"
+
 typedef struct parserContext* ParserCtx;
-ParserCtx ParseFile(char* fileName);
+//nThreads is used for lowering and optimizing, and for checking the bodies if they are not parsed lazily
+ParserCtx ParseFile(char* fileName, bool lazyFuncBodies, int nThreads, struct optConfig optConfig);
 
 #endif //PARSER_H
 */
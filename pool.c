@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "pool.h"
+#include "util.h"
+
+//the owner takes tasks from the front, thieves take the back half
+struct poolDeque {
+    pthread_mutex_t lock;
+    int front;
+    int back; //exclusive
+};
+
+struct pool {
+    int nWorkers;
+    struct poolDeque* deques;
+    void (*func)(void* ctx, int taskIdx);
+    void* ctx;
+};
+
+struct poolWorker {
+    struct pool* p;
+    int idx;
+};
+
+bool poolPopFront(struct poolDeque* d, int* taskIdx) {
+    pthread_mutex_lock(&d->lock);
+    bool found = d->front < d->back;
+    if (found) *taskIdx = d->front++;
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+//moves the back half of a victim's tasks into the empty deque of the thief
+bool poolSteal(struct pool* p, int thief) {
+    for (int i = 1; i < p->nWorkers; i++) {
+        struct poolDeque* victim = &p->deques[(thief + i) % p->nWorkers];
+        pthread_mutex_lock(&victim->lock);
+        int n = victim->back - victim->front;
+        int back = victim->back;
+        victim->back -= (n +1) / 2;
+        int front = victim->back;
+        pthread_mutex_unlock(&victim->lock);
+        if (n <= 0) continue;
+
+        struct poolDeque* own = &p->deques[thief];
+        pthread_mutex_lock(&own->lock);
+        own->front = front;
+        own->back = back;
+        pthread_mutex_unlock(&own->lock);
+        return true;
+    }
+    return false;
+}
+
+//tasks are never added while running, so a worker is done once a full sweep finds nothing to steal
+void* poolWork(void* arg) {
+    struct poolWorker* w = arg;
+    int taskIdx;
+    do {
+        while (poolPopFront(&w->p->deques[w->idx], &taskIdx)) w->p->func(w->p->ctx, taskIdx);
+    } while (poolSteal(w->p, w->idx));
+    return NULL;
+}
+
+void PoolRun(int nThreads, int nTasks, void (*func)(void* ctx, int taskIdx), void* ctx) {
+    if (nThreads > nTasks) nThreads = nTasks;
+    if (nThreads <= 1) {
+        for (int i = 0; i < nTasks; i++) func(ctx, i);
+        return;
+    }
+    struct pool p;
+    p.nWorkers = nThreads;
+    p.func = func;
+    p.ctx = ctx;
+    p.deques = MallocOrCrash(nThreads * sizeof(struct poolDeque));
+    struct poolWorker* workers = MallocOrCrash(nThreads * sizeof(struct poolWorker));
+    pthread_t* threads = MallocOrCrash(nThreads * sizeof(pthread_t));
+    bool* started = CallocOrCrash(nThreads * sizeof(bool));
+    for (int i = 0; i < nThreads; i++) {
+        pthread_mutex_init(&p.deques[i].lock, NULL);
+        p.deques[i].front = (long long)nTasks * i / nThreads;
+        p.deques[i].back = (long long)nTasks * (i +1) / nThreads;
+        workers[i].p = &p;
+        workers[i].idx = i;
+    }
+
+    //the caller is worker 0, tasks of threads that could not be started are stolen by the others
+    for (int i = 1; i < nThreads; i++) started[i] = !pthread_create(&threads[i], NULL, poolWork, &workers[i]);
+    poolWork(&workers[0]);
+    for (int i = 1; i < nThreads; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < nThreads; i++) pthread_mutex_destroy(&p.deques[i].lock);
+    free(p.deques);
+    free(workers);
+    free(threads);
+    free(started);
+}
+
+int PoolDefaultThreads() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+}
@@ -0,0 +1,10 @@
+#ifndef POOL_H
+#define POOL_H
+
+//runs func once for every task index in [0, nTasks) on up to nThreads threads, the calling thread included
+//every thread starts with a contiguous range of the tasks and steals half of another's remaining range once done
+//returns when all tasks are done; tasks must not depend on each other
+void PoolRun(int nThreads, int nTasks, void (*func)(void* ctx, int taskIdx), void* ctx);
+int PoolDefaultThreads(); //the number of online cores
+
+#endif //POOL_H
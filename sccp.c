@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "opt.h"
+#include "fold.h"
+#include "util.h"
+
+//Wegman and Zadeck's algorithm: values only move down the lattice and only blocks reached by an executable
+//edge are evaluated, so constants flowing around loops and branches on them are both found
+enum sccpState {
+    SCCP_TOP, //not evaluated yet, or only reached from unexecuted code
+    SCCP_CONST,
+    SCCP_BOTTOM
+};
+
+struct sccpCtx {
+    struct irFunc* f;
+    int nInstrs; //when the propagation started, constants added later have no state
+    enum sccpState* states;
+    struct foldVal* vals;
+    struct list* users; //per instruction, int
+    bool* blockExec;
+    int* edgeOffsets; //per block, into edgeExec; one edge per entry of its preds
+    bool* edgeExec;
+    struct list cfgWork; //int[2]; from and to block
+    struct list ssaWork; //int; instructions whose args changed
+};
+
+bool sccpIsScalar(TypeId type) {
+    if (type == TYPE_ID_NONE) return false;
+    struct type* t = TypeGet(type);
+    return t->arrLvls == 0 && t->bType <= BASETYPE_FLOAT64;
+}
+
+void sccpAddEdge(struct sccpCtx* c, int from, int to) {
+    int edge[2] = {from, to};
+    ListAdd(&c->cfgWork, edge);
+}
+
+void sccpSet(struct sccpCtx* c, int instr, enum sccpState state, struct foldVal val) {
+    if (state <= c->states[instr]) return;
+    c->states[instr] = state;
+    c->vals[instr] = val;
+    ListAddList(&c->ssaWork, c->users[instr]);
+}
+
+void sccpVisitPhi(struct sccpCtx* c, int instr) {
+    struct irFunc* f = c->f;
+    struct irInstr* in = IrGetInstr(f, instr);
+    int offset = c->edgeOffsets[in->block];
+    enum sccpState state = SCCP_TOP;
+    struct foldVal val = {0};
+    for (int i = 0; i < in->args.len && state != SCCP_BOTTOM; i++) {
+        if (!c->edgeExec[offset + i]) continue;
+        int arg = IrGetArg(f, instr, i);
+        if (c->states[arg] == SCCP_TOP) continue;
+        if (c->states[arg] == SCCP_BOTTOM || !sccpIsScalar(in->type)) state = SCCP_BOTTOM;
+        else if (state == SCCP_TOP) {
+            state = SCCP_CONST;
+            val = c->vals[arg];
+        }
+        else if (FoldToBits(val) != FoldToBits(c->vals[arg])) state = SCCP_BOTTOM;
+    }
+    sccpSet(c, instr, state, val);
+}
+
+//operations and casts of constants are folded with the target semantics, a division by zero is left to run
+void sccpVisitFoldable(struct sccpCtx* c, int instr) {
+    struct irFunc* f = c->f;
+    struct irInstr* in = IrGetInstr(f, instr);
+    struct foldVal args[2] = {0};
+    for (int i = 0; i < in->args.len; i++) {
+        int arg = IrGetArg(f, instr, i);
+        if (c->states[arg] == SCCP_TOP) return;
+        if (c->states[arg] == SCCP_BOTTOM || !sccpIsScalar(in->type)) {
+            sccpSet(c, instr, SCCP_BOTTOM, args[0]);
+            return;
+        }
+        args[i] = c->vals[arg];
+    }
+    enum baseType bType = TypeGet(in->type)->bType;
+    struct foldVal out;
+    enum foldStatus status = FOLD_OK;
+    if (in->op == IR_CAST) out = FoldCast(args[0], bType);
+    else if (in->args.len == 1) status = FoldUnary(in->opType, args[0], &out);
+    else status = FoldBinary(in->opType, args[0], args[1], &out);
+    if (status != FOLD_OK) {
+        sccpSet(c, instr, SCCP_BOTTOM, args[0]);
+        return;
+    }
+    if (out.bType != bType) out = FoldCast(out, bType);
+    sccpSet(c, instr, SCCP_CONST, out);
+}
+
+void sccpVisit(struct sccpCtx* c, int instr) {
+    struct irFunc* f = c->f;
+    struct irInstr* in = IrGetInstr(f, instr);
+    struct foldVal none = {0};
+    switch (in->op) {
+        case IR_PHI: sccpVisitPhi(c, instr); break;
+        case IR_CONST:
+            if (sccpIsScalar(in->type)) sccpSet(c, instr, SCCP_CONST, FoldFromBits(TypeGet(in->type)->bType, in->val));
+            else sccpSet(c, instr, SCCP_BOTTOM, none);
+            break;
+        case IR_OPERATION:
+        case IR_CAST: sccpVisitFoldable(c, instr); break;
+        case IR_BR: sccpAddEdge(c, in->block, in->targets[0]); break;
+        case IR_CONDBR: {
+            int cond = IrGetArg(f, instr, 0);
+            if (c->states[cond] == SCCP_TOP) break;
+            if (c->states[cond] == SCCP_BOTTOM || c->vals[cond].i) sccpAddEdge(c, in->block, in->targets[0]);
+            if (c->states[cond] == SCCP_BOTTOM || !c->vals[cond].i) sccpAddEdge(c, in->block, in->targets[1]);
+            break;
+        }
+        default:
+            if (in->type != TYPE_ID_NONE) sccpSet(c, instr, SCCP_BOTTOM, none);
+    }
+}
+
+void sccpVisitEdge(struct sccpCtx* c, int from, int to) {
+    struct irFunc* f = c->f;
+    struct irBlock* b = IrGetBlock(f, to);
+    bool newEdge = false;
+    for (int i = 0; i < b->preds.len; i++) {
+        if (*(int*)ListGetIdx(&b->preds, i) != from || c->edgeExec[c->edgeOffsets[to] + i]) continue;
+        c->edgeExec[c->edgeOffsets[to] + i] = true;
+        newEdge = true;
+    }
+    if (!newEdge) return;
+    bool firstVisit = !c->blockExec[to];
+    c->blockExec[to] = true;
+    for (int i = 0; i < b->instrs.len; i++) {
+        int instr = *(int*)ListGetIdx(&b->instrs, i);
+        if (!firstVisit && IrGetInstr(f, instr)->op != IR_PHI) break;
+        sccpVisit(c, instr);
+    }
+}
+
+void sccpInit(struct sccpCtx* c, struct irFunc* f) {
+    int n = f->instrs.len;
+    c->f = f;
+    c->nInstrs = n;
+    c->states = CallocOrCrash(n * sizeof(enum sccpState) +1);
+    c->vals = CallocOrCrash(n * sizeof(struct foldVal) +1);
+    c->users = MallocOrCrash(n * sizeof(struct list) +1);
+    for (int i = 0; i < n; i++) c->users[i] = ListInit(sizeof(int));
+    for (int i = 0; i < n; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        for (int j = 0; j < in->args.len; j++) ListAdd(&c->users[IrGetArg(f, i, j)], &i);
+    }
+    c->blockExec = CallocOrCrash(f->blocks.len * sizeof(bool));
+    c->edgeOffsets = MallocOrCrash(f->blocks.len * sizeof(int));
+    int nEdges = 0;
+    for (int i = 0; i < f->blocks.len; i++) {
+        c->edgeOffsets[i] = nEdges;
+        nEdges += IrGetBlock(f, i)->preds.len;
+    }
+    c->edgeExec = CallocOrCrash(nEdges * sizeof(bool) +1);
+    c->cfgWork = ListInit(sizeof(int[2]));
+    c->ssaWork = ListInit(sizeof(int));
+}
+
+void sccpDestroy(struct sccpCtx* c) {
+    for (int i = 0; i < c->nInstrs; i++) ListDestroy(c->users[i]);
+    free(c->states);
+    free(c->vals);
+    free(c->users);
+    free(c->blockExec);
+    free(c->edgeOffsets);
+    free(c->edgeExec);
+    ListDestroy(c->cfgWork);
+    ListDestroy(c->ssaWork);
+}
+
+//constant values are replaced by constants in the entry block, the instructions computing them are left to dce
+bool sccpRewrite(struct sccpCtx* c) {
+    struct irFunc* f = c->f;
+    int n = c->nInstrs;
+    int* repl = MallocOrCrash(n * sizeof(int) +1);
+    bool changed = false;
+    for (int i = 0; i < n; i++) {
+        repl[i] = IR_NONE;
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->block == IR_NONE || !c->blockExec[in->block] || c->states[i] != SCCP_CONST || in->op == IR_CONST) continue;
+        repl[i] = IrInsertInstr(f, 0, 0, IR_CONST, in->type);
+        IrGetInstr(f, repl[i])->val = FoldToBits(c->vals[i]);
+        changed = true;
+    }
+    IrReplaceUsesMapped(f, repl, n);
+    free(repl);
+
+    for (int b = 0; b < f->blocks.len; b++) {
+        if (IrGetBlock(f, b)->removed || !c->blockExec[b]) continue;
+        int term = IrGetTerminator(f, b);
+        struct irInstr* in = IrGetInstr(f, term);
+        if (in->op != IR_CONDBR) continue;
+        int cond = IrGetArg(f, term, 0);
+        if (cond >= n || c->states[cond] != SCCP_CONST) continue;
+        IrDropTarget(f, term, c->vals[cond].i ? 1 : 0);
+        changed = true;
+    }
+    return IrRemoveUnreachable(f) || changed;
+}
+
+bool OptSccp(struct irFunc* f) {
+    struct sccpCtx c;
+    sccpInit(&c, f);
+    c.blockExec[0] = true;
+    struct irBlock* entry = IrGetBlock(f, 0);
+    for (int i = 0; i < entry->instrs.len; i++) sccpVisit(&c, *(int*)ListGetIdx(&entry->instrs, i));
+    while (c.cfgWork.len || c.ssaWork.len) {
+        if (c.cfgWork.len) {
+            int edge[2];
+            memcpy(edge, ListGetIdx(&c.cfgWork, c.cfgWork.len -1), sizeof(edge));
+            ListRetract(&c.cfgWork, c.cfgWork.len -1);
+            sccpVisitEdge(&c, edge[0], edge[1]);
+            continue;
+        }
+        int instr = *(int*)ListGetIdx(&c.ssaWork, c.ssaWork.len -1);
+        ListRetract(&c.ssaWork, c.ssaWork.len -1);
+        if (c.blockExec[IrGetInstr(f, instr)->block]) sccpVisit(&c, instr);
+    }
+    bool changed = sccpRewrite(&c);
+    sccpDestroy(&c);
+    return changed;
+}
@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "irtest.h"
+#include "loop.h"
+#include "util.h"
+
+int srAddOperation(struct irFunc* f, int block, enum operation opType, int a, int b) {
+    int instr = IrInsertInstr(f, block, IrGetBlock(f, block)->instrs.len -1, IR_OPERATION, IrGetInstr(f, a)->type);
+    IrGetInstr(f, instr)->opType = opType;
+    IrAddArg(f, instr, a);
+    IrAddArg(f, instr, b);
+    return instr;
+}
+
+//iv * k becomes a phi of its own that starts at init * k and changes by step * k, which wraps the same way
+void srReduce(struct irFunc* f, struct loop* l, struct loopIndVar* iv, int mul, int k) {
+    int init = srAddOperation(f, l->preheader, OPERATION_MUL, iv->init, k);
+    int step = srAddOperation(f, l->preheader, OPERATION_MUL, iv->step, k);
+    int phi = IrInsertInstr(f, l->header, 0, IR_PHI, IrGetInstr(f, mul)->type);
+    int next = srAddOperation(f, l->latch, iv->opType, phi, step);
+    struct list* preds = &IrGetBlock(f, l->header)->preds;
+    for (int i = 0; i < preds->len; i++) IrAddArg(f, phi, *(int*)ListGetIdx(preds, i) == l->preheader ? init : next);
+    IrReplaceUses(f, mul, phi);
+    IrRemoveInstr(f, mul);
+}
+
+bool srLoop(struct irFunc* f, struct loop* l) {
+    struct list ivs = ListInit(sizeof(struct loopIndVar));
+    struct list* headerInstrs = &IrGetBlock(f, l->header)->instrs;
+    for (int i = 0; i < headerInstrs->len; i++) {
+        struct loopIndVar iv;
+        if (LoopFindIndVar(f, l, *(int*)ListGetIdx(headerInstrs, i), &iv)) ListAdd(&ivs, &iv);
+    }
+
+    struct list muls = ListInit(sizeof(int[3])); //mul, iv, k; all found first as reducing adds phis to the header
+    for (int i = 0; i < l->blocks.len; i++) {
+        struct list* instrs = &IrGetBlock(f, *(int*)ListGetIdx(&l->blocks, i))->instrs;
+        for (int j = 0; j < instrs->len; j++) {
+            int instr = *(int*)ListGetIdx(instrs, j);
+            struct irInstr* in = IrGetInstr(f, instr);
+            if (in->op != IR_OPERATION || in->opType != OPERATION_MUL) continue; //typed like the iv if it uses one
+            for (int k = 0; k < ivs.len; k++) {
+                int phi = ((struct loopIndVar*)ListGetIdx(&ivs, k))->phi;
+                int a = IrGetArg(f, instr, 0);
+                int b = IrGetArg(f, instr, 1);
+                if (b == phi) {
+                    b = a;
+                    a = phi;
+                }
+                if (a != phi || !LoopIsInvariant(f, l, b)) continue;
+                int mul[3] = {instr, k, b};
+                ListAdd(&muls, mul);
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < muls.len; i++) {
+        int* mul = ListGetIdx(&muls, i);
+        srReduce(f, l, ListGetIdx(&ivs, mul[1]), mul[0], mul[2]);
+    }
+    bool changed = muls.len != 0;
+    ListDestroy(ivs);
+    ListDestroy(muls);
+    return changed;
+}
+
+int srLog2(long long k) {
+    if (k <= 0 || (k & (k - 1))) return -1;
+    int n = 0;
+    while ((1LL << n) != k) n++;
+    return n;
+}
+
+//shifting left wraps like multiplying, for negative values too, so only the sign of the constant matters
+bool srShift(struct irFunc* f, int instr) {
+    struct irInstr* in = IrGetInstr(f, instr);
+    enum baseType bType = TypeGet(in->type)->bType;
+    if (bType != BASETYPE_BYTE && bType != BASETYPE_INT32 && bType != BASETYPE_INT64) return false;
+    int argIdx = IrGetInstr(f, IrGetArg(f, instr, 1))->op == IR_CONST ? 1 : 0;
+    struct irInstr* k = IrGetInstr(f, IrGetArg(f, instr, argIdx));
+    int n = k->op == IR_CONST ? srLog2(k->val) : -1;
+    if (n <= 0) return false;
+    struct list* instrs = &IrGetBlock(f, in->block)->instrs;
+    int pos = 0;
+    while (*(int*)ListGetIdx(instrs, pos) != instr) pos++;
+    int count = IrInsertInstr(f, in->block, pos, IR_CONST, k->type);
+    IrGetInstr(f, count)->val = n;
+    in = IrGetInstr(f, instr);
+    in->opType = OPERATION_BITSHIFT_LEFT;
+    *(int*)ListGetIdx(&in->args, 0) = IrGetArg(f, instr, 1 - argIdx);
+    *(int*)ListGetIdx(&in->args, 1) = count;
+    return true;
+}
+
+//products of induction variables are reduced first, the ones left that multiply by a power of two become shifts
+bool OptStrengthReduce(struct irFunc* f) {
+    bool changed = false;
+    struct list loops = LoopFind(f, &changed);
+    for (int i = 0; i < loops.len; i++) changed |= srLoop(f, ListGetIdx(&loops, i));
+    LoopDestroyAll(loops);
+    int n = f->instrs.len;
+    for (int i = 0; i < n; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->block != IR_NONE && in->op == IR_OPERATION && in->opType == OPERATION_MUL) changed |= srShift(f, i);
+    }
+    return changed;
+}
+
+//the products of shifted in testopt.olang become shifts, while quarter still divides since n may be negative,
+//where shifting right would round -7 / 4 down to -2 instead of towards zero
+TEST(OptStrengthSource) {
+    bool passed;
+    struct list program = IrTestCheckFile("testopt.olang", OPT_LEVEL_2, false, &passed);
+    struct optFunc* shifted = passed ? IrTestFind(&program, "shifted") : NULL;
+    struct optFunc* quarter = passed ? IrTestFind(&program, "quarter") : NULL;
+    passed = shifted && IrTestCountOps(shifted->func->ir, OPERATION_MUL) == 0;
+    passed = passed && IrTestCountOps(shifted->func->ir, OPERATION_BITSHIFT_LEFT) == 2;
+    passed = passed && quarter && IrTestCountOps(quarter->func->ir, OPERATION_DIV) == 1;
+    passed = passed && IrTestCountOps(quarter->func->ir, OPERATION_BITSHIFT_RIGHT) == 0;
+    passed = passed && IrTestRetConst(&program, "negQuarter") == -2;
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
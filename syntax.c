@@ -3,175 +3,702 @@
 #include <string.h>
 #include "syntax.h"
 #include "token.h"
+#include "errmsg.h"
+#include "syntaxrules.h"
+#include "hashmap.h"
+#include "timer.h"
 #include "util.h"
 
-struct syntaxContext {
-    TokenCtx tc;
-    struct list syntax;
-    struct list* ctxs;
+bool syntaxWordCmp(char* str, char* word) {
+    int len = strlen(word);
+    if (strncmp(str, word, len) != 0) return false;
+    return str[len] == ' ' || str[len] == '\0';
+}
+
+enum syntaxType syntaxGetTypeFromStr(char* str) {
+    for (int i = SNTX_NOT_FOUND +1; i < SNTX_COUNT; i++) {
+        if (syntaxWordCmp(str, syntaxTypeNames[i])) return i;
+    }
+    ErrorBugFound();
+    return SNTX_NOT_FOUND;
+}
+
+struct syntax SyntaxInit(enum syntaxType type) {
+    struct syntax s = (struct syntax){0};
+    s.type = type;
+    s.parts = ListInit(sizeof(struct syntaxPart));
+    s.skippedAt = -1;
+    return s;
+}
+
+void SyntaxAddTok(struct syntax* s, struct token tok) {
+    struct syntaxPart part = (struct syntaxPart){0};
+    part.tok = tok;
+    ListAdd(&s->parts, &part);
+}
+
+void SyntaxAddNested(struct syntax* s, struct syntax nested) {
+    struct syntaxPart part = (struct syntaxPart){0};
+    part.nested = MallocOrCrash(sizeof(struct syntax));
+    *part.nested = nested;
+    ListAdd(&s->parts, &part);
+}
+
+void SyntaxUnexpectedToken(SyntaxCtx sc, struct token found, char* expected) {
+    sc->nErrors++;
+    if (!sc->quiet) ErrMsgUnexpectedToken(found, expected);
+}
+
+//patterns are compiled once into one flat op array so ParseRule only dispatches on integers
+enum syntaxOpCode {
+    SOP_TOK, //arg = expected tokenType
+    SOP_RULE, //arg = syntaxType to parse
+    SOP_COMMIT, //mismatches from here on are reported instead of backtracked
+    SOP_LAZY, //the SOP_RULE after it is skipped as a block when parsing lazily
+    SOP_OPTIONAL, //jump = matching SOP_GROUP_END
+    SOP_REPEAT, //jump = matching SOP_GROUP_END
+    SOP_CHOICE, //jump = matching SOP_GROUP_END, every op until then is one alternative, arg = choice table
+    SOP_GROUP_END, //jump = the op opening the group
+    SOP_END
 };
 
-enum syntaxType {
-    SNTX_NOT_FOUND,
-    SNTX_IDEN_MB_NMESPCE,
-    SNTX_IMPORT,
-    SNTX_STMNT_ASS,
-    SNTX_STMNT_GLOB_DECL,
-    SNTX_STMNT_LOC_DECL,
-    SNTX_STMNT_GLOB,
-    SNTX_STMNT_LOC,
-    SNTX_CBLOCK
+struct syntaxOp {
+    unsigned char code;
+    unsigned char arg;
+    short jump;
 };
 
-struct syntaxRule {
-    enum syntaxType type;
-    char* pattern;
+#define TOKEN_SET_WORDS ((TOK_COUNT + 63) / 64)
+#define SYNTAX_MAX_ALTS 32
+
+struct tokenSet {
+    unsigned long long bits[TOKEN_SET_WORDS];
 };
 
-union syntaxPart {
-    struct token type;
-    struct syntax* nested;
+//bit n is set if alternative n of the choice can start with the lookahead token
+struct syntaxChoiceTable {
+    unsigned int alts[TOK_COUNT];
 };
 
-struct syntax {
-    enum syntaxType type;
-    struct list parts;
-    struct token errorTok;
+struct syntaxProgram {
+    struct list ops; //struct syntaxOp
+    struct list names; //char*; the pattern word of each op, only read when reporting errors
+    int start[SNTX_COUNT]; //-1 for rules without a pattern
+    enum tokenType syncTok[SNTX_COUNT]; //the token the pattern ends with outside of groups, TOK_NONE if it ends otherwise
+    struct tokenSet first[SNTX_COUNT]; //every token if the rule commits before consuming one
+    struct tokenSet follow[SNTX_COUNT];
+    bool nullable[SNTX_COUNT];
+    struct list choices; //struct syntaxChoiceTable; in the order the choices were compiled
+    int firstChoice[SNTX_COUNT]; //index into choices of the first choice of the rule
 };
 
-enum syntaxType syntaxGetTypeFromStr(char* str) {
-    return 0; //TODO
+struct syntaxProgram syntaxProg;
+bool syntaxProgCompiled = false;
+
+//copies the pattern text up to end, which must be a space or the end of the pattern
+char* syntaxCopyPatternText(char* start, char* end) {
+    char* text = MallocOrCrash(end - start +1);
+    memcpy(text, start, end - start);
+    text[end - start] = '\0';
+    return text;
 }
 
-//! = start of pattern, ? = optional, & = optional exactly one, * = optional repeating, $ = end of optional
-//on incomplete pattern after start, tokenFeed is set to the next occurence of the last token in the pattern
-//all expressions must be separated by a space
-struct syntaxRule rules[] = {
-    {SNTX_IDEN_MB_NMESPCE, "TOK_IDEN * TOK_DOT TOK_IDEN $"},
-    {SNTX_IMPORT, "TOK_IMPORT ! TOK_IDEN ? TOK_AS TOK_IDEN $ TOK_SCOLON"},
+char* syntaxPartEnd(char* part) {
+    char* end = strchr(part, ' ');
+    return end ? end : part + strlen(part);
+}
 
-    {SNTX_STMNT_ASS, "SNTX_IDEN_MB_NMESPCE &"
-        "TOK_ASS TOK_ASS_ADD TOK_ASS_SUB TOK_ASS_MUL"
-        "TOK_ASS_DIV TOK_ASS_MOD TOK_ASS_AND TOK_ASS_OR TOK_ASS_XOR TOK_ASS_BTSFT_L"
-        "TOK_ASS_BTSFT_R TOK_ASS_BTWSE_AND TOK_ASS_BTWSE_OR TOK_ASS_BTWSE_XOR"
-        "$ ! SNTX_EXPR TOK_SCOLON"},
+void syntaxEmit(enum syntaxOpCode code, int arg, char* name) {
+    struct syntaxOp op = {code, arg, 0};
+    ListAdd(&syntaxProg.ops, &op);
+    ListAdd(&syntaxProg.names, &name);
+}
 
-    {SNTX_STMNT_GLOB_DECL, "TOK_IDEN ? TOK_MUT $ SNTX_SMNT_ASS !"},
-    {SNTX_STMNT_LOC_DECL, "TOK_IDEN SNTX_SMNT_ASS !"},
+struct syntaxOp* syntaxGetOp(int idx) {
+    return ListGetIdx(&syntaxProg.ops, idx);
+}
 
-    {SNTX_STMNT_GLOB, "& SMNT_LOC_DECL SMNT_ASS $ !"},
-    {SNTX_STMNT_LOC, "&"
-        "SMNT_LOC_DECL SMNT_ASS SMNT_IF SMNT_FOR"
-        "SMNT_MATCH SMTN_RET SMNT_EXIT $ !"},
+void syntaxCompileRule(struct syntaxRule rule) {
+    syntaxProg.start[rule.type] = syntaxProg.ops.len;
+    syntaxProg.firstChoice[rule.type] = syntaxProg.choices.len;
+    int groupStart = -1;
+    char* groupText = NULL;
+    enum tokenType syncTok = TOK_NONE; //tokens inside groups may be missing, so they cannot end what an error skips
+    for (char* part = rule.pattern; part; part = strchr(part, ' ')) {
+        while (*part == ' ') part++;
+        if (*part == '\0') break;
+        switch (part[0]) {
+            case 'T':
+                syntaxEmit(SOP_TOK, TokenGetTypeFromStr(part), syntaxCopyPatternText(part, syntaxPartEnd(part)));
+                syncTok = groupStart == -1 ? TokenGetTypeFromStr(part) : TOK_NONE;
+                break;
+            case 'S':
+                syntaxEmit(SOP_RULE, syntaxGetTypeFromStr(part), syntaxCopyPatternText(part, syntaxPartEnd(part)));
+                syncTok = TOK_NONE;
+                break;
+            case '!': syntaxEmit(SOP_COMMIT, 0, NULL); break;
+            case '~':
+                if (groupStart != -1) ErrorBugFound();
+                syntaxEmit(SOP_LAZY, 0, NULL);
+                break;
+            case '?':
+            case '*':
+            case '&':
+                if (groupStart != -1) ErrorBugFound(); //groups do not nest
+                groupStart = syntaxProg.ops.len;
+                groupText = syntaxPartEnd(part);
+                syntaxEmit(part[0] == '?' ? SOP_OPTIONAL : part[0] == '*' ? SOP_REPEAT : SOP_CHOICE, 0, NULL);
+                if (part[0] == '&') {
+                    struct syntaxChoiceTable table = (struct syntaxChoiceTable){0};
+                    syntaxGetOp(groupStart)->arg = syntaxProg.choices.len;
+                    ListAdd(&syntaxProg.choices, &table);
+                }
+                break;
+            case '$':
+                if (groupStart == -1) ErrorBugFound();
+                if (syntaxProg.ops.len - groupStart -1 > SYNTAX_MAX_ALTS) ErrorBugFound();
+                syntaxEmit(SOP_GROUP_END, 0, NULL);
+                syntaxGetOp(syntaxProg.ops.len -1)->jump = groupStart;
+                syntaxGetOp(groupStart)->jump = syntaxProg.ops.len -1;
+                //a choice that matched nothing is reported as expecting any of its alternatives
+                *(char**)ListGetIdx(&syntaxProg.names, groupStart) = syntaxCopyPatternText(groupText +1, part -1);
+                groupStart = -1;
+                syncTok = TOK_NONE;
+                break;
+            default: ErrorBugFound();
+        }
+    }
+    if (groupStart != -1) ErrorBugFound();
+    syntaxProg.syncTok[rule.type] = syncTok;
+    syntaxEmit(SOP_END, 0, NULL);
+}
 
-    {SNTX_CBLOCK, "TOK_CURLY_O ! * SNTX_STMNT $ TOK_CURLY_C"},
-};
+bool tokenSetHas(struct tokenSet* set, int tokType) {
+    return set->bits[tokType / 64] >> (tokType % 64) & 1;
+}
 
-char* nextPatternPart(char* pattern) {
-    for (int i = 0; i < (int)strlen(pattern); i++) {
-        if (pattern[i] == ' ') return pattern +i +1;
+//returns true if set changed
+bool tokenSetAdd(struct tokenSet* set, int tokType) {
+    if (tokenSetHas(set, tokType)) return false;
+    set->bits[tokType / 64] |= 1ULL << (tokType % 64);
+    return true;
+}
+
+bool tokenSetAddSet(struct tokenSet* set, struct tokenSet* other) {
+    bool changed = false;
+    for (int i = 0; i < TOK_COUNT; i++) {
+        if (tokenSetHas(other, i)) changed |= tokenSetAdd(set, i);
     }
-    return NULL;
+    return changed;
 }
 
-char* lastPatternPart(char* pattern) {
-    int lastPart = 0;
-    for (int i = (int)strlen(pattern) -1; i >= 0; i--) {
-        if (pattern[i] == ' ') return pattern + i +1;
+void tokenSetAddAll(struct tokenSet* set) {
+    for (int i = 0; i < TOK_COUNT; i++) tokenSetAdd(set, i);
+}
+
+void syntaxOpFirst(struct syntaxOp op, struct tokenSet* first, bool* nullable) {
+    if (op.code == SOP_TOK) {
+        tokenSetAdd(first, op.arg);
+        *nullable = false;
+    }
+    else if (op.code == SOP_RULE) {
+        tokenSetAddSet(first, &syntaxProg.first[op.arg]);
+        *nullable = syntaxProg.nullable[op.arg];
     }
-    return NULL;
 }
 
-#define CURSOR_NOT_SET -1
+//adds the tokens the ops from pc up to SOP_END can start with, returns whether they may match nothing
+//a commit before anything is consumed makes every token a possible start since mismatches are then reported
+bool syntaxSeqFirst(int pc, bool atRuleStart, struct tokenSet* first) {
+    while (true) {
+        struct syntaxOp op = *syntaxGetOp(pc);
+        bool nullable = true;
+        switch (op.code) {
+            case SOP_END: return true;
+            case SOP_COMMIT: if (atRuleStart) tokenSetAddAll(first); break;
+            case SOP_OPTIONAL:
+            case SOP_REPEAT:
+                for (int i = pc +1; i < op.jump && nullable; i++) syntaxOpFirst(*syntaxGetOp(i), first, &nullable);
+                nullable = true;
+                pc = op.jump;
+                break;
+            case SOP_CHOICE:
+                nullable = false;
+                for (int i = pc +1; i < op.jump; i++) {
+                    bool altNullable = true;
+                    syntaxOpFirst(*syntaxGetOp(i), first, &altNullable);
+                    nullable |= altNullable;
+                }
+                pc = op.jump;
+                break;
+            default: syntaxOpFirst(op, first, &nullable);
+        }
+        if (!nullable) return false;
+        pc++;
+    }
+}
+
+//what may follow the op at pc inside its rule, group is the op opening the group pc is in or -1
+void syntaxFollowOfOp(enum syntaxType type, int pc, int group, struct tokenSet* follow) {
+    int rest = pc +1;
+    if (group != -1 && syntaxGetOp(group)->code == SOP_CHOICE) rest = syntaxGetOp(group)->jump +1;
+    if (group != -1 && syntaxGetOp(group)->code == SOP_REPEAT) syntaxSeqFirst(group +1, false, follow);
+    if (syntaxSeqFirst(rest, false, follow)) tokenSetAddSet(follow, &syntaxProg.follow[type]);
+}
+
+bool syntaxComputeFollowOfRule(enum syntaxType type) {
+    bool changed = false;
+    int group = -1;
+    for (int pc = syntaxProg.start[type]; syntaxGetOp(pc)->code != SOP_END; pc++) {
+        struct syntaxOp op = *syntaxGetOp(pc);
+        if (op.code == SOP_OPTIONAL || op.code == SOP_REPEAT || op.code == SOP_CHOICE) group = pc;
+        if (op.code == SOP_GROUP_END) group = -1;
+        if (op.code != SOP_RULE) continue;
+        struct tokenSet follow = (struct tokenSet){0};
+        syntaxFollowOfOp(type, pc, group, &follow);
+        changed |= tokenSetAddSet(&syntaxProg.follow[op.arg], &follow);
+    }
+    return changed;
+}
+
+void syntaxComputeSets() {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int type = 0; type < SNTX_COUNT; type++) {
+            if (syntaxProg.start[type] == -1) continue;
+            struct tokenSet first = syntaxProg.first[type];
+            bool nullable = syntaxSeqFirst(syntaxProg.start[type], true, &first);
+            changed |= tokenSetAddSet(&syntaxProg.first[type], &first);
+            if (nullable && !syntaxProg.nullable[type]) changed = syntaxProg.nullable[type] = true;
+        }
+    }
+    changed = true;
+    while (changed) {
+        changed = false;
+        for (int type = 0; type < SNTX_COUNT; type++) {
+            if (syntaxProg.start[type] != -1) changed |= syntaxComputeFollowOfRule(type);
+        }
+    }
+}
+
+//alternatives that can match empty are candidates for what may follow the choice
+void syntaxComputeChoiceTable(enum syntaxType type, int group) {
+    struct syntaxOp choice = *syntaxGetOp(group);
+    struct syntaxChoiceTable* table = ListGetIdx(&syntaxProg.choices, choice.arg);
+    struct tokenSet groupFollow = (struct tokenSet){0};
+    syntaxFollowOfOp(type, choice.jump, -1, &groupFollow);
+    for (int alt = 0; alt < choice.jump - group -1; alt++) {
+        struct tokenSet first = (struct tokenSet){0};
+        bool nullable = true;
+        syntaxOpFirst(*syntaxGetOp(group +1 + alt), &first, &nullable);
+        if (nullable) tokenSetAddSet(&first, &groupFollow);
+        for (int tokType = 0; tokType < TOK_COUNT; tokType++) {
+            if (tokenSetHas(&first, tokType)) table->alts[tokType] |= 1u << alt;
+        }
+    }
+}
+
+void syntaxComputeChoiceTables() {
+    for (int type = 0; type < SNTX_COUNT; type++) {
+        if (syntaxProg.start[type] == -1) continue;
+        for (int pc = syntaxProg.start[type]; syntaxGetOp(pc)->code != SOP_END; pc++) {
+            if (syntaxGetOp(pc)->code == SOP_CHOICE) syntaxComputeChoiceTable(type, pc);
+        }
+    }
+}
+
+void syntaxCompileRules() {
+    if (syntaxProgCompiled) return;
+    syntaxProg.ops = ListInit(sizeof(struct syntaxOp));
+    syntaxProg.names = ListInit(sizeof(char*));
+    syntaxProg.choices = ListInit(sizeof(struct syntaxChoiceTable));
+    for (int i = 0; i < SNTX_COUNT; i++) {
+        syntaxProg.start[i] = -1;
+        syntaxProg.syncTok[i] = TOK_NONE;
+    }
+    for (int i = 0; i < nRules; i++) syntaxCompileRule(rules[i]);
+    syntaxComputeSets();
+    syntaxComputeChoiceTables();
+    syntaxProgCompiled = true;
+}
+
+//tokens outside of the grammar may still start alternatives that commit before consuming anything
+unsigned int SyntaxChoiceCandidates(enum syntaxType type, int choice, enum tokenType lookahead) {
+    if (lookahead < 0 || lookahead >= TOK_COUNT) return ~0u;
+    struct syntaxChoiceTable* table = ListGetIdx(&syntaxProg.choices, syntaxProg.firstChoice[type] + choice);
+    return table->alts[lookahead];
+}
+
+char* syntaxOpName(int idx) {
+    return *(char**)ListGetIdx(&syntaxProg.names, idx);
+}
+
+struct syntax ParseRule(SyntaxCtx sc, enum syntaxType type);
+
+//returns false on a mismatch, the mismatching token is stored in s->errorTok
+bool syntaxMatchOp(SyntaxCtx sc, struct syntaxOp op, struct syntax* s) {
+    if (op.code == SOP_TOK) {
+        struct token tok = TokenFeed(sc->tc);
+        if (tok.type != op.arg) {
+            s->errorTok = tok;
+            TokenUnfeed(sc->tc); //a peek at the next token, nothing is thrown away
+            return false;
+        }
+        SyntaxAddTok(s, tok);
+        return true;
+    }
+    struct syntax nested = ParseRule(sc, op.arg);
+    if (nested.type == SNTX_NOT_FOUND) {
+        s->errorTok = nested.errorTok;
+        return false;
+    }
+    SyntaxAddNested(s, nested);
+    return true;
+}
 
-struct syntax ParseRule(SyntaxCtx sc, struct syntaxRule rule, bool started) {
-    struct syntax s; 
-    s.type = rule.type;
-    s.parts = ListInit(sizeof(union syntaxPart));
+//reference implementation of the rules, ParseSyntax uses the parser generated from them
+//an error inside a started pattern is reported once, the returned syntax keeps its type so callers do not report it again
+struct syntax ParseRule(SyntaxCtx sc, enum syntaxType type) {
+    struct syntax s = SyntaxInit(type);
+    int pc = syntaxProg.start[type];
+    if (pc == -1) {
+        s.type = SNTX_NOT_FOUND;
+        s.errorTok = TokenFeed(sc->tc);
+        TokenUnfeed(sc->tc);
+        return s;
+    }
 
-    bool optional = false;
-/   bool mayRepeat = false;
-    enum tokenType expectedTok;
-    enum syntaxType expectedSntx;
-    struct token foundTok;
-    struct syntax foundSntx;
+    bool started = false;
     int startCursor = TokenGetCursor(sc->tc);
-    int repeatCursor = CURSOR_NOT_SET;
-    while (rule.pattern[0] != '\0') {
-        switch (rule.pattern[0]) {
-            case 'T':
-                expectedTok = TokenGetTypeFromStr(rule.pattern);
-                foundTok = TokenFeed(sc->tc);
-                if (foundTok.type != tokType) {
-                    s.type = SNTX_NOT_FOUND;
-                    s.errorTok = tok;
-                    if (optional) {
-                        TokenUnfeed(sc->tc);
-                        break;
-                    }
-                    else if (started) {
-                        ErrMsgUnexpectedToken((tok, TokenStrFromType(expected)));
-                        TokenFeedUntil(sc->tc, lastPatternPart(rule.pattern));
-                        return s;
-                    }
-                    else {
-                        TokenSetCursor(sc->tc, startCursor);
-                        return s;
-                    }
+    int group = -1; //index of the op opening the current group
+    int groupCursor = 0;
+    int groupPartsLen = 0;
+    unsigned int candidates = 0; //alternatives of the current choice that can start with the lookahead
+    struct token lookahead;
+    while (true) {
+        struct syntaxOp op = *syntaxGetOp(pc);
+        switch (op.code) {
+            case SOP_END: return s;
+            case SOP_COMMIT: started = true; pc++; continue;
+            case SOP_LAZY: pc += SyntaxSkipBlock(sc, syntaxGetOp(pc +1)->arg, &s) ? 2 : 1; continue;
+            case SOP_OPTIONAL:
+            case SOP_REPEAT:
+            case SOP_CHOICE:
+                group = pc;
+                groupCursor = TokenGetCursor(sc->tc);
+                groupPartsLen = s.parts.len;
+                if (op.code == SOP_CHOICE) {
+                    lookahead = TokenFeed(sc->tc);
+                    TokenUnfeed(sc->tc);
+                    candidates = SyntaxChoiceCandidates(type, op.arg - syntaxProg.firstChoice[type], lookahead.type);
                 }
-                if (mayRepeat && *nextPatternPart(rule.pattern) == '$') {
-                    TokenSetCursor(sc->tc, repeatCursor);
+                pc++;
+                continue;
+            case SOP_GROUP_END:
+                if (syntaxGetOp(group)->code == SOP_REPEAT && TokenGetCursor(sc->tc) != groupCursor) {
+                    groupCursor = TokenGetCursor(sc->tc);
+                    groupPartsLen = s.parts.len;
+                    pc = group +1;
+                    continue;
                 }
-                ListAdd(&s.parts, &foundTok);
-                break;
-
-            case 'S':
-                expectedSntx = syntaxGetTypeFromStr(rule.pattern);
-                foundSntx = ParseRule(sc, rules[(rule.pattern)], started);
-                if (foundSntx.type != expectedSntx) {
-                    s.type = SNTX_NOT_FOUND;
-                    s.errorTok = tok;
-                    if (optional) {
-                        TokenUnfeed(sc->tc);
-                        break;
-                    }
-                    else if (started) {
-                        ErrMsgUnexpectedToken((foundSntx.errorTok, syntaxStrFromType(syntaxType)));
-                        TokenFeedUntil(sc->tc, lastPatternPart(rule.pattern));
-                        return s;
-                    }
-                    else {
-                        TokenSetCursor(sc->tc, startCursor);
-                        return s;
+                if (syntaxGetOp(group)->code == SOP_CHOICE) {pc = group; break;} //no alternative matched
+                group = -1;
+                pc++;
+                continue;
+            default:
+                if (group != -1 && syntaxGetOp(group)->code == SOP_CHOICE && !(candidates >> (pc - group -1) & 1)) {
+                    s.errorTok = lookahead;
+                    pc++;
+                    continue;
+                }
+                if (syntaxMatchOp(sc, op, &s)) {
+                    if (group != -1 && syntaxGetOp(group)->code == SOP_CHOICE) {
+                        pc = syntaxGetOp(group)->jump +1;
+                        group = -1;
                     }
+                    else pc++;
+                    continue;
                 }
-                if (mayRepeat && *nextPatternPart(rule.pattern) == '$') {
-                    TokenSetCursor(sc->tc, repeatCursor);
+                if (group != -1) {
+                    SyntaxRewind(sc, type, groupCursor);
+                    ListRetract(&s.parts, groupPartsLen);
+                    if (syntaxGetOp(group)->code == SOP_CHOICE) {pc++; continue;}
+                    pc = syntaxGetOp(group)->jump +1;
+                    group = -1;
+                    continue;
                 }
-                ListAdd(&s.parts, &foundSntx);
-                break;
-            //case '&': optionalAtLeastOne = true; break;
-            case '*':
-                      repeatCursor = TokenGetCursor(sc->tc);
-                      mayRepeat = true;
-                      break;
-
-            case '$':
-                      repeatCursor = CURSOR_NOT_SET;
-                      optional = false;
-                      mayRepeat = false;
-                      break;
+        }
 
-            case '?': optional = true; break;
-            case '!': started = true; break;
-            default: ErrorBugFound();
+        //mismatch outside of a group
+        if (started) {
+            SyntaxUnexpectedToken(sc, s.errorTok, syntaxOpName(pc));
+            if (syntaxProg.syncTok[type] != TOK_NONE) TokenFeedPast(sc->tc, syntaxProg.syncTok[type]);
+            return s;
         }
-        rule.pattern = nextPatternPart(rule.pattern);
+        SyntaxRewind(sc, type, startCursor);
+        s.type = SNTX_NOT_FOUND;
+        return s;
+    }
+}
+
+bool SyntaxSkipBlock(SyntaxCtx sc, enum syntaxType type, struct syntax* s) {
+    if (!sc->lazyBodies) return false;
+    int open = TokenGetCursor(sc->tc);
+    int close = TokenGetMatchingBracket(sc->tc, open);
+    struct token tok = TokenFeed(sc->tc);
+    if (tok.type != TOK_CURLY_O || close == -1) {
+        TokenUnfeed(sc->tc);
+        return false;
     }
+    struct syntax block = SyntaxInit(type);
+    block.skippedAt = open;
+    SyntaxAddTok(&block, tok);
+    SyntaxAddNested(s, block);
+    TokenSetCursor(sc->tc, close +1);
+    return true;
+}
+
+bool SyntaxParseSkipped(SyntaxCtx sc, struct syntax* block) {
+    if (block->skippedAt == -1) ErrorBugFound();
+    struct syntaxContext fork = *sc;
+    fork.tc = TokenFork(sc->tc);
+    fork.profile = NULL; //the profile is printed once the file is parsed
+    fork.lazyBodies = false;
+    fork.nErrors = 0;
+    TokenSetCursor(fork.tc, block->skippedAt);
+    struct syntax parsed = SyntaxParseRuleGenerated(&fork, block->type);
+    free(fork.tc);
+    if (fork.nErrors != 0 || parsed.type == SNTX_NOT_FOUND) return false;
+    ListDestroy(block->parts);
+    *block = parsed;
+    return true;
+}
+
+//thrown away tokens are attributed to the rule that rewound and the line the speculative parse started at
+struct syntaxRewindSite {
+    enum syntaxType type;
+    int lineNr;
+    int nRewinds;
+    long long nTokens;
+};
+
+struct syntaxProfile {
+    struct hashMap sites; //struct syntaxRewindSite
+    long long nTokens;
+};
+
+#define SYNTAX_PROFILE_TOP 20
+
+bool syntaxRewindSiteCmp(void* key, void* elem) {
+    struct syntaxRewindSite* a = key;
+    struct syntaxRewindSite* b = elem;
+    return a->type == b->type && a->lineNr == b->lineNr;
+}
+
+void syntaxProfileRewind(struct syntaxProfile* p, enum syntaxType type, struct token start, int nTokens) {
+    struct syntaxRewindSite key = {type, start.lineNr, 0, 0};
+    unsigned long long hash = HashBytes(HASH_SEED, &key.type, sizeof(key.type));
+    hash = HashBytes(hash, &key.lineNr, sizeof(key.lineNr));
+    struct syntaxRewindSite* site = HashMapGet(&p->sites, hash, &key, syntaxRewindSiteCmp);
+    if (!site) site = HashMapAdd(&p->sites, hash, &key);
+    site->nRewinds++;
+    site->nTokens += nTokens;
+    p->nTokens += nTokens;
 }
 
-void ParseSyntax(char* fileName) {
+void SyntaxRewind(SyntaxCtx sc, enum syntaxType type, int cursor) {
+    int nTokens = TokenGetCursor(sc->tc) - cursor;
+    TokenSetCursor(sc->tc, cursor);
+    if (!sc->profile || nTokens <= 0) return;
+    struct token tok = TokenFeed(sc->tc);
+    TokenUnfeed(sc->tc);
+    syntaxProfileRewind(sc->profile, type, tok, nTokens);
+}
+
+int syntaxRewindSiteOrder(const void* a, const void* b) {
+    long long na = ((struct syntaxRewindSite*)a)->nTokens;
+    long long nb = ((struct syntaxRewindSite*)b)->nTokens;
+    return (na < nb) - (na > nb);
+}
+
+void syntaxProfilePrint(struct syntaxProfile* p, TokenCtx tc) {
+    int nSites = p->sites.elems.len;
+    struct syntaxRewindSite* sites = MallocOrCrash(nSites * sizeof(struct syntaxRewindSite) +1);
+    for (int i = 0; i < nSites; i++) sites[i] = *(struct syntaxRewindSite*)ListGetIdx(&p->sites.elems, i);
+    qsort(sites, nSites, sizeof(struct syntaxRewindSite), syntaxRewindSiteOrder);
+
+    printf("backtracking threw away %lld tokens, %d were parsed\n", p->nTokens, TokenGetCount(tc));
+    for (int i = 0; i < nSites && i < SYNTAX_PROFILE_TOP; i++) {
+        StrPrint(TokenGetFileName(tc), stdout);
+        printf(":%d %s: %lld tokens in %d rewinds\n", sites[i].lineNr, syntaxTypeNames[sites[i].type],
+            sites[i].nTokens, sites[i].nRewinds);
+    }
+    free(sites);
+}
+
+SyntaxCtx syntaxCtxNew(char* fileName) {
     SyntaxCtx sc = MallocOrCrash(sizeof(struct syntaxContext));
+    *sc = (struct syntaxContext){0};
     sc->tc = TokenizeFile(fileName);
     sc->syntax = ListInit(sizeof(struct syntax));
+    return sc;
+}
+
+//past the next semicolon or, if a block starts before it, past the block's close,
+//so a global statement that is not in the grammar is reported once instead of once per token
+void syntaxSkipGlobal(TokenCtx tc) {
+    int end = TokenGetNextSColon(tc, TokenGetCursor(tc));
+    int curlyO = TokenGetNextCurlyO(tc, TokenGetCursor(tc));
+    if (curlyO < end) end = TokenGetMatchingBracket(tc, curlyO) == -1 ? TokenGetCount(tc) : TokenGetMatchingBracket(tc, curlyO);
+    TokenSetCursor(tc, end +1);
+}
+
+//parses a global syntax element with the given rule function, returns false at EOF
+bool parseGlobalSyntax(SyntaxCtx sc, struct syntax(*parseRule)(SyntaxCtx sc, enum syntaxType type)) {
+    struct token tok = TokenFeed(sc->tc);
+    if (tok.type == TOK_EOF) return false;
+    TokenUnfeed(sc->tc);
+    struct syntax s = parseRule(sc, SNTX_IMPORT);
+    if (s.type == SNTX_NOT_FOUND) s = parseRule(sc, SNTX_STMNT_GLOB);
+    if (s.type == SNTX_NOT_FOUND) {
+        SyntaxUnexpectedToken(sc, TokenFeed(sc->tc), EXPECTED_STATEMENT);
+        TokenUnfeed(sc->tc);
+        syntaxSkipGlobal(sc->tc);
+        return true;
+    }
+    ListAdd(&sc->syntax, &s);
+    return true;
+}
+
+SyntaxCtx ParseSyntax(char* fileName, bool profileBacktracking, bool lazyBodies) {
+    syntaxCompileRules(); //the generated parser dispatches choices on the tables of the interpreter
+    SyntaxCtx sc = syntaxCtxNew(fileName);
+    sc->lazyBodies = lazyBodies;
+    TimerStart("parse syntax", TokenGetFileName(sc->tc));
+    struct syntaxProfile profile = (struct syntaxProfile){0};
+    if (profileBacktracking) {
+        profile.sites = HashMapInit(sizeof(struct syntaxRewindSite));
+        sc->profile = &profile;
+    }
+    while (parseGlobalSyntax(sc, SyntaxParseRuleGenerated));
+    TimerStop();
+    if (!profileBacktracking) return sc;
+    syntaxProfilePrint(&profile, sc->tc);
+    HashMapDestroy(profile.sites);
+    sc->profile = NULL;
+    return sc;
+}
+
+bool syntaxIsSame(struct syntax* a, struct syntax* b) {
+    if (a->type != b->type || a->parts.len != b->parts.len) return false;
+    if (a->errorTok.tokId != b->errorTok.tokId || a->skippedAt != b->skippedAt) return false;
+    for (int i = 0; i < a->parts.len; i++) {
+        struct syntaxPart* pa = ListGetIdx(&a->parts, i);
+        struct syntaxPart* pb = ListGetIdx(&b->parts, i);
+        if (!pa->nested != !pb->nested) return false;
+        if (pa->nested && !syntaxIsSame(pa->nested, pb->nested)) return false;
+        if (!pa->nested && pa->tok.tokId != pb->tok.tokId) return false;
+    }
+    return true;
+}
+
+//the generated parser must build the same trees, end at the same token and report the same number of errors
+//as the interpreter for every rule started at every token of the test files
+void testGeneratedParserMatchesFile(char* fileName, bool lazyBodies, bool* passed) {
+    syntaxCompileRules();
+    SyntaxCtx sc = syntaxCtxNew(fileName);
+    sc->quiet = true;
+    sc->lazyBodies = lazyBodies;
+    for (int i = 0; i < TokenGetCount(sc->tc); i++) {
+        for (int type = SNTX_NOT_FOUND +1; type < SNTX_COUNT; type++) {
+            TokenSetCursor(sc->tc, i);
+            sc->nErrors = 0;
+            struct syntax a = ParseRule(sc, type);
+            int cursorA = TokenGetCursor(sc->tc);
+            int nErrorsA = sc->nErrors;
+
+            TokenSetCursor(sc->tc, i);
+            sc->nErrors = 0;
+            struct syntax b = SyntaxParseRuleGenerated(sc, type);
+            if (!syntaxIsSame(&a, &b) || cursorA != TokenGetCursor(sc->tc) || nErrorsA != sc->nErrors) {
+                printf("%s: %s differs at token %d\n", fileName, syntaxTypeNames[type], i);
+                *passed = false;
+            }
+        }
+    }
+}
+
+TEST(GeneratedParserMatchesInterpreter) {
+    bool passed = true;
+    testGeneratedParserMatchesFile("test1.olang", false, &passed);
+    testGeneratedParserMatchesFile("test2.olang", false, &passed);
+    testGeneratedParserMatchesFile("test3.olang", false, &passed);
+    testGeneratedParserMatchesFile("test3.olang", true, &passed);
+    testGeneratedParserMatchesFile("testrecovery.olang", false, &passed);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+SyntaxCtx testParseQuiet(char* fileName) {
+    syntaxCompileRules();
+    SyntaxCtx sc = syntaxCtxNew(fileName);
+    sc->quiet = true;
+    while (parseGlobalSyntax(sc, SyntaxParseRuleGenerated));
+    return sc;
+}
+
+//the names of the functions parsed at the global level, in order
+bool testParsedFuncs(SyntaxCtx sc, char** names, int nNames) {
+    int nFuncs = 0;
+    for (int i = 0; i < sc->syntax.len; i++) {
+        struct syntax* s = ListGetIdx(&sc->syntax, i);
+        if (s->type != SNTX_STMNT_GLOB) continue;
+        struct syntax* func = ((struct syntaxPart*)ListGetIdx(&s->parts, 0))->nested;
+        if (func->type != SNTX_FUNC) continue;
+        if (nFuncs == nNames || func->parts.len < 2) return false;
+        struct token name = ((struct syntaxPart*)ListGetIdx(&func->parts, 1))->tok;
+        if (!StrCmp(name.str, StrFromCStr(names[nFuncs++]))) return false;
+    }
+    return nFuncs == nNames;
+}
+
+//an error in one function must not swallow the next, main still gets its whole body
+//and the global statements outside of the grammar are reported once each
+TEST(SyntaxRecoversPerFunction) {
+    SyntaxCtx sc = testParseQuiet("testrecovery.olang");
+    char* names[] = {"stepless", "caseless", "nested", "main"};
+    bool passed = testParsedFuncs(sc, names, 4) && sc->nErrors == 7;
+    struct syntax* main = ListGetIdx(&sc->syntax, sc->syntax.len -1);
+    struct syntax* func = ((struct syntaxPart*)ListGetIdx(&main->parts, 0))->nested;
+    struct syntax* body = ((struct syntaxPart*)ListGetIdx(&func->parts, func->parts.len -1))->nested;
+    passed = passed && body->type == SNTX_CBLOCK && body->parts.len == 3;
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//y and x * 2 start like a call and x = 2 like a declaration, each of them throws away the token read past the name,
+//what the other statements of the file only peek at is not counted, for the interpreter and the generated parser alike
+TEST(SyntaxProfilesRewinds) {
+    struct syntax(*parseRules[])(SyntaxCtx sc, enum syntaxType type) = {ParseRule, SyntaxParseRuleGenerated};
+    struct syntaxRewindSite expected[] = {{SNTX_CALL, 2, 1, 1}, {SNTX_STMNT_LOC_DECL, 6, 1, 1}, {SNTX_CALL, 15, 1, 1}};
+    bool passed = true;
+    syntaxCompileRules();
+    for (int i = 0; i < 2 && passed; i++) {
+        SyntaxCtx sc = syntaxCtxNew("testerrors.olang");
+        struct syntaxProfile profile = {HashMapInit(sizeof(struct syntaxRewindSite)), 0};
+        sc->profile = &profile;
+        while (parseGlobalSyntax(sc, parseRules[i]));
+        passed = sc->nErrors == 0 && profile.nTokens == 3 && profile.sites.elems.len == 3;
+        for (int j = 0; j < 3 && passed; j++) {
+            struct syntaxRewindSite* site = ListGetIdx(&profile.sites.elems, j);
+            passed = false;
+            for (int k = 0; k < 3; k++) {
+                if (syntaxRewindSiteCmp(&expected[k], site)) passed = site->nRewinds == 1 && site->nTokens == 1;
+            }
+        }
+        HashMapDestroy(profile.sites);
+    }
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
 }
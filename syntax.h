@@ -1,9 +1,12 @@
 #ifndef SYNTAX_H
 #define SYNTAX_H
 
+#include <stdbool.h>
 #include "list.h"
 
 typedef struct syntaxContext* SyntaxCtx;
-void ParseSyntax(char* fileName);
+//the trees are in the order of the file, prints the rules and lines that threw away the most tokens,
+//with lazyBodies function bodies are only matched by their curly brackets until CheckSyntax needs them
+SyntaxCtx ParseSyntax(char* fileName, bool profileBacktracking, bool lazyBodies);
 
 #endif //SYNTAX_H
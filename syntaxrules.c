@@ -0,0 +1,118 @@
+#include "syntaxrules.h"
+
+//must stay in the order of enum syntaxType
+char* syntaxTypeNames[SNTX_COUNT] = {
+    "SNTX_NOT_FOUND",
+    "SNTX_IDEN_MB_NMESPCE",
+    "SNTX_IMPORT",
+    "SNTX_EXPR",
+    "SNTX_EXPR_BITWISE",
+    "SNTX_EXPR_CMP",
+    "SNTX_EXPR_SHIFT",
+    "SNTX_EXPR_ADD",
+    "SNTX_EXPR_MUL",
+    "SNTX_EXPR_UNARY",
+    "SNTX_EXPR_PRIMARY",
+    "SNTX_EXPR_PAREN",
+    "SNTX_CALL",
+    "SNTX_ARGS",
+    "SNTX_OP_LOGIC",
+    "SNTX_OP_BITWISE",
+    "SNTX_OP_CMP",
+    "SNTX_OP_SHIFT",
+    "SNTX_OP_ADD",
+    "SNTX_OP_MUL",
+    "SNTX_OP_UNARY",
+    "SNTX_ASS",
+    "SNTX_INC",
+    "SNTX_STMNT_ASS",
+    "SNTX_STMNT_INC",
+    "SNTX_STMNT_GLOB_DECL",
+    "SNTX_STMNT_LOC_DECL",
+    "SNTX_STMNT_IF",
+    "SNTX_ELSE",
+    "SNTX_STMNT_FOR",
+    "SNTX_FOR_INIT",
+    "SNTX_FOR_STEP",
+    "SNTX_STMNT_MATCH",
+    "SNTX_CASE",
+    "SNTX_NOMATCH",
+    "SNTX_STMNT_RET",
+    "SNTX_STMNT_EXIT",
+    "SNTX_FUNC",
+    "SNTX_PARAMS",
+    "SNTX_PARAM",
+    "SNTX_STMNT_GLOB",
+    "SNTX_STMNT_LOC",
+    "SNTX_CBLOCK",
+};
+
+//! = start of pattern, ? = optional, & = optional exactly one, * = optional repeating, $ = end of optional
+//~ = the next rule, outside of groups, is a code block that lazy parsing skips to its matching curly close
+//on incomplete pattern after start, tokenFeed is set past the next occurence of the token the pattern ends with outside of groups, if it ends with one
+//all expressions must be separated by a space
+//rules without a pattern are not written yet and never match
+//changes take effect in both the interpreter and, after rebuilding, the generated parser
+//the assignment operators, of statements and of the step of for loops
+#define SYNTAX_ASS_TOKS "TOK_ASS TOK_ASS_ADD TOK_ASS_SUB TOK_ASS_MUL " \
+    "TOK_ASS_DIV TOK_ASS_MOD TOK_ASS_AND TOK_ASS_OR TOK_ASS_XOR TOK_ASS_BTSFT_L " \
+    "TOK_ASS_BTSFT_R TOK_ASS_BTWSE_AND TOK_ASS_BTWSE_OR TOK_ASS_BTWSE_XOR "
+
+struct syntaxRule rules[] = {
+    {SNTX_IDEN_MB_NMESPCE, "TOK_IDEN * TOK_DOT TOK_IDEN $"},
+    {SNTX_IMPORT, "TOK_IMPORT ! TOK_IDEN TOK_STR_LIT TOK_SCOLON"},
+
+    //one rule per precedence level from the lowest, the operators of a level are applied from left to right
+    {SNTX_EXPR, "SNTX_EXPR_BITWISE * SNTX_OP_LOGIC SNTX_EXPR_BITWISE $"},
+    {SNTX_EXPR_BITWISE, "SNTX_EXPR_CMP * SNTX_OP_BITWISE SNTX_EXPR_CMP $"},
+    {SNTX_EXPR_CMP, "SNTX_EXPR_SHIFT * SNTX_OP_CMP SNTX_EXPR_SHIFT $"},
+    {SNTX_EXPR_SHIFT, "SNTX_EXPR_ADD * SNTX_OP_SHIFT SNTX_EXPR_ADD $"},
+    {SNTX_EXPR_ADD, "SNTX_EXPR_MUL * SNTX_OP_ADD SNTX_EXPR_MUL $"},
+    {SNTX_EXPR_MUL, "SNTX_EXPR_UNARY * SNTX_OP_MUL SNTX_EXPR_UNARY $"},
+    {SNTX_EXPR_UNARY, "* SNTX_OP_UNARY $ SNTX_EXPR_PRIMARY"},
+    {SNTX_EXPR_PRIMARY, "& SNTX_CALL SNTX_IDEN_MB_NMESPCE TOK_BOOL_LIT TOK_INT_LIT TOK_FLOAT_LIT TOK_CHAR_LIT "
+        "SNTX_EXPR_PAREN $"},
+    {SNTX_EXPR_PAREN, "TOK_PAREN_O ! SNTX_EXPR TOK_PAREN_C"},
+    {SNTX_CALL, "SNTX_IDEN_MB_NMESPCE TOK_PAREN_O ! ? SNTX_ARGS $ TOK_PAREN_C"},
+    {SNTX_ARGS, "SNTX_EXPR * TOK_COMMA SNTX_EXPR $"},
+
+    {SNTX_OP_LOGIC, "& TOK_AND TOK_OR TOK_XOR $"},
+    {SNTX_OP_BITWISE, "& TOK_BTWSE_AND TOK_BTWSE_OR TOK_BTWSE_XOR $"},
+    {SNTX_OP_CMP, "& TOK_LST TOK_LSE TOK_GRT TOK_GRE TOK_NEQ TOK_EQ $"},
+    {SNTX_OP_SHIFT, "& TOK_BTSFT_L TOK_BTSFT_R $"},
+    {SNTX_OP_ADD, "& TOK_ADD TOK_SUB $"},
+    {SNTX_OP_MUL, "& TOK_MUL TOK_DIV TOK_MOD $"},
+    {SNTX_OP_UNARY, "& TOK_ADD TOK_SUB TOK_NOT TOK_BTWSE_INV $"},
+
+    {SNTX_ASS, "SNTX_IDEN_MB_NMESPCE & " SYNTAX_ASS_TOKS "$ ! SNTX_EXPR"},
+    {SNTX_INC, "SNTX_IDEN_MB_NMESPCE & TOK_INC TOK_DEC $"},
+    {SNTX_STMNT_ASS, "SNTX_IDEN_MB_NMESPCE & " SYNTAX_ASS_TOKS "$ ! SNTX_EXPR TOK_SCOLON"},
+    {SNTX_STMNT_INC, "SNTX_IDEN_MB_NMESPCE & TOK_INC TOK_DEC $ ! TOK_SCOLON"},
+
+    {SNTX_STMNT_GLOB_DECL, "TOK_IDEN ? TOK_MUT $ SNTX_STMNT_ASS !"},
+    {SNTX_STMNT_LOC_DECL, "TOK_IDEN SNTX_STMNT_ASS !"},
+
+    {SNTX_STMNT_IF, "TOK_IF ! SNTX_EXPR SNTX_CBLOCK ? SNTX_ELSE $"},
+    {SNTX_ELSE, "TOK_ELSE ! & SNTX_STMNT_IF SNTX_CBLOCK $"},
+    {SNTX_STMNT_FOR, "TOK_FOR ! ? SNTX_FOR_INIT $ SNTX_EXPR ? TOK_SCOLON SNTX_FOR_STEP $ SNTX_CBLOCK"},
+    {SNTX_FOR_INIT, "& SNTX_STMNT_LOC_DECL SNTX_STMNT_ASS $"},
+    {SNTX_FOR_STEP, "& SNTX_INC SNTX_ASS $"},
+    {SNTX_STMNT_MATCH, "TOK_MATCH ! SNTX_EXPR TOK_CURLY_O * SNTX_CASE $ ? SNTX_NOMATCH $ TOK_CURLY_C"},
+    {SNTX_CASE, "TOK_CASE ! SNTX_EXPR SNTX_CBLOCK"},
+    {SNTX_NOMATCH, "TOK_NOMATCH ! SNTX_CBLOCK"},
+    {SNTX_STMNT_RET, "TOK_RET ! ? SNTX_EXPR $ TOK_SCOLON"},
+    {SNTX_STMNT_EXIT, "TOK_EXIT ! ? SNTX_EXPR $ TOK_SCOLON"},
+
+    {SNTX_FUNC, "TOK_FUNC ! TOK_IDEN TOK_PAREN_O ? SNTX_PARAMS $ TOK_PAREN_C ? SNTX_IDEN_MB_NMESPCE $ ~ SNTX_CBLOCK"},
+    {SNTX_PARAMS, "SNTX_PARAM * TOK_COMMA SNTX_PARAM $"},
+    {SNTX_PARAM, "TOK_IDEN ? TOK_MUT $ SNTX_IDEN_MB_NMESPCE"},
+
+    {SNTX_STMNT_GLOB, "& SNTX_STMNT_GLOB_DECL SNTX_FUNC $ !"},
+    {SNTX_STMNT_LOC, "& "
+        "SNTX_STMNT_LOC_DECL SNTX_STMNT_ASS SNTX_STMNT_INC SNTX_STMNT_IF SNTX_STMNT_FOR "
+        "SNTX_STMNT_MATCH SNTX_STMNT_RET SNTX_STMNT_EXIT $ !"},
+
+    {SNTX_CBLOCK, "TOK_CURLY_O ! * SNTX_STMNT_LOC $ TOK_CURLY_C"},
+};
+
+int nRules = sizeof(rules) / sizeof(rules[0]);
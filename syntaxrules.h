@@ -0,0 +1,105 @@
+#ifndef SYNTAXRULES_H
+#define SYNTAXRULES_H
+
+#include <stdbool.h>
+#include "syntax.h"
+#include "token.h"
+#include "list.h"
+
+//shared by the interpreter in syntax.c, the parser generator and the parser it generates
+
+enum syntaxType {
+    SNTX_NOT_FOUND,
+    SNTX_IDEN_MB_NMESPCE,
+    SNTX_IMPORT,
+    SNTX_EXPR,
+    SNTX_EXPR_BITWISE,
+    SNTX_EXPR_CMP,
+    SNTX_EXPR_SHIFT,
+    SNTX_EXPR_ADD,
+    SNTX_EXPR_MUL,
+    SNTX_EXPR_UNARY,
+    SNTX_EXPR_PRIMARY,
+    SNTX_EXPR_PAREN,
+    SNTX_CALL,
+    SNTX_ARGS,
+    SNTX_OP_LOGIC,
+    SNTX_OP_BITWISE,
+    SNTX_OP_CMP,
+    SNTX_OP_SHIFT,
+    SNTX_OP_ADD,
+    SNTX_OP_MUL,
+    SNTX_OP_UNARY,
+    SNTX_ASS,
+    SNTX_INC,
+    SNTX_STMNT_ASS,
+    SNTX_STMNT_INC,
+    SNTX_STMNT_GLOB_DECL,
+    SNTX_STMNT_LOC_DECL,
+    SNTX_STMNT_IF,
+    SNTX_ELSE,
+    SNTX_STMNT_FOR,
+    SNTX_FOR_INIT,
+    SNTX_FOR_STEP,
+    SNTX_STMNT_MATCH,
+    SNTX_CASE,
+    SNTX_NOMATCH,
+    SNTX_STMNT_RET,
+    SNTX_STMNT_EXIT,
+    SNTX_FUNC,
+    SNTX_PARAMS,
+    SNTX_PARAM,
+    SNTX_STMNT_GLOB,
+    SNTX_STMNT_LOC,
+    SNTX_CBLOCK,
+    SNTX_COUNT
+};
+
+struct syntaxRule {
+    enum syntaxType type;
+    char* pattern;
+};
+
+extern char* syntaxTypeNames[SNTX_COUNT];
+extern struct syntaxRule rules[];
+extern int nRules;
+
+struct syntaxProfile;
+
+struct syntaxContext {
+    TokenCtx tc;
+    struct syntaxProfile* profile; //NULL unless backtracking is profiled
+    struct list syntax;
+    struct list* ctxs;
+    bool quiet; //errors are only counted
+    bool lazyBodies; //blocks marked with ~ in the patterns are skipped and parsed once they are needed
+    int nErrors;
+};
+
+struct syntaxPart {
+    struct token tok;
+    struct syntax* nested; //NULL for tokens
+};
+
+struct syntax {
+    enum syntaxType type;
+    struct list parts;
+    struct token errorTok;
+    int skippedAt; //a block skipped by lazy parsing only holds its curly open, this is its token index; -1 otherwise
+};
+
+struct syntax SyntaxInit(enum syntaxType type);
+void SyntaxAddTok(struct syntax* s, struct token tok);
+void SyntaxAddNested(struct syntax* s, struct syntax nested);
+void SyntaxUnexpectedToken(SyntaxCtx sc, struct token found, char* expected);
+//speculative parses are undone with this so the thrown away tokens can be profiled,
+//a mismatching token is only a peek and undone with TokenUnfeed
+void SyntaxRewind(SyntaxCtx sc, enum syntaxType type, int cursor);
+unsigned int SyntaxChoiceCandidates(enum syntaxType type, int choice, enum tokenType lookahead); //bit n set if alternative n may match
+bool SyntaxSkipBlock(SyntaxCtx sc, enum syntaxType type, struct syntax* s); //false unless lazy and a matched curly open is next
+//parses a skipped block in place on a fork of the tokens, so different blocks can be parsed on different threads,
+//false if it has syntax errors, they are reported and the block is left skipped
+bool SyntaxParseSkipped(SyntaxCtx sc, struct syntax* block);
+struct syntax SyntaxParseRuleGenerated(SyntaxCtx sc, enum syntaxType type); //in the generated bin/syntaxparser.c
+
+#endif //SYNTAXRULES_H
@@ -0,0 +1,239 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "irtest.h"
+#include "util.h"
+
+//why a call in tail position stays a call
+enum tailKept {
+    TAIL_KEPT_NONE,
+    TAIL_KEPT_UNKNOWN_CALLEE,
+    TAIL_KEPT_STACK_MEMORY,
+    TAIL_KEPT_MUT_ARG,
+    TAIL_KEPT_SIGNATURE
+};
+
+char* tailKeptReasons[] = {
+    [TAIL_KEPT_NONE] = "converted",
+    [TAIL_KEPT_UNKNOWN_CALLEE] = "the callee is not known",
+    [TAIL_KEPT_STACK_MEMORY] = "the frame owns stack memory the callee may refer to",
+    [TAIL_KEPT_MUT_ARG] = "a mut arg may refer to a slot of the frame",
+    [TAIL_KEPT_SIGNATURE] = "the callee differs in params, return type or having errors, so its frame does not fit"
+};
+
+struct var* tailOrigin(struct var* func) {
+    return func && func->origin ? func->origin : func;
+}
+
+//the call whose value the ret of block returns right after it, IR_NONE if there is none
+int tailCallOf(struct irFunc* f, int block) {
+    struct list* instrs = &IrGetBlock(f, block)->instrs;
+    if (instrs->len < 2) return IR_NONE;
+    int ret = *(int*)ListGetIdx(instrs, instrs->len -1);
+    int call = *(int*)ListGetIdx(instrs, instrs->len -2);
+    struct irInstr* in = IrGetInstr(f, ret);
+    if (in->op != IR_RET || IrGetInstr(f, call)->op != IR_CALL) return IR_NONE;
+    if (in->args.len ? IrGetArg(f, ret, 0) != call : IrGetInstr(f, call)->type != TYPE_ID_NONE) return IR_NONE;
+    return call;
+}
+
+//a frame is only given up if nothing the callee gets may point into it
+//params and results are passed alike and errors take a slot of their own, so those have to agree
+bool tailSameSignature(struct var* a, struct var* b) {
+    struct type* ta = &a->type;
+    struct type* tb = &b->type;
+    if (ta->vars.len != tb->vars.len || ta->retType.len != tb->retType.len || (ta->errors.len != 0) != (tb->errors.len != 0)) return false;
+    for (int i = 0; i < ta->vars.len; i++) {
+        struct var* pa = ListGetIdx(&ta->vars, i);
+        struct var* pb = ListGetIdx(&tb->vars, i);
+        if (pa->type.id != pb->type.id || pa->mut != pb->mut) return false;
+    }
+    return ta->retType.len == 0 || ((struct type*)ListGetIdx(&ta->retType, 0))->id == ((struct type*)ListGetIdx(&tb->retType, 0))->id;
+}
+
+enum tailKept tailKept(struct irFunc* f, int call) {
+    struct var* callee = IrGetInstr(f, call)->var;
+    if (!callee) return TAIL_KEPT_UNKNOWN_CALLEE;
+    for (int i = 0; i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->op == IR_ALLOCA && in->block != IR_NONE && in->val == IR_ALLOC_STACK) return TAIL_KEPT_STACK_MEMORY;
+    }
+    for (int i = 0; i < callee->type.vars.len; i++) {
+        if (((struct var*)ListGetIdx(&callee->type.vars, i))->mut) return TAIL_KEPT_MUT_ARG;
+    }
+    if (tailOrigin(callee) != tailOrigin(f->func) && !tailSameSignature(callee, f->func)) return TAIL_KEPT_SIGNATURE;
+    return TAIL_KEPT_NONE;
+}
+
+//a block only returning what its preds computed last is copied into each pred ending in a call that can become a tail call
+bool tailDuplicateRets(struct irFunc* f) {
+    bool changed = false;
+    for (int b = 0; b < f->blocks.len; b++) {
+        struct list* instrs = &IrGetBlock(f, b)->instrs;
+        int ret = instrs->len ? *(int*)ListGetIdx(instrs, instrs->len -1) : IR_NONE;
+        if (ret == IR_NONE || IrGetInstr(f, ret)->op != IR_RET || instrs->len > 2) continue;
+        int phi = instrs->len == 2 ? *(int*)ListGetIdx(instrs, 0) : IR_NONE;
+        if (phi != IR_NONE && (IrGetInstr(f, phi)->op != IR_PHI || IrGetArg(f, ret, 0) != phi)) continue;
+        if (phi == IR_NONE && IrGetInstr(f, ret)->args.len) continue;
+
+        struct list* preds = &IrGetBlock(f, b)->preds;
+        for (int p = preds->len -1; p >= 0; p--) {
+            int pred = *(int*)ListGetIdx(preds, p);
+            struct list* predInstrs = &IrGetBlock(f, pred)->instrs;
+            int br = IrGetTerminator(f, pred);
+            if (IrGetInstr(f, br)->op != IR_BR || predInstrs->len < 2) continue;
+            int call = *(int*)ListGetIdx(predInstrs, predInstrs->len -2);
+            struct irInstr* in = IrGetInstr(f, call);
+            if (in->op != IR_CALL || tailKept(f, call) != TAIL_KEPT_NONE) continue;
+            if (phi != IR_NONE ? IrGetArg(f, phi, p) != call : in->type != TYPE_ID_NONE) continue;
+            IrRemoveInstr(f, br);
+            int newRet = IrAddInstr(f, pred, IR_RET, TYPE_ID_NONE);
+            if (phi != IR_NONE) IrAddArg(f, newRet, call);
+            changed = true;
+        }
+    }
+    if (changed) IrRemoveUnreachable(f);
+    return changed;
+}
+
+//the entry is split after its params and slots into the header of a loop with a phi per param
+int tailLoopHeader(struct irFunc* f, int* phis) {
+    int header = IrSplitBlock(f, 0, 0);
+    struct list* instrs = &IrGetBlock(f, header)->instrs;
+    for (int i = 0; i < instrs->len; i++) {
+        int instr = *(int*)ListGetIdx(instrs, i);
+        enum irOp op = IrGetInstr(f, instr)->op;
+        if (op != IR_PARAM && op != IR_ALLOCA) continue;
+        IrMoveInstr(f, instr, 0, IrGetBlock(f, 0)->instrs.len);
+        i--;
+    }
+    IrSetTargets(f, IrAddInstr(f, 0, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+
+    for (int p = 0; p < f->nParams; p++) phis[p] = IR_NONE;
+    struct list* entry = &IrGetBlock(f, 0)->instrs;
+    for (int i = 0; i < entry->len; i++) {
+        int param = *(int*)ListGetIdx(entry, i);
+        struct irInstr* in = IrGetInstr(f, param);
+        if (in->op != IR_PARAM) continue;
+        int p = in->val;
+        bool first = phis[p] == IR_NONE;
+        if (first) phis[p] = IrInsertInstr(f, header, 0, IR_PHI, in->type);
+        IrReplaceUses(f, param, phis[p]);
+        if (first) IrAddArg(f, phis[p], param);
+    }
+    return header;
+}
+
+void tailJump(struct irFunc* f, int call, int header, int* phis) {
+    int block = IrGetInstr(f, call)->block;
+    int args[f->nParams +1];
+    for (int p = 0; p < f->nParams; p++) args[p] = IrGetArg(f, call, p);
+    IrRemoveInstr(f, IrGetTerminator(f, block));
+    IrRemoveInstr(f, call);
+    IrSetTargets(f, IrAddInstr(f, block, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+    for (int p = 0; p < f->nParams; p++) {
+        if (phis[p] != IR_NONE) IrAddArg(f, phis[p], args[p]);
+    }
+}
+
+//self tail calls become a loop, the others jump to the callee reusing the frame
+bool OptTailCalls(struct irFunc* f) {
+    bool changed = false;
+    for (int i = 0; i < f->instrs.len; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->op != IR_CALL || in->val != IR_CALL_TAIL || (in->block != IR_NONE && tailCallOf(f, in->block) == i)) continue;
+        in->val = IR_CALL_NORMAL;
+        changed = true;
+    }
+    changed |= tailDuplicateRets(f);
+
+    int header = IR_NONE;
+    int phis[f->nParams +1];
+    for (int b = 0; b < f->blocks.len; b++) {
+        int call = tailCallOf(f, b);
+        if (call == IR_NONE || tailKept(f, call) != TAIL_KEPT_NONE) continue;
+        struct irInstr* in = IrGetInstr(f, call);
+        if (tailOrigin(in->var) != tailOrigin(f->func)) {
+            changed |= in->val != IR_CALL_TAIL;
+            in->val = IR_CALL_TAIL;
+            continue;
+        }
+        if (header == IR_NONE) header = tailLoopHeader(f, phis);
+        tailJump(f, call, header, phis);
+        changed = true;
+    }
+    return changed;
+}
+
+void OptTailReport(struct list* funcs, FILE* stream) {
+    int nKept = 0;
+    for (int i = 0; i < funcs->len; i++) {
+        struct irFunc* f = ((struct optFunc*)ListGetIdx(funcs, i))->func->ir;
+        for (int b = 0; f && b < f->blocks.len; b++) {
+            int call = tailCallOf(f, b);
+            if (call == IR_NONE || IrGetInstr(f, call)->val == IR_CALL_TAIL) continue;
+            fputs("tail call kept in ", stream);
+            StrPrint(f->func->name, stream);
+            fprintf(stream, ", %%%d in b%d: %s\n", call, b, tailKeptReasons[tailKept(f, call)]);
+            nKept++;
+        }
+    }
+    fprintf(stream, "%d tail calls kept\n", nKept);
+}
+
+//sum(n, acc) returns acc if n is 0, else sum(n - 1, acc + n)
+TEST(OptTailSelf) {
+    TypeId i32 = TypeVanillaId(BASETYPE_INT32);
+    struct type types[2] = {TypeVanilla(BASETYPE_INT32), TypeVanilla(BASETYPE_INT32)};
+    struct var func;
+    struct irFunc* f = IrTestFunc(&func, "sum", &types[0], types, 2);
+    int done = IrAddBlock(f);
+    int recurse = IrAddBlock(f);
+    int n = IrAddInstr(f, 0, IR_PARAM, i32);
+    int acc = IrAddInstr(f, 0, IR_PARAM, i32);
+    IrGetInstr(f, acc)->val = 1;
+    int zero = IrAddInstr(f, 0, IR_CONST, i32);
+    int one = IrAddInstr(f, 0, IR_CONST, i32);
+    IrGetInstr(f, one)->val = 1;
+    int cond = IrAddInstr(f, 0, IR_OPERATION, TypeVanillaId(BASETYPE_BOOL));
+    IrGetInstr(f, cond)->opType = OPERATION_EQUALS;
+    IrAddArg(f, cond, n);
+    IrAddArg(f, cond, zero);
+    int condBr = IrAddInstr(f, 0, IR_CONDBR, TYPE_ID_NONE);
+    IrAddArg(f, condBr, cond);
+    IrSetTargets(f, condBr, done, recurse);
+    IrAddArg(f, IrAddInstr(f, done, IR_RET, TYPE_ID_NONE), acc);
+
+    int ops[2];
+    enum operation opTypes[2] = {OPERATION_SUB, OPERATION_ADD};
+    for (int i = 0; i < 2; i++) {
+        ops[i] = IrAddInstr(f, recurse, IR_OPERATION, i32);
+        IrGetInstr(f, ops[i])->opType = opTypes[i];
+        IrAddArg(f, ops[i], i == 0 ? n : acc);
+        IrAddArg(f, ops[i], i == 0 ? one : n);
+    }
+    int call = IrAddInstr(f, recurse, IR_CALL, i32);
+    IrGetInstr(f, call)->var = &func;
+    IrAddArg(f, call, ops[0]);
+    IrAddArg(f, call, ops[1]);
+    IrAddArg(f, IrAddInstr(f, recurse, IR_RET, TYPE_ID_NONE), call);
+
+    bool passed = IrTestPassConverges(f, OptTailCalls);
+    passed = passed && IrGetInstr(f, call)->block == IR_NONE && IrGetInstr(f, n)->block == 0;
+    passed = passed && IrGetInstr(f, IrGetArg(f, ops[0], 0))->op == IR_PHI;
+    IrTestFuncDestroy(&func);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//sumDown of testopt.olang returns a call of itself, even at -O0 the call becomes a jump back with a phi per param
+TEST(OptTailSelfSource) {
+    bool passed;
+    struct list program = IrTestCheckFile("testopt.olang", OPT_LEVEL_0, false, &passed);
+    struct optFunc* sumDown = passed ? IrTestFind(&program, "sumDown") : NULL;
+    passed = sumDown && IrTestCount(sumDown->func->ir, IR_CALL) == 0 && IrTestCount(sumDown->func->ir, IR_PHI) == 2;
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
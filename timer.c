@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "timer.h"
+#include "list.h"
+#include "util.h"
+
+struct timerEvent {
+    char* phase;
+    struct str detail;
+    int tid;
+    long long startNs; //since TimerEnable
+    long long durNs;
+    long long selfNs; //durNs without nested scopes of the same thread
+};
+
+struct timerScope {
+    char* phase;
+    struct str detail;
+    long long startNs;
+    long long childNs;
+};
+
+#define TIMER_MAX_DEPTH 64
+
+static bool timerEnabled = false;
+static long long timerStartNs;
+static pthread_mutex_t timerLock = PTHREAD_MUTEX_INITIALIZER;
+static struct list timerEvents; //struct timerEvent; in the order the scopes ended
+static atomic_int timerNThreads = 0;
+static _Thread_local int timerTid = -1; //threads get a track once they start their first scope
+static _Thread_local struct timerScope timerStack[TIMER_MAX_DEPTH];
+static _Thread_local int timerDepth = 0;
+
+long long timerNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void TimerEnable() {
+    timerEvents = ListInit(sizeof(struct timerEvent));
+    timerStartNs = timerNowNs();
+    timerEnabled = true;
+}
+
+void TimerStart(char* phase, struct str detail) {
+    if (!timerEnabled) return;
+    if (timerDepth >= TIMER_MAX_DEPTH) ErrorBugFound();
+    if (timerTid == -1) timerTid = atomic_fetch_add(&timerNThreads, 1);
+    struct timerScope* scope = &timerStack[timerDepth++];
+    scope->phase = phase;
+    scope->detail = detail;
+    scope->childNs = 0;
+    scope->startNs = timerNowNs() - timerStartNs;
+}
+
+void TimerStop() {
+    if (!timerEnabled) return;
+    long long endNs = timerNowNs() - timerStartNs;
+    if (timerDepth <= 0) ErrorBugFound();
+    struct timerScope* scope = &timerStack[--timerDepth];
+    struct timerEvent e = {scope->phase, scope->detail, timerTid, scope->startNs, endNs - scope->startNs, 0};
+    e.selfNs = e.durNs - scope->childNs;
+    if (timerDepth > 0) timerStack[timerDepth -1].childNs += e.durNs;
+
+    pthread_mutex_lock(&timerLock);
+    ListAdd(&timerEvents, &e);
+    pthread_mutex_unlock(&timerLock);
+}
+
+struct timerPhaseTotal {
+    char* phase;
+    int count;
+    long long selfNs;
+};
+
+int timerPhaseTotalOrder(const void* a, const void* b) {
+    long long na = ((struct timerPhaseTotal*)a)->selfNs;
+    long long nb = ((struct timerPhaseTotal*)b)->selfNs;
+    return (na < nb) - (na > nb);
+}
+
+void TimerReport(FILE* stream) {
+    if (!timerEnabled) return;
+    pthread_mutex_lock(&timerLock);
+    struct timerPhaseTotal* totals = MallocOrCrash(timerEvents.len * sizeof(struct timerPhaseTotal) +1);
+    int nTotals = 0;
+    long long sumNs = 0;
+    for (int i = 0; i < timerEvents.len; i++) {
+        struct timerEvent* e = ListGetIdx(&timerEvents, i);
+        int j = 0;
+        while (j < nTotals && strcmp(totals[j].phase, e->phase) != 0) j++;
+        if (j == nTotals) totals[nTotals++] = (struct timerPhaseTotal){e->phase, 0, 0};
+        totals[j].count++;
+        totals[j].selfNs += e->selfNs;
+        sumNs += e->selfNs;
+    }
+    pthread_mutex_unlock(&timerLock);
+    qsort(totals, nTotals, sizeof(struct timerPhaseTotal), timerPhaseTotalOrder);
+
+    //with parallel phases the sum is cpu time rather than wall time
+    fprintf(stream, "%-28s %8s %12s %7s\n", "phase", "count", "time (ms)", "%");
+    for (int i = 0; i < nTotals; i++) {
+        fprintf(stream, "%-28s %8d %12.3f %7.1f\n", totals[i].phase, totals[i].count, totals[i].selfNs / 1e6,
+            sumNs ? 100.0 * totals[i].selfNs / sumNs : 0.0);
+    }
+    fprintf(stream, "%-28s %8s %12.3f\n", "total", "", sumNs / 1e6);
+    free(totals);
+}
+
+void timerWriteJsonStr(FILE* fp, char* ptr, int len) {
+    fputc('"', fp);
+    for (int i = 0; i < len; i++) {
+        if (ptr[i] == '"' || ptr[i] == '\\') fputc('\\', fp);
+        if ((unsigned char)ptr[i] < 0x20) fprintf(fp, "\\u%04x", ptr[i]);
+        else fputc(ptr[i], fp);
+    }
+    fputc('"', fp);
+}
+
+//timestamps are in microseconds, complete events ("X") nest on a track by their time ranges
+bool TimerWriteTrace(char* fileName) {
+    FILE* fp = fopen(fileName, "w");
+    if (!fp) return false;
+    fputs("{\"traceEvents\":[\n", fp);
+    int nThreads = atomic_load(&timerNThreads);
+    for (int i = 0; i < nThreads; i++) {
+        if (i > 0) fputs(",\n", fp);
+        fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", i);
+        if (i == 0) fputs("\"main\"}}", fp);
+        else fprintf(fp, "\"worker %d\"}}", i);
+    }
+    pthread_mutex_lock(&timerLock);
+    for (int i = 0; timerEnabled && i < timerEvents.len; i++) {
+        struct timerEvent* e = ListGetIdx(&timerEvents, i);
+        fputs(",\n{\"name\":", fp);
+        timerWriteJsonStr(fp, e->phase, strlen(e->phase));
+        fprintf(fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", e->tid, e->startNs / 1e3, e->durNs / 1e3);
+        if (e->detail.len) {
+            fputs(",\"args\":{\"detail\":", fp);
+            timerWriteJsonStr(fp, e->detail.ptr, e->detail.len);
+            fputc('}', fp);
+        }
+        fputc('}', fp);
+    }
+    pthread_mutex_unlock(&timerLock);
+    fputs("\n]}\n", fp);
+    fclose(fp);
+    return true;
+}
+
+static inline void timerTestSpin(long long ns) {
+    long long end = timerNowNs() + ns;
+    while (timerNowNs() < end);
+}
+
+//inner runs for 3 ms inside outer, which itself spins 2 ms before and 1 ms after it,
+//inner ends first and lies within outer, whose self time is its duration without inner's
+TEST(TimerNestsScopes) {
+    TimerEnable();
+    TimerStart("outer", StrFromCStr(""));
+    timerTestSpin(2000000);
+    TimerStart("inner", StrFromCStr(""));
+    timerTestSpin(3000000);
+    TimerStop();
+    timerTestSpin(1000000);
+    TimerStop();
+    bool passed = timerEvents.len == 2 && timerDepth == 0;
+    struct timerEvent* inner = passed ? ListGetIdx(&timerEvents, 0) : NULL;
+    struct timerEvent* outer = passed ? ListGetIdx(&timerEvents, 1) : NULL;
+    passed = passed && strcmp(inner->phase, "inner") == 0 && strcmp(outer->phase, "outer") == 0;
+    passed = passed && inner->startNs >= outer->startNs + 2000000 && inner->startNs + inner->durNs <= outer->startNs + outer->durNs;
+    passed = passed && inner->durNs >= 3000000 && inner->selfNs == inner->durNs;
+    passed = passed && outer->selfNs == outer->durNs - inner->durNs && outer->selfNs >= 3000000;
+
+    //the other tests run untimed
+    ListDestroy(timerEvents);
+    timerEnabled = false;
+    timerTid = -1;
+    atomic_store(&timerNThreads, 0);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
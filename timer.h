@@ -0,0 +1,16 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "util.h"
+
+//compiler phases are timed with a monotonic clock once enabled, otherwise starting and stopping does nothing
+//scopes nest per thread, TimerStop ends the scope the calling thread started last
+void TimerEnable(); //before any other thread is started
+void TimerStart(char* phase, struct str detail); //detail, e.g. the file name, may be empty and must outlive the timer
+void TimerStop();
+void TimerReport(FILE* stream); //time spent in each phase, excluding the phases nested in it
+bool TimerWriteTrace(char* fileName); //as Chrome trace event JSON with one track per thread, false if not writable
+
+#endif //TIMER_H
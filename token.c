@@ -2,22 +2,36 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "token.h"
 #include "util.h"
 #include "list.h"
+#include "timer.h"
+#include "errmsg.h"
 
-static int tokIdCtr = 0;
+static atomic_int tokIdCtr = 0; //tokens are merged while function bodies are checked in parallel
 
 int tokIdCtrCount() {
-    return tokIdCtr++;
+    return atomic_fetch_add_explicit(&tokIdCtr, 1, memory_order_relaxed);
 }
 
+//precomputed when tokenizing so error recovery can skip in constant time
+//indexes equal to the number of tokens point at EOF
+struct tokenJumps {
+    int match; //matching bracket of the same kind, -1 for non brackets and unmatched brackets
+    int curlyClose; //first curly close at or after the token that is not part of a nested curly pair
+    int nextSColon;
+    int nextCurlyO;
+};
+
 struct tokenContext {
     struct str fileName;
-    struct list chars;
+    struct list chars; //ends with '\0'
+    int charCursor;
     int charLineNr;
     struct list tokens;
-
+    int cursor; //index of the next token to feed, EOF is fed once it reaches the number of tokens
+    struct list jumps; //struct tokenJumps, one per token
 };
 
 bool isValidChar(char c) {
@@ -29,37 +43,54 @@ bool isValidChar(char c) {
 }
 
 char feedChar(TokenCtx tc) {
-    char c = *(char*)ListFeed(&tc->chars);
+    char c = *(char*)ListGetIdx(&tc->chars, tc->charCursor);
+    if (c == '\0') return c; //stays at the end
+    tc->charCursor++;
     if (c == '\n') tc->charLineNr++;
     return c;
 }
 
+//must only undo a feedChar that did not return '\0'
 void unfeedChar(TokenCtx tc) {
-    ListUnfeed(&tc->chars);
-    if (tc->chars.len <= 0) ErrorBugFound();
-    if (*(char*)ListPeek(&tc->chars) == '\n') tc->charLineNr--;
+    if (tc->charCursor <= 0) ErrorBugFound();
+    tc->charCursor--;
+    if (*(char*)ListGetIdx(&tc->chars, tc->charCursor) == '\n') tc->charLineNr--;
 }
 
 bool tryFeedChar(TokenCtx tc, char c) {
     char fed = feedChar(tc);
     if (fed != c) {
-        unfeedChar(tc);
+        if (fed != '\0') unfeedChar(tc);
         return false;
     }
     return true;
 }
 
+//the token spans the last fed char
+void errorLastFedChar(TokenCtx tc, char* errMsg) {
+    struct token tok = (struct token){0};
+    int idx = tc->charCursor > 0 ? tc->charCursor -1 : 0;
+    tok.str = Str(ListGetIdx(&tc->chars, idx), 1);
+    tok.lineNr = tc->charLineNr;
+    tok.owner = tc;
+    ErrMsgTok(tok, errMsg);
+}
+
 void readChars(TokenCtx tc) {
     char buffer[tc->fileName.len +1];
     StrGetAsCStr(tc->fileName, buffer);
     FILE* fp = fopen(buffer, "r");
-    if (!fp) ErrorUnableToOpenFile(buffer);
+    if (!fp) ErrMsgFatal(UNABLE_TO_OPEN_FILE);
 
     int c;
-    while ((c = fgetc(fp)) != EOF) ListAdd(&tc->chars, &c);
-    c = '\0';
-    ListAdd(&tc->chars, &c);
+    while ((c = fgetc(fp)) != EOF) {
+        char ch = c;
+        ListAdd(&tc->chars, &ch);
+    }
+    char end = '\0';
+    ListAdd(&tc->chars, &end);
     tc->charLineNr = 1;
+    fclose(fp);
 }
 
 bool isLetter(char c) {
@@ -116,14 +147,14 @@ void tokenizeEscapeChar(TokenCtx tc, bool inString) {
     else if (c == '\\');
     else if (inString && c == '\"');
     else if (!inString && c == '\'');
-    else SyntaxErrorLastFedChar(tc, INVALID_ESCAPE_CHAR);
+    else errorLastFedChar(tc, INVALID_ESCAPE_CHAR);
 }
 
 bool tokenizeCharInStringLiteral(TokenCtx tc) {
     char c = feedChar(tc);
     if (c == '\\') tokenizeEscapeChar(tc, true);
-    else if (c == '\n') {
-        SyntaxErrorLastFedChar(tc, NEWLINE_BEFORE_CLOSING_OF_CHAR_LITERAL);
+    else if (c == '\n' || c == '\0') {
+        errorLastFedChar(tc, NEWLINE_BEFORE_CLOSING_OF_CHAR_LITERAL);
         return true;
     }
     else if (c == '"') return true;
@@ -134,13 +165,14 @@ bool tokenizeCharInStringLiteral(TokenCtx tc) {
 void tokenizeCharLiteral(TokenCtx tc) {
     char c = feedChar(tc);
     switch (c) {
-        case '\n': SyntaxErrorLastFedChar(tc, NEWLINE_BEFORE_CLOSING_OF_CHAR_LITERAL); return;
-        case '\'': SyntaxErrorLastFedChar(tc, EMPTY_CHAR_LITERAL); return;
+        case '\0':
+        case '\n': errorLastFedChar(tc, NEWLINE_BEFORE_CLOSING_OF_CHAR_LITERAL); return;
+        case '\'': errorLastFedChar(tc, EMPTY_CHAR_LITERAL); return;
         case '\\': tokenizeEscapeChar(tc, false); break;
         default: break;
     }
     if (feedChar(tc) == '\'') return;
-    SyntaxErrorLastFedChar(tc, EXPECTED_CLOSING_CHAR_LITERAL);
+    errorLastFedChar(tc, EXPECTED_CLOSING_CHAR_LITERAL);
     char* str = "'\n";
     feedUntilIncludingOneOfCharsOrEOF(tc, str);
 }
@@ -150,117 +182,117 @@ void tokenizeStringLiteral(TokenCtx tc) {
 }
 
 enum tokenType tokenizePlus(TokenCtx tc) {
-    if (tryFeedChar(tc, '+')) return TOKEN_INCREMENT;
-    if (tryFeedChar(tc, '=')) return TOKEN_ASSIGNMENT_ADD;
-    return TOKEN_ADD;
+    if (tryFeedChar(tc, '+')) return TOK_INC;
+    if (tryFeedChar(tc, '=')) return TOK_ASS_ADD;
+    return TOK_ADD;
 }
 
 enum tokenType tokenizeHyphen(TokenCtx tc) {
-    if (tryFeedChar(tc, '-')) return TOKEN_DECREMENT;
-    if (tryFeedChar(tc, '=')) return TOKEN_ASSIGNMENT_SUB;
-    return TOKEN_SUB;
+    if (tryFeedChar(tc, '-')) return TOK_DEC;
+    if (tryFeedChar(tc, '=')) return TOK_ASS_SUB;
+    return TOK_SUB;
 }
 
 enum tokenType tokenizeEqualSign(TokenCtx tc) {
-    enum tokenType type = TOKEN_ASSIGNMENT;
-    if (tryFeedChar(tc, '=')) type = TOKEN_EQUAL;
-    if (tryFeedChar(tc, '=')) type = TOKEN_ASSIGNMENT_EQUAL;
-    return type;
+    if (tryFeedChar(tc, '=')) return TOK_EQ;
+    return TOK_ASS;
 }
 
 enum tokenType tokenizeAsterisk(TokenCtx tc) {
-    if (tryFeedChar(tc, '=')) return TOKEN_ASSIGNMENT_MUL;
-    return TOKEN_MUL;
+    if (tryFeedChar(tc, '=')) return TOK_ASS_MUL;
+    return TOK_MUL;
 }
 
 enum tokenType tokenizeSlash(TokenCtx tc) {
-    if (tryFeedChar(tc, '=')) return TOKEN_ASSIGNMENT_DIV;
-    return TOKEN_DIV;
+    if (tryFeedChar(tc, '=')) return TOK_ASS_DIV;
+    return TOK_DIV;
 }
 
 enum tokenType tokenizePercentSign(TokenCtx tc) {
-    if (tryFeedChar(tc, '=')) return TOKEN_ASSIGNMENT_MODULO;
-    return TOKEN_MODULO;
+    if (tryFeedChar(tc, '=')) return TOK_ASS_MOD;
+    return TOK_MOD;
 }
 
 enum tokenType tokenizeExclamation(TokenCtx tc) {
-    enum tokenType type = TOKEN_NOT;
-    if (tryFeedChar(tc, '=')) type = TOKEN_NOT_EQUAL;
-    if (tryFeedChar(tc, '=')) type = TOKEN_ASSIGNMENT_NOT_EQUAL;
-    return type;
+    if (tryFeedChar(tc, '=')) return TOK_NEQ;
+    return TOK_NOT;
 }
 
 enum tokenType tokenizeLessThan(TokenCtx tc) {
-    enum tokenType type = TOKEN_LESS_THAN;
-    if (tryFeedChar(tc, '=')) return TOKEN_LESS_THAN_OR_EQUAL;
-    if (tryFeedChar(tc, '<')) type = TOKEN_BITSHIFT_LEFT;
-    if (tryFeedChar(tc, '=')) type = TOKEN_ASSIGNMENT_BITSHIFT_LEFT;
+    enum tokenType type = TOK_LST;
+    if (tryFeedChar(tc, '=')) return TOK_LSE;
+    if (tryFeedChar(tc, '<')) type = TOK_BTSFT_L;
+    if (tryFeedChar(tc, '=')) type = TOK_ASS_BTSFT_L;
     return type;
 }
 
 enum tokenType tokenizeGreaterThan(TokenCtx tc) {
-    enum tokenType type = TOKEN_GREATER_THAN;
-    if (tryFeedChar(tc, '=')) return TOKEN_GREATER_THAN_OR_EQUAL;
-    if (tryFeedChar(tc, '>')) type = TOKEN_BITSHIFT_RIGHT;
-    if (tryFeedChar(tc, '=')) type = TOKEN_ASSIGNMENT_BITSHIFT_RIGHT;
+    enum tokenType type = TOK_GRT;
+    if (tryFeedChar(tc, '=')) return TOK_GRE;
+    if (tryFeedChar(tc, '>')) type = TOK_BTSFT_R;
+    if (tryFeedChar(tc, '=')) type = TOK_ASS_BTSFT_R;
     return type;
 }
 
 enum tokenType tokenizeAmpersand(TokenCtx tc) {
-    enum tokenType type = TOKEN_BITWISE_AND;
-    if (tryFeedChar(tc, '=')) return TOKEN_ASSIGNMENT_BITWISE_AND;
-    if (tryFeedChar(tc, '&')) type = TOKEN_AND;
-    if (tryFeedChar(tc, '=')) type = TOKEN_ASSIGNMENT_AND;
+    enum tokenType type = TOK_BTWSE_AND;
+    if (tryFeedChar(tc, '=')) return TOK_ASS_BTWSE_AND;
+    if (tryFeedChar(tc, '&')) type = TOK_AND;
+    if (tryFeedChar(tc, '=')) type = TOK_ASS_AND;
     return type;
 }
 
 enum tokenType tokenizeVBar(TokenCtx tc) {
-    enum tokenType type = TOKEN_BITWISE_OR;
-    if (tryFeedChar(tc, '=')) return TOKEN_ASSIGNMENT_BITWISE_OR;
-    if (tryFeedChar(tc, '|')) type = TOKEN_OR;
-    if (tryFeedChar(tc, '=')) type = TOKEN_ASSIGNMENT_OR;
+    enum tokenType type = TOK_BTWSE_OR;
+    if (tryFeedChar(tc, '=')) return TOK_ASS_BTWSE_OR;
+    if (tryFeedChar(tc, '|')) type = TOK_OR;
+    if (tryFeedChar(tc, '=')) type = TOK_ASS_OR;
     return type;
 }
 
 enum tokenType tokenizeCaret(TokenCtx tc) {
-    enum tokenType type = TOKEN_BITWISE_XOR;
-    if (tryFeedChar(tc, '=')) return TOKEN_ASSIGNMENT_BITWISE_XOR;
-    if (tryFeedChar(tc, '^')) type = TOKEN_XOR;
-    if (tryFeedChar(tc, '=')) type = TOKEN_ASSIGNMENT_XOR;
+    enum tokenType type = TOK_BTWSE_XOR;
+    if (tryFeedChar(tc, '=')) return TOK_ASS_BTWSE_XOR;
+    if (tryFeedChar(tc, '^')) type = TOK_XOR;
+    if (tryFeedChar(tc, '=')) type = TOK_ASS_XOR;
     return type;
 }
 
-bool isSubIdentifer(char* start, char* subId) {
-    int subIdLen = strlen(subId);
-    if (!strncmp(start, subId, subIdLen)) return true;
-    return false;
+//the whole identifier must be the keyword, so iffy is not an if
+bool isKeyword(char* start, int len, char* keyword) {
+    return (int)strlen(keyword) == len && !strncmp(start, keyword, len);
 }
 
 enum tokenType tokenizeIdentifier(TokenCtx tc) {
-    char* start = (char*)tc->chars.ptr + tc->chars.cursor -1;
-    while (isIdentifierBodyChar(feedChar(tc)));
-    unfeedChar(tc);
-
-    if (isSubIdentifer(start, "if")) return TOKEN_IF;
-    else if (isSubIdentifer(start, "else")) return TOKEN_ELSE;
-    else if (isSubIdentifer(start, "for")) return TOKEN_FOR;
-    else if (isSubIdentifer(start, "compif")) return TOKEN_COMPIF;
-    else if (isSubIdentifer(start, "compelse")) return TOKEN_COMPELSE;
-    else if (isSubIdentifer(start, "return")) return TOKEN_RETURN;
-    else if (isSubIdentifer(start, "exit")) return TOKEN_EXIT;
-    else if (isSubIdentifer(start, "match")) return TOKEN_MATCH;
-    else if (isSubIdentifer(start, "nomatch")) return TOKEN_NOMATCH;
-    else if (isSubIdentifer(start, "case")) return TOKEN_CASE;
-    else if (isSubIdentifer(start, "type")) return TOKEN_TYPE;
-    else if (isSubIdentifer(start, "struct")) return TOKEN_STRUCT;
-    else if (isSubIdentifer(start, "vocab")) return TOKEN_VOCAB;
-    else if (isSubIdentifer(start, "error")) return TOKEN_ERROR;
-    else if (isSubIdentifer(start, "func")) return TOKEN_FUNC;
-    else if (isSubIdentifer(start, "mut")) return TOKEN_MUT;
-    else if (isSubIdentifer(start, "import")) return TOKEN_IMPORT;
-    else if (isSubIdentifer(start, "true")) return TOKEN_BOOL_LITERAL;
-    else if (isSubIdentifer(start, "false")) return TOKEN_BOOL_LITERAL;
-    return TOKEN_IDENTIFIER;
+    char* start = (char*)ListGetIdx(&tc->chars, tc->charCursor -1);
+    char c;
+    while (isIdentifierBodyChar(c = feedChar(tc)));
+    if (c != '\0') unfeedChar(tc);
+    int len = (char*)ListGetIdx(&tc->chars, tc->charCursor) - start;
+
+    if (isKeyword(start, len, "if")) return TOK_IF;
+    else if (isKeyword(start, len, "else")) return TOK_ELSE;
+    else if (isKeyword(start, len, "for")) return TOK_FOR;
+    else if (isKeyword(start, len, "compif")) return TOK_COMPIF;
+    else if (isKeyword(start, len, "compelse")) return TOK_COMPELSE;
+    else if (isKeyword(start, len, "try")) return TOK_TRY;
+    else if (isKeyword(start, len, "catch")) return TOK_CATCH;
+    else if (isKeyword(start, len, "return")) return TOK_RET;
+    else if (isKeyword(start, len, "exit")) return TOK_EXIT;
+    else if (isKeyword(start, len, "match")) return TOK_MATCH;
+    else if (isKeyword(start, len, "nomatch")) return TOK_NOMATCH;
+    else if (isKeyword(start, len, "case")) return TOK_CASE;
+    else if (isKeyword(start, len, "type")) return TOK_TYPE;
+    else if (isKeyword(start, len, "struct")) return TOK_STRUCT;
+    else if (isKeyword(start, len, "vocab")) return TOK_VOCAB;
+    else if (isKeyword(start, len, "error")) return TOK_ERROR;
+    else if (isKeyword(start, len, "func")) return TOK_FUNC;
+    else if (isKeyword(start, len, "mut")) return TOK_MUT;
+    else if (isKeyword(start, len, "import")) return TOK_IMPORT;
+    else if (isKeyword(start, len, "as")) return TOK_AS;
+    else if (isKeyword(start, len, "true")) return TOK_BOOL_LIT;
+    else if (isKeyword(start, len, "false")) return TOK_BOOL_LIT;
+    return TOK_IDEN;
 }
 
 enum tokenType tokenizeNumberLiteral(TokenCtx tc) {
@@ -270,29 +302,29 @@ enum tokenType tokenizeNumberLiteral(TokenCtx tc) {
     while (isDigit(c) || c == '.') {
         if (c == '.') {
             nDots++;
-            if (nDots > 1) SyntaxErrorLastFedChar(tc, MULTIPLE_DECIMAL_POINTS);
+            if (nDots > 1) errorLastFedChar(tc, MULTIPLE_DECIMAL_POINTS);
             lastWasDecimal = true;
         }
         else lastWasDecimal = false;
         c = feedChar(tc);
     }
-    unfeedChar(tc);
-    if (lastWasDecimal) SyntaxErrorLastFedChar(tc, LAST_WAS_DECIMAL_POINT);
-    if (nDots == 0) return TOKEN_INT_LITERAL;
-    return TOKEN_FLOAT_LITERAL;
+    if (c != '\0') unfeedChar(tc);
+    if (lastWasDecimal) errorLastFedChar(tc, LAST_WAS_DECIMAL_POINT);
+    if (nDots == 0) return TOK_INT_LIT;
+    return TOK_FLOAT_LIT;
 }
 
 struct token tokenizeToken(TokenCtx tc) {
-    struct token tok;
-    tok.str.ptr = (char*)tc->chars.ptr + tc->chars.cursor;
+    struct token tok = (struct token){0};
+    tok.str.ptr = ListGetIdx(&tc->chars, tc->charCursor);
     tok.lineNr = tc->charLineNr;
 
     char c = feedChar(tc);
     if (isLetter(c) || c == '_') tok.type = tokenizeIdentifier(tc);
     else if (isDigit(c)) tok.type = tokenizeNumberLiteral(tc);
     else switch (c) {
-        case '\'': tok.type = TOKEN_CHAR_LITERAL; tokenizeCharLiteral(tc); break;
-        case '"': tok.type = TOKEN_STRING_LITERAL; tokenizeStringLiteral(tc); break;
+        case '\'': tok.type = TOK_CHAR_LIT; tokenizeCharLiteral(tc); break;
+        case '"': tok.type = TOK_STR_LIT; tokenizeStringLiteral(tc); break;
         case '+': tok.type = tokenizePlus(tc); break;
         case '-': tok.type = tokenizeHyphen(tc); break;
         case '=': tok.type = tokenizeEqualSign(tc); break;
@@ -305,44 +337,92 @@ struct token tokenizeToken(TokenCtx tc) {
         case '&': tok.type = tokenizeAmpersand(tc); break;
         case '|': tok.type = tokenizeVBar(tc); break;
         case '^': tok.type = tokenizeCaret(tc); break;
-        case ',': tok.type = TOKEN_COMMA; break;
-        case '.': tok.type = TOKEN_DOT; break;
-        case ';': tok.type = TOKEN_SEMICOLON; break;
-        case '?': tok.type = TOKEN_QUESTIONMARK; break;
-        case '~': tok.type = TOKEN_BITWISE_COMPLEMENT; break;
-        case '(': tok.type = TOKEN_PAREN_OPEN; break;
-        case ')': tok.type = TOKEN_PAREN_CLOSE; break;
-        case '[': tok.type = TOKEN_SQUARE_OPEN; break;
-        case ']': tok.type = TOKEN_SQUARE_CLOSE; break;
-        case '{': tok.type = TOKEN_CURLY_OPEN; break;
-        case '}': tok.type = TOKEN_CURLY_CLOSE; break;
-        default: SyntaxErrorLastFedChar(tc, UNKNOWN_SYMBOL);
+        case ',': tok.type = TOK_COMMA; break;
+        case '.': tok.type = TOK_DOT; break;
+        case ';': tok.type = TOK_SCOLON; break;
+        case '?': tok.type = TOK_QSNTMRK; break;
+        case '~': tok.type = TOK_BTWSE_INV; break;
+        case '(': tok.type = TOK_PAREN_O; break;
+        case ')': tok.type = TOK_PAREN_C; break;
+        case '[': tok.type = TOK_SQUARE_O; break;
+        case ']': tok.type = TOK_SQUARE_C; break;
+        case '{': tok.type = TOK_CURLY_O; break;
+        case '}': tok.type = TOK_CURLY_C; break;
+        default: errorLastFedChar(tc, UNKNOWN_SYMBOL); //stays TOK_NONE, which no rule expects
     }
-    tok.str.len = (char*)tc->chars.ptr + tc->chars.cursor - tok.str.ptr;
+    tok.str.len = (char*)ListGetIdx(&tc->chars, tc->charCursor) - tok.str.ptr;
     tok.owner = tc;
     tok.tokId = tokIdCtrCount();
     return tok;
 }
 
 void tokenizeTokensFromChars(TokenCtx tc) {
-    while (*(char*)ListPeek(&tc->chars) != '\0') {
-        if (!findNextTokStart(tc)) break;
+    while (findNextTokStart(tc)) {
         struct token tok = tokenizeToken(tc);
         ListAdd(&tc->tokens, &tok);
     }
 }
 
+void matchBrackets(TokenCtx tc, enum tokenType open, enum tokenType close) {
+    struct list openIdxs = ListInit(sizeof(int));
+    for (int i = 0; i < tc->tokens.len; i++) {
+        enum tokenType type = ((struct token*)ListGetIdx(&tc->tokens, i))->type;
+        if (type == open) ListAdd(&openIdxs, &i);
+        else if (type == close && openIdxs.len > 0) {
+            int openIdx = *(int*)ListGetIdx(&openIdxs, openIdxs.len -1);
+            ListRetract(&openIdxs, openIdxs.len -1);
+            ((struct tokenJumps*)ListGetIdx(&tc->jumps, openIdx))->match = i;
+            ((struct tokenJumps*)ListGetIdx(&tc->jumps, i))->match = openIdx;
+        }
+    }
+    ListDestroy(openIdxs);
+}
+
+void computeTokenJumps(TokenCtx tc) {
+    int nTokens = tc->tokens.len;
+    struct tokenJumps empty = (struct tokenJumps){-1, nTokens, nTokens, nTokens};
+    for (int i = 0; i < nTokens; i++) ListAdd(&tc->jumps, &empty);
+    //each kind is matched on its own so a stray parenthesis does not break curly matching
+    matchBrackets(tc, TOK_PAREN_O, TOK_PAREN_C);
+    matchBrackets(tc, TOK_SQUARE_O, TOK_SQUARE_C);
+    matchBrackets(tc, TOK_CURLY_O, TOK_CURLY_C);
+
+    int sColon = nTokens;
+    int curlyO = nTokens;
+    for (int i = nTokens -1; i >= 0; i--) {
+        enum tokenType type = ((struct token*)ListGetIdx(&tc->tokens, i))->type;
+        struct tokenJumps* j = ListGetIdx(&tc->jumps, i);
+        if (type == TOK_SCOLON) sColon = i;
+        else if (type == TOK_CURLY_O) curlyO = i;
+        j->nextSColon = sColon;
+        j->nextCurlyO = curlyO;
+
+        if (type == TOK_CURLY_C) j->curlyClose = i;
+        else if (type == TOK_CURLY_O) {
+            if (j->match != -1 && j->match +1 < nTokens) {
+                j->curlyClose = ((struct tokenJumps*)ListGetIdx(&tc->jumps, j->match +1))->curlyClose;
+            }
+        }
+        else if (i +1 < nTokens) j->curlyClose = ((struct tokenJumps*)ListGetIdx(&tc->jumps, i +1))->curlyClose;
+    }
+}
+
 TokenCtx TokenizeFile(char* fileName) {
     TokenCtx tc = MallocOrCrash(sizeof(*tc));
-    CheckAllocPtr(tc);
     *tc = (struct tokenContext){0};
     tc->chars = ListInit(sizeof(char));
     tc->tokens = ListInit(sizeof(struct token));
+    tc->jumps = ListInit(sizeof(struct tokenJumps));
     tc->charLineNr = 1;
-    tc->fileName = fileName;
+    tc->fileName = StrFromCStr(fileName);
 
+    TimerStart("read file", tc->fileName);
     readChars(tc);
+    TimerStop();
+    TimerStart("tokenize", tc->fileName);
     tokenizeTokensFromChars(tc);
+    computeTokenJumps(tc);
+    TimerStop();
     return tc;
 }
 
@@ -351,32 +431,74 @@ struct str TokenGetFileName(TokenCtx tc) {
     return tc->fileName;
 }
 
+//spans the '\0' ending the chars so errors at EOF point behind the last line
+struct token tokenEOF(TokenCtx tc) {
+    struct token tok = (struct token){0};
+    tok.type = TOK_EOF;
+    tok.str = Str(ListGetIdx(&tc->chars, tc->chars.len -1), 1);
+    tok.lineNr = tc->charLineNr;
+    tok.tokId = -1;
+    tok.owner = tc;
+    return tok;
+}
+
 struct token TokenFeed(TokenCtx tc) {
-    struct token* tokPtr = ListFeed(&tc->tokens);
-    if (!tokPtr) return TokenEOF(tc);
-    return *tokPtr;
+    int idx = tc->cursor++;
+    if (idx >= tc->tokens.len) return tokenEOF(tc);
+    return *(struct token*)ListGetIdx(&tc->tokens, idx);
 }
 
+//the jump table finds the sync tokens of the syntax rules without feeding every token in between
+//a curly close is the one ending the block the cursor is in, so an error inside nested blocks does not end the outer one
 void TokenFeedPast(TokenCtx tc, enum tokenType type) {
-    struct token tok = TokenFeed(tc);
-    while (tok.type != type && tok.type != TOKEN_EOF) tok = TokenFeed(tc);
+    int idx = TokenGetCount(tc);
+    if (tc->cursor >= idx) idx = tc->cursor;
+    else if (type == TOK_SCOLON) idx = TokenGetNextSColon(tc, tc->cursor);
+    else if (type == TOK_CURLY_O) idx = TokenGetNextCurlyO(tc, tc->cursor);
+    else if (type == TOK_CURLY_C) idx = TokenGetCurlyClose(tc, tc->cursor);
+    else {
+        for (idx = tc->cursor; idx < TokenGetCount(tc); idx++) {
+            if (((struct token*)ListGetIdx(&tc->tokens, idx))->type == type) break;
+        }
+    }
+    tc->cursor = idx +1; //past EOF if there is no such token
 }
 
 void TokenUnfeed(TokenCtx tc) {
-    ListUnfeed(&tc->tokens);
-    if (tc->tokens.len <= 0) ErrorBugFound();
+    if (tc->cursor <= 0) ErrorBugFound();
+    tc->cursor--;
 }
 
+int TokenGetStrStart(struct token tok) {
+    return tok.str.ptr - (char*)tok.owner->chars.ptr;
+}
+
+int TokenGetLineStart(TokenCtx tc, int charIdx) {
+    while (charIdx > 0 && TokenGetChar(tc, charIdx -1) != '\n') charIdx--;
+    return charIdx;
+}
+
+//the index of the newline or '\0' ending the line
+int TokenGetLineEnd(TokenCtx tc, int charIdx) {
+    while (charIdx < tc->chars.len -1 && TokenGetChar(tc, charIdx) != '\n') charIdx++;
+    return charIdx;
+}
+
+char TokenGetChar(TokenCtx tc, int charIdx) {
+    return *(char*)ListGetIdx(&tc->chars, charIdx);
+}
+
+//the merged token keeps the type of head and spans up to the end of tail
 struct token TokenMerge(struct token head, struct token tail) {
     if (head.owner != tail.owner) ErrorBugFound();
-    head.type = TOKEN_MERGE;
-    head.str = StrMerge(head.str, tail.str);
+    if (tail.str.ptr < head.str.ptr) ErrorBugFound();
+    head.str.len = tail.str.ptr + tail.str.len - head.str.ptr;
     head.tokId = tokIdCtrCount();
     return head;
 }
 
 struct token TokenMergeFromListRange(struct list l, int start, int end) {
-    if (start > end) ErrorBugFound();
+    if (start >= end) ErrorBugFound();
     if (start < 0) ErrorBugFound();
     if (end > l.len) ErrorBugFound();
     struct token head = *(struct token*)ListGetIdx(&l, start);
@@ -385,32 +507,67 @@ struct token TokenMergeFromListRange(struct list l, int start, int end) {
 }
 
 struct token TokenMergeFromList(struct list l) {
-    struct token head = *(struct token*)ListGetIdx(&l, 0);
-    struct token tail = *(struct token*)ListGetIdx(&l, l.len -1);
-    return TokenMerge(head, tail);
+    return TokenMergeFromListRange(l, 0, l.len);
+}
+
+TokenCtx TokenFork(TokenCtx tc) {
+    TokenCtx fork = MallocOrCrash(sizeof(*fork));
+    *fork = *tc;
+    return fork;
 }
 
 int TokenGetCursor(TokenCtx tc) {
-    return tc->tokens.cursor;
+    return tc->cursor;
 }
 
 void TokenSetCursor(TokenCtx tc, int cursor) {
-    ListSetCursor(&tc->tokens, cursor);
+    if (cursor < 0) ErrorBugFound();
+    tc->cursor = cursor;
 }
 
-enum tokenGetTypeFromStrCmp(char* str, char* pattern) {
-    for (int i = 0; i < strlen(pattern); i++) {
-        if (str[i] != pattern[i]) return false;
-    }
-    return true;
+int TokenGetCount(TokenCtx tc) {
+    return tc->tokens.len;
+}
+
+struct tokenJumps* getTokenJumps(TokenCtx tc, int tokIdx) { //returns NULL at EOF
+    if (tokIdx < 0) ErrorBugFound();
+    if (tokIdx >= tc->jumps.len) return NULL;
+    return ListGetIdx(&tc->jumps, tokIdx);
+}
+
+int TokenGetMatchingBracket(TokenCtx tc, int tokIdx) {
+    struct tokenJumps* j = getTokenJumps(tc, tokIdx);
+    return j ? j->match : -1;
+}
+
+int TokenGetCurlyClose(TokenCtx tc, int tokIdx) {
+    struct tokenJumps* j = getTokenJumps(tc, tokIdx);
+    return j ? j->curlyClose : tc->tokens.len;
+}
+
+int TokenGetNextSColon(TokenCtx tc, int tokIdx) {
+    struct tokenJumps* j = getTokenJumps(tc, tokIdx);
+    return j ? j->nextSColon : tc->tokens.len;
+}
+
+int TokenGetNextCurlyO(TokenCtx tc, int tokIdx) {
+    struct tokenJumps* j = getTokenJumps(tc, tokIdx);
+    return j ? j->nextCurlyO : tc->tokens.len;
+}
+
+//str may continue with more space separated words, pattern must match the first one as a whole
+bool tokenGetTypeFromStrCmp(char* str, char* pattern) {
+    int len = strlen(pattern);
+    if (strncmp(str, pattern, len)) return false;
+    return str[len] == ' ' || str[len] == '\0';
 }
 
 enum tokenType TokenGetTypeFromStr(char* str) {
-    if (tokenGetTypeFromStrCmp(str, "TOKEN_EOF")) return TOKEN_EOF;
+    if (tokenGetTypeFromStrCmp(str, "TOK_EOF")) return TOK_EOF;
     if (tokenGetTypeFromStrCmp(str, "TOK_BOOL_LIT")) return TOK_BOOL_LIT;
     if (tokenGetTypeFromStrCmp(str, "TOK_INT_LIT")) return TOK_INT_LIT;
-    if (tokenGetTypeFromStrCmp(str, "TOK_FLOAT_LIT")) return TOK_INT_LIT;
-    if (tokenGetTypeFromStrCmp(str, "TOK_CHAR_LIT")) return TOK_CHAR_LIT
+    if (tokenGetTypeFromStrCmp(str, "TOK_FLOAT_LIT")) return TOK_FLOAT_LIT;
+    if (tokenGetTypeFromStrCmp(str, "TOK_CHAR_LIT")) return TOK_CHAR_LIT;
     if (tokenGetTypeFromStrCmp(str, "TOK_STR_LIT")) return TOK_STR_LIT;
     if (tokenGetTypeFromStrCmp(str, "TOK_IDEN")) return TOK_IDEN;
     if (tokenGetTypeFromStrCmp(str, "TOK_IF")) return TOK_IF;
@@ -430,6 +587,7 @@ enum tokenType TokenGetTypeFromStr(char* str) {
     if (tokenGetTypeFromStrCmp(str, "TOK_ERROR")) return TOK_ERROR;
     if (tokenGetTypeFromStrCmp(str, "TOK_MUT")) return TOK_MUT;
     if (tokenGetTypeFromStrCmp(str, "TOK_IMPORT")) return TOK_IMPORT;
+    if (tokenGetTypeFromStrCmp(str, "TOK_AS")) return TOK_AS;
     if (tokenGetTypeFromStrCmp(str, "TOK_ADD")) return TOK_ADD;
     if (tokenGetTypeFromStrCmp(str, "TOK_SUB")) return TOK_SUB;
     if (tokenGetTypeFromStrCmp(str, "TOK_MUL")) return TOK_MUL;
@@ -467,7 +625,6 @@ enum tokenType TokenGetTypeFromStr(char* str) {
     if (tokenGetTypeFromStrCmp(str, "TOK_GRE")) return TOK_GRE;
     if (tokenGetTypeFromStrCmp(str, "TOK_BTWSE_AND")) return TOK_BTWSE_AND;
     if (tokenGetTypeFromStrCmp(str, "TOK_BTWSE_OR")) return TOK_BTWSE_OR;
-    if (tokenGetTypeFromStrCmp(str, "TOK_BTWSE_OR")) return TOK_BTWSE_OR;
     if (tokenGetTypeFromStrCmp(str, "TOK_BTWSE_XOR")) return TOK_BTWSE_XOR;
     if (tokenGetTypeFromStrCmp(str, "TOK_BTWSE_INV")) return TOK_BTWSE_INV;
     if (tokenGetTypeFromStrCmp(str, "TOK_BTSFT_L")) return TOK_BTSFT_L;
@@ -479,5 +636,17 @@ enum tokenType TokenGetTypeFromStr(char* str) {
     if (tokenGetTypeFromStrCmp(str, "TOK_CURLY_O")) return TOK_CURLY_O;
     if (tokenGetTypeFromStrCmp(str, "TOK_CURLY_C")) return TOK_CURLY_C;
     ErrorBugFound();
-    return TOKEN_NONE;
+    return TOK_NONE;
+}
+
+//an error at the > of the if skips the if block and the rest of the for block, not only up to the if block's close
+TEST(TokenFeedPastEnclosingBlock) {
+    TokenCtx tc = TokenizeFile("testrecovery.olang");
+    int ifIdx = 0;
+    while (ifIdx < TokenGetCount(tc) && ((struct token*)ListGetIdx(&tc->tokens, ifIdx))->type != TOK_IF) ifIdx++;
+    TokenSetCursor(tc, ifIdx +2);
+    TokenFeedPast(tc, TOK_CURLY_C);
+    struct token next = TokenFeed(tc);
+    if (next.type == TOK_RET && next.lineNr == 25) TEST_PASSED;
+    TEST_FAILED;
 }
@@ -34,6 +34,7 @@ enum tokenType {
     TOK_ERROR,
     TOK_MUT,
     TOK_IMPORT,
+    TOK_AS,
     TOK_ADD,
     TOK_SUB,
     TOK_MUL,
@@ -80,7 +81,8 @@ enum tokenType {
     TOK_SQUARE_O,
     TOK_SQUARE_C,
     TOK_CURLY_O,
-    TOK_CURLY_C
+    TOK_CURLY_C,
+    TOK_COUNT
 };
 
 struct token {
@@ -103,8 +105,15 @@ char TokenGetChar(TokenCtx tc, int charIdx);
 struct token TokenMerge(struct token head, struct token tail);
 struct token TokenMergeFromListRange(struct list l, int start, int end);
 struct token TokenMergeFromList(struct list l);
+TokenCtx TokenFork(TokenCtx tc); //shares the tokens but has its own cursor, freed with free() and must not outlive tc
 int TokenGetCursor(TokenCtx tc);
 void TokenSetCursor(TokenCtx tc, int cursor);
+int TokenGetCount(TokenCtx tc);
+//token index lookups in constant time, a returned index equal to TokenGetCount means EOF
+int TokenGetMatchingBracket(TokenCtx tc, int tokIdx); //returns -1 if not a bracket or unmatched
+int TokenGetCurlyClose(TokenCtx tc, int tokIdx); //the curly close ending the block tokIdx is in, nested blocks are skipped
+int TokenGetNextSColon(TokenCtx tc, int tokIdx);
+int TokenGetNextCurlyO(TokenCtx tc, int tokIdx);
 enum tokenType TokenGetTypeFromStr(char* str);
 
 #endif //TOKEN_H
@@ -2,9 +2,12 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include "util.h"
 #include "type.h"
 #include "operation.h"
+#include "hashmap.h"
 
 #define PTR_SIZE 8 //4 for 32bit
 #define ARR_LEN_SIZE 8 //4 for 32bit
@@ -52,7 +55,7 @@ static char* typeVanillaInt64Str = "int64";
 static char* typeVanillaFloat32Str = "float32";
 static char* typeVanillaFloat64Str = "float64";
 
-struct type TypeVanilla(enum baseType bType) {
+struct type typeVanillaNoId(enum baseType bType) {
     struct type t = (struct type){0};
     switch (bType) {
         case BASETYPE_BOOL: t.name.ptr = typeVanillaBoolStr; break;
@@ -68,6 +71,12 @@ struct type TypeVanilla(enum baseType bType) {
     return t;
 }
 
+struct type TypeVanilla(enum baseType bType) {
+    struct type t = typeVanillaNoId(bType);
+    t.id = TypeVanillaId(bType);
+    return t;
+}
+
 bool isTypeVanilla(enum baseType bType) {
     switch (bType) {
         case BASETYPE_BOOL: return true;
@@ -86,6 +95,9 @@ struct type TypeString(struct operand* len) {
     t.name.len = strlen(t.name.ptr);
     t.bType = BASETYPE_ARRAY;
     t.arrBase = BASETYPE_BYTE;
+    t.arrBaseId = TypeVanillaId(BASETYPE_BYTE);
+    t.arrLvls = 1;
+    t.id = TypeInternArray(t.arrBaseId, t.arrLvls);
     t.arrMalloc = true;
     t.arrLen = len;
     return t;
@@ -114,8 +126,133 @@ struct type* TypeGetList(struct list* l, struct str name) {
 }
 
 bool TypeIsSame(struct type a, struct type b) {
+    if (a.id != TYPE_ID_NONE && b.id != TYPE_ID_NONE) return a.id == b.id;
     if (isTypeVanilla(a.bType) && a.bType == b.bType) return true;
     if (a.owner != b.owner) return false;
     if (StrCmp(a.name, b.name)) return true;
     return false;
 }
+
+enum typeKeyKind {
+    TYPEKEY_VANILLA,
+    TYPEKEY_ARRAY
+};
+
+struct typeKey {
+    enum typeKeyKind kind;
+    enum baseType bType;
+    TypeId elem;
+    int arrLvls;
+    TypeId id;
+};
+
+//types are interned while function bodies are checked in parallel,
+//the table grows in chunks that never move so TypeGet does not need the lock
+#define TYPE_CHUNK_LEN 1024
+#define TYPE_MAX_CHUNKS 4096
+
+static pthread_mutex_t typeLock = PTHREAD_MUTEX_INITIALIZER;
+static bool typeKeysInitialized = false;
+static struct hashMap typeKeys;
+static struct type** typeChunks[TYPE_MAX_CHUNKS]; //indexed by TypeId
+static atomic_int nTypes = 1; //TYPE_ID_NONE is never stored
+static atomic_int vanillaIds[BASETYPE_COUNT]; //0 until interned
+
+unsigned long long typeKeyHash(struct typeKey* key) {
+    unsigned long long hash = HashBytes(HASH_SEED, &key->kind, sizeof(key->kind));
+    switch (key->kind) {
+        case TYPEKEY_VANILLA: return HashBytes(hash, &key->bType, sizeof(key->bType));
+        case TYPEKEY_ARRAY:
+            hash = HashBytes(hash, &key->elem, sizeof(key->elem));
+            return HashBytes(hash, &key->arrLvls, sizeof(key->arrLvls));
+    }
+    return hash; //unreachable
+}
+
+bool typeKeyCmp(void* key, void* elem) {
+    struct typeKey* a = key;
+    struct typeKey* b = elem;
+    if (a->kind != b->kind) return false;
+    switch (a->kind) {
+        case TYPEKEY_VANILLA: return a->bType == b->bType;
+        case TYPEKEY_ARRAY: return a->elem == b->elem && a->arrLvls == b->arrLvls;
+    }
+    return false; //unreachable
+}
+
+TypeId typeInternKey(struct typeKey key, struct type t) {
+    unsigned long long hash = typeKeyHash(&key);
+    pthread_mutex_lock(&typeLock);
+    if (!typeKeysInitialized) {
+        typeKeys = HashMapInit(sizeof(struct typeKey));
+        typeKeysInitialized = true;
+    }
+    struct typeKey* found = HashMapGet(&typeKeys, hash, &key, typeKeyCmp);
+    if (found) {
+        pthread_mutex_unlock(&typeLock);
+        return found->id;
+    }
+
+    key.id = atomic_load_explicit(&nTypes, memory_order_relaxed);
+    int chunk = key.id / TYPE_CHUNK_LEN;
+    if (chunk >= TYPE_MAX_CHUNKS) ErrorBugFound();
+    if (!typeChunks[chunk]) typeChunks[chunk] = CallocOrCrash(TYPE_CHUNK_LEN * sizeof(struct type*));
+    struct type* stored = MallocOrCrash(sizeof(struct type));
+    *stored = t;
+    stored->id = key.id;
+    typeChunks[chunk][key.id % TYPE_CHUNK_LEN] = stored;
+    atomic_store_explicit(&nTypes, key.id +1, memory_order_release); //publishes stored to TypeGet
+    HashMapAdd(&typeKeys, hash, &key);
+    pthread_mutex_unlock(&typeLock);
+    return key.id;
+}
+
+//asked for on every literal and comparison, so cached outside of the lock
+TypeId TypeVanillaId(enum baseType bType) {
+    if (!isTypeVanilla(bType)) ErrorBugFound();
+    TypeId id = atomic_load_explicit(&vanillaIds[bType], memory_order_acquire);
+    if (id != TYPE_ID_NONE) return id;
+    struct typeKey key = (struct typeKey){0};
+    key.kind = TYPEKEY_VANILLA;
+    key.bType = bType;
+    id = typeInternKey(key, typeVanillaNoId(bType));
+    atomic_store_explicit(&vanillaIds[bType], id, memory_order_release);
+    return id;
+}
+
+//arrays of arrays are keyed by their innermost element, so int32[][] is the same type however it is built
+TypeId TypeInternArray(TypeId elem, int arrLvls) {
+    if (arrLvls <= 0) return elem;
+    struct type t = *TypeGet(elem);
+    if (t.bType == BASETYPE_ARRAY) {
+        elem = t.arrBaseId;
+        arrLvls += t.arrLvls;
+    } else {
+        t.arrBase = t.bType;
+        t.bType = BASETYPE_ARRAY;
+    }
+    struct typeKey key = (struct typeKey){0};
+    key.kind = TYPEKEY_ARRAY;
+    key.elem = elem;
+    key.arrLvls = arrLvls;
+    t.arrBaseId = elem;
+    t.arrLvls = arrLvls;
+    return typeInternKey(key, t);
+}
+
+struct type* TypeGet(TypeId id) {
+    if (id <= TYPE_ID_NONE || id >= atomic_load_explicit(&nTypes, memory_order_acquire)) ErrorBugFound();
+    return typeChunks[id / TYPE_CHUNK_LEN][id % TYPE_CHUNK_LEN];
+}
+
+//structurally equal arrays share one id, whether built from their element or from a smaller array of it
+TEST(TypeInternsArrays) {
+    TypeId i32 = TypeVanillaId(BASETYPE_INT32);
+    TypeId matrix = TypeInternArray(i32, 2);
+    bool passed = matrix == TypeInternArray(i32, 2) && matrix == TypeInternArray(TypeInternArray(i32, 1), 1);
+    passed = passed && matrix != TypeInternArray(i32, 1) && matrix != TypeInternArray(TypeVanillaId(BASETYPE_INT64), 2);
+    passed = passed && TypeGet(matrix)->arrBaseId == i32 && TypeGet(matrix)->arrLvls == 2;
+    passed = passed && TypeString(NULL).id == TypeInternArray(TypeVanillaId(BASETYPE_BYTE), 1);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
@@ -18,13 +18,19 @@ enum baseType {
     BASETYPE_FUNC,
     BASETYPE_ERROR,
 };
+#define BASETYPE_COUNT (BASETYPE_ERROR +1)
+
+typedef int TypeId; //handle into the global type table
+#define TYPE_ID_NONE 0 //for types not interned yet
 
 struct type {
+    TypeId id;
     struct parserContext* owner;
     enum baseType bType;
     struct str name;
     struct token tok;
     enum baseType arrBase;
+    TypeId arrBaseId; //the element type arrays were built from
     bool placeholder;
     bool structMAlloc;
     bool arrMalloc;
@@ -47,4 +53,10 @@ bool TypeIsByteArray(struct type t);
 struct type* TypeGetList(struct list* l, struct str name);
 bool TypeIsSame(struct type a, struct type b);
 
+//vanilla types are interned by base type and arrays structurally by element type and levels,
+//so equal handles mean equal types
+TypeId TypeInternArray(TypeId elem, int arrLvls);
+TypeId TypeVanillaId(enum baseType bType);
+struct type* TypeGet(TypeId id);
+
 #endif //TYPE_H
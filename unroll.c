@@ -0,0 +1,304 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "opt.h"
+#include "irtest.h"
+#include "loop.h"
+#include "fold.h"
+#include "util.h"
+
+#define UNROLL_MAX_TRIPS 1000000 //simulated iterations when computing a trip count
+#define UNROLL_MAX_INSTRS 1024 //in the unrolled loop
+
+//the loop must be innermost, exit only from the header and test an induction variable against a constant there
+struct unrollLoop {
+    struct loop* l;
+    int bodyTarget; //the successor of the header inside the loop
+    long long trips; //times the body runs
+};
+
+bool unrollIsConst(struct irFunc* f, int value) {
+    struct irInstr* in = IrGetInstr(f, value);
+    return in->op == IR_CONST && in->type != TYPE_ID_NONE && TypeGet(in->type)->bType <= BASETYPE_INT64;
+}
+
+bool unrollIsComparison(enum operation opType) {
+    switch (opType) {
+        case OPERATION_LESS_THAN: return true;
+        case OPERATION_LESS_THAN_OR_EQUAL: return true;
+        case OPERATION_GREATER_THAN: return true;
+        case OPERATION_GREATER_THAN_OR_EQUAL: return true;
+        case OPERATION_EQUALS: return true;
+        case OPERATION_NOT_EQUALS: return true;
+        default: return false;
+    }
+}
+
+//runs the induction variable through the comparison until the loop would exit, with the wraparound of its type
+bool unrollTripCount(struct irFunc* f, struct loopIndVar* iv, int cond, bool continueIfTrue, long long* trips) {
+    struct irInstr* c = IrGetInstr(f, cond);
+    if (c->op != IR_OPERATION || !unrollIsComparison(c->opType)) return false;
+    int a = IrGetArg(f, cond, 0);
+    int b = IrGetArg(f, cond, 1);
+    bool ivFirst = a == iv->phi;
+    int bound = ivFirst ? b : a;
+    if ((!ivFirst && b != iv->phi) || !unrollIsConst(f, bound) || !unrollIsConst(f, iv->init) || !unrollIsConst(f, iv->step)) return false;
+
+    enum baseType bType = TypeGet(IrGetInstr(f, iv->phi)->type)->bType;
+    struct foldVal v = FoldFromBits(bType, IrGetInstr(f, iv->init)->val);
+    struct foldVal step = FoldFromBits(bType, IrGetInstr(f, iv->step)->val);
+    struct foldVal boundVal = FoldFromBits(bType, IrGetInstr(f, bound)->val);
+    for (*trips = 0; *trips <= UNROLL_MAX_TRIPS; (*trips)++) {
+        struct foldVal result;
+        FoldBinary(c->opType, ivFirst ? v : boundVal, ivFirst ? boundVal : v, &result);
+        if ((result.i != 0) != continueIfTrue) return true;
+        FoldBinary(iv->opType, v, step, &v);
+    }
+    return false;
+}
+
+bool unrollIsCandidate(struct irFunc* f, struct list* loops, struct loop* l, struct unrollLoop* u) {
+    if (l->latch == IR_NONE) return false;
+    for (int i = 0; i < loops->len; i++) {
+        struct loop* other = ListGetIdx(loops, i);
+        if (other != l && LoopContains(l, other->header)) return false;
+    }
+    for (int i = 0; i < l->blocks.len; i++) {
+        int b = *(int*)ListGetIdx(&l->blocks, i);
+        if (b == l->header) continue;
+        struct irInstr* term = IrGetInstr(f, IrGetTerminator(f, b));
+        for (int t = 0; t < 2; t++) {
+            if (term->targets[t] != IR_NONE && !LoopContains(l, term->targets[t])) return false;
+        }
+    }
+    int term = IrGetTerminator(f, l->header);
+    struct irInstr* condBr = IrGetInstr(f, term);
+    if (condBr->op != IR_CONDBR || LoopContains(l, condBr->targets[0]) == LoopContains(l, condBr->targets[1])) return false;
+    bool continueIfTrue = LoopContains(l, condBr->targets[0]);
+    u->l = l;
+    u->bodyTarget = condBr->targets[!continueIfTrue];
+
+    struct list* instrs = &IrGetBlock(f, l->header)->instrs;
+    for (int i = 0; i < instrs->len; i++) {
+        struct loopIndVar iv;
+        if (!LoopFindIndVar(f, l, *(int*)ListGetIdx(instrs, i), &iv)) continue;
+        if (unrollTripCount(f, &iv, IrGetArg(f, term, 0), continueIfTrue, &u->trips)) return true;
+    }
+    return false;
+}
+
+struct unrollCopy {
+    int* vals; //per instruction of the original loop, IR_NONE if not defined in the loop
+    int* blocks; //per block of the function before unrolling
+};
+
+int unrollMap(struct unrollCopy* c, int nInstrs, int value) {
+    if (value < nInstrs && c->vals[value] != IR_NONE) return c->vals[value];
+    return value;
+}
+
+int unrollMapBlock(struct unrollCopy* copies, int factor, int k, struct loop* l, int target) {
+    if (target != l->header) return copies[k].blocks[target];
+    return k +1 < factor ? copies[k +1].blocks[target] : l->header;
+}
+
+//copy k of every block but the header gets the instructions of the original with args of copy k,
+//the header phis of copy k are the latch values of copy k -1 and its exit test is dropped
+void unrollCloneBody(struct irFunc* f, struct unrollLoop* u, struct list* domOrder, struct unrollCopy* copies, int k, int* latchArgs, int nInstrs) {
+    struct loop* l = u->l;
+    struct unrollCopy* c = &copies[k];
+    struct list* headerInstrs = &IrGetBlock(f, l->header)->instrs;
+    for (int i = 0; i < headerInstrs->len; i++) {
+        int phi = *(int*)ListGetIdx(headerInstrs, i);
+        if (IrGetInstr(f, phi)->op != IR_PHI) break;
+        c->vals[phi] = unrollMap(&copies[k -1], nInstrs, latchArgs[i]);
+    }
+    for (int i = 0; i < domOrder->len; i++) {
+        int b = *(int*)ListGetIdx(domOrder, i);
+        if (!LoopContains(l, b)) continue;
+        struct list* instrs = &IrGetBlock(f, b)->instrs;
+        for (int j = 0; j < instrs->len; j++) {
+            int instr = *(int*)ListGetIdx(instrs, j);
+            struct irInstr in = *IrGetInstr(f, instr);
+            if ((b == l->header && in.op == IR_PHI) || IrIsTerminator(in.op)) continue;
+            int clone = IrAddInstr(f, c->blocks[b], in.op, in.type);
+            IrGetInstr(f, clone)->opType = in.opType;
+            IrGetInstr(f, clone)->val = in.val;
+            IrGetInstr(f, clone)->var = in.var;
+            c->vals[instr] = clone;
+            if (in.op == IR_PHI) continue; //args once all preds of the copy are known
+            for (int a = 0; a < in.args.len; a++) IrAddArg(f, clone, unrollMap(c, nInstrs, IrGetArg(f, instr, a)));
+        }
+    }
+}
+
+void unrollCloneTerminators(struct irFunc* f, struct unrollLoop* u, struct unrollCopy* copies, int factor, int k, int nInstrs) {
+    struct loop* l = u->l;
+    for (int i = 0; i < l->blocks.len; i++) {
+        int b = *(int*)ListGetIdx(&l->blocks, i);
+        struct irInstr term = *IrGetInstr(f, IrGetTerminator(f, b));
+        int clone;
+        if (b == l->header) {
+            clone = IrAddInstr(f, copies[k].blocks[b], IR_BR, TYPE_ID_NONE);
+            IrSetTargets(f, clone, unrollMapBlock(copies, factor, k, l, u->bodyTarget), IR_NONE);
+            continue;
+        }
+        clone = IrAddInstr(f, copies[k].blocks[b], term.op, TYPE_ID_NONE);
+        for (int a = 0; a < term.args.len; a++) IrAddArg(f, clone, unrollMap(&copies[k], nInstrs, *(int*)ListGetIdx(&term.args, a)));
+        int t1 = term.targets[1] == IR_NONE ? IR_NONE : unrollMapBlock(copies, factor, k, l, term.targets[1]);
+        IrSetTargets(f, clone, unrollMapBlock(copies, factor, k, l, term.targets[0]), t1);
+    }
+}
+
+//the preds of a copied block are copies of the preds of the original, possibly in another order
+void unrollFillPhis(struct irFunc* f, struct loop* l, struct unrollCopy* c, int* origBlocks, int nInstrs) {
+    for (int i = 0; i < l->blocks.len; i++) {
+        int b = *(int*)ListGetIdx(&l->blocks, i);
+        if (b == l->header) continue;
+        struct irBlock* orig = IrGetBlock(f, b);
+        struct list* preds = &IrGetBlock(f, c->blocks[b])->preds;
+        for (int j = 0; j < orig->instrs.len; j++) {
+            int phi = *(int*)ListGetIdx(&orig->instrs, j);
+            if (IrGetInstr(f, phi)->op != IR_PHI) break;
+            for (int p = 0; p < preds->len; p++) {
+                int origPred = origBlocks[*(int*)ListGetIdx(preds, p)];
+                int argIdx = 0;
+                while (*(int*)ListGetIdx(&orig->preds, argIdx) != origPred) argIdx++;
+                IrAddArg(f, c->vals[phi], unrollMap(c, nInstrs, IrGetArg(f, phi, argIdx)));
+            }
+        }
+    }
+}
+
+//the trip count is a multiple of factor, so only the test of the first of every factor copies is needed
+void unrollLoop(struct irFunc* f, struct unrollLoop* u, int factor, struct list* domOrder) {
+    struct loop* l = u->l;
+    int nInstrs = f->instrs.len;
+    int nBlocks = f->blocks.len;
+    struct unrollCopy* copies = MallocOrCrash(factor * sizeof(struct unrollCopy));
+    for (int k = 0; k < factor; k++) {
+        copies[k].vals = MallocOrCrash(nInstrs * sizeof(int));
+        copies[k].blocks = MallocOrCrash(nBlocks * sizeof(int));
+        for (int i = 0; i < nInstrs; i++) copies[k].vals[i] = IR_NONE;
+        for (int i = 0; i < nBlocks; i++) copies[k].blocks[i] = k == 0 ? i : IR_NONE;
+    }
+    for (int k = 1; k < factor; k++) {
+        for (int i = 0; i < l->blocks.len; i++) {
+            int b = *(int*)ListGetIdx(&l->blocks, i);
+            copies[k].blocks[b] = IrAddBlock(f);
+        }
+    }
+    int* origBlocks = MallocOrCrash(f->blocks.len * sizeof(int));
+    for (int k = 0; k < factor; k++) {
+        for (int i = 0; i < nBlocks; i++) {
+            if (copies[k].blocks[i] != IR_NONE) origBlocks[copies[k].blocks[i]] = i;
+        }
+    }
+
+    struct irBlock* header = IrGetBlock(f, l->header);
+    int latchIdx = 0;
+    while (*(int*)ListGetIdx(&header->preds, latchIdx) != l->latch) latchIdx++;
+    int* latchArgs = MallocOrCrash(header->instrs.len * sizeof(int));
+    int nPhis = 0;
+    for (; nPhis < header->instrs.len; nPhis++) {
+        int phi = *(int*)ListGetIdx(&header->instrs, nPhis);
+        if (IrGetInstr(f, phi)->op != IR_PHI) break;
+        latchArgs[nPhis] = IrGetArg(f, phi, latchIdx);
+    }
+
+    for (int k = 1; k < factor; k++) unrollCloneBody(f, u, domOrder, copies, k, latchArgs, nInstrs);
+    for (int k = 1; k < factor; k++) unrollCloneTerminators(f, u, copies, factor, k, nInstrs);
+    for (int k = 1; k < factor; k++) unrollFillPhis(f, l, &copies[k], origBlocks, nInstrs);
+    IrRetarget(f, IrGetTerminator(f, l->latch), l->header, copies[1].blocks[l->header]);
+    header = IrGetBlock(f, l->header);
+    for (int i = 0; i < nPhis; i++) {
+        int phi = *(int*)ListGetIdx(&header->instrs, i);
+        IrAddArg(f, phi, unrollMap(&copies[factor -1], nInstrs, latchArgs[i]));
+    }
+
+    for (int k = 0; k < factor; k++) {
+        free(copies[k].vals);
+        free(copies[k].blocks);
+    }
+    free(copies);
+    free(origBlocks);
+    free(latchArgs);
+}
+
+bool OptUnroll(struct irFunc* f, int factor) {
+    if (factor < 2) return false;
+    bool changed = false;
+    struct list loops = LoopFind(f, &changed);
+    struct list candidates = ListInit(sizeof(struct unrollLoop));
+    for (int i = 0; i < loops.len; i++) {
+        struct unrollLoop u;
+        struct loop* l = ListGetIdx(&loops, i);
+        if (!unrollIsCandidate(f, &loops, l, &u) || u.trips == 0 || u.trips % factor != 0) continue;
+        int nInstrs = 0;
+        for (int j = 0; j < l->blocks.len; j++) nInstrs += IrGetBlock(f, *(int*)ListGetIdx(&l->blocks, j))->instrs.len;
+        if (nInstrs * factor <= UNROLL_MAX_INSTRS) ListAdd(&candidates, &u);
+    }
+    if (candidates.len) {
+        struct list idoms = IrDominators(f);
+        struct list domOrder = IrDomTreeOrder(f, &idoms);
+        for (int i = 0; i < candidates.len; i++) unrollLoop(f, ListGetIdx(&candidates, i), factor, &domOrder);
+        ListDestroy(idoms);
+        ListDestroy(domOrder);
+        changed = true;
+    }
+    ListDestroy(candidates);
+    LoopDestroyAll(loops);
+    return changed;
+}
+
+TEST(OptUnrollCount) {
+    TypeId i32 = TypeVanillaId(BASETYPE_INT32);
+    TypeId boolType = TypeVanillaId(BASETYPE_BOOL);
+    struct type ret = TypeVanilla(BASETYPE_INT32);
+    struct var func;
+    struct irFunc* f = IrTestFunc(&func, "eight", &ret, NULL, 0);
+    int header = IrAddBlock(f);
+    int body = IrAddBlock(f);
+    int exit = IrAddBlock(f);
+    int zero = IrAddInstr(f, 0, IR_CONST, i32);
+    int one = IrAddInstr(f, 0, IR_CONST, i32);
+    IrGetInstr(f, one)->val = 1;
+    int eight = IrAddInstr(f, 0, IR_CONST, i32);
+    IrGetInstr(f, eight)->val = 8;
+    IrSetTargets(f, IrAddInstr(f, 0, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+
+    int phi = IrAddInstr(f, header, IR_PHI, i32);
+    int cond = IrAddInstr(f, header, IR_OPERATION, boolType);
+    IrGetInstr(f, cond)->opType = OPERATION_LESS_THAN;
+    IrAddArg(f, cond, phi);
+    IrAddArg(f, cond, eight);
+    int condBr = IrAddInstr(f, header, IR_CONDBR, TYPE_ID_NONE);
+    IrAddArg(f, condBr, cond);
+    IrSetTargets(f, condBr, body, exit);
+
+    int next = IrAddInstr(f, body, IR_OPERATION, i32);
+    IrGetInstr(f, next)->opType = OPERATION_ADD;
+    IrAddArg(f, next, phi);
+    IrAddArg(f, next, one);
+    IrSetTargets(f, IrAddInstr(f, body, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+    IrAddArg(f, phi, zero);
+    IrAddArg(f, phi, next);
+    IrAddArg(f, IrAddInstr(f, exit, IR_RET, TYPE_ID_NONE), phi);
+
+    bool passed = OptUnroll(f, 4) && !OptUnroll(f, 3) && IrTestVerify(f);
+    passed = passed && IrTestCountOps(f, OPERATION_ADD) == 4 && IrTestCount(f, IR_CONDBR) == 1;
+    IrTestFuncDestroy(&func);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
+
+//the loop of eight in testopt.olang runs 4 times, at -O2 its two adds are copied 4 times with one test per round
+TEST(OptUnrollSource) {
+    bool passed;
+    struct list program = IrTestCheckFile("testopt.olang", OPT_LEVEL_2, false, &passed);
+    struct optFunc* eight = passed ? IrTestFind(&program, "eight") : NULL;
+    passed = eight && IrTestCountOps(eight->func->ir, OPERATION_ADD) == 8 && IrTestCount(eight->func->ir, IR_CONDBR) == 1;
+    IrTestProgramDestroy(program);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}
@@ -19,10 +19,33 @@ struct str StrFromCStr(char* cStr) {
     return s;
 }
 
+bool StrCmp(struct str a, struct str b) {
+    if (a.len != b.len) return false;
+    if (a.len == 0) return true;
+    return !memcmp(a.ptr, b.ptr, a.len);
+}
+
+void StrGetAsCStr(struct str s, char* buffer) {
+    memcpy(buffer, s.ptr, s.len);
+    buffer[s.len] = '\0';
+}
+
+void StrPrint(struct str s, FILE* stream) {
+    fwrite(s.ptr, 1, s.len, stream);
+}
+
+unsigned long long HashBytes(unsigned long long hash, void* ptr, int len) {
+    for (int i = 0; i < len; i++) {
+        hash ^= ((unsigned char*)ptr)[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 void* MallocOrCrash(size_t size) {
     void* ptr = malloc(size);
     if (!ptr) {
-        fputs(COLOR_RED "ERROR: " COLOR_RESET "memory allocation failed\n", stderr);
+        fputs(COLOR_FG_RED "ERROR: " COLOR_RESET "memory allocation failed\n", stderr);
         exit(EXIT_FAILURE);
     }
     return ptr;
@@ -31,7 +54,7 @@ void* MallocOrCrash(size_t size) {
 void* CallocOrCrash(size_t size) {
     void* ptr = calloc(size, 1);
     if (!ptr) {
-        fputs(COLOR_RED "ERROR: " COLOR_RESET "memory allocation failed\n", stderr);
+        fputs(COLOR_FG_RED "ERROR: " COLOR_RESET "memory allocation failed\n", stderr);
         exit(EXIT_FAILURE);
     }
     return ptr;
@@ -40,14 +63,14 @@ void* CallocOrCrash(size_t size) {
 void* ReallocOrCrash(void* oldPtr, size_t size) {
     void* ptr = realloc(oldPtr, size);
     if (!ptr) {
-        fputs(COLOR_RED "ERROR: " COLOR_RESET "memory allocation failed\n", stderr);
+        fputs(COLOR_FG_RED "ERROR: " COLOR_RESET "memory allocation failed\n", stderr);
         exit(EXIT_FAILURE);
     }
     return ptr;
 }
 
 void ErrorBugFound() {
-    fputs(COLOR_RED "ERROR: bug found\n" COLOR_RESET, stderr);
+    fputs(COLOR_FG_RED "ERROR: bug found\n" COLOR_RESET, stderr);
     exit(EXIT_FAILURE);
 }
 
@@ -1,6 +1,7 @@
 #ifndef UTIL_H
 #define UTIL_H
 #include <stdio.h>
+#include <stdbool.h>
 
 #define COLOR_RESET "\x1b[0m"
 #define COLOR_FG_RED "\x1b[31m"
@@ -15,11 +16,11 @@
 
 #ifndef TEST
 #undef TEST
-#define TEST(func) __attribute__((unused)) static void Test##func()
+#define TEST(func) __attribute__((unused)) static inline void Test##func() //not emitted, so the fixtures of irtest.c are not needed
 #endif //TEST
 
-#define TEST_PASSED {printf(COLOR_GREEN "%s passed\n" COLOR_RESET, __func__); return;}
-#define TEST_FAILED {printf(COLOR_RED "%s failed\n" COLOR_RESET, __func__); return;}
+#define TEST_PASSED {printf(COLOR_FG_GREEN "%s passed\n" COLOR_RESET, __func__); return;}
+#define TEST_FAILED {printf(COLOR_FG_RED "%s failed\n" COLOR_RESET, __func__); return;}
 
 struct str {
     char* ptr;
@@ -28,12 +29,17 @@ struct str {
 
 struct str Str(char* ptr, int len);
 struct str StrFromCStr(char* cStr);
+bool StrCmp(struct str a, struct str b);
+void StrGetAsCStr(struct str s, char* buffer); //buffer must hold s.len +1 chars
 void StrPrint(struct str s, FILE* stream);
 void ErrorBugFound();
 void* MallocOrCrash(size_t size);
 void* CallocOrCrash(size_t size);
 void* ReallocOrCrash(void* oldPtr, size_t size);
 
+#define HASH_SEED 14695981039346656037ULL
+unsigned long long HashBytes(unsigned long long hash, void* ptr, int len); //FNV-1a, chain by passing the previous hash
+
 /*
 void SyntaxErrorInfo(TokenCtx tc, char* errMsg);
 void SyntaxErrorLastFedChar(TokenCtx tc, char* errMsg);
@@ -12,7 +12,8 @@ struct var {
     bool mut; //local variables are mutable by default
     bool mayBeInitialized; //access defined only through the origin member
     struct var* origin; //where the variable declaration is stored throughout the compilation process
-    struct list codeBlock; //for functions
+    struct astFunc* body; //for functions, flattened once parsed
+    struct irFunc* ir; //for functions with a body, lowered and optimized once the whole program is checked
 };
 
 struct var* VarAllocSetOrigin();
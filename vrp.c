@@ -0,0 +1,391 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <limits.h>
+#include "opt.h"
+#include "irtest.h"
+#include "util.h"
+
+#define VRP_WIDEN_AFTER 3 //changes of a phi before a bound that keeps moving goes to the end of its type
+
+//intervals of byte, int32 and int64 values: iterated to a fixpoint over the dominator tree order with widening at phis,
+//and narrowed where they are used by the branches leading there, so a loop counter is bounded inside the loop
+struct vrpRange {
+    long long lo;
+    long long hi; //empty if below lo, i.e. not reached yet
+};
+
+struct vrpCtx {
+    struct irFunc* f;
+    struct list idoms;
+    struct vrpRange* ranges;
+    int* nChanges;
+};
+
+bool vrpIsInt(TypeId type) {
+    if (type == TYPE_ID_NONE) return false;
+    enum baseType bType = TypeGet(type)->bType;
+    return bType == BASETYPE_BYTE || bType == BASETYPE_INT32 || bType == BASETYPE_INT64;
+}
+
+struct vrpRange vrpFull(TypeId type) {
+    switch (TypeGet(type)->bType) {
+        case BASETYPE_BYTE: return (struct vrpRange){0, UCHAR_MAX};
+        case BASETYPE_INT32: return (struct vrpRange){INT_MIN, INT_MAX};
+        default: return (struct vrpRange){LLONG_MIN, LLONG_MAX};
+    }
+}
+
+bool vrpIsEmpty(struct vrpRange r) {
+    return r.lo > r.hi;
+}
+
+bool vrpIsConst(struct vrpRange r, long long* c) {
+    *c = r.lo;
+    return r.lo == r.hi;
+}
+
+struct vrpRange vrpUnion(struct vrpRange a, struct vrpRange b) {
+    if (vrpIsEmpty(a)) return b;
+    if (vrpIsEmpty(b)) return a;
+    return (struct vrpRange){a.lo < b.lo ? a.lo : b.lo, a.hi > b.hi ? a.hi : b.hi};
+}
+
+struct vrpRange vrpIntersect(struct vrpRange a, struct vrpRange b) {
+    return (struct vrpRange){a.lo > b.lo ? a.lo : b.lo, a.hi < b.hi ? a.hi : b.hi};
+}
+
+//the operations wrap around, so a result that may not fit the type can be anything
+struct vrpRange vrpFit(TypeId type, bool overflow, long long lo, long long hi) {
+    struct vrpRange full = vrpFull(type);
+    if (overflow || lo < full.lo || hi > full.hi) return full;
+    return (struct vrpRange){lo, hi};
+}
+
+enum operation vrpMirror(enum operation opType) {
+    switch (opType) {
+        case OPERATION_LESS_THAN: return OPERATION_GREATER_THAN;
+        case OPERATION_LESS_THAN_OR_EQUAL: return OPERATION_GREATER_THAN_OR_EQUAL;
+        case OPERATION_GREATER_THAN: return OPERATION_LESS_THAN;
+        case OPERATION_GREATER_THAN_OR_EQUAL: return OPERATION_LESS_THAN_OR_EQUAL;
+        default: return opType;
+    }
+}
+
+enum operation vrpNegate(enum operation opType) {
+    switch (opType) {
+        case OPERATION_LESS_THAN: return OPERATION_GREATER_THAN_OR_EQUAL;
+        case OPERATION_LESS_THAN_OR_EQUAL: return OPERATION_GREATER_THAN;
+        case OPERATION_GREATER_THAN: return OPERATION_LESS_THAN_OR_EQUAL;
+        case OPERATION_GREATER_THAN_OR_EQUAL: return OPERATION_LESS_THAN;
+        case OPERATION_EQUALS: return OPERATION_NOT_EQUALS;
+        case OPERATION_NOT_EQUALS: return OPERATION_EQUALS;
+        default: return OPERATION_NONE;
+    }
+}
+
+//r holds value, which is known to compare to other by opType
+struct vrpRange vrpNarrow(struct vrpRange r, enum operation opType, struct vrpRange other) {
+    if (vrpIsEmpty(other)) return r;
+    long long c;
+    switch (opType) {
+        case OPERATION_LESS_THAN: if (other.hi != LLONG_MIN && other.hi - 1 < r.hi) r.hi = other.hi - 1; break;
+        case OPERATION_LESS_THAN_OR_EQUAL: if (other.hi < r.hi) r.hi = other.hi; break;
+        case OPERATION_GREATER_THAN: if (other.lo != LLONG_MAX && other.lo + 1 > r.lo) r.lo = other.lo + 1; break;
+        case OPERATION_GREATER_THAN_OR_EQUAL: if (other.lo > r.lo) r.lo = other.lo; break;
+        case OPERATION_EQUALS: r = vrpIntersect(r, other); break;
+        case OPERATION_NOT_EQUALS:
+            if (!vrpIsConst(other, &c)) break;
+            if (r.lo == c && r.lo != LLONG_MAX) r.lo++;
+            else if (r.hi == c && r.hi != LLONG_MIN) r.hi--;
+            break;
+        default: break;
+    }
+    return r;
+}
+
+//the range of value in block, narrowed by the comparisons of the branches dominating it
+struct vrpRange vrpRangeAt(struct vrpCtx* c, int value, int block) {
+    struct irFunc* f = c->f;
+    struct vrpRange r = c->ranges[value];
+    int def = IrGetInstr(f, value)->block;
+    for (int b = block; b != IR_NONE && b != def && !vrpIsEmpty(r); b = *(int*)ListGetIdx(&c->idoms, b)) {
+        struct irBlock* bb = IrGetBlock(f, b);
+        if (bb->preds.len != 1) continue;
+        struct irInstr* term = IrGetInstr(f, IrGetTerminator(f, *(int*)ListGetIdx(&bb->preds, 0)));
+        if (term->op != IR_CONDBR || term->targets[0] == term->targets[1]) continue;
+        int cond = *(int*)ListGetIdx(&term->args, 0);
+        struct irInstr* in = IrGetInstr(f, cond);
+        if (in->op != IR_OPERATION || in->args.len != 2 || vrpNegate(in->opType) == OPERATION_NONE) continue;
+        enum operation opType = term->targets[0] == b ? in->opType : vrpNegate(in->opType);
+        int lhs = IrGetArg(f, cond, 0);
+        int rhs = IrGetArg(f, cond, 1);
+        if (lhs == value && rhs != value) r = vrpNarrow(r, opType, c->ranges[rhs]);
+        else if (rhs == value && lhs != value) r = vrpNarrow(r, vrpMirror(opType), c->ranges[lhs]);
+    }
+    return r;
+}
+
+//x % d has the sign of x and is below d in magnitude, x & m is within m if either is not negative
+struct vrpRange vrpBinary(TypeId type, enum operation opType, struct vrpRange a, struct vrpRange b) {
+    long long lo;
+    long long hi;
+    long long d;
+    bool overflow = false;
+    switch (opType) {
+        case OPERATION_ADD:
+            overflow = __builtin_add_overflow(a.lo, b.lo, &lo) || __builtin_add_overflow(a.hi, b.hi, &hi);
+            return vrpFit(type, overflow, lo, hi);
+        case OPERATION_SUB:
+            overflow = __builtin_sub_overflow(a.lo, b.hi, &lo) || __builtin_sub_overflow(a.hi, b.lo, &hi);
+            return vrpFit(type, overflow, lo, hi);
+        case OPERATION_MUL: {
+            long long p[4];
+            overflow = __builtin_mul_overflow(a.lo, b.lo, &p[0]) || __builtin_mul_overflow(a.lo, b.hi, &p[1]) ||
+                    __builtin_mul_overflow(a.hi, b.lo, &p[2]) || __builtin_mul_overflow(a.hi, b.hi, &p[3]);
+            lo = hi = p[0];
+            for (int i = 1; i < 4 && !overflow; i++) {
+                if (p[i] < lo) lo = p[i];
+                if (p[i] > hi) hi = p[i];
+            }
+            return vrpFit(type, overflow, lo, hi);
+        }
+        case OPERATION_DIV:
+            if (!vrpIsConst(b, &d) || d == 0 || d == -1) return vrpFull(type);
+            return d > 0 ? vrpFit(type, false, a.lo / d, a.hi / d) : vrpFit(type, false, a.hi / d, a.lo / d);
+        case OPERATION_MODULO: {
+            if (b.lo <= 0 && b.hi >= 0) return vrpFull(type);
+            long long m = b.lo > 0 ? b.hi - 1 : b.lo == LLONG_MIN ? LLONG_MAX : -b.lo - 1;
+            lo = a.lo >= 0 ? 0 : a.lo > -m ? a.lo : -m;
+            hi = a.hi <= 0 ? 0 : a.hi < m ? a.hi : m;
+            return vrpFit(type, false, lo, hi);
+        }
+        case OPERATION_BITWISE_AND:
+            if (a.lo < 0 && b.lo < 0) return vrpFull(type);
+            hi = a.lo < 0 ? b.hi : b.lo < 0 ? a.hi : a.hi < b.hi ? a.hi : b.hi;
+            return vrpFit(type, false, 0, hi);
+        default: return vrpFull(type);
+    }
+}
+
+struct vrpRange vrpEval(struct vrpCtx* c, int instr) {
+    struct irFunc* f = c->f;
+    struct irInstr* in = IrGetInstr(f, instr);
+    struct vrpRange empty = {1, 0};
+    switch (in->op) {
+        case IR_CONST: return (struct vrpRange){in->val, in->val};
+        case IR_LEN: return (struct vrpRange){0, LLONG_MAX};
+        case IR_PHI: {
+            struct vrpRange r = empty;
+            struct list* preds = &IrGetBlock(f, in->block)->preds;
+            for (int i = 0; i < in->args.len; i++) r = vrpUnion(r, vrpRangeAt(c, IrGetArg(f, instr, i), *(int*)ListGetIdx(preds, i)));
+            return r;
+        }
+        case IR_CAST: {
+            int arg = IrGetArg(f, instr, 0);
+            if (!vrpIsInt(IrGetInstr(f, arg)->type)) return vrpFull(in->type);
+            struct vrpRange r = vrpRangeAt(c, arg, in->block);
+            return vrpIsEmpty(r) ? r : vrpFit(in->type, false, r.lo, r.hi);
+        }
+        case IR_OPERATION: {
+            struct vrpRange args[2];
+            for (int i = 0; i < in->args.len; i++) {
+                int arg = IrGetArg(f, instr, i);
+                if (!vrpIsInt(IrGetInstr(f, arg)->type)) return vrpFull(in->type);
+                args[i] = vrpRangeAt(c, arg, in->block);
+                if (vrpIsEmpty(args[i])) return empty;
+            }
+            if (in->args.len == 2) return vrpBinary(in->type, in->opType, args[0], args[1]);
+            if (in->opType == OPERATION_PLUS) return args[0];
+            if (in->opType != OPERATION_MINUS || args[0].lo == LLONG_MIN) return vrpFull(in->type);
+            return vrpFit(in->type, false, -args[0].hi, -args[0].lo);
+        }
+        default: return vrpFull(in->type);
+    }
+}
+
+//phis that keep growing are widened, so every value changes a bounded number of times
+void vrpSolve(struct vrpCtx* c, struct list* order) {
+    struct irFunc* f = c->f;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < order->len; i++) {
+            struct list* instrs = &IrGetBlock(f, *(int*)ListGetIdx(order, i))->instrs;
+            for (int j = 0; j < instrs->len; j++) {
+                int instr = *(int*)ListGetIdx(instrs, j);
+                struct irInstr* in = IrGetInstr(f, instr);
+                if (!vrpIsInt(in->type)) continue;
+                struct vrpRange old = c->ranges[instr];
+                struct vrpRange r = vrpEval(c, instr);
+                if (in->op == IR_PHI && c->nChanges[instr] >= VRP_WIDEN_AFTER && !vrpIsEmpty(old)) {
+                    struct vrpRange full = vrpFull(in->type);
+                    if (r.lo < old.lo) r.lo = full.lo;
+                    if (r.hi > old.hi) r.hi = full.hi;
+                }
+                if (r.lo == old.lo && r.hi == old.hi) continue;
+                c->ranges[instr] = r;
+                c->nChanges[instr]++;
+                changed = true;
+            }
+        }
+    }
+}
+
+//-1 if the ranges do not decide the comparison
+int vrpDecide(enum operation opType, struct vrpRange a, struct vrpRange b) {
+    switch (opType) {
+        case OPERATION_LESS_THAN: return a.hi < b.lo ? 1 : a.lo >= b.hi ? 0 : -1;
+        case OPERATION_LESS_THAN_OR_EQUAL: return a.hi <= b.lo ? 1 : a.lo > b.hi ? 0 : -1;
+        case OPERATION_GREATER_THAN: return vrpDecide(OPERATION_LESS_THAN, b, a);
+        case OPERATION_GREATER_THAN_OR_EQUAL: return vrpDecide(OPERATION_LESS_THAN_OR_EQUAL, b, a);
+        case OPERATION_EQUALS: return a.hi < b.lo || b.hi < a.lo ? 0 : a.lo == a.hi && b.lo == b.hi ? 1 : -1;
+        case OPERATION_NOT_EQUALS: {
+            int equals = vrpDecide(OPERATION_EQUALS, a, b);
+            return equals < 0 ? -1 : !equals;
+        }
+        default: return -1;
+    }
+}
+
+int vrpPos(struct irFunc* f, int instr) {
+    struct list* instrs = &IrGetBlock(f, IrGetInstr(f, instr)->block)->instrs;
+    int pos = 0;
+    while (*(int*)ListGetIdx(instrs, pos) != instr) pos++;
+    return pos;
+}
+
+int vrpConstBefore(struct irFunc* f, int instr, TypeId type, long long val) {
+    int c = IrInsertInstr(f, IrGetInstr(f, instr)->block, vrpPos(f, instr), IR_CONST, type);
+    IrGetInstr(f, c)->val = val;
+    return c;
+}
+
+int vrpLog2(long long d) {
+    if (d <= 0 || (d & (d - 1))) return -1;
+    int k = 0;
+    while ((1LL << k) != d) k++;
+    return k;
+}
+
+//comparisons the ranges decide become constants, dividing values that are not negative by a power of two
+//becomes a shift or a mask and bounds checks of an index within the smallest length are removed
+bool vrpApply(struct vrpCtx* c) {
+    struct irFunc* f = c->f;
+    bool changed = false;
+    int n = f->instrs.len;
+    for (int i = 0; i < n; i++) {
+        struct irInstr* in = IrGetInstr(f, i);
+        if (in->block == IR_NONE || in->args.len != 2 || (in->op != IR_OPERATION && in->op != IR_BOUNDSCHECK)) continue;
+        int a = IrGetArg(f, i, 0);
+        int b = IrGetArg(f, i, 1);
+        if (!vrpIsInt(IrGetInstr(f, a)->type) || !vrpIsInt(IrGetInstr(f, b)->type)) continue;
+        struct vrpRange ra = vrpRangeAt(c, a, in->block);
+        struct vrpRange rb = vrpRangeAt(c, b, in->block);
+        if (vrpIsEmpty(ra) || vrpIsEmpty(rb)) continue;
+        if (in->op == IR_BOUNDSCHECK) {
+            if (ra.lo < 0 || ra.hi >= rb.lo) continue;
+            IrRemoveInstr(f, i);
+            changed = true;
+            continue;
+        }
+        long long d;
+        int k = vrpIsConst(rb, &d) ? vrpLog2(d) : -1;
+        int decided = vrpDecide(in->opType, ra, rb);
+        if (decided >= 0) {
+            IrReplaceUses(f, i, vrpConstBefore(f, i, in->type, decided));
+            IrRemoveInstr(f, i);
+            changed = true;
+        }
+        else if ((in->opType == OPERATION_DIV || in->opType == OPERATION_MODULO) && k >= 0 && ra.lo >= 0) {
+            bool div = in->opType == OPERATION_DIV;
+            int operand = vrpConstBefore(f, i, IrGetInstr(f, b)->type, div ? k : d - 1);
+            in = IrGetInstr(f, i);
+            in->opType = div ? OPERATION_BITSHIFT_RIGHT : OPERATION_BITWISE_AND;
+            *(int*)ListGetIdx(&in->args, 1) = operand;
+            changed = true;
+        }
+    }
+
+    for (int b = 0; b < f->blocks.len; b++) {
+        int term = IrGetTerminator(f, b);
+        struct irInstr* in = term != IR_NONE ? IrGetInstr(f, term) : NULL;
+        if (!in || in->op != IR_CONDBR || in->targets[0] == in->targets[1]) continue;
+        struct irInstr* cond = IrGetInstr(f, *(int*)ListGetIdx(&in->args, 0));
+        if (cond->op != IR_CONST) continue;
+        IrDropTarget(f, term, cond->val ? 1 : 0);
+        changed = true;
+    }
+    return changed;
+}
+
+bool OptValueRanges(struct irFunc* f) {
+    int n = f->instrs.len;
+    struct vrpCtx c = {f, IrDominators(f), MallocOrCrash(n * sizeof(struct vrpRange) +1), CallocOrCrash(n * sizeof(int) +1)};
+    for (int i = 0; i < n; i++) c.ranges[i] = (struct vrpRange){1, 0};
+    struct list order = IrDomTreeOrder(f, &c.idoms);
+    vrpSolve(&c, &order);
+    bool changed = vrpApply(&c);
+    ListDestroy(order);
+    ListDestroy(c.idoms);
+    free(c.ranges);
+    free(c.nChanges);
+    return changed;
+}
+
+//for i = 0; i < 10; i++, the body tests i < 20 and computes i / 4 and i % 8
+TEST(OptValueRangesLoop) {
+    TypeId i32 = TypeVanillaId(BASETYPE_INT32);
+    TypeId boolType = TypeVanillaId(BASETYPE_BOOL);
+    struct type ret = TypeVanilla(BASETYPE_INT32);
+    struct var func;
+    struct irFunc* f = IrTestFunc(&func, "ranges", &ret, NULL, 0);
+    int header = IrAddBlock(f);
+    int body = IrAddBlock(f);
+    int then = IrAddBlock(f);
+    int latch = IrAddBlock(f);
+    int exit = IrAddBlock(f);
+    long long vals[6] = {0, 1, 10, 20, 4, 8};
+    int consts[6];
+    for (int i = 0; i < 6; i++) {
+        consts[i] = IrAddInstr(f, 0, IR_CONST, i32);
+        IrGetInstr(f, consts[i])->val = vals[i];
+    }
+    IrSetTargets(f, IrAddInstr(f, 0, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+
+    int phi = IrAddInstr(f, header, IR_PHI, i32);
+    int blocks[2] = {header, body};
+    int targets[2][2] = {{body, exit}, {then, latch}};
+    int conds[2];
+    for (int i = 0; i < 2; i++) {
+        conds[i] = IrAddInstr(f, blocks[i], IR_OPERATION, boolType);
+        IrGetInstr(f, conds[i])->opType = OPERATION_LESS_THAN;
+        IrAddArg(f, conds[i], phi);
+        IrAddArg(f, conds[i], consts[2 + i]);
+        int condBr = IrAddInstr(f, blocks[i], IR_CONDBR, TYPE_ID_NONE);
+        IrAddArg(f, condBr, conds[i]);
+        IrSetTargets(f, condBr, targets[i][0], targets[i][1]);
+    }
+
+    enum operation opTypes[3] = {OPERATION_DIV, OPERATION_MODULO, OPERATION_ADD};
+    int ops[3];
+    for (int i = 0; i < 3; i++) {
+        ops[i] = IrAddInstr(f, i < 2 ? then : latch, IR_OPERATION, i32);
+        IrGetInstr(f, ops[i])->opType = opTypes[i];
+        IrAddArg(f, ops[i], phi);
+        IrAddArg(f, ops[i], consts[i < 2 ? 4 + i : 1]);
+        if (i == 1) IrSetTargets(f, IrAddInstr(f, then, IR_BR, TYPE_ID_NONE), latch, IR_NONE);
+    }
+    IrSetTargets(f, IrAddInstr(f, latch, IR_BR, TYPE_ID_NONE), header, IR_NONE);
+    IrAddArg(f, phi, consts[0]);
+    IrAddArg(f, phi, ops[2]);
+    IrAddArg(f, IrAddInstr(f, exit, IR_RET, TYPE_ID_NONE), phi);
+
+    bool passed = OptValueRanges(f) && IrTestVerify(f);
+    passed = passed && IrGetInstr(f, conds[1])->block == IR_NONE && IrGetInstr(f, IrGetTerminator(f, body))->op == IR_BR;
+    passed = passed && IrGetInstr(f, conds[0])->block == header;
+    passed = passed && IrGetInstr(f, ops[0])->opType == OPERATION_BITSHIFT_RIGHT && IrGetInstr(f, ops[1])->opType == OPERATION_BITWISE_AND;
+    IrTestFuncDestroy(&func);
+    if (passed) TEST_PASSED;
+    TEST_FAILED;
+}